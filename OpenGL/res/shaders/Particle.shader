@@ -3,8 +3,14 @@
 
 // Input vertex data, different for all executions of this shader.
 layout(location = 0) in vec3 squareVertices;
-layout(location = 1) in vec4 xyzs; // Position of the center of the particule and size of the square
-layout(location = 2) in vec4 color; // Position of the center of the particule and size of the square
+layout(location = 1) in int particleIndex; // Particle drawn by this instance, back to front
+
+// Per particle data in texture buffers, from the first texel of this frame's region: position of the center of the
+// particle and size of the square, and color
+uniform samplerBuffer u_PositionSize;
+uniform samplerBuffer u_Colors;
+uniform int u_FirstPositionSize;
+uniform int u_FirstColor;
 
 // Output data ; will be interpolated for each fragment.
 out vec2 UV;
@@ -16,6 +22,8 @@ uniform vec3 CameraUp_worldspace;
 uniform mat4 VP; // Model-View-Projection matrix, but without the Model (the position is in BillboardPos; the orientation depends on the camera)
 
 void main() {
+	vec4 xyzs = texelFetch(u_PositionSize, u_FirstPositionSize + particleIndex);
+	vec4 color = texelFetch(u_Colors, u_FirstColor + particleIndex);
 	float particleSize = xyzs.w; // because we encoded it this way.
 	vec3 particleCenter_wordspace = xyzs.xyz;
 
@@ -0,0 +1,73 @@
+#varyings outPositionSize outVelocityLife outColor
+#shader vertex
+#version 330 core
+
+// One vertex per particle slot, drawn as points with rasterization off and the outputs captured by transform
+// feedback into the other set of state buffers. Mirrors ParticleBackend::GetSpawn and ParticleKernels::Simulate.
+layout(location = 0) in vec4 positionSize; // Size 0 once the particle has died
+layout(location = 1) in vec4 velocityLife;
+layout(location = 2) in uint color; // RGBA bytes
+
+out vec4 outPositionSize;
+out vec4 outVelocityLife;
+flat out uint outColor;
+
+uniform float u_DeltaTime;
+uniform vec3 u_VelocityStep; // Acceleration times the time step
+
+// Slots [u_EmitFirst, u_EmitFirst + u_EmitCount) of the ring are respawned this frame, with spawn ids from u_SpawnBase
+uniform uint u_Capacity;
+uniform uint u_EmitFirst;
+uniform uint u_EmitCount;
+uniform uint u_SpawnBase;
+
+uniform vec3 u_EmitterPosition;
+uniform vec3 u_EmitterVelocity;
+uniform float u_Spread;
+uniform float u_Lifetime;
+uniform float u_MinSize;
+uniform float u_MaxSize;
+
+// PCG hash (Jarzynski and Olano 2020)
+uint Hash(uint v) {
+	uint state = v * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+float Uniform(inout uint state) {
+	state = Hash(state);
+	return float(state >> 8u) * (1.0 / 16777216.0);
+}
+
+void main() {
+	vec3 position = positionSize.xyz;
+	float size = positionSize.w;
+	vec3 velocity = velocityLife.xyz;
+	float life = velocityLife.w;
+	uint rgba = color;
+
+	uint offset = (uint(gl_VertexID) + u_Capacity - u_EmitFirst) % u_Capacity;
+	if (offset < u_EmitCount) {
+		uint state = u_SpawnBase + offset;
+		float x = Uniform(state) * 2.0 - 1.0;
+		float y = Uniform(state) * 2.0 - 1.0;
+		float z = Uniform(state) * 2.0 - 1.0;
+		position = u_EmitterPosition;
+		velocity = u_EmitterVelocity + vec3(x, y, z) * u_Spread;
+		state = Hash(state);
+		rgba = (state & 0x00ffffffu) | (((state >> 24u) / 3u) << 24u);
+		size = u_MinSize + Uniform(state) * (u_MaxSize - u_MinSize);
+		life = u_Lifetime;
+	}
+
+	if (life > 0.0) {
+		life -= u_DeltaTime;
+		velocity += u_VelocityStep;
+		position += velocity * u_DeltaTime;
+	}
+
+	outPositionSize = vec4(position, life > 0.0 ? size : 0.0);
+	outVelocityLife = vec4(velocity, life);
+	outColor = rgba;
+}
@@ -0,0 +1,36 @@
+#shader vertex
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+
+uniform mat4 u_MVP;
+
+out vec3 v_Normal;
+out vec2 v_TexCoord;
+
+void main() {
+	v_Normal = normal;
+	v_TexCoord = texCoord;
+	gl_Position = u_MVP * vec4(position, 1.0);
+};
+
+#shader fragment
+#version 330 core
+
+in vec3 v_Normal;
+in vec2 v_TexCoord;
+
+layout(location = 0) out vec4 color;
+
+/* 0 shows the normal, 1 the texture coordinates */
+uniform int u_Mode;
+
+void main() {
+	if (u_Mode == 0) {
+		color = vec4(normalize(v_Normal) * 0.5 + 0.5, 1.0);
+	} else {
+		color = vec4(fract(v_TexCoord), 0.0, 1.0);
+	}
+};
@@ -15,6 +15,7 @@
 #include "VertexBufferLayout.h"
 #include "IndexBuffer.h"
 #include "Shader.h"
+#include "StreamingBuffer.h"
 #include "Texture.h"
 
 #include "tests/Test.h"
@@ -24,6 +25,7 @@
 #include "tests/TestParticle.h"
 #include "tests/TestTemplate.h"
 #include "tests/TestPhysics.h"
+#include "tests/TestBenchmark.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -32,6 +34,7 @@
 #include "App.h"
 
 #include "Mesh.h"
+#include "checks/Check.h"
 
 /* Forward declarations of camera-related input callbacks */
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -42,6 +45,7 @@ void processInput(GLFWwindow *window);
 
 Camera camera;
 float lastX, lastY;
+float cursorX = 0.0f, cursorY = 0.0f; // latest cursor position, for picking
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastTime = 0.0f;
 bool firstMouse = true;
@@ -49,8 +53,10 @@ bool mouseClickFlag = false;
 
 #define BASE_DPI 72.0f
 
-int main(void) {
+/* Starting with --check runs the self checks (see checks/Check.h) without showing the window and returns the number that failed */
+int main(int argc, char** argv) {
 	GLFWwindow* window;
+	const bool runChecks = argc > 1 && std::string(argv[1]) == "--check";
 
 	/* Initialize the library */
 	if (!glfwInit())
@@ -58,6 +64,9 @@ int main(void) {
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (runChecks) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
 	int windowWidth = 3 * GetSystemMetrics(SM_CXSCREEN) / 4;
 	int windowHeight = 3 * GetSystemMetrics(SM_CYSCREEN) / 4;
@@ -99,6 +108,12 @@ int main(void) {
 
 	std::cout << glGetString(GL_VERSION) << std::endl;
 
+	if (runChecks) {
+		const int numFailed = Check::RunAll(std::cout);
+		glfwTerminate();
+		return numFailed;
+	}
+
 	{ //Prevent infinite loop in glGetError calls by ensuring destructor (which?) is called 
 
 		GLCall(glEnable(GL_BLEND));
@@ -126,6 +141,7 @@ int main(void) {
 		testMenu->RegisterTest<Test::TestMesh>("Basic Mesh");
 		testMenu->RegisterTest<Test::TestParticle>("Particles");
 		testMenu->RegisterTest<Test::TestPhysics>("Physics");
+		testMenu->RegisterTest<Test::TestBenchmark>("Benchmarks");
 		//testMenu->RegisterTest<Test::TestTemplate>("Template");
 
 
@@ -147,6 +163,7 @@ int main(void) {
 			if (currentTest) {
 				currentTest->SetCamera(&camera);
 				currentTest->SetScreenSize(windowWidth, windowHeight);
+				currentTest->SetCursorPosition(cursorX, cursorY);
 				currentTest->OnUpdate(currentTime);
 				currentTest->OnRender();
 				ImGui::Begin("Begin Test");
@@ -169,6 +186,7 @@ int main(void) {
 
 			glfwSwapBuffers(window);
 			glfwPollEvents();
+			StreamingBuffer::EndFrame();
 		}
 
 		delete currentTest;
@@ -222,6 +240,8 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 void mouse_move_callback(GLFWwindow* window, double xpos, double ypos) {
 	float xposF = (float)xpos;
 	float yposF = (float)ypos;
+	cursorX = xposF;
+	cursorY = yposF;
 	if (mouseClickFlag) {
 		if (firstMouse) {
 			lastX = xposF;
@@ -1,21 +1,29 @@
 #include "Mesh.h"
 
-#include <chrono>
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <sstream>
 #include <cmath>
 
 #include "VertexBufferLayout.h"
+#include "io/ObjParser.h"
+#include "io/ObjVertexBuilder.h"
+#include "util/ThreadPool.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
 
-Mesh::Mesh(const std::string& filepath, unsigned int numInstances) : m_Filepath(filepath), m_NumInstances(numInstances) {
-	ParseMeshFile(filepath);
-	SetupMesh();
+Mesh::Mesh(const std::string& filepath, unsigned int numInstances, VertexFormat vertexFormat) : m_Filepath(filepath), m_NumInstances(numInstances), m_VertexFormat(vertexFormat) {
+	/* Use the cooked copy of the file when it is up to date, otherwise parse the source and cook it for next time */
+	MeshCache::CookedMesh cooked;
+	if (MeshCache::Load(filepath, cooked)) {
+		LoadCookedMesh(cooked);
+		SetupBuffers();
+	} else {
+		ParseMeshFile(filepath);
+		SetupMesh();
+		SaveCookedMesh();
+	}
 }
 
 Mesh::~Mesh() {
@@ -25,31 +33,52 @@ Mesh::~Mesh() {
 
 
 void Mesh::Update(float deltaTime, float scale, glm::vec3 trans, float angularVel, glm::vec3 rotAxis) {
-
-	// Define instance matrices
-	m_InstanceModelMatrices.clear();
-	m_InstanceMVPMatrices.clear();
-
+	// Every instance shares the rotation and scale, and is offset along trans by its index
+	m_InstanceTransforms.Resize(m_NumInstances);
+	glm::quat rotation = glm::angleAxis(angularVel*((float)deltaTime), glm::normalize(rotAxis));
 	for (unsigned int i = 0; i < m_NumInstances; i++) {
-		m_InstanceModelMatrices.push_back(glm::translate(glm::mat4(1.0f), trans + glm::vec3(trans.x*(float)i, trans.x*(float)i, trans.z*(float)i)));
-		m_InstanceMVPMatrices.push_back(glm::rotate(glm::mat4(1.0f), angularVel*((float)deltaTime), rotAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(scale, scale, scale)));
+		glm::vec3 position = trans + glm::vec3(trans.x*(float)i, trans.x*(float)i, trans.z*(float)i);
+		m_InstanceTransforms.Set(i, position, rotation, glm::vec3(scale));
 	}
+	UpdateInstances(m_InstanceTransforms.GetBatch());
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WORLD_MAT_VB]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_NumInstances, &m_InstanceModelMatrices[0], GL_DYNAMIC_DRAW);
+void Mesh::UpdateInstances(const TransformBatch& transforms) {
+	// Build the instance matrices straight into the streaming buffer
+	glm::mat4* instanceModelMatrices = (glm::mat4*)m_InstanceStream->Map(sizeof(glm::mat4) * m_NumInstances);
+	TransformKernels::BuildMatrices(transforms, instanceModelMatrices);
 
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WVP_MAT_VB]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_NumInstances, &m_InstanceMVPMatrices[0], GL_DYNAMIC_DRAW);
+	unsigned int offset = m_InstanceStream->Unmap();
+	m_VAO->Bind();
+	SetInstanceAttributes(offset);
+	m_VAO->Unbind();
+}
+
+/* Points the instance matrix attributes at the matrices written at offset in the streaming buffer (VAO must be bound) */
+void Mesh::SetInstanceAttributes(unsigned int offset) {
+	m_InstanceStream->Bind();
 
+	GLsizei vec4Size = sizeof(glm::vec4);
+	size_t modelOffset = offset;
+	for (int i = 0; i < 4; i++) {
+		glVertexAttribPointer(WORLD_LOCATION + i, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(modelOffset + i * vec4Size));
+	}
 }
 
 void Mesh::Draw(const Shader& shader) {
 	shader.Bind();
 	m_VAO->Bind();
+
+	/* The instance matrices already include rotation and scale, so the per-instance rotModel attribute is a constant identity */
+	for (int i = 0; i < 4; i++) {
+		glVertexAttrib4f(MVP_LOCATION + i, i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f, i == 3 ? 1.0f : 0.0f);
+	}
 	glDrawElementsInstanced(GL_TRIANGLES, m_VertexIndices.size(), GL_UNSIGNED_INT, 0, m_NumInstances);
+
+	/* The instance matrices of this frame may not be overwritten until the draw has completed */
+	m_InstanceStream->Fence();
 }
 
-/* Uses the structure of arrays approach (one array for each attribute type) */
 void Mesh::SetupMesh() {
 	// Create face structure for the mesh
 	CreateFaces();
@@ -57,8 +86,20 @@ void Mesh::SetupMesh() {
 	// Ensure that the winding order is correct 
 	//FixWinding();
 
+	SetupBuffers();
+}
 
+void Mesh::SetupBuffers() {
+	VertexSource source;
+	source.numVertices = GetNumVertices();
+	source.positions = m_Positions.data();
+	source.normals = m_Normals.size() >= m_Positions.size() ? m_Normals.data() : nullptr;
+	source.texCoords = m_TextureCoordinates.size() > 0 ? m_TextureCoordinates.data() : nullptr;
+	SetupBuffers(source);
+}
 
+/* Uploads the vertex attributes in m_VertexFormat */
+void Mesh::SetupBuffers(const VertexSource& source) {
 	/* Setup vertex array object */
 	m_VAO = std::make_unique<VertexArray>();
 	m_VAO->Bind();
@@ -66,62 +107,113 @@ void Mesh::SetupMesh() {
 	/* Create the array buffers for the vertex atttributes */
 	glGenBuffers(ARRAY_SIZE(m_Buffers), m_Buffers);
 
-	/* Reserve space in the vectors for the vertex attributes and indices */
-	// Generate and populate the buffers with vertex attributes and the indices
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[POS_VB]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(m_Positions[0]) * m_Positions.size(), &m_Positions[0], GL_STATIC_DRAW);
-	glEnableVertexAttribArray(POSITION_LOCATION);
-	glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[NORMAL_VB]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(m_Normals[0]) * m_Normals.size(), &m_Normals[0], GL_STATIC_DRAW);
-	glEnableVertexAttribArray(NORMAL_LOCATION);
-	glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	/* Setup texture coordinate array buffer */
-	if (m_TextureCoordinates.size() > 0) {
-		glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[TEXCOORD_VB]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(m_TextureCoordinates[0]) * m_TextureCoordinates.size(), &m_TextureCoordinates[0], GL_STATIC_DRAW);
-		glEnableVertexAttribArray(TEXTURE_LOCATION);
-		glVertexAttribPointer(TEXTURE_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	if (m_VertexFormat == VertexFormat::Separate) {
+		/* Uses the structure of arrays approach (one array for each attribute type), packing strided sources first */
+		std::vector<float> packed;
+		auto uploadAttribute = [&](unsigned int buffer, unsigned int location, int components, const float* data, int stride) {
+			if (stride != components) {
+				packed.resize(source.numVertices * components);
+				for (int v = 0; v < source.numVertices; v++) {
+					std::copy(data + v * stride, data + v * stride + components, &packed[v * components]);
+				}
+				data = packed.data();
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[buffer]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * components * source.numVertices, data, GL_STATIC_DRAW);
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, 0, 0);
+			m_GpuVertexBytes += sizeof(float) * components * source.numVertices;
+		};
+
+		m_GpuVertexBytes = 0;
+		uploadAttribute(POS_VB, POSITION_LOCATION, 3, source.positions, source.positionStride);
+		if (source.normals) {
+			uploadAttribute(NORMAL_VB, NORMAL_LOCATION, 3, source.normals, source.normalStride);
+		}
+		if (source.texCoords) {
+			uploadAttribute(TEXCOORD_VB, TEXTURE_LOCATION, 2, source.texCoords, source.texCoordStride);
+		}
+	} else {
+		EncodedVertices encoded;
+		VertexEncoder::Encode(m_VertexFormat, source, encoded);
+		m_GpuVertexBytes = encoded.data.size();
+		m_VertexBuffer = std::make_unique<VertexBuffer>(encoded.data.data(), (unsigned int)m_GpuVertexBytes);
+
+		VertexBufferLayout layout;
+		GetVertexLayout(m_VertexFormat, encoded, layout);
+		m_VAO->AddBuffer(*m_VertexBuffer, layout);
 	}
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Buffers[INDEX_BUFFER]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_VertexIndices[0]) * m_VertexIndices.size(), &m_VertexIndices[0], GL_STATIC_DRAW);
 
-	/* Bind the array buffer used for feeding instance matrices to the mesh shader */
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WORLD_MAT_VB]);
+	/* Instance matrices are streamed every frame (see Update) */
+	m_InstanceStream = std::make_unique<StreamingBuffer>(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_NumInstances);
 
-	/* Set the vertex attributes for the instanced matrices */
-	GLsizei vec4Size = sizeof(glm::vec4);
+	/* Set the vertex attributes for the instanced matrices (rotModel stays disabled, see Draw) */
 	for (int i = 0; i < 4; i++) {
-		int attributePosition = WORLD_LOCATION + i;
-		glEnableVertexAttribArray(attributePosition);
-		glVertexAttribPointer(attributePosition, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(i * vec4Size));
-		glVertexAttribDivisor(attributePosition, 1);
+		glEnableVertexAttribArray(WORLD_LOCATION + i);
+		glVertexAttribDivisor(WORLD_LOCATION + i, 1);
 	}
+	SetInstanceAttributes(0);
 
-	/* Bind the array buffer used for feeding instance matrices to the mesh shader */
-	glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[WVP_MAT_VB]);
+	m_VAO->Unbind();
+}
 
-	/* Set the vertex attributes for the instanced matrices */
-	for (int i = 0; i < 4; i++) {
-		int attributePosition = MVP_LOCATION + i;
-		glEnableVertexAttribArray(attributePosition);
-		glVertexAttribPointer(attributePosition, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(i * vec4Size));
-		glVertexAttribDivisor(attributePosition, 1);
+
+
+const MeshBVH& Mesh::GetBVH() {
+	if (m_BVH.IsEmpty() && !m_VertexIndices.empty()) {
+		m_BVH.Build(m_Positions, m_VertexIndices);
 	}
+	return m_BVH;
+}
 
-	m_VAO->Unbind();
+const SpatialProperties& Mesh::GetSpatialProperties() {
+	if (!m_HasSpatialProperties) {
+		m_SpatialProperties = ComputeSpatialProperties(m_Positions, &ThreadPool::Global());
+		m_HasSpatialProperties = true;
+	}
+	return m_SpatialProperties;
 }
 
+const ConvexHull& Mesh::GetConvexHull() {
+	if (!m_HasConvexHull) {
+		m_ConvexHull.Build(m_Positions, 0, &ThreadPool::Global());
+		m_HasConvexHull = true;
+	}
+	return m_ConvexHull;
+}
 
+Mesh::MemoryReport Mesh::GetMemoryReport() const {
+	MemoryReport report;
+	report.cpuVertices = (m_Positions.capacity() + m_Normals.capacity() + m_Tangents.capacity() + m_Bitangents.capacity()
+		+ m_TextureCoordinates.capacity() + m_Vertices.capacity()) * sizeof(float);
+	report.cpuIndices = (m_PositionIndices.capacity() + m_TextureIndices.capacity() + m_NormalIndices.capacity() + m_VertexIndices.capacity()) * sizeof(unsigned int);
+	report.cpuFaces = m_Faces.capacity() * sizeof(Face);
+	report.cpuAdjacency = m_Adjacency.GetMemoryUsage();
+	report.cpuBVH = m_BVH.GetMemoryUsage();
+	report.cpuHull = m_ConvexHull.GetMemoryUsage();
+	report.gpuVertices = m_GpuVertexBytes;
+	report.gpuIndices = m_VertexIndices.size() * sizeof(unsigned int);
+	return report;
+}
 
 void Mesh::CreateFaces() {
 	using namespace glm;
 
 	// Create faces
 	int numFaces = m_VertexIndices.size() / 3;
+	m_Faces.clear();
+	m_Faces.reserve(numFaces);
+
+	m_BoundsMin = m_BoundsMax = vec3(0.0f);
+	for (int v = 0; v < GetNumVertices(); v++) {
+		vec3 p = vec3(m_Positions[v * 3], m_Positions[v * 3 + 1], m_Positions[v * 3 + 2]);
+		m_BoundsMin = v == 0 ? p : min(m_BoundsMin, p);
+		m_BoundsMax = v == 0 ? p : max(m_BoundsMax, p);
+	}
+
 	for (int fIdx = 0; fIdx < numFaces; fIdx++) {
 		int i = m_VertexIndices[fIdx * 3];
 		int j = m_VertexIndices[fIdx * 3 + 1];
@@ -133,102 +225,94 @@ void Mesh::CreateFaces() {
 
 		float offset = -normal.x * p0.x - normal.y * p0.y - normal.z * p0.z;
 
-		Face f = { p0, p1, p2, normal, i, j, k, offset };
-		f.verts.insert(f.verts.begin(), { p0, p1, p2 }); //Add the positions to a vector for the purposes of inertia tensor computation (see InertiaTensor.h)
+		Face f = { p0, p1, p2, normal, i, j, k, offset, { MeshAdjacency::NO_NEIGHBOUR, MeshAdjacency::NO_NEIGHBOUR, MeshAdjacency::NO_NEIGHBOUR } };
 		m_Faces.push_back(f);
 
 	}
 
 	// Determine connectivity of faces by using the positions (since indices may not necessarily be shared if separate vertices between adjacent faces are used for lighting purposes, as in the case of the cube)
-	for (Face& face1 : m_Faces) {
-
-		// Search through all faces and find all edge neighbours (vertex neighbours are ignored)
-		for (Face& face2 : m_Faces) {
-			if (&face1 != &face2) {
-				int p0Match = (face1.p0 == face2.p0 || face1.p0 == face2.p1 || face1.p0 == face2.p2);
-				int p1Match = (face1.p1 == face2.p0 || face1.p1 == face2.p1 || face1.p1 == face2.p2);
-				int p2Match = (face1.p2 == face2.p0 || face1.p2 == face2.p1 || face1.p2 == face2.p2);
-
-				if (p0Match + p1Match + p2Match == 2) {
-					face1.neighbours.push_back(&face2);
-				}
-
-				//If three neighbours have been found, stop as there is no more point in searching
-				if (face1.neighbours.size() == 3) {
-					break;
-				}
-			}
+	m_Adjacency.Build(m_Positions, m_VertexIndices);
+	for (int fIdx = 0; fIdx < numFaces; fIdx++) {
+		for (int e = 0; e < 3; e++) {
+			m_Faces[fIdx].neighbours[e] = m_Adjacency.GetNeighbour(fIdx, e);
 		}
 	}
+
+	if (!m_Filepath.empty() && !m_Adjacency.IsClosedManifold()) {
+		std::cout << "Mesh " << m_Filepath << " has " << m_Adjacency.GetBoundaryEdges().size() << " boundary edges and "
+			<< m_Adjacency.GetNonManifoldEdges().size() << " non-manifold edges" << std::endl;
+	}
 }
 
 void Mesh::FixWinding() {
 	using namespace glm;
 
+	if (m_Faces.empty()) {
+		return;
+	}
 
-	//Systematically search all faces and correct the winding using the first face as the standard
+	//Systematically search all faces (breadth first over the edge adjacency) and correct the winding using the first face as the standard
 	Face* face = &m_Faces[0];
-	std::vector<Face*> checkedFaces;
-	std::vector<Face*> searchFaces;
-	checkedFaces.push_back(face);
-
-	searchFaces.insert(searchFaces.end(), face->neighbours.begin(), face->neighbours.end());
-	Face* searchFace;
-
-	while (searchFaces.size() > 0) {
-		searchFace = searchFaces[0];
-
-		if (std::find(checkedFaces.begin(), checkedFaces.end(), searchFace) == checkedFaces.end()) {
-			int p0Match = (face->p0 == searchFace->p0) + 2 * (face->p0 == searchFace->p1) + 3 * (face->p0 == searchFace->p2);
-			int p1Match = (face->p1 == searchFace->p0) + 2 * (face->p1 == searchFace->p1) + 3 * (face->p1 == searchFace->p2);
-			int p2Match = (face->p2 == searchFace->p0) + 2 * (face->p2 == searchFace->p1) + 3 * (face->p2 == searchFace->p2);
-
-			int first = 0;
-			int second = 0;
-
-			if (p0Match > 0 && p1Match > 0) {
-				//0-1 edge
-				first = p0Match;
-				second = p1Match;
-			} else if (p1Match > 0 && p2Match > 0) {
-				//1-2 edge
-				first = p1Match;
-				second = p2Match;
-			} else {
-				//2-0 edge
-				first = p2Match;
-				second = p0Match;
-			}
+	std::vector<char> checkedFaces(m_Faces.size(), 0);
+	std::vector<char> queuedFaces(m_Faces.size(), 0);
+	std::vector<int> searchFaces;
+	searchFaces.reserve(m_Faces.size());
+	checkedFaces[0] = queuedFaces[0] = 1;
+
+	for (int neighbour : face->neighbours) {
+		if (neighbour != MeshAdjacency::NO_NEIGHBOUR && !queuedFaces[neighbour]) {
+			queuedFaces[neighbour] = 1;
+			searchFaces.push_back(neighbour);
+		}
+	}
 
-			//If any of these orderings occur, it means that the vertex winding is not consistent with the current face
-			if ((first == 2 && second == 3) || (first == 2 && second == 3) || (first == 1 && second == 2)) {
-				//Correct the winding by swapping the ordering of the first two vertices (any pair will do) in the search face
-				int tempIndex = searchFace->i0;
-				searchFace->i0 = searchFace->i1;
-				searchFace->i1 = tempIndex;
+	for (size_t head = 0; head < searchFaces.size(); head++) {
+		int searchIndex = searchFaces[head];
+		Face* searchFace = &m_Faces[searchIndex];
+
+		int p0Match = (face->p0 == searchFace->p0) + 2 * (face->p0 == searchFace->p1) + 3 * (face->p0 == searchFace->p2);
+		int p1Match = (face->p1 == searchFace->p0) + 2 * (face->p1 == searchFace->p1) + 3 * (face->p1 == searchFace->p2);
+		int p2Match = (face->p2 == searchFace->p0) + 2 * (face->p2 == searchFace->p1) + 3 * (face->p2 == searchFace->p2);
+
+		int first = 0;
+		int second = 0;
+
+		if (p0Match > 0 && p1Match > 0) {
+			//0-1 edge
+			first = p0Match;
+			second = p1Match;
+		} else if (p1Match > 0 && p2Match > 0) {
+			//1-2 edge
+			first = p1Match;
+			second = p2Match;
+		} else {
+			//2-0 edge
+			first = p2Match;
+			second = p0Match;
+		}
 
-				//glm::vec3 tempPos = searchFace->p0;
-				//searchFace->p0 = searchFace->p1;
-				//searchFace->p1 = tempPos;
+		//If any of these orderings occur, it means that the vertex winding is not consistent with the current face
+		if ((first == 2 && second == 3) || (first == 2 && second == 3) || (first == 1 && second == 2)) {
+			//Correct the winding by swapping the ordering of the first two vertices (any pair will do) in the search face
+			int tempIndex = searchFace->i0;
+			searchFace->i0 = searchFace->i1;
+			searchFace->i1 = tempIndex;
 
-				searchFace->normal = glm::normalize(glm::cross(searchFace->p1 - searchFace->p0, searchFace->p2 - searchFace->p0));
-			}
+			//glm::vec3 tempPos = searchFace->p0;
+			//searchFace->p0 = searchFace->p1;
+			//searchFace->p1 = tempPos;
 
-			//Add the search face to the list of checked faces
-			checkedFaces.push_back(searchFace);
+			searchFace->normal = glm::normalize(glm::cross(searchFace->p1 - searchFace->p0, searchFace->p2 - searchFace->p0));
+		}
 
-			//Add the search faces neighbours to the list of search faces (if the neighbour is not already in the list)
-			for (Face* neighbour : searchFace->neighbours) {
-				bool checkedFlag = (std::find(checkedFaces.begin(), checkedFaces.end(), neighbour) == checkedFaces.end());
-				bool searchFlag = (std::find(searchFaces.begin(), searchFaces.end(), neighbour) == searchFaces.end());
-				if (checkedFlag && searchFlag) {
-					searchFaces.push_back(neighbour);
-				}
-			}
+		//Mark the search face as checked
+		checkedFaces[searchIndex] = 1;
 
-			ptrdiff_t pos = std::find(searchFaces.begin(), searchFaces.end(), searchFace) - searchFaces.begin();
-			if (pos < (ptrdiff_t)searchFaces.size()) {
-				searchFaces.erase(searchFaces.begin() + pos);
+		//Add the search faces neighbours to the list of search faces (if the neighbour is not already in the list)
+		for (int neighbour : searchFace->neighbours) {
+			if (neighbour != MeshAdjacency::NO_NEIGHBOUR && !checkedFaces[neighbour] && !queuedFaces[neighbour]) {
+				queuedFaces[neighbour] = 1;
+				searchFaces.push_back(neighbour);
 			}
 		}
 	}
@@ -246,157 +330,111 @@ void Mesh::FixWinding() {
 			m_Normals[j * 3 + 2] = m_Faces[fIdx].normal.z;
 		}
 	}
-
-	int ththt = 1;
 }
 
 
 
 
-enum AttributeType { NONE, POSITION, VERTEX_NORMAL, TEXTURE_UV_COORD, FACE };
-
-class VertexAttribute {
-public:
-	VertexAttribute(const std::string& type) {
-		if (type.find("v") != std::string::npos && type.size() == 1) {
-			at = POSITION; //Positions are given as "v" in Wavefront .OBJ 
-		} else if (type.find("vn") != std::string::npos) {
-			at = VERTEX_NORMAL;
-		} else if (type.find("vt") != std::string::npos) {
-			at = TEXTURE_UV_COORD;
-		} else if (type.find("f") != std::string::npos) {
-			at = FACE;
-		}
-	}
-	~VertexAttribute() {}
-	bool IsType(const AttributeType type) const { return type == at; }
-private:
-	AttributeType at;
-};
-
 void Mesh::ParseMeshFile(const std::string& filepath) {
-	using namespace std::literals::chrono_literals;
-	auto start = std::chrono::high_resolution_clock::now();
-	std::ifstream stream(filepath);
-
-	std::vector<float> normalsTemp;
-	std::vector<float> texCoordTemp;
-
-	//if (!stream) {
-		/* Set dimensions to zero so that the check for dimensionality will occur */
-	m_Dimensions = 0;
-	//std::vector<Texture> m_Textures;
-	std::string line;
-
-	while (getline(stream, line)) {
-		if (line.find("mtllib") != std::string::npos) {
-			//m_MaterialFilepath = line;
-		} else if (line.find("#") != std::string::npos) {
-
-		} else {
-			std::vector<std::string> tokens;
-			std::string token;
-			std::istringstream tokenStream(line);
-			std::getline(tokenStream, token, ' ');
-			VertexAttribute at = VertexAttribute(token);
-			int vertexCount = 1; //Used to check if we have a triangle or a quad (and hence need to add an additional vertex to convert to two triangles)
-
-			while (std::getline(tokenStream, token, ' ')) {
-
-				try {
-					if (at.IsType(AttributeType::POSITION)) {
-						m_Positions.push_back(std::stof(token));
-					} else if (at.IsType(AttributeType::VERTEX_NORMAL)) {
-						normalsTemp.push_back(std::stof(token));
-					} else if (at.IsType(AttributeType::TEXTURE_UV_COORD)) {
-						texCoordTemp.push_back(std::stof(token));
-					} else if (at.IsType(AttributeType::FACE)) {
-						/* Check if this is the 4th vertex, and, if so, copy the first and third previous indices to complete the triangle */
-						if (vertexCount > 3) {
-							/* TO convert a quad to two triangles, we first need to copy the previous indices */
-							m_VertexIndices.push_back(m_VertexIndices.back());
-							m_NormalIndices.push_back(m_NormalIndices.back());
-							if (m_TextureIndices.size() > 0) { m_TextureIndices.push_back(m_TextureIndices.back()); }
-						}
-
-						int firstSlash = token.find("/");
-						int secondSlash = token.find("/", firstSlash + 1);
-
-						/* Store indices, subtracting 1 because Wavefront .OBJ indices start at 1*/
-						std::string vertexIndex = token.substr(0, firstSlash);
-						m_VertexIndices.push_back(std::stoi(vertexIndex) - 1);
-
-						std::string normalIndex = token.substr(secondSlash + 1);
-						m_NormalIndices.push_back(std::stoi(normalIndex) - 1);
-
-						if (secondSlash - firstSlash != 1) {
-							std::string textureIndex = token.substr(firstSlash + 1, firstSlash + (secondSlash - firstSlash) - 1);
-							m_TextureIndices.push_back(std::stoi(textureIndex) - 1);
-						}
-
-						/* Check if this is the 4th vertex, and, if so, copy the first and third previous indices to complete the triangle */
-						if (vertexCount > 3) {
-							/* To convert a quad to two triangles, we then need to copy the first indices that we found in this line */
-							m_VertexIndices.push_back(m_VertexIndices[m_VertexIndices.size() - 5]);
-							m_NormalIndices.push_back(m_NormalIndices[m_NormalIndices.size() - 5]);
-							if (m_TextureIndices.size() > 0) { m_TextureIndices.push_back(m_TextureIndices[m_TextureIndices.size() - 5]); }
-						}
-
-						vertexCount++;
-					}
-				}
-				catch (...) {
-					std::cout << "Could not parse string: " << token << std::endl;
-				}
-			}
+	ThreadPool& pool = ThreadPool::Global();
+	ObjMeshData data;
+	if (!ObjParser::ParseFile(filepath, data, &pool)) {
+		std::cout << "Unable to read file " << m_Filepath << std::endl;
+		return;
+	}
 
-			/* Determine dimensionality using first position attribute that we encounter */
-			if (m_Dimensions == 0 && at.IsType(AttributeType::POSITION)) {
-				m_Dimensions = (int)m_Positions.size();
-			}
+	/* Give every distinct position/normal/uv combination its own vertex so seams keep both sets of attributes */
+	ObjVertexData vertices;
+	ObjVertexBuilder::Build(data, vertices, pool);
+
+	m_Dimensions = 3;
+	m_Positions = std::move(vertices.positions);
+	m_Normals = std::move(vertices.normals);
+	m_TextureCoordinates = std::move(vertices.texCoords);
+	m_VertexIndices = std::move(vertices.indices);
+	if (m_Normals.empty()) {
+		m_Normals.assign(m_Positions.size(), 0.0f);
+	}
 
-			//std::cout << std::endl;
+	std::cout << "Time to read file " << m_Filepath << ": " << data.parseSeconds << " s (" << data.GetThroughputMBs() << " MB/s)" << std::endl;
+}
 
-		}
+/* Specify the layout of the data in each vertex (position, normal, uv-coords) */
+void Mesh::GetVertexLayout(VertexFormat format, const EncodedVertices& encoded, VertexBufferLayout& layout) {
+	if (format == VertexFormat::Interleaved) {
+		layout.Push<float>(3);
+		layout.Push<float>(3);
+	} else {
+		layout.Push(GL_HALF_FLOAT, 4, GL_FALSE);
+		layout.Push(GL_INT_2_10_10_10_REV, 4, GL_TRUE);
 	}
 
+	switch (encoded.texCoordEncoding) {
+		case EncodedVertices::TEXCOORD_FLOAT:	layout.Push<float>(2); break;
+		case EncodedVertices::TEXCOORD_UNORM16:	layout.Push<unsigned short>(2); break;
+		case EncodedVertices::TEXCOORD_HALF:	layout.Push(GL_HALF_FLOAT, 2, GL_FALSE); break;
+		default: break;
+	}
+}
 
-	/* Map position and normal indices based on the face data */
-	for (int i = 0; i < (int)m_VertexIndices.size(); i++) {
-		if (m_VertexIndexMap_PositionNormal.find(m_VertexIndices[i]) == m_VertexIndexMap_PositionNormal.end()) {
-			m_VertexIndexMap_PositionNormal[m_VertexIndices[i]] = m_NormalIndices[i];
-		}
+/*
+	Rebuilds the CPU side data from a cooked file, leaving the mesh as a cold load does. Nothing is parsed or
+	recomputed: every array is stored in the layout Mesh keeps it in, so each one is a single copy out of the
+	mapping, and the faces take their planes and neighbours from the cooked data in one allocation.
+*/
+void Mesh::LoadCookedMesh(const MeshCache::CookedMesh& cooked) {
+	using namespace glm;
 
-		/* If there are UV coordinates, attempt to load an associated texture bearing the same file name */
-		if (m_TextureIndices.size() > 0) {
-			if (m_VertexIndexMap_PositionTexture.find(m_VertexIndices[i]) == m_VertexIndexMap_PositionTexture.end()) {
-				m_VertexIndexMap_PositionTexture[m_VertexIndices[i]] = m_TextureIndices[i];
-			}
+	const int numVertices = cooked.numVertices;
+	m_Dimensions = 3;
+	m_Positions.assign(cooked.positions, cooked.positions + numVertices * 3);
+	m_VertexIndices.assign(cooked.indices, cooked.indices + cooked.numIndices);
+	if (cooked.hasNormals) {
+		m_Normals.assign(cooked.normals, cooked.normals + numVertices * 3);
+	} else {
+		m_Normals.clear();
+	}
+	if (cooked.hasTexCoords) {
+		m_TextureCoordinates.assign(cooked.texCoords, cooked.texCoords + numVertices * 2);
+	} else {
+		m_TextureCoordinates.clear();
+	}
+	m_BoundsMin = cooked.boundsMin;
+	m_BoundsMax = cooked.boundsMax;
+	MeshCache::LoadAdjacency(cooked, m_Adjacency);
+	MeshCache::LoadConvexHull(cooked, m_ConvexHull);
+	m_HasConvexHull = true;
+
+	m_Faces.resize(cooked.numFaces);
+	for (int fIdx = 0; fIdx < cooked.numFaces; fIdx++) {
+		Face& f = m_Faces[fIdx];
+		f.i0 = m_VertexIndices[fIdx * 3];
+		f.i1 = m_VertexIndices[fIdx * 3 + 1];
+		f.i2 = m_VertexIndices[fIdx * 3 + 2];
+		f.p0 = vec3(cooked.positions[f.i0 * 3], cooked.positions[f.i0 * 3 + 1], cooked.positions[f.i0 * 3 + 2]);
+		f.p1 = vec3(cooked.positions[f.i1 * 3], cooked.positions[f.i1 * 3 + 1], cooked.positions[f.i1 * 3 + 2]);
+		f.p2 = vec3(cooked.positions[f.i2 * 3], cooked.positions[f.i2 * 3 + 1], cooked.positions[f.i2 * 3 + 2]);
+		f.normal = vec3(cooked.facePlanes[fIdx]);
+		f.offset = cooked.facePlanes[fIdx].w;
+		for (int e = 0; e < 3; e++) {
+			f.neighbours[e] = m_Adjacency.GetNeighbour(fIdx, e);
 		}
 	}
+}
 
-
-	/* Store everything in the same order */
-
-	for (int i = 0; i < (int)m_VertexIndexMap_PositionNormal.size(); i++) {
-		int j = m_VertexIndexMap_PositionNormal[i] * 3;
-		m_Normals.push_back(normalsTemp[j]);
-		m_Normals.push_back(normalsTemp[j + 1]);
-		m_Normals.push_back(normalsTemp[j + 2]);
-	}
-	for (int i = 0; i < (int)m_VertexIndexMap_PositionTexture.size(); i++) {
-		int j = m_VertexIndexMap_PositionTexture[i] * 2;
-		m_TextureCoordinates.push_back(texCoordTemp[j]);
-		m_TextureCoordinates.push_back(texCoordTemp[j + 1]);
+void Mesh::SaveCookedMesh() {
+	if (m_Positions.empty()) {
+		return;
 	}
 
-	auto end = std::chrono::high_resolution_clock::now();
+	std::vector<glm::vec4> facePlanes(m_Faces.size());
+	for (size_t fIdx = 0; fIdx < m_Faces.size(); fIdx++) {
+		facePlanes[fIdx] = glm::vec4(m_Faces[fIdx].normal, m_Faces[fIdx].offset);
+	}
 
-	std::chrono::duration<float> duration = end - start;
-	std::cout << "Time to read file " << m_Filepath << ": " << duration.count() << " s" << std::endl;
-	//} else {
-	//	std::cout << "Unable to read file " << m_Filepath << std::endl;
-	//}
+	if (!MeshCache::Save(m_Filepath, m_Positions, m_Normals, m_TextureCoordinates, m_VertexIndices, facePlanes, m_Adjacency, m_BoundsMin, m_BoundsMax, GetConvexHull())) {
+		std::cout << "Unable to cook mesh " << m_Filepath << std::endl;
+	}
 }
 
 
@@ -3,7 +3,16 @@
 
 #include "Renderer.h"
 #include "Shader.h"
+#include "StreamingBuffer.h"
 #include "Texture.h"
+#include "VertexBufferLayout.h"
+#include "VertexFormat.h"
+#include "geometry/ConvexHull.h"
+#include "geometry/Geometry.h"
+#include "geometry/MeshAdjacency.h"
+#include "geometry/MeshBVH.h"
+#include "geometry/TransformBatch.h"
+#include "io/MeshCache.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -29,8 +38,7 @@
 		glm::vec3 p0, p1, p2, normal;
 		int i0, i1, i2;
 		float offset;
-		std::vector<Face*> neighbours;
-		std::vector<glm::vec3> verts;
+		int neighbours[3]; //Face across edges p0-p1, p1-p2 and p2-p0 (MeshAdjacency::NO_NEIGHBOUR if none)
 	};
 
 	class Mesh {
@@ -40,24 +48,55 @@
 
 		/* Instance data */
 		unsigned int m_NumInstances;
-		std::vector<glm::mat4> m_InstanceMVPMatrices;
-		std::vector<glm::mat4> m_InstanceModelMatrices;
 
 		
 
 		/*  Functions  */
-		Mesh(unsigned int numInstances) : m_NumInstances(numInstances) {}
-		Mesh(const std::string& filepath, unsigned int numInstances = 1);
+		/* Bytes held by a mesh, on the CPU and in GPU buffers */
+		struct MemoryReport {
+			size_t cpuVertices = 0; //Attribute arrays
+			size_t cpuIndices = 0;
+			size_t cpuFaces = 0; //Face structures
+			size_t cpuAdjacency = 0;
+			size_t cpuBVH = 0; //Ray casting tree, once built
+			size_t cpuHull = 0; //Convex hull, once built or loaded
+			size_t gpuVertices = 0;
+			size_t gpuIndices = 0;
+
+			size_t GetCpuTotal() const { return cpuVertices + cpuIndices + cpuFaces + cpuAdjacency + cpuBVH + cpuHull; }
+			size_t GetGpuTotal() const { return gpuVertices + gpuIndices; }
+		};
+
+		Mesh(unsigned int numInstances, VertexFormat vertexFormat = VertexFormat::Interleaved) : m_NumInstances(numInstances), m_VertexFormat(vertexFormat) {}
+		Mesh(const std::string& filepath, unsigned int numInstances = 1, VertexFormat vertexFormat = VertexFormat::Interleaved);
 		~Mesh();
 		void Update(float deltaTime, float scale, glm::vec3 trans, float angularVel, glm::vec3 rotAxis);
+		/* Streams one translation/rotation/scale per instance (transforms.count must equal the instance count) */
+		void UpdateInstances(const TransformBatch& transforms);
 		void Draw(const Shader& shader);
 		void SetColor(float r, float g, float b, float a) { m_Color.x = r; m_Color.y = g; m_Color.z = b; m_Color.w = a; }
 		glm::vec4 GetColor() { return m_Color; }
 		Face& GetFace(int faceIndex) { return m_Faces[faceIndex]; }
+		const std::vector<Face>& GetFaces() const { return m_Faces; }
 		int GetNumFaces() { return m_Faces.size(); }
 		int GetNumVertices() { return (int) (m_Positions.size() / 3); }
 		std::vector<float>& GetPositions() { return m_Positions; }
 		std::vector<unsigned int>& GetIndices() { return m_VertexIndices; }
+		const std::vector<float>& GetNormals() const { return m_Normals; }
+		const std::vector<float>& GetTextureCoordinates() const { return m_TextureCoordinates; }
+		const MeshAdjacency& GetAdjacency() const { return m_Adjacency; }
+		/* Ray casting tree over the faces (face i is triangle i of GetIndices()), built on first use */
+		const MeshBVH& GetBVH();
+		/* Bounds, centroid, principal axes and oriented bounding box of the vertices, computed on first use */
+		const SpatialProperties& GetSpatialProperties();
+		/* Convex hull of the vertices, built on first use and stored in the cooked file (empty for flat meshes) */
+		const ConvexHull& GetConvexHull();
+		const glm::vec3& GetBoundsMin() const { return m_BoundsMin; }
+		const glm::vec3& GetBoundsMax() const { return m_BoundsMax; }
+		VertexFormat GetVertexFormat() const { return m_VertexFormat; }
+		MemoryReport GetMemoryReport() const;
+		/* Vertex attribute layout of an Interleaved or Compact buffer produced by VertexEncoder */
+		static void GetVertexLayout(VertexFormat format, const EncodedVertices& encoded, VertexBufferLayout& layout);
 
 		/* Factory functions */
 		static Mesh* Plane(unsigned int numInstances) {
@@ -267,10 +306,10 @@
 			/* Bottom point of sphere */
 			sphere->m_Positions.insert(sphere->m_Positions.end(), { 0.0f, -1.0f, 0.0f });
 
-			/* Indices for sphere top */
-			for (unsigned int sIdx = 0; sIdx < sphereDiv + 1; sIdx++) {
+			/* Indices for sphere top (every triangle is counter-clockwise seen from outside) */
+			for (unsigned int sIdx = 0; sIdx < sphereDiv; sIdx++) {
 				unsigned int thirdIndex = sIdx + 2;
-				sphere->m_VertexIndices.insert(sphere->m_VertexIndices.end(), { 0, sIdx + 1, (thirdIndex > sphereDiv ? 1 : thirdIndex) });
+				sphere->m_VertexIndices.insert(sphere->m_VertexIndices.end(), { 0, (thirdIndex > sphereDiv ? 1 : thirdIndex), sIdx + 1 });
 			}
 
 			/* Indices for inner sphere rings */
@@ -288,11 +327,11 @@
 
 					/* Bottom triangle */
 					sphere->m_VertexIndices.insert(sphere->m_VertexIndices.end(),
-						{ bIdx, highIndex - 1, sharedIndex });
+						{ bIdx, sharedIndex, highIndex - 1 });
 
 					/* Top triangle */
 					sphere->m_VertexIndices.insert(sphere->m_VertexIndices.end(),
-						{ bIdx, sharedIndex, lowIndex });
+						{ bIdx, lowIndex, sharedIndex });
 
 				}
 			}
@@ -310,7 +349,6 @@
 			sphere->m_Dimensions = 3;
 			unsigned int numVertices = sphere->m_Positions.size() / 3;
 			for (unsigned int i = 0; i < numVertices; i++) {
-				sphere->m_VertexIndexMap_PositionNormal[i] = i;
 				int pIdx = (i * 3);
 				glm::vec3 norm = glm::normalize(glm::vec3(sphere->m_Positions[pIdx], sphere->m_Positions[pIdx + 1], sphere->m_Positions[pIdx + 2]));
 				sphere->m_Normals.insert(sphere->m_Normals.end(), { norm.x, norm.y, norm.z });
@@ -325,6 +363,15 @@
 	private:
 
 		std::vector<Face> m_Faces;
+		MeshAdjacency m_Adjacency;
+		MeshBVH m_BVH;
+		SpatialProperties m_SpatialProperties;
+		bool m_HasSpatialProperties = false;
+		ConvexHull m_ConvexHull;
+		bool m_HasConvexHull = false;
+		glm::vec3 m_BoundsMin, m_BoundsMax;
+		VertexFormat m_VertexFormat = VertexFormat::Interleaved;
+		size_t m_GpuVertexBytes = 0;
 
 		//  Mesh Data 
 		unsigned int m_Dimensions = 0;
@@ -335,8 +382,6 @@
 		std::vector<float> m_Bitangents;
 		std::vector<float> m_TextureCoordinates;
 		std::vector<float> m_Vertices;
-		std::unordered_map<int, int> m_VertexIndexMap_PositionNormal;
-		std::unordered_map<int, int> m_VertexIndexMap_PositionTexture;
 
 		std::vector<unsigned int> m_PositionIndices;
 		std::vector<unsigned int> m_TextureIndices;
@@ -346,7 +391,8 @@
 
 		/* Instance data */
 		std::unique_ptr<VertexArray> m_InstanceVAO;
-		std::unique_ptr<VertexBuffer> m_InstanceBuffer;
+		std::unique_ptr<StreamingBuffer> m_InstanceStream; //Model matrices, rewritten every Update
+		TransformArrays m_InstanceTransforms; //Scratch input for Update
 
 		/* Texture data */
 		std::unique_ptr<Texture> m_Texture;
@@ -363,7 +409,12 @@
 
 		/*  Functions */
 		void ParseMeshFile(const std::string& filepath);
+		void LoadCookedMesh(const MeshCache::CookedMesh& cooked);
+		void SaveCookedMesh();
 		void SetupMesh();
+		void SetupBuffers();
+		void SetupBuffers(const VertexSource& source);
 		void CreateFaces();
 		void FixWinding();
+		void SetInstanceAttributes(unsigned int offset);
 	};
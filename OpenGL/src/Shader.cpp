@@ -43,6 +43,10 @@ void Shader::SetUniform1i(const std::string& name, int v0) {
 	GLCall(glUniform1i(GetUniformLocation(name), v0));
 }
 
+void Shader::SetUniform1ui(const std::string& name, unsigned int v0) {
+	GLCall(glUniform1ui(GetUniformLocation(name), v0));
+}
+
 void Shader::SetUniform1b(const std::string& name, bool v0) {
 	GLCall(glUniform1i(GetUniformLocation(name), (int) v0));
 }
@@ -76,10 +80,18 @@ ShaderProgramSource Shader::ParseShader(const std::string& filepath) {
 
 	std::string line;
 	std::stringstream ss[3];
+	std::vector<std::string> varyings;
 	ShaderType type = ShaderType::NONE;
 
 	while (getline(stream, line)) {
-		if (line.find("#shader") != std::string::npos) {
+		if (line.find("#varyings") == 0) {
+			std::stringstream names(line.substr(9));
+			std::string name;
+			while (names >> name) {
+				varyings.push_back(name);
+			}
+		}
+		else if (line.find("#shader") != std::string::npos) {
 			if (line.find("vertex") != std::string::npos) {
 				type = ShaderType::VERTEX;
 			}
@@ -95,7 +107,7 @@ ShaderProgramSource Shader::ParseShader(const std::string& filepath) {
 		}
 	}
 
-	return { filepath, ss[0].str(), ss[1].str(), ss[2].str() };
+	return { filepath, ss[0].str(), ss[1].str(), ss[2].str(), varyings };
 }
 
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source) {
@@ -142,6 +154,14 @@ unsigned int Shader::CreateShader(const ShaderProgramSource& source) {
 	if (gs != 0) { GLCall(glAttachShader(program, gs)); std::cout << "-->attached geometry shader" << std::endl; }
 	if (fs != 0) { GLCall(glAttachShader(program, fs)); std::cout << "-->attached fragment shader" << std::endl; }
 
+	if (!source.FeedbackVaryings.empty()) {
+		std::vector<const char*> names;
+		for (const std::string& name : source.FeedbackVaryings) {
+			names.push_back(name.c_str());
+		}
+		GLCall(glTransformFeedbackVaryings(program, (GLsizei)names.size(), names.data(), GL_SEPARATE_ATTRIBS));
+	}
+
 	GLCall(glLinkProgram(program));
 	GLCall(glValidateProgram(program));
 
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
 struct ShaderProgramSource {
@@ -9,6 +10,7 @@ struct ShaderProgramSource {
 	std::string VertexSource;
 	std::string GeometrySource;
 	std::string FragmentSource;
+	std::vector<std::string> FeedbackVaryings; //From a "#varyings a b c" line: captured by transform feedback, one buffer each
 };
 
 
@@ -31,6 +33,7 @@ public:
 	void SetUniform3f(const std::string & name, glm::vec3 v);
 	void SetUniform1f(const std::string& name, float v0);
 	void SetUniform1i(const std::string & name, int v0);
+	void SetUniform1ui(const std::string & name, unsigned int v0);
 	void SetUniform1b(const std::string & name, bool v0);
 	void SetUniformMat4f(const std::string & name, const glm::mat4 matrix);
 
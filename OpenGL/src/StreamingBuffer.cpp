@@ -0,0 +1,122 @@
+#include "StreamingBuffer.h"
+#include "Renderer.h"
+
+#include <chrono>
+
+StreamingBuffer::Stats StreamingBuffer::s_CurrentFrame;
+StreamingBuffer::Stats StreamingBuffer::s_LastFrame;
+
+StreamingBuffer::StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int numRegions, bool allowPersistent)
+	: m_Target(target), m_RegionSize(0), m_NumRegions(numRegions), m_Persistent(allowPersistent && GLEW_ARB_buffer_storage) {
+	m_Fences.assign(m_NumRegions, nullptr);
+	Allocate(regionSize > 0 ? regionSize : 1);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	Release();
+}
+
+void StreamingBuffer::Allocate(unsigned int regionSize) {
+	m_RegionSize = regionSize;
+	GLCall(glGenBuffers(1, &m_RendererID));
+	GLCall(glBindBuffer(m_Target, m_RendererID));
+
+	if (m_Persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = (GLsizeiptr)m_RegionSize * m_NumRegions;
+		GLCall(glBufferStorage(m_Target, size, nullptr, flags));
+		GLCall(m_Mapping = (unsigned char*)glMapBufferRange(m_Target, 0, size, flags));
+	} else {
+		GLCall(glBufferData(m_Target, m_RegionSize, nullptr, GL_STREAM_DRAW));
+		m_Staging.resize(m_RegionSize);
+	}
+}
+
+void StreamingBuffer::Release() {
+	for (unsigned int region = 0; region < m_NumRegions; region++) {
+		if (m_Fences[region]) {
+			glDeleteSync(m_Fences[region]);
+			m_Fences[region] = nullptr;
+		}
+	}
+
+	if (m_Mapping) {
+		GLCall(glBindBuffer(m_Target, m_RendererID));
+		GLCall(glUnmapBuffer(m_Target));
+		m_Mapping = nullptr;
+	}
+	GLCall(glDeleteBuffers(1, &m_RendererID));
+	m_RendererID = 0;
+}
+
+void StreamingBuffer::WaitForRegion(unsigned int region) {
+	GLsync fence = m_Fences[region];
+	if (!fence) {
+		return;
+	}
+
+	/* Poll first so that only real stalls are counted */
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		auto start = std::chrono::high_resolution_clock::now();
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1 ms
+		} while (result == GL_TIMEOUT_EXPIRED);
+		std::chrono::duration<double, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+		s_CurrentFrame.fenceWaits++;
+		s_CurrentFrame.fenceWaitMs += waited.count();
+	}
+
+	glDeleteSync(fence);
+	m_Fences[region] = nullptr;
+}
+
+void* StreamingBuffer::Map(unsigned int size) {
+	if (size > m_RegionSize) {
+		/* Grow with some headroom; the regions still in flight belong to the old buffer and are released with it */
+		Release();
+		Allocate(size + size / 2);
+	}
+
+	m_MappedSize = size;
+	if (!m_Persistent) {
+		return m_Staging.data();
+	}
+
+	m_Region = (m_Region + 1) % m_NumRegions;
+	WaitForRegion(m_Region);
+	return m_Mapping + (size_t)m_Region * m_RegionSize;
+}
+
+unsigned int StreamingBuffer::Unmap() {
+	s_CurrentFrame.bytesUploaded += m_MappedSize;
+	if (m_Persistent) {
+		/* The mapping is coherent, so the writes are visible to commands issued from here on */
+		return m_Region * m_RegionSize;
+	}
+
+	GLCall(glBindBuffer(m_Target, m_RendererID));
+	GLCall(glBufferData(m_Target, m_RegionSize, nullptr, GL_STREAM_DRAW)); //Orphan the storage the GPU may still be reading
+	GLCall(glBufferSubData(m_Target, 0, m_MappedSize, m_Staging.data()));
+	return 0;
+}
+
+void StreamingBuffer::Fence() {
+	if (!m_Persistent) {
+		return;
+	}
+
+	if (m_Fences[m_Region]) {
+		glDeleteSync(m_Fences[m_Region]);
+	}
+	m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamingBuffer::Bind() const {
+	GLCall(glBindBuffer(m_Target, m_RendererID));
+}
+
+void StreamingBuffer::EndFrame() {
+	s_LastFrame = s_CurrentFrame;
+	s_CurrentFrame = Stats();
+}
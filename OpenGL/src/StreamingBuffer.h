@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct __GLsync;
+
+/*
+	Ring of buffer regions for data rewritten every frame (instance matrices, particles). Each Map() moves to the next
+	of numRegions regions, so the CPU writes one region while the GPU may still be reading the previous ones.
+
+	With ARB_buffer_storage the buffer is mapped once (persistent and coherent) and Map() returns a pointer straight
+	into it; a fence placed after the draws that read a region (Fence()) is waited on before that region is written
+	again. Without it (plain GL 3.3) Map() returns a CPU staging area and Unmap() orphans the buffer and uploads the
+	data with glBufferSubData, which never stalls but copies once more.
+*/
+class StreamingBuffer {
+public:
+	/* Counters summed over every streaming buffer */
+	struct Stats {
+		size_t bytesUploaded = 0;
+		unsigned int fenceWaits = 0; //Maps that had to wait for the GPU to release a region
+		double fenceWaitMs = 0.0;
+	};
+
+	StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int numRegions = 3, bool allowPersistent = true);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	/* Starts writing size bytes into the next region (growing the regions if needed) and returns where to write them */
+	void* Map(unsigned int size);
+
+	/* Finishes the write started by Map() and returns the byte offset of the data in the buffer */
+	unsigned int Unmap();
+
+	/* Marks the current region as read by the draw calls issued so far */
+	void Fence();
+
+	void Bind() const;
+	inline unsigned int GetRendererID() const { return m_RendererID; }
+	inline unsigned int GetRegionSize() const { return m_RegionSize; }
+	inline bool IsPersistent() const { return m_Persistent; }
+
+	/* Totals of the last completed frame; EndFrame() is called once per frame by the application loop */
+	static const Stats& GetFrameStats() { return s_LastFrame; }
+	static void EndFrame();
+
+private:
+	unsigned int m_RendererID = 0;
+	unsigned int m_Target;
+	unsigned int m_RegionSize;
+	unsigned int m_NumRegions;
+	unsigned int m_Region = 0;
+	unsigned int m_MappedSize = 0;
+	bool m_Persistent;
+
+	unsigned char* m_Mapping = nullptr; //Persistent mapping of the whole buffer
+	std::vector<unsigned char> m_Staging; //Write area for the orphaning fallback
+	std::vector<__GLsync*> m_Fences; //One per region, null when the region is free
+
+	static Stats s_CurrentFrame, s_LastFrame;
+
+	void Allocate(unsigned int regionSize);
+	void Release();
+	void WaitForRegion(unsigned int region);
+};
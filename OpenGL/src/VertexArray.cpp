@@ -14,14 +14,12 @@ void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& la
 	Bind();
 	vb.Bind();
 	const auto& elements = layout.GetElements();
-	unsigned int offset = 0;
 	for (unsigned int i = 0; i < elements.size(); i++) {
 		const auto& element = elements[i];
 
 		if (element.type != GL_MATRIX4_NV) {
 			GLCall(glEnableVertexAttribArray(i));
-			GLCall(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.GetStride(), (const void*)offset));
-			offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
+			GLCall(glVertexAttribPointer(i, element.count, element.type, element.normalized, layout.GetStride(), (const void*)layout.GetOffset(i)));
 		} else {
 			/* Instance mode: Filling a matrix into the vertex buffer requires providing four vec 4s, one four each column */
 			unsigned int instanceOffset = 0;
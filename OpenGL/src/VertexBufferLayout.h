@@ -14,10 +14,23 @@ struct VertexBufferElement {
 			case GL_FLOAT:				return 4;
 			case GL_UNSIGNED_INT:		return 4;
 			case GL_UNSIGNED_BYTE:		return 1;
+			case GL_HALF_FLOAT:			return 2;
+			case GL_SHORT:				return 2;
+			case GL_UNSIGNED_SHORT:		return 2;
+			case GL_INT_2_10_10_10_REV:	return 4; //All four components share one 32 bit word
 		}
 		ASSERT(false);
 		return 0;
 	}
+
+	static bool IsPackedType(unsigned int type) {
+		return type == GL_INT_2_10_10_10_REV;
+	}
+
+	/* Size of the whole element in bytes */
+	unsigned int GetSize() const {
+		return IsPackedType(type) ? GetSizeOfType(type) : count * GetSizeOfType(type);
+	}
 };
 
 class VertexBufferLayout {
@@ -28,37 +41,65 @@ public:
 	VertexBufferLayout() : m_Stride(0) {}
 	~VertexBufferLayout() {}
 
+	/* Specialized below for float, unsigned int, unsigned char, unsigned short, short and glm::mat4 */
 	template<typename T>
 	void Push(unsigned int count) {
-		static_assert(false);
+		static_assert(sizeof(T) == 0, "VertexBufferLayout::Push has no specialization for this type");
 	}
 
-	template<>
-	void Push<float>(unsigned int count) {
-		m_Elements.push_back({ GL_FLOAT, count, GL_FALSE });
-		m_Stride += count * VertexBufferElement::GetSizeOfType(GL_FLOAT);
+	/* Types without a C++ counterpart (GL_HALF_FLOAT, GL_INT_2_10_10_10_REV) */
+	void Push(unsigned int type, unsigned int count, unsigned char normalized) {
+		VertexBufferElement element = { type, count, normalized };
+		m_Elements.push_back(element);
+		m_Stride += element.GetSize();
 	}
 
-	template<>
-	void Push<unsigned int>(unsigned int count) {
-		m_Elements.push_back({ GL_UNSIGNED_INT, count, GL_FALSE });
-		m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT);
-	}
+	inline const std::vector<VertexBufferElement> GetElements() const { return m_Elements; }
+	inline unsigned int GetStride() const { return m_Stride; }
 
-	template<>
-	void Push<unsigned char>(unsigned int count) {
-		m_Elements.push_back({ GL_UNSIGNED_BYTE, count, GL_TRUE });
-		m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
+	/* Byte offset of element index within a vertex */
+	unsigned int GetOffset(unsigned int index) const {
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < index && i < m_Elements.size(); i++) {
+			offset += m_Elements[i].GetSize();
+		}
+		return offset;
 	}
 
-	template<>
-	void Push<glm::mat4>(unsigned int count) {
-		m_Elements.push_back({ GL_MATRIX4_NV, 4*count, GL_FALSE });
-		m_Stride += 64;
-	}
+};
 
-	inline const std::vector<VertexBufferElement> GetElements() const { return m_Elements; }
-	inline unsigned int GetStride() const { return m_Stride; }
+template<>
+inline void VertexBufferLayout::Push<float>(unsigned int count) {
+	m_Elements.push_back({ GL_FLOAT, count, GL_FALSE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_FLOAT);
+}
 
-};
+template<>
+inline void VertexBufferLayout::Push<unsigned int>(unsigned int count) {
+	m_Elements.push_back({ GL_UNSIGNED_INT, count, GL_FALSE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned char>(unsigned int count) {
+	m_Elements.push_back({ GL_UNSIGNED_BYTE, count, GL_TRUE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned short>(unsigned int count) {
+	m_Elements.push_back({ GL_UNSIGNED_SHORT, count, GL_TRUE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_SHORT);
+}
+
+template<>
+inline void VertexBufferLayout::Push<short>(unsigned int count) {
+	m_Elements.push_back({ GL_SHORT, count, GL_TRUE });
+	m_Stride += count * VertexBufferElement::GetSizeOfType(GL_SHORT);
+}
 
+template<>
+inline void VertexBufferLayout::Push<glm::mat4>(unsigned int count) {
+	m_Elements.push_back({ GL_MATRIX4_NV, 4*count, GL_FALSE });
+	m_Stride += 64;
+}
@@ -0,0 +1,158 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void VertexEncoder::Encode(VertexFormat format, const VertexSource& source, EncodedVertices& encoded) {
+	const int numVertices = source.numVertices;
+	const bool hasTexCoords = source.texCoords != nullptr;
+
+	if (format == VertexFormat::Compact) {
+		/* Unsigned normalized uvs only when every uv lies in [0, 1] */
+		encoded.texCoordEncoding = EncodedVertices::TEXCOORD_NONE;
+		if (hasTexCoords) {
+			encoded.texCoordEncoding = EncodedVertices::TEXCOORD_UNORM16;
+			for (int v = 0; v < numVertices; v++) {
+				const float* uv = source.texCoords + v * source.texCoordStride;
+				if (uv[0] < 0.0f || uv[0] > 1.0f || uv[1] < 0.0f || uv[1] > 1.0f) {
+					encoded.texCoordEncoding = EncodedVertices::TEXCOORD_HALF;
+					break;
+				}
+			}
+		}
+
+		encoded.stride = 8 + 4 + (hasTexCoords ? 4 : 0);
+		encoded.data.assign((size_t)numVertices * encoded.stride, 0);
+		const uint16_t one = FloatToHalf(1.0f);
+		for (int v = 0; v < numVertices; v++) {
+			unsigned char* vertex = &encoded.data[(size_t)v * encoded.stride];
+			const float* p = source.positions + v * source.positionStride;
+			uint16_t position[4] = { FloatToHalf(p[0]), FloatToHalf(p[1]), FloatToHalf(p[2]), one };
+			std::memcpy(vertex, position, sizeof(position));
+
+			uint32_t normal = 0;
+			if (source.normals) {
+				const float* n = source.normals + v * source.normalStride;
+				normal = PackNormal(glm::vec3(n[0], n[1], n[2]));
+			}
+			std::memcpy(vertex + 8, &normal, sizeof(normal));
+
+			if (hasTexCoords) {
+				const float* uv = source.texCoords + v * source.texCoordStride;
+				uint16_t texCoord[2];
+				for (int i = 0; i < 2; i++) {
+					texCoord[i] = encoded.texCoordEncoding == EncodedVertices::TEXCOORD_UNORM16
+						? (uint16_t)std::lround(uv[i] * 65535.0f) : FloatToHalf(uv[i]);
+				}
+				std::memcpy(vertex + 12, texCoord, sizeof(texCoord));
+			}
+		}
+		return;
+	}
+
+	/* Interleaved (Separate is uploaded by Mesh directly and never encoded) */
+	encoded.texCoordEncoding = hasTexCoords ? EncodedVertices::TEXCOORD_FLOAT : EncodedVertices::TEXCOORD_NONE;
+	const int floatsPerVertex = hasTexCoords ? 8 : 6;
+	encoded.stride = floatsPerVertex * sizeof(float);
+	encoded.data.assign((size_t)numVertices * encoded.stride, 0);
+	for (int v = 0; v < numVertices; v++) {
+		float* vertex = (float*)&encoded.data[(size_t)v * encoded.stride];
+		std::memcpy(vertex, source.positions + v * source.positionStride, 3 * sizeof(float));
+		if (source.normals) {
+			std::memcpy(vertex + 3, source.normals + v * source.normalStride, 3 * sizeof(float));
+		}
+		if (hasTexCoords) {
+			std::memcpy(vertex + 6, source.texCoords + v * source.texCoordStride, 2 * sizeof(float));
+		}
+	}
+}
+
+/* Round to nearest even, with overflow to infinity and gradual underflow to half denormals */
+uint16_t VertexEncoder::FloatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	if (magnitude >= 0x7f800000) {
+		return (uint16_t)(sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00)); //NaN or infinity
+	}
+	if (magnitude >= 0x477ff000) {
+		return (uint16_t)(sign | 0x7c00); //Rounds to a value beyond the largest half
+	}
+	if (magnitude < 0x38800000) {
+		if (magnitude < 0x33000000) {
+			return (uint16_t)sign; //Below half the smallest denormal
+		}
+		/* Denormal: shift the mantissa (with its implicit one) into place and round */
+		uint32_t exponent = magnitude >> 23;
+		uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+		uint32_t shift = 126 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))) {
+			half++;
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((magnitude - 0x38000000) >> 13);
+	uint32_t remainder = magnitude & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+		half++;
+	}
+	return (uint16_t)(sign | half);
+}
+
+float VertexEncoder::HalfToFloat(uint16_t value) {
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0) {
+		float denormal = std::ldexp((float)mantissa, -24);
+		return sign ? -denormal : denormal;
+	} else if (exponent == 31) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+/* x, y, z in signed normalized 10 bit fields (GL_INT_2_10_10_10_REV), w left at zero */
+uint32_t VertexEncoder::PackNormal(const glm::vec3& normal) {
+	uint32_t packed = 0;
+	for (int i = 0; i < 3; i++) {
+		int component = (int)std::lround(std::min(std::max(normal[i], -1.0f), 1.0f) * 511.0f);
+		packed |= ((uint32_t)component & 0x3ff) << (i * 10);
+	}
+	return packed;
+}
+
+glm::vec3 VertexEncoder::UnpackNormal(uint32_t packed) {
+	glm::vec3 normal;
+	for (int i = 0; i < 3; i++) {
+		int component = (int)((packed >> (i * 10)) & 0x3ff);
+		if (component & 0x200) {
+			component -= 0x400;
+		}
+		normal[i] = std::max(component / 511.0f, -1.0f);
+	}
+	return normal;
+}
+
+const char* VertexEncoder::GetName(VertexFormat format) {
+	switch (format) {
+		case VertexFormat::Separate:	return "separate float";
+		case VertexFormat::Interleaved:	return "interleaved float";
+		case VertexFormat::Compact:		return "compact";
+	}
+	return "unknown";
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/* How Mesh lays out its vertex attributes on the GPU */
+enum class VertexFormat {
+	Separate, //One float buffer per attribute (structure of arrays)
+	Interleaved, //Position, normal and uv floats interleaved in one buffer (32 bytes per vertex)
+	Compact //Half float positions, 10:10:10:2 normals and 16 bit uvs in one buffer (16 bytes per vertex)
+};
+
+/* Float attribute arrays to encode from. Strides are in floats so that interleaved sources can be read in place */
+struct VertexSource {
+	int numVertices = 0;
+	const float* positions = nullptr;
+	const float* normals = nullptr; //May be null (encoded as zero normals)
+	const float* texCoords = nullptr; //May be null
+	int positionStride = 3, normalStride = 3, texCoordStride = 2;
+};
+
+/* A single interleaved vertex buffer produced by VertexEncoder */
+struct EncodedVertices {
+	enum TexCoordEncoding { TEXCOORD_NONE, TEXCOORD_FLOAT, TEXCOORD_UNORM16, TEXCOORD_HALF };
+
+	std::vector<unsigned char> data;
+	unsigned int stride = 0;
+	TexCoordEncoding texCoordEncoding = TEXCOORD_NONE;
+};
+
+/*
+	Packs vertex attributes into the Interleaved or Compact formats. In the compact format positions are stored as
+	four half floats (the fourth is 1.0 and keeps the normal 4 byte aligned), normals as signed normalized
+	GL_INT_2_10_10_10_REV and uvs as unsigned normalized shorts. Uvs outside [0, 1] (wrapping textures) fall back to
+	half floats. Every compact attribute is expanded by the vertex fetch, so shaders read them as ordinary floats.
+*/
+class VertexEncoder {
+public:
+	static void Encode(VertexFormat format, const VertexSource& source, EncodedVertices& encoded);
+
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t value);
+	static uint32_t PackNormal(const glm::vec3& normal);
+	static glm::vec3 UnpackNormal(uint32_t packed);
+
+	static const char* GetName(VertexFormat format);
+};
@@ -0,0 +1,966 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "Mesh.h"
+#include "geometry/ConvexHull.h"
+#include "geometry/Geometry.h"
+#include "geometry/IntersectKernels.h"
+#include "geometry/MeshAdjacency.h"
+#include "geometry/MeshBVH.h"
+#include "geometry/Picker.h"
+#include "geometry/SignedDistanceField.h"
+#include "geometry/TransformBatch.h"
+#include "geometry/WindingNumberQuery.h"
+#include "io/MeshCache.h"
+#include "util/ThreadPool.h"
+
+#include "WindingNumber/UT_BVHImpl.h"
+#include "WindingNumber/UT_ParallelUtil.h"
+#include "WindingNumber/UT_SolidAngle.h"
+
+#include "Eigen/Dense"
+
+/* After the vendor headers: Intersect.h pulls glm into the global namespace, whose int64 clashes with SYS_Types.h */
+#include "geometry/Intersect.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+namespace Benchmark {
+
+	/* Above this many faces the quadratic reference loop is skipped (res256 would take minutes) */
+	static const int BRUTE_FORCE_FACE_LIMIT = 20000;
+
+	/* The original O(F^2) loop from Mesh::CreateFaces, kept as the reference for timing and validation */
+	static std::vector<std::vector<int>> BruteForceNeighbours(const std::vector<float>& pos, const std::vector<unsigned int>& inds) {
+		using namespace glm;
+		int numFaces = (int)inds.size() / 3;
+		std::vector<vec3> p(inds.size());
+		for (int i = 0; i < (int)inds.size(); i++) {
+			p[i] = vec3(pos[inds[i] * 3], pos[inds[i] * 3 + 1], pos[inds[i] * 3 + 2]);
+		}
+
+		std::vector<std::vector<int>> neighbours(numFaces);
+		for (int f1 = 0; f1 < numFaces; f1++) {
+			for (int f2 = 0; f2 < numFaces; f2++) {
+				if (f1 != f2) {
+					const vec3* a = &p[f1 * 3];
+					const vec3* b = &p[f2 * 3];
+					int p0Match = (a[0] == b[0] || a[0] == b[1] || a[0] == b[2]);
+					int p1Match = (a[1] == b[0] || a[1] == b[1] || a[1] == b[2]);
+					int p2Match = (a[2] == b[0] || a[2] == b[1] || a[2] == b[2]);
+
+					if (p0Match + p1Match + p2Match == 2) {
+						neighbours[f1].push_back(f2);
+					}
+
+					if (neighbours[f1].size() == 3) {
+						break;
+					}
+				}
+			}
+		}
+		return neighbours;
+	}
+
+	static void ReportAdjacency(std::ostream& out, const std::string& name, const std::vector<float>& pos, const std::vector<unsigned int>& inds) {
+		int numFaces = (int)inds.size() / 3;
+		MeshAdjacency adjacency;
+		int iterations = numFaces < 10000 ? 20 : 5;
+		double hashMs = TimeMs([&]() { adjacency.Build(pos, inds); }, iterations);
+
+		out << name << ": " << numFaces << " faces, " << adjacency.GetNumWeldedVertices() << " welded vertices, "
+			<< adjacency.GetBoundaryEdges().size() << " boundary / " << adjacency.GetNonManifoldEdges().size() << " non-manifold edges" << std::endl;
+		out << "  edge hash:   " << hashMs << " ms (" << adjacency.GetMemoryUsage() / 1024 << " KB)" << std::endl;
+
+		if (numFaces > BRUTE_FORCE_FACE_LIMIT) {
+			out << "  brute force: skipped (more than " << BRUTE_FORCE_FACE_LIMIT << " faces)" << std::endl;
+			return;
+		}
+
+		std::vector<std::vector<int>> reference;
+		double bruteMs = TimeMs([&]() { reference = BruteForceNeighbours(pos, inds); });
+
+		/* Compare neighbour sets face by face (ordering differs between the two approaches) */
+		int mismatches = 0;
+		for (int f = 0; f < numFaces; f++) {
+			std::vector<int> fast;
+			for (int e = 0; e < 3; e++) {
+				if (adjacency.GetNeighbour(f, e) != MeshAdjacency::NO_NEIGHBOUR) {
+					fast.push_back(adjacency.GetNeighbour(f, e));
+				}
+			}
+			std::vector<int> ref = reference[f];
+			std::sort(fast.begin(), fast.end());
+			std::sort(ref.begin(), ref.end());
+			mismatches += (fast != ref);
+		}
+
+		out << "  brute force: " << bruteMs << " ms (speedup " << bruteMs / hashMs << "x), " << mismatches << " faces differ" << std::endl;
+	}
+
+	void RunAdjacency(std::ostream& out) {
+		for (const std::string& asset : MeshAssets()) {
+			Mesh mesh(asset);
+			ReportAdjacency(out, asset, mesh.GetPositions(), mesh.GetIndices());
+		}
+
+		const Mesh::SphereDivisions resolutions[] = { Mesh::res16, Mesh::res32, Mesh::res64, Mesh::res128, Mesh::res256 };
+		for (Mesh::SphereDivisions res : resolutions) {
+			std::unique_ptr<Mesh> sphere(Mesh::Sphere(res, 1));
+			ReportAdjacency(out, "sphere res" + std::to_string((int)res), sphere->GetPositions(), sphere->GetIndices());
+		}
+	}
+
+	void RunTransformBatch(std::ostream& out) {
+		const int numInstances = 100000;
+		const int iterations = 20;
+
+		/* Random instance transforms */
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		TransformArrays transforms;
+		transforms.Resize(numInstances);
+		std::vector<glm::vec3> axes(numInstances);
+		std::vector<float> angles(numInstances);
+		for (int i = 0; i < numInstances; i++) {
+			glm::vec3 position(uniform(rng) * 100.0f, uniform(rng) * 100.0f, uniform(rng) * 100.0f);
+			axes[i] = glm::normalize(glm::vec3(uniform(rng), uniform(rng), uniform(rng)) + glm::vec3(0.0f, 0.0f, 1.5f));
+			angles[i] = uniform(rng) * 3.14159265f;
+			glm::vec3 scale(1.0f + uniform(rng) * 0.5f, 1.0f + uniform(rng) * 0.5f, 1.0f + uniform(rng) * 0.5f);
+			transforms.Set(i, position, glm::angleAxis(angles[i], axes[i]), scale);
+		}
+		TransformBatch batch = transforms.GetBatch();
+
+		/* The glm path, as Mesh::Update built its matrices before the batch kernel */
+		std::vector<glm::mat4> reference(numInstances);
+		double glmMs = TimeMs([&]() {
+			for (int i = 0; i < numInstances; i++) {
+				glm::vec3 position(batch.px[i], batch.py[i], batch.pz[i]);
+				glm::vec3 scale(batch.sx[i], batch.sy[i], batch.sz[i]);
+				reference[i] = glm::translate(glm::mat4(1.0f), position) * glm::rotate(glm::mat4(1.0f), angles[i], axes[i]) * glm::scale(glm::mat4(1.0f), scale);
+			}
+		}, iterations);
+		out << numInstances << " instance matrices" << std::endl;
+		out << "  glm:    " << glmMs << " ms (" << numInstances / (glmMs * 1000.0) << " M matrices/s)" << std::endl;
+
+		std::vector<glm::mat4> scalar(numInstances);
+		TransformKernels::BuildMatrices(batch, scalar.data(), TransformKernels::Path::Scalar);
+
+		const TransformKernels::Path paths[] = { TransformKernels::Path::Scalar, TransformKernels::Path::SSE, TransformKernels::Path::AVX2 };
+		for (TransformKernels::Path path : paths) {
+			const char* name = TransformKernels::GetName(path);
+			if (!TransformKernels::IsSupported(path)) {
+				out << "  " << name << ": not supported by this CPU" << std::endl;
+				continue;
+			}
+
+			std::vector<glm::mat4> matrices(numInstances);
+			double ms = TimeMs([&]() { TransformKernels::BuildMatrices(batch, matrices.data(), path); }, iterations);
+
+			float maxError = 0.0f;
+			for (int i = 0; i < numInstances; i++) {
+				for (int c = 0; c < 4; c++) {
+					for (int r = 0; r < 4; r++) {
+						maxError = std::max(maxError, std::abs(matrices[i][c][r] - reference[i][c][r]));
+					}
+				}
+			}
+			bool matchesScalar = std::memcmp(matrices.data(), scalar.data(), sizeof(glm::mat4) * numInstances) == 0;
+
+			out << "  " << name << ": " << ms << " ms (" << numInstances / (ms * 1000.0) << " M matrices/s, speedup " << glmMs / ms
+				<< "x), max error vs glm " << maxError << (matchesScalar ? "" : ", DIFFERS FROM SCALAR") << std::endl;
+		}
+	}
+
+	/* Closed torus with 2 * rings * sides triangles, big enough for the parallel build paths to kick in */
+	static void GenerateTorus(int rings, int sides, std::vector<HDK_Sample::UT_Vector3T<float>>& positions, std::vector<int>& triangles) {
+		const float twoPi = 6.28318531f;
+		positions.clear();
+		triangles.clear();
+		for (int i = 0; i < rings; i++) {
+			float u = twoPi * i / rings;
+			for (int j = 0; j < sides; j++) {
+				float v = twoPi * j / sides;
+				float p[3] = { (1.0f + 0.35f * std::cos(v)) * std::cos(u), (1.0f + 0.35f * std::cos(v)) * std::sin(u), 0.35f * std::sin(v) };
+				positions.push_back(HDK_Sample::UT_Vector3T<float>(p));
+			}
+		}
+		for (int i = 0; i < rings; i++) {
+			for (int j = 0; j < sides; j++) {
+				int a = i * sides + j;
+				int b = ((i + 1) % rings) * sides + j;
+				int c = ((i + 1) % rings) * sides + (j + 1) % sides;
+				int d = i * sides + (j + 1) % sides;
+				triangles.insert(triangles.end(), { a, b, c, a, c, d });
+			}
+		}
+	}
+
+	void RunWindingNumberBuild(std::ostream& out) {
+		using namespace HDK_Sample;
+		typedef UT::BVH<4> Tree;
+
+		std::vector<UT_Vector3T<float>> positions;
+		std::vector<int> triangles;
+		GenerateTorus(1024, 512, positions, triangles);
+		const int numTriangles = (int)triangles.size() / 3;
+
+		std::vector<UT::Box<float, 3>> boxes(numTriangles);
+		for (int i = 0; i < numTriangles; i++) {
+			boxes[i].initBounds(positions[triangles[i * 3]]);
+			boxes[i].enlargeBounds(positions[triangles[i * 3 + 1]]);
+			boxes[i].enlargeBounds(positions[triangles[i * 3 + 2]]);
+		}
+
+		/* Query points inside the tube, at the hole and outside, to check the precomputed expansions */
+		float queries[][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.9f, 0.1f }, { 3.0f, 1.0f, 0.5f } };
+		const int numQueries = sizeof(queries) / sizeof(queries[0]);
+
+		out << "torus: " << numTriangles << " triangles, " << positions.size() << " points" << std::endl;
+
+		/* Powers of two up to the machine's thread count, plus the thread count itself */
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned int> threadCounts;
+		for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		/* The single-threaded results are the reference every other thread count must reproduce bit for bit */
+		std::vector<Tree::Node> referenceNodes;
+		std::vector<float> referenceAngles;
+		double serialBuildMs = 0.0;
+		double serialInitMs = 0.0;
+
+		for (unsigned int threads : threadCounts) {
+			ThreadPool pool(threads);
+			UT_ThreadPoolScope scope(pool);
+
+			Tree tree;
+			double buildMs = TimeMs([&]() { tree.init<UT::BVH_Heuristic::BOX_AREA, float, 3>(boxes.data(), numTriangles); }, 3);
+			std::vector<Tree::Node> nodes(tree.getNodes(), tree.getNodes() + tree.getNumNodes());
+
+			/* Triangle boxes, BVH build and the multipole precompute */
+			UT_SolidAngle<float, float> solidAngle;
+			double initMs = TimeMs([&]() { solidAngle.init(numTriangles, triangles.data(), (int)positions.size(), positions.data(), 2); });
+			std::vector<float> angles(numQueries);
+			for (int q = 0; q < numQueries; q++) {
+				angles[q] = solidAngle.computeSolidAngle(UT_Vector3T<float>(queries[q]));
+			}
+
+			if (threads == 1) {
+				referenceNodes = nodes;
+				referenceAngles = angles;
+				serialBuildMs = buildMs;
+				serialInitMs = initMs;
+				out << "  winding numbers:";
+				for (float angle : angles) {
+					out << " " << angle / (2.0f * 6.28318531f);
+				}
+				out << std::endl;
+			}
+
+			bool sameTree = nodes.size() == referenceNodes.size() && std::memcmp(nodes.data(), referenceNodes.data(), nodes.size() * sizeof(Tree::Node)) == 0;
+			bool sameAngles = std::memcmp(angles.data(), referenceAngles.data(), numQueries * sizeof(float)) == 0;
+
+			out << "  " << threads << " thread(s): BVH " << buildMs << " ms (" << serialBuildMs / buildMs << "x, " << nodes.size() << " nodes), "
+				<< "solid angle init " << initMs << " ms (" << serialInitMs / initMs << "x), "
+				<< (sameTree && sameAngles ? "matches serial" : "DIFFERS from serial") << std::endl;
+		}
+	}
+
+	/* Inside test for the torus GenerateTorus builds (major radius 1, minor radius 0.35, around z) */
+	static bool InsideTorus(float x, float y, float z) {
+		float ring = std::sqrt(x * x + y * y) - 1.0f;
+		return ring * ring + z * z < 0.35f * 0.35f;
+	}
+
+	void RunWindingNumberQueries(std::ostream& out) {
+		std::vector<HDK_Sample::UT_Vector3T<float>> torusPositions;
+		std::vector<int> torusTriangles;
+		GenerateTorus(256, 128, torusPositions, torusTriangles);
+
+		std::vector<float> positions;
+		for (const HDK_Sample::UT_Vector3T<float>& p : torusPositions) {
+			positions.insert(positions.end(), { p[0], p[1], p[2] });
+		}
+		std::vector<unsigned int> indices(torusTriangles.begin(), torusTriangles.end());
+
+		WindingNumberQuery query;
+		double buildMs = TimeMs([&]() { query.Build(positions, indices); });
+
+		/* Random points over the torus' bounding box (plus a margin), in no particular order */
+		const int numPoints = 250000;
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> uniformXY(-1.6f, 1.6f);
+		std::uniform_real_distribution<float> uniformZ(-0.6f, 0.6f);
+		std::vector<float> x(numPoints), y(numPoints), z(numPoints);
+		for (int i = 0; i < numPoints; i++) {
+			x[i] = uniformXY(rng);
+			y[i] = uniformXY(rng);
+			z[i] = uniformZ(rng);
+		}
+		PointBatch points;
+		points.x = x.data(); points.y = y.data(); points.z = z.data();
+		points.count = numPoints;
+
+		out << "torus: " << query.GetNumFaces() << " triangles (built in " << buildMs << " ms), " << numPoints << " random query points" << std::endl;
+
+		/* The single point loop is the reference for speed and for the results */
+		std::vector<float> reference(numPoints);
+		double loopMs = TimeMs([&]() {
+			for (int i = 0; i < numPoints; i++) {
+				reference[i] = query.Compute(glm::vec3(x[i], y[i], z[i]));
+			}
+		});
+		out << "  single point loop: " << loopMs << " ms (" << numPoints / (loopMs / 1000.0) / 1.0e6 << " M points/s)" << std::endl;
+
+		int misclassified = 0;
+		for (int i = 0; i < numPoints; i++) {
+			misclassified += (std::abs(reference[i]) >= WindingNumberQuery::INSIDE_THRESHOLD) != InsideTorus(x[i], y[i], z[i]);
+		}
+		out << "  " << misclassified << " points classified differently from the analytic torus (tessellation error)" << std::endl;
+
+		/* Powers of two up to the machine's thread count, plus the thread count itself */
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned int> threadCounts;
+		for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		for (unsigned int threads : threadCounts) {
+			ThreadPool pool(threads);
+			std::vector<float> windingNumbers(numPoints);
+			std::vector<uint8_t> inside(numPoints);
+			double batchMs = TimeMs([&]() { query.ComputeBatch(points, windingNumbers.data(), pool); });
+			double classifyMs = TimeMs([&]() { query.ClassifyBatch(points, inside.data(), pool); });
+
+			bool match = std::memcmp(windingNumbers.data(), reference.data(), numPoints * sizeof(float)) == 0;
+			for (int i = 0; i < numPoints; i++) {
+				match &= inside[i] == (std::abs(reference[i]) >= WindingNumberQuery::INSIDE_THRESHOLD ? 1 : 0);
+			}
+
+			out << "  " << threads << " thread(s): batch " << batchMs << " ms (" << numPoints / (batchMs / 1000.0) / 1.0e6 << " M points/s, "
+				<< loopMs / batchMs << "x), classify " << classifyMs << " ms, " << (match ? "matches single point loop" : "DIFFERS from single point loop") << std::endl;
+		}
+	}
+
+	/* Rays from a sphere around the mesh towards random points inside its bounding box, so most (not all) hit */
+	static std::vector<Ray> RandomRays(const glm::vec3& boundsMin, const glm::vec3& boundsMax, int count) {
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = glm::length(boundsMax - boundsMin);
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::normal_distribution<float> normal;
+
+		std::vector<Ray> rays(count);
+		for (Ray& ray : rays) {
+			glm::vec3 onSphere = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng)));
+			glm::vec3 target = boundsMin + (boundsMax - boundsMin) * glm::vec3(unit(rng), unit(rng), unit(rng));
+			ray.origin = center + onSphere * radius;
+			ray.direction = glm::normalize(target - ray.origin);
+		}
+		return rays;
+	}
+
+	/* The per-face loop the tree replaces: every triangle is tested and the nearest hit is kept */
+	static bool BruteForceClosestHit(const std::vector<float>& pos, const std::vector<unsigned int>& inds, const Ray& ray, RayHit& hit) {
+		auto vertex = [&pos](unsigned int i) { return glm::vec3(pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]); };
+		bool found = false;
+		float closestT = ray.tMax;
+		for (int f = 0; f < (int)inds.size() / 3; f++) {
+			float t, u, v;
+			const glm::vec3 v0 = vertex(inds[f * 3]);
+			if (Intersect::RayTriangleIntersect(ray.origin, ray.direction, v0, vertex(inds[f * 3 + 1]) - v0, vertex(inds[f * 3 + 2]) - v0,
+				ray.tMin, closestT, false, t, u, v)) {
+				closestT = t;
+				hit.face = f; hit.t = t; hit.u = u; hit.v = v;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	static void ReportRayCasting(std::ostream& out, const std::string& name, Mesh& mesh) {
+		const std::vector<float>& pos = mesh.GetPositions();
+		const std::vector<unsigned int>& inds = mesh.GetIndices();
+
+		MeshBVH bvh;
+		double buildMs = TimeMs([&]() { bvh.Build(pos, inds); }, 5);
+		out << name << ": " << bvh.GetNumFaces() << " faces, " << bvh.GetNodes().size() << " nodes, depth " << bvh.GetDepth()
+			<< " (built in " << buildMs << " ms, " << bvh.GetMemoryUsage() / 1024 << " KB)" << std::endl;
+
+		const int numRays = 200000;
+		std::vector<Ray> rays = RandomRays(mesh.GetBoundsMin(), mesh.GetBoundsMax(), numRays);
+
+		std::vector<RayHit> hits(numRays);
+		std::vector<uint8_t> found(numRays), anyFound(numRays);
+		double closestMs = TimeMs([&]() {
+			for (int i = 0; i < numRays; i++) {
+				found[i] = bvh.ClosestHit(rays[i], hits[i]) ? 1 : 0;
+			}
+		});
+		double anyMs = TimeMs([&]() {
+			for (int i = 0; i < numRays; i++) {
+				anyFound[i] = bvh.AnyHit(rays[i]) ? 1 : 0;
+			}
+		});
+		int numHits = 0, anyMismatches = 0;
+		for (int i = 0; i < numRays; i++) {
+			numHits += found[i];
+			anyMismatches += found[i] != anyFound[i];
+		}
+
+		out << "  closest hit: " << numRays / (closestMs / 1000.0) / 1.0e6 << " M rays/s (" << numHits << " of " << numRays << " rays hit)" << std::endl;
+		out << "  any hit:     " << numRays / (anyMs / 1000.0) / 1.0e6 << " M rays/s, " << anyMismatches << " disagreements with closest hit" << std::endl;
+
+		/* The brute force loop is O(faces) per ray, so it only runs over enough rays to time and validate */
+		const int numBruteRays = std::max(100, std::min(numRays, 200000000 / std::max(1, bvh.GetNumFaces())));
+		std::vector<RayHit> reference(numBruteRays);
+		std::vector<uint8_t> referenceFound(numBruteRays);
+		double bruteMs = TimeMs([&]() {
+			for (int i = 0; i < numBruteRays; i++) {
+				referenceFound[i] = BruteForceClosestHit(pos, inds, rays[i], reference[i]) ? 1 : 0;
+			}
+		});
+
+		/* Faces may legitimately differ where the ray crosses a shared edge, at exactly the same t */
+		int mismatches = 0, edgeTies = 0;
+		for (int i = 0; i < numBruteRays; i++) {
+			if (found[i] != referenceFound[i] || (found[i] && hits[i].t != reference[i].t)) {
+				mismatches++;
+			} else if (found[i] && hits[i].face != reference[i].face) {
+				edgeTies++;
+			}
+		}
+		double bruteRaysPerSec = numBruteRays / (bruteMs / 1000.0);
+		out << "  brute force: " << bruteRaysPerSec / 1.0e6 << " M rays/s over " << numBruteRays << " rays ("
+			<< (numRays / (closestMs / 1000.0)) / bruteRaysPerSec << "x slower than closest hit), "
+			<< (mismatches == 0 ? "identical" : std::to_string(mismatches) + " MISMATCHES") << ", " << edgeTies << " ties on shared edges" << std::endl;
+	}
+
+	void RunRayCasting(std::ostream& out) {
+		Mesh suzanne("res/meshes/suzanne.obj");
+		ReportRayCasting(out, "res/meshes/suzanne.obj", suzanne);
+
+		std::unique_ptr<Mesh> sphere(Mesh::Sphere(Mesh::res256, 1));
+		ReportRayCasting(out, "sphere res256", *sphere);
+	}
+
+	static bool SameHit(bool foundA, const RayHit& a, bool foundB, const RayHit& b) {
+		return foundA == foundB && (!foundA || (a.face == b.face && a.t == b.t && a.u == b.u && a.v == b.v));
+	}
+
+	void RunIntersectKernels(std::ostream& out) {
+		Mesh mesh("res/meshes/suzanne.obj");
+		const std::vector<float>& pos = mesh.GetPositions();
+		const std::vector<unsigned int>& inds = mesh.GetIndices();
+		auto vertex = [&pos](unsigned int i) { return glm::vec3(pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]); };
+
+		const int numFaces = (int)inds.size() / 3;
+		TriangleArrays triangleArrays;
+		triangleArrays.Resize(numFaces);
+		for (int f = 0; f < numFaces; f++) {
+			triangleArrays.Set(f, vertex(inds[f * 3]), vertex(inds[f * 3 + 1]), vertex(inds[f * 3 + 2]));
+		}
+		TrianglePacket triangles = triangleArrays.GetPacket();
+
+		const int numRays = 4096;
+		std::vector<Ray> rays = RandomRays(mesh.GetBoundsMin(), mesh.GetBoundsMax(), numRays);
+		std::vector<float> rayChannels[7];
+		for (std::vector<float>& channel : rayChannels) {
+			channel.resize(numRays);
+		}
+		for (int i = 0; i < numRays; i++) {
+			rayChannels[0][i] = rays[i].origin.x; rayChannels[1][i] = rays[i].origin.y; rayChannels[2][i] = rays[i].origin.z;
+			rayChannels[3][i] = rays[i].direction.x; rayChannels[4][i] = rays[i].direction.y; rayChannels[5][i] = rays[i].direction.z;
+			rayChannels[6][i] = rays[i].tMin;
+		}
+		RayPacket rayPacket;
+		rayPacket.ox = rayChannels[0].data(); rayPacket.oy = rayChannels[1].data(); rayPacket.oz = rayChannels[2].data();
+		rayPacket.dx = rayChannels[3].data(); rayPacket.dy = rayChannels[4].data(); rayPacket.dz = rayChannels[5].data();
+		rayPacket.tMin = rayChannels[6].data();
+		rayPacket.count = numRays;
+
+		const double tests = (double)numRays * numFaces;
+		out << "res/meshes/suzanne.obj: " << numFaces << " triangles, " << numRays << " rays (" << tests / 1.0e6 << " M ray-triangle tests per pass)" << std::endl;
+
+		/* The scalar path is the Intersect::RayTriangleIntersect loop, and the reference for the SIMD paths */
+		std::vector<RayHit> reference(numRays);
+		std::vector<uint8_t> referenceFound(numRays);
+		for (int i = 0; i < numRays; i++) {
+			referenceFound[i] = IntersectKernels::RayTriangles(rays[i], triangles, reference[i], IntersectKernels::Path::Scalar) ? 1 : 0;
+		}
+
+		const IntersectKernels::Path paths[] = { IntersectKernels::Path::Scalar, IntersectKernels::Path::SSE, IntersectKernels::Path::AVX2 };
+		double scalarRayMs = 0.0, scalarPacketMs = 0.0;
+		for (IntersectKernels::Path path : paths) {
+			const char* name = IntersectKernels::GetName(path);
+			if (!IntersectKernels::IsSupported(path)) {
+				out << "  " << name << ": not supported by this CPU" << std::endl;
+				continue;
+			}
+
+			/* One ray against all triangles at a time */
+			std::vector<RayHit> hits(numRays);
+			std::vector<uint8_t> found(numRays);
+			double rayMs = TimeMs([&]() {
+				for (int i = 0; i < numRays; i++) {
+					found[i] = IntersectKernels::RayTriangles(rays[i], triangles, hits[i], path) ? 1 : 0;
+				}
+			});
+
+			/* All rays against one triangle at a time */
+			std::vector<float> t(numRays), u(numRays), v(numRays);
+			std::vector<int> face(numRays);
+			RayHitPacket packetHits;
+			packetHits.t = t.data(); packetHits.u = u.data(); packetHits.v = v.data(); packetHits.face = face.data();
+			double packetMs = TimeMs([&]() {
+				std::fill(t.begin(), t.end(), FLT_MAX);
+				std::fill(face.begin(), face.end(), MeshBVH::NO_HIT);
+				for (int f = 0; f < numFaces; f++) {
+					glm::vec3 v0(triangles.v0x[f], triangles.v0y[f], triangles.v0z[f]);
+					glm::vec3 e1(triangles.e1x[f], triangles.e1y[f], triangles.e1z[f]);
+					glm::vec3 e2(triangles.e2x[f], triangles.e2y[f], triangles.e2z[f]);
+					IntersectKernels::RaysTriangle(rayPacket, v0, e1, e2, f, packetHits, path);
+				}
+			});
+
+			int rayMismatches = 0, packetMismatches = 0;
+			for (int i = 0; i < numRays; i++) {
+				rayMismatches += !SameHit(found[i] != 0, hits[i], referenceFound[i] != 0, reference[i]);
+				RayHit packetHit;
+				packetHit.face = face[i]; packetHit.t = t[i]; packetHit.u = u[i]; packetHit.v = v[i];
+				packetMismatches += !SameHit(face[i] != MeshBVH::NO_HIT, packetHit, referenceFound[i] != 0, reference[i]);
+			}
+
+			if (path == IntersectKernels::Path::Scalar) {
+				scalarRayMs = rayMs;
+				scalarPacketMs = packetMs;
+			}
+			out << "  " << name << ": ray vs triangles " << tests / (rayMs / 1000.0) / 1.0e6 << " M tests/s (" << scalarRayMs / rayMs << "x), "
+				<< "rays vs triangle " << tests / (packetMs / 1000.0) / 1.0e6 << " M tests/s (" << scalarPacketMs / packetMs << "x), "
+				<< (rayMismatches + packetMismatches == 0 ? "same hits as scalar" : std::to_string(rayMismatches + packetMismatches) + " HITS DIFFER FROM SCALAR") << std::endl;
+		}
+	}
+
+	static double Percentile(std::vector<double> samples, double fraction) {
+		std::sort(samples.begin(), samples.end());
+		return samples[std::min(samples.size() - 1, (size_t)(fraction * samples.size()))];
+	}
+
+	void RunPicking(std::ostream& out) {
+		Mesh suzanne("res/meshes/suzanne.obj");
+		std::unique_ptr<Mesh> sphere(Mesh::Sphere(Mesh::res64, 1));
+		const MeshBVH* meshes[] = { &suzanne.GetBVH(), &sphere->GetBVH() };
+
+		/* A field of randomly rotated and scaled instances in front of the camera */
+		const int gridX = 40, gridZ = 25;
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		Picker picker;
+		std::vector<const MeshBVH*> instanceMeshes;
+		std::vector<glm::mat4> instanceModels;
+		for (int z = 0; z < gridZ; z++) {
+			for (int x = 0; x < gridX; x++) {
+				glm::vec3 position((x - gridX / 2) * 3.0f, unit(rng) * 2.0f - 1.0f, -z * 3.0f);
+				glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng) + 0.1f));
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), position) * glm::rotate(glm::mat4(1.0f), unit(rng) * 6.28f, axis)
+					* glm::scale(glm::mat4(1.0f), glm::vec3(0.5f + unit(rng)));
+				const MeshBVH* mesh = meshes[(x + z) % 2];
+				picker.AddInstance(*mesh, model);
+				instanceMeshes.push_back(mesh);
+				instanceModels.push_back(model);
+			}
+		}
+
+		const float width = 1280.0f, height = 720.0f;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 15.0f), glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 proj = glm::perspective(glm::radians(45.0f), width / height, 1.0f, 1000.0f);
+
+		const int numPicks = 10000;
+		std::vector<Ray> rays(numPicks);
+		for (Ray& ray : rays) {
+			ray = Picker::CursorRay(unit(rng) * width, unit(rng) * height, width, height, view, proj);
+		}
+
+		out << picker.GetNumInstances() << " instances (" << meshes[0]->GetNumFaces() << " and " << meshes[1]->GetNumFaces() << " faces), "
+			<< numPicks << " picks at random cursor positions" << std::endl;
+
+		/* Unlimited, then a budget tight enough to cut some picks short */
+		const float budgetsMs[] = { 0.0f, 0.02f };
+		std::vector<Picker::Hit> unlimited;
+		for (float budgetMs : budgetsMs) {
+			std::vector<double> latencies(numPicks);
+			std::vector<Picker::Hit> hits(numPicks);
+			int numHits = 0, incomplete = 0, changed = 0;
+			double traversed = 0.0;
+			for (int i = 0; i < numPicks; i++) {
+				latencies[i] = TimeMs([&]() { picker.Pick(rays[i], hits[i], budgetMs); }) * 1000.0;
+				numHits += hits[i].instance != Picker::NO_HIT;
+				incomplete += !hits[i].complete;
+				traversed += hits[i].instancesTested;
+				if (!unlimited.empty()) {
+					changed += hits[i].instance != unlimited[i].instance || hits[i].t != unlimited[i].t;
+				}
+			}
+
+			out << "  budget ";
+			if (budgetMs > 0.0f) {
+				out << budgetMs * 1000.0f << " us";
+			} else {
+				out << "none";
+			}
+			out << ": latency p50 " << Percentile(latencies, 0.5) << " us, p90 " << Percentile(latencies, 0.9) << " us, p99 " << Percentile(latencies, 0.99)
+				<< " us, max " << Percentile(latencies, 1.0) << " us; " << numHits << " hits, " << traversed / numPicks << " instances traversed per pick";
+			if (!unlimited.empty()) {
+				out << ", " << incomplete << " cut short (" << changed << " with a different result)";
+			}
+			out << std::endl;
+
+			if (unlimited.empty()) {
+				unlimited = hits;
+			}
+		}
+
+		/* Reference: every instance's BVH, without bounds culling or ordering */
+		const int numChecked = 1000;
+		int mismatches = 0;
+		double referenceMs = TimeMs([&]() {
+			for (int i = 0; i < numChecked; i++) {
+				int bestInstance = Picker::NO_HIT;
+				RayHit best;
+				for (int k = 0; k < (int)instanceMeshes.size(); k++) {
+					glm::mat4 inverse = glm::inverse(instanceModels[k]);
+					Ray local;
+					local.origin = glm::vec3(inverse * glm::vec4(rays[i].origin, 1.0f));
+					local.direction = glm::vec3(inverse * glm::vec4(rays[i].direction, 0.0f));
+					local.tMax = best.t;
+					if (instanceMeshes[k]->ClosestHit(local, best)) {
+						bestInstance = k;
+					}
+				}
+				mismatches += bestInstance != unlimited[i].instance || (bestInstance != Picker::NO_HIT && best.face != unlimited[i].face);
+			}
+		});
+		out << "  every instance, no culling: " << referenceMs * 1000.0 / numChecked << " us per pick, "
+			<< (mismatches == 0 ? "same hits" : std::to_string(mismatches) + " DIFFERENT HITS") << " over the first " << numChecked << " picks" << std::endl;
+	}
+
+	/* The JacobiSVD route ComputeSpatialProperties used to take: copy the centred points into an N x 3 matrix */
+	static void PrincipalAxesSVD(const std::vector<float>& positions, glm::vec3& variances, glm::mat3& axes) {
+		int numPoints = (int)positions.size() / 3;
+		Eigen::MatrixXf A(numPoints, 3);
+		Eigen::Vector3f centroid(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < numPoints; i++) {
+			A.row(i) << positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2];
+			centroid += A.row(i).transpose();
+		}
+		centroid /= (float)numPoints;
+		A.rowwise() -= centroid.transpose();
+
+		Eigen::JacobiSVD<Eigen::MatrixXf> svd(A, Eigen::ComputeThinV);
+		for (int k = 0; k < 3; k++) {
+			float sigma = svd.singularValues()[k];
+			variances[k] = sigma * sigma / numPoints;
+			axes[k] = glm::vec3(svd.matrixV()(0, k), svd.matrixV()(1, k), svd.matrixV()(2, k));
+		}
+	}
+
+	static void ReportSpatialProperties(std::ostream& out, const std::string& name, const std::vector<float>& positions) {
+		int numPoints = (int)positions.size() / 3;
+		int iterations = numPoints < 100000 ? 20 : 3;
+
+		SpatialProperties props;
+		double serialMs = TimeMs([&]() { props = ComputeSpatialProperties(positions); }, iterations);
+		SpatialProperties parallelProps;
+		double parallelMs = TimeMs([&]() { parallelProps = ComputeSpatialProperties(positions, &ThreadPool::Global()); }, iterations);
+		bool threadInvariant = std::memcmp(&props, &parallelProps, sizeof(SpatialProperties)) == 0;
+
+		glm::vec3 variances;
+		glm::mat3 axes;
+		double svdMs = TimeMs([&]() { PrincipalAxesSVD(positions, variances, axes); });
+
+		/* Axes are only defined up to sign */
+		float maxVarianceError = 0.0f, minAxisAlignment = 1.0f;
+		for (int k = 0; k < 3; k++) {
+			maxVarianceError = std::max(maxVarianceError, std::abs(props.principalVariances[k] - variances[k]) / std::max(variances[k], 1e-20f));
+			minAxisAlignment = std::min(minAxisAlignment, std::abs(glm::dot(props.principalAxes[k], axes[k])));
+		}
+
+		/* Every point must lie in the box (up to rounding) */
+		float maxOutside = 0.0f;
+		glm::mat3 axesT = glm::transpose(props.obb.axes);
+		for (int i = 0; i < numPoints; i++) {
+			glm::vec3 local = axesT * (glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]) - props.obb.center);
+			glm::vec3 outside = glm::abs(local) - props.obb.halfExtents;
+			maxOutside = std::max(maxOutside, std::max(outside.x, std::max(outside.y, outside.z)));
+		}
+
+		out << name << ": " << numPoints << " vertices, principal variances " << props.principalVariances.x << ", " << props.principalVariances.y
+			<< ", " << props.principalVariances.z << std::endl;
+		out << "  moments + eigen-solve + OBB: " << serialMs << " ms serial, " << parallelMs << " ms on " << ThreadPool::Global().GetNumThreads()
+			<< " thread(s)" << (threadInvariant ? "" : " (RESULTS DIFFER)") << ", no extra memory" << std::endl;
+		out << "  JacobiSVD: " << svdMs << " ms (" << svdMs / serialMs << "x slower, " << (size_t)numPoints * 3 * sizeof(float) / 1024 << " KB matrix), max variance error "
+			<< maxVarianceError << ", min |axis dot| " << minAxisAlignment << std::endl;
+		out << "  OBB half extents " << props.obb.halfExtents.x << ", " << props.obb.halfExtents.y << ", " << props.obb.halfExtents.z
+			<< " (max point outside " << maxOutside << ")" << std::endl;
+	}
+
+	void RunSpatialProperties(std::ostream& out) {
+		Mesh suzanne("res/meshes/suzanne.obj");
+		ReportSpatialProperties(out, "res/meshes/suzanne.obj", suzanne.GetPositions());
+
+		/* A torus of 1M vertices, stretched and tilted so that its principal axes are distinct and off the coordinate axes */
+		std::vector<HDK_Sample::UT_Vector3T<float>> torusPositions;
+		std::vector<int> torusTriangles;
+		GenerateTorus(1000, 1000, torusPositions, torusTriangles);
+		glm::mat3 transform = glm::mat3(glm::rotate(glm::mat4(1.0f), 0.7f, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)))) * glm::mat3(glm::scale(glm::mat4(1.0f), glm::vec3(3.0f, 1.5f, 1.0f)));
+		std::vector<float> positions;
+		positions.reserve(torusPositions.size() * 3);
+		for (const HDK_Sample::UT_Vector3T<float>& p : torusPositions) {
+			glm::vec3 q = transform * glm::vec3(p[0], p[1], p[2]) + glm::vec3(5.0f, -2.0f, 1.0f);
+			positions.insert(positions.end(), { q.x, q.y, q.z });
+		}
+		ReportSpatialProperties(out, "torus 1000x1000", positions);
+	}
+
+
+	/* Exact signed distance the field approximates: closest point on the mesh, signed by the winding number */
+	static float ReferenceDistance(const MeshBVH& bvh, const WindingNumberQuery& windingNumber, const glm::vec3& p) {
+		PointHit hit;
+		bvh.ClosestPoint(p, FLT_MAX, hit);
+		bool inside = std::abs(windingNumber.Compute(p)) >= WindingNumberQuery::INSIDE_THRESHOLD;
+		return inside ? -hit.distance : hit.distance;
+	}
+
+	void RunSignedDistanceField(std::ostream& out) {
+		const std::string name = "res/meshes/suzanne.obj";
+		Mesh suzanne(name);
+		const std::vector<float>& pos = suzanne.GetPositions();
+		const std::vector<unsigned int>& inds = suzanne.GetIndices();
+
+		MeshBVH bvh;
+		WindingNumberQuery windingNumber;
+		double bvhMs = TimeMs([&]() { bvh.Build(pos, inds); });
+		double windingMs = TimeMs([&]() { windingNumber.Build(pos, inds); });
+		out << name << ": " << bvh.GetNumFaces() << " faces, " << suzanne.GetAdjacency().GetBoundaryEdges().size()
+			<< " boundary edges; BVH built in " << bvhMs << " ms, winding number tree in " << windingMs << " ms" << std::endl;
+
+		/* Random points over the bounds grown by a fifth, with the exact signed distance at each */
+		const int numPoints = 50000;
+		glm::vec3 margin = (suzanne.GetBoundsMax() - suzanne.GetBoundsMin()) * 0.2f;
+		glm::vec3 lo = suzanne.GetBoundsMin() - margin, hi = suzanne.GetBoundsMax() + margin;
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<glm::vec3> points(numPoints);
+		std::vector<float> reference(numPoints);
+		for (int i = 0; i < numPoints; i++) {
+			points[i] = lo + (hi - lo) * glm::vec3(unit(rng), unit(rng), unit(rng));
+			reference[i] = ReferenceDistance(bvh, windingNumber, points[i]);
+		}
+
+		const std::string sdfPath = name + ".sdf";
+		const int resolutions[] = { 32, 64, 128, 256 };
+		for (int resolution : resolutions) {
+			SignedDistanceField sdf;
+			SignedDistanceField::BakeSettings settings;
+			settings.resolution = resolution;
+			double bakeMs = TimeMs([&]() { sdf.Bake(bvh, windingNumber, settings, &ThreadPool::Global()); });
+
+			glm::ivec3 cells = sdf.GetCellDimensions();
+			size_t denseBytes = (size_t)(cells.x + 1) * (cells.y + 1) * (cells.z + 1) * sizeof(float);
+			out << "  resolution " << resolution << " (" << cells.x << "x" << cells.y << "x" << cells.z << " cells): baked in " << bakeMs
+				<< " ms on " << ThreadPool::Global().GetNumThreads() << " thread(s), " << sdf.GetNumAllocatedBricks() << " of " << sdf.GetNumBricks()
+				<< " bricks stored, " << sdf.GetMemoryUsage() / 1024 << " KB (dense grid " << denseBytes / 1024 << " KB, "
+				<< (double)denseBytes / sdf.GetMemoryUsage() << "x larger)" << std::endl;
+
+			/* Accuracy where the band is stored in full, and signs away from the surface everywhere */
+			const float voxel = sdf.GetVoxelSize();
+			double maxError = 0.0, sumError = 0.0, sumGradientLength = 0.0;
+			int numBand = 0, signMismatches = 0;
+			for (int i = 0; i < numPoints; i++) {
+				glm::vec3 gradient;
+				float d = sdf.SampleGradient(points[i], gradient);
+				if (std::abs(reference[i]) < sdf.GetBandWidth() - 2.0f * voxel) {
+					double error = std::abs(d - reference[i]) / voxel;
+					maxError = std::max(maxError, error);
+					sumError += error;
+					sumGradientLength += glm::length(gradient);
+					numBand++;
+				}
+				if (std::abs(reference[i]) > voxel && (d < 0.0f) != (reference[i] < 0.0f)) {
+					signMismatches++;
+				}
+			}
+			out << "    " << numBand << " points in the band: mean error " << sumError / std::max(1, numBand) << " voxels, max "
+				<< maxError << ", mean |gradient| " << sumGradientLength / std::max(1, numBand) << "; " << signMismatches
+				<< " sign mismatches more than a voxel from the surface" << std::endl;
+
+			volatile float sink = 0.0f;
+			double sampleMs = TimeMs([&]() {
+				float sum = 0.0f;
+				for (const glm::vec3& p : points) {
+					sum += sdf.Sample(p);
+				}
+				sink = sum;
+			}, 5);
+			double gradientMs = TimeMs([&]() {
+				float sum = 0.0f;
+				for (const glm::vec3& p : points) {
+					glm::vec3 gradient;
+					sum += sdf.SampleGradient(p, gradient) + gradient.x;
+				}
+				sink = sum;
+			}, 5);
+			(void)sink;
+
+			SignedDistanceField loaded;
+			bool roundTrip = sdf.Save(sdfPath) && loaded.Load(sdfPath);
+			for (int i = 0; roundTrip && i < numPoints; i++) {
+				roundTrip = loaded.Sample(points[i]) == sdf.Sample(points[i]);
+			}
+			std::ifstream file(sdfPath, std::ios::binary | std::ios::ate);
+			long long fileBytes = file ? (long long)file.tellg() : 0;
+			file.close();
+			std::remove(sdfPath.c_str());
+
+			out << "    sample " << numPoints / sampleMs / 1000.0 << " M/s, sample + gradient " << numPoints / gradientMs / 1000.0
+				<< " M/s; file " << fileBytes / 1024 << " KB, " << (roundTrip ? "reloads identically" : "RELOAD MISMATCH") << std::endl;
+		}
+	}
+
+
+	/* Half-edge links, Euler's formula and local convexity (every face's neighbours lie below its plane) */
+	static std::string ValidateHull(const ConvexHull& hull) {
+		const std::vector<glm::vec3>& vertices = hull.GetVertices();
+		const std::vector<ConvexHull::Face>& faces = hull.GetFaces();
+		const std::vector<ConvexHull::HalfEdge>& edges = hull.GetEdges();
+		for (int e = 0; e < (int)edges.size(); e++) {
+			const ConvexHull::HalfEdge& edge = edges[e];
+			if (edge.twin < 0 || edges[edge.twin].twin != e || edges[edge.twin].face == edge.face
+				|| edges[edge.twin].vertex != edges[edge.next].vertex || edges[edge.next].face != edge.face) {
+				return "BROKEN HALF-EDGES";
+			}
+		}
+		if ((int)vertices.size() - (int)edges.size() / 2 + (int)faces.size() != 2) {
+			return "EULER CHARACTERISTIC NOT 2";
+		}
+		float worst = 0.0f;
+		for (const ConvexHull::Face& face : faces) {
+			for (int i = 0; i < face.numEdges; i++) {
+				const ConvexHull::Face& neighbour = faces[edges[edges[face.edge + i].twin].face];
+				for (int j = 0; j < neighbour.numEdges; j++) {
+					worst = std::max(worst, glm::dot(face.normal, vertices[edges[neighbour.edge + j].vertex]) + face.offset);
+				}
+			}
+		}
+		return worst <= 4.0f * hull.GetTolerance() ? "valid" : "NOT CONVEX (" + std::to_string(worst) + ")";
+	}
+
+	/* Farthest any of the points lies outside the hull (checking at most maxChecks of them, spread evenly) */
+	static float MaxOutside(const ConvexHull& hull, const std::vector<float>& positions, int maxChecks) {
+		int numPoints = (int)(positions.size() / 3);
+		int step = std::max(1, numPoints / std::max(1, maxChecks));
+		float worst = 0.0f;
+		for (int i = 0; i < numPoints; i += step) {
+			glm::vec3 p(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+			float outside = -FLT_MAX;
+			for (const ConvexHull::Face& face : hull.GetFaces()) {
+				outside = std::max(outside, glm::dot(face.normal, p) + face.offset);
+			}
+			worst = std::max(worst, outside);
+		}
+		return worst;
+	}
+
+	static void ReportConvexHull(std::ostream& out, const std::string& name, const std::vector<float>& positions) {
+		ConvexHull hull, parallelHull;
+		int iterations = positions.size() > 3000000 ? 1 : 5;
+		double serialMs = TimeMs([&]() { hull.Build(positions); }, iterations);
+		double parallelMs = TimeMs([&]() { parallelHull.Build(positions, 0, &ThreadPool::Global()); }, iterations);
+		bool same = hull.GetEdges().size() == parallelHull.GetEdges().size()
+			&& std::memcmp(hull.GetVertices().data(), parallelHull.GetVertices().data(), hull.GetVertices().size() * sizeof(glm::vec3)) == 0;
+
+		glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for (size_t i = 0; i < positions.size(); i += 3) {
+			lo = glm::min(lo, glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+			hi = glm::max(hi, glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+		}
+		const float diagonal = glm::length(hi - lo);
+		const int maxChecks = (int)std::max<size_t>(1000, 100000000 / std::max<size_t>(1, hull.GetFaces().size()));
+
+		out << name << ": " << positions.size() / 3 << " points -> " << hull.GetVertices().size() << " vertices, " << hull.GetFaces().size()
+			<< " faces, " << hull.GetEdges().size() / 2 << " edges (" << hull.GetMemoryUsage() / 1024 << " KB), " << ValidateHull(hull) << std::endl;
+		out << "  built in " << serialMs << " ms serial, " << parallelMs << " ms on " << ThreadPool::Global().GetNumThreads() << " thread(s) ("
+			<< (same ? "same hull" : "DIFFERENT HULL") << "), points at most " << MaxOutside(hull, positions, maxChecks) / hull.GetTolerance()
+			<< " tolerances outside" << std::endl;
+
+		/* Simplified hulls: the farthest points first, so the error is how far the dropped points stick out */
+		const int limits[] = { 16, 32, 64 };
+		for (int limit : limits) {
+			ConvexHull simplified;
+			double limitedMs = TimeMs([&]() { simplified.Build(positions, limit); }, iterations);
+			out << "  at most " << limit << " vertices: " << simplified.GetVertices().size() << " vertices, " << simplified.GetFaces().size() << " faces in "
+				<< limitedMs << " ms, " << ValidateHull(simplified) << ", points at most " << 100.0f * MaxOutside(simplified, positions, maxChecks) / diagonal
+				<< "% of the diagonal outside" << std::endl;
+		}
+	}
+
+	void RunConvexHull(std::ostream& out) {
+		for (const std::string& asset : MeshAssets()) {
+			std::remove(MeshCache::GetCookedPath(asset).c_str());
+			Mesh mesh(asset);
+			ReportConvexHull(out, asset, mesh.GetPositions());
+
+			/* The first load cooked the hull, the second one reads it back */
+			Mesh cooked(asset);
+			const ConvexHull& a = mesh.GetConvexHull();
+			const ConvexHull& b = cooked.GetConvexHull();
+			bool same = a.GetEdges().size() == b.GetEdges().size() && a.GetFaces().size() == b.GetFaces().size()
+				&& std::memcmp(a.GetVertices().data(), b.GetVertices().data(), a.GetVertices().size() * sizeof(glm::vec3)) == 0;
+			out << "  cooked hull " << (same ? "matches" : "DOES NOT MATCH") << " the built one" << std::endl;
+		}
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		const int counts[] = { 10000, 1000000 };
+		for (int count : counts) {
+			std::vector<float> cube, ball;
+			cube.reserve(count * 3);
+			ball.reserve(count * 3);
+			for (int i = 0; i < count; i++) {
+				cube.insert(cube.end(), { unit(rng), unit(rng), unit(rng) });
+				glm::vec3 p;
+				do {
+					p = glm::vec3(unit(rng), unit(rng), unit(rng));
+				} while (glm::dot(p, p) > 1.0f);
+				ball.insert(ball.end(), { p.x, p.y, p.z });
+			}
+			ReportConvexHull(out, "cube", cube);
+			ReportConvexHull(out, "ball", ball);
+		}
+
+		/* Every point on the hull: the worst case, where the output is as large as the input */
+		std::vector<float> sphere;
+		for (int i = 0; i < 100000; i++) {
+			glm::vec3 p = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng)));
+			sphere.insert(sphere.end(), { p.x, p.y, p.z });
+		}
+		ReportConvexHull(out, "sphere surface", sphere);
+	}
+
+}
@@ -0,0 +1,325 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "Mesh.h"
+#include "Renderer.h"
+#include "Shader.h"
+#include "io/MeshCache.h"
+#include "io/ObjParser.h"
+#include "io/ObjVertexBuilder.h"
+#include "util/ThreadPool.h"
+
+namespace Benchmark {
+
+	/* The original getline/istringstream/stof loop from Mesh::ParseMeshFile, kept as the reference for timing and validation */
+	static void LegacyParse(const std::string& filepath, ObjMeshData& data) {
+		std::ifstream stream(filepath);
+		std::string line;
+
+		while (getline(stream, line)) {
+			if (line.find("mtllib") != std::string::npos || line.find("#") != std::string::npos) {
+				continue;
+			}
+
+			std::string token;
+			std::istringstream tokenStream(line);
+			std::getline(tokenStream, token, ' ');
+			std::string type = token;
+			int vertexCount = 1;
+
+			while (std::getline(tokenStream, token, ' ')) {
+				try {
+					if (type == "v") {
+						data.positions.push_back(std::stof(token));
+					} else if (type == "vn") {
+						data.normals.push_back(std::stof(token));
+					} else if (type == "vt") {
+						data.texCoords.push_back(std::stof(token));
+					} else if (type == "f") {
+						if (vertexCount > 3) {
+							data.positionIndices.push_back(data.positionIndices.back());
+							data.normalIndices.push_back(data.normalIndices.back());
+							if (data.textureIndices.size() > 0) { data.textureIndices.push_back(data.textureIndices.back()); }
+						}
+
+						int firstSlash = token.find("/");
+						int secondSlash = token.find("/", firstSlash + 1);
+						data.positionIndices.push_back(std::stoi(token.substr(0, firstSlash)) - 1);
+						data.normalIndices.push_back(std::stoi(token.substr(secondSlash + 1)) - 1);
+						if (secondSlash - firstSlash != 1) {
+							data.textureIndices.push_back(std::stoi(token.substr(firstSlash + 1, secondSlash - firstSlash - 1)) - 1);
+						}
+
+						if (vertexCount > 3) {
+							data.positionIndices.push_back(data.positionIndices[data.positionIndices.size() - 5]);
+							data.normalIndices.push_back(data.normalIndices[data.normalIndices.size() - 5]);
+							if (data.textureIndices.size() > 0) { data.textureIndices.push_back(data.textureIndices[data.textureIndices.size() - 5]); }
+						}
+						vertexCount++;
+					}
+				}
+				catch (...) {
+				}
+			}
+		}
+	}
+
+	static double MaxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+		if (a.size() != b.size()) {
+			return -1.0;
+		}
+		double maxDifference = 0.0;
+		for (size_t i = 0; i < a.size(); i++) {
+			maxDifference = std::max(maxDifference, (double)std::abs(a[i] - b[i]));
+		}
+		return maxDifference;
+	}
+
+	void RunObjParsing(std::ostream& out) {
+		for (const std::string& asset : MeshAssets()) {
+			ObjMeshData fast, legacy;
+			const int iterations = 10;
+
+			double fastMs = TimeMs([&]() { ObjParser::ParseFile(asset, fast); }, iterations);
+			double legacyMs = TimeMs([&]() { legacy.Clear(); LegacyParse(asset, legacy); }, iterations);
+			double megabytes = fast.fileSize / (1024.0 * 1024.0);
+
+			bool indicesMatch = fast.positionIndices == legacy.positionIndices
+				&& fast.normalIndices == legacy.normalIndices
+				&& fast.textureIndices == legacy.textureIndices;
+
+			out << asset << ": " << fast.positions.size() / 3 << " positions, " << fast.positionIndices.size() / 3 << " triangles" << std::endl;
+			out << "  mapped tokenizer: " << fastMs << " ms (" << megabytes / (fastMs / 1000.0) << " MB/s)" << std::endl;
+			out << "  getline/stof:     " << legacyMs << " ms (" << megabytes / (legacyMs / 1000.0) << " MB/s), speedup " << legacyMs / fastMs << "x" << std::endl;
+			out << "  max attribute difference " << std::max(MaxDifference(fast.positions, legacy.positions), MaxDifference(fast.normals, legacy.normals))
+				<< ", indices " << (indicesMatch ? "match" : "DIFFER") << std::endl;
+		}
+	}
+
+	/* Writes a uv-mapped torus with quad faces as .OBJ text, with a seam in the uvs where the grid wraps around */
+	static std::string SyntheticObj(int rings, int segments) {
+		std::string text;
+		text.reserve((size_t)rings * segments * 160);
+		char line[128];
+		const float pi = 3.14159265f;
+
+		for (int i = 0; i < rings; i++) {
+			for (int j = 0; j < segments; j++) {
+				float u = 2.0f * pi * i / rings, v = 2.0f * pi * j / segments;
+				float r = 1.0f + 0.25f * std::cos(v);
+				std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", r * std::cos(u), 0.25f * std::sin(v), r * std::sin(u));
+				text += line;
+				std::snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", std::cos(v) * std::cos(u), std::sin(v), std::cos(v) * std::sin(u));
+				text += line;
+			}
+		}
+		for (int i = 0; i <= rings; i++) {
+			for (int j = 0; j <= segments; j++) {
+				std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)i / rings, (float)j / segments);
+				text += line;
+			}
+		}
+		for (int i = 0; i < rings; i++) {
+			for (int j = 0; j < segments; j++) {
+				int i1 = (i + 1) % rings, j1 = (j + 1) % segments;
+				int a = i * segments + j + 1, b = i1 * segments + j + 1, c = i1 * segments + j1 + 1, d = i * segments + j1 + 1;
+				int ta = i * (segments + 1) + j + 1, tb = ta + segments + 1;
+				std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, ta, a, b, tb, b, c, tb + 1, c, d, ta + 1, d);
+				text += line;
+			}
+		}
+		return text;
+	}
+
+	void RunObjScaling(std::ostream& out) {
+		std::string text = SyntheticObj(700, 700);
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+		double megabytes = text.size() / (1024.0 * 1024.0);
+
+		/* The serial parser and de-indexer are the reference every thread count must reproduce exactly */
+		ObjMeshData reference;
+		ObjVertexData referenceVertices;
+		double parseMs = TimeMs([&]() { reference.Clear(); ObjParser::Parse(begin, end, reference); });
+		double buildMs = TimeMs([&]() { ObjVertexBuilder::Build(reference, referenceVertices); });
+
+		out << "synthetic torus: " << megabytes << " MB, " << reference.positionIndices.size() / 3 << " triangles, "
+			<< referenceVertices.positions.size() / 3 << " vertices after de-indexing (" << reference.positions.size() / 3 << " positions)" << std::endl;
+		out << "  serial: parse " << parseMs << " ms (" << megabytes / (parseMs / 1000.0) << " MB/s), de-index " << buildMs << " ms" << std::endl;
+
+		/* Powers of two up to the machine's thread count, plus the thread count itself */
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned int> threadCounts;
+		for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		for (unsigned int threads : threadCounts) {
+			ThreadPool pool(threads);
+			ObjMeshData data;
+			ObjVertexData vertices;
+			double chunkedMs = TimeMs([&]() { data.Clear(); ObjParser::ParseChunked(begin, end, data, pool); }, 3);
+			double parallelBuildMs = TimeMs([&]() { ObjVertexBuilder::Build(data, vertices, pool); }, 3);
+
+			bool match = data.positions == reference.positions && data.normals == reference.normals && data.texCoords == reference.texCoords
+				&& data.positionIndices == reference.positionIndices && data.normalIndices == reference.normalIndices
+				&& data.textureIndices == reference.textureIndices
+				&& vertices.positions == referenceVertices.positions && vertices.normals == referenceVertices.normals
+				&& vertices.texCoords == referenceVertices.texCoords && vertices.indices == referenceVertices.indices;
+
+			out << "  " << threads << " thread(s): parse " << chunkedMs << " ms (" << megabytes / (chunkedMs / 1000.0) << " MB/s, "
+				<< parseMs / chunkedMs << "x), de-index " << parallelBuildMs << " ms (" << buildMs / parallelBuildMs << "x), "
+				<< (match ? "matches serial" : "DIFFERS from serial") << std::endl;
+		}
+	}
+
+
+	/* Startup cost of a Mesh from the .OBJ source (which also cooks it) against the memory-mapped cooked file */
+	void RunMeshCache(std::ostream& out) {
+		for (const std::string& asset : MeshAssets()) {
+			const std::string cookedPath = MeshCache::GetCookedPath(asset);
+			std::remove(cookedPath.c_str());
+
+			std::unique_ptr<Mesh> cold;
+			double coldMs = TimeMs([&]() { cold = std::make_unique<Mesh>(asset); });
+			MeshCache::CookedMesh cooked;
+			if (!MeshCache::Load(asset, cooked)) {
+				out << asset << ": cooking failed" << std::endl;
+				continue;
+			}
+			size_t cookedBytes = cooked.file->GetSize();
+			cooked = MeshCache::CookedMesh();
+
+			const int iterations = 10;
+			double warmMs = TimeMs([&]() { Mesh mesh(asset); }, iterations);
+			double mapMs = TimeMs([&]() { MeshCache::CookedMesh mapped; MeshCache::Load(asset, mapped); }, iterations);
+
+			out << asset << ": cooked file " << cookedBytes / 1024 << " KB" << std::endl;
+			out << "  cold (parse, faces, adjacency, cook): " << coldMs << " ms" << std::endl;
+			out << "  warm (mapped cooked file):            " << warmMs << " ms, speedup " << coldMs / warmMs << "x (mapping alone " << mapMs << " ms)" << std::endl;
+
+			/* A warm load must leave the mesh as the cold load did */
+			Mesh warm(asset);
+			bool same = warm.GetPositions() == cold->GetPositions() && warm.GetIndices() == cold->GetIndices()
+				&& warm.GetNormals() == cold->GetNormals() && warm.GetTextureCoordinates() == cold->GetTextureCoordinates()
+				&& warm.GetFaces().size() == cold->GetFaces().size() && warm.GetBoundsMin() == cold->GetBoundsMin() && warm.GetBoundsMax() == cold->GetBoundsMax();
+			for (size_t f = 0; same && f < warm.GetFaces().size(); f++) {
+				const Face& a = warm.GetFaces()[f];
+				const Face& b = cold->GetFaces()[f];
+				same = a.p0 == b.p0 && a.p1 == b.p1 && a.p2 == b.p2 && a.normal == b.normal && a.offset == b.offset
+					&& a.i0 == b.i0 && a.i1 == b.i1 && a.i2 == b.i2 && std::equal(a.neighbours, a.neighbours + 3, b.neighbours);
+			}
+			out << "  " << (same ? "warm and cold meshes hold the same data" : "WARM AND COLD MESHES DIFFER") << std::endl;
+		}
+	}
+
+
+	/* Renders a mesh into the currently bound framebuffer, fitted to the view, and reads the pixels back */
+	static std::vector<unsigned char> RenderMesh(Mesh& mesh, Shader& shader, int mode, int size) {
+		glm::vec3 center = 0.5f * (mesh.GetBoundsMin() + mesh.GetBoundsMax());
+		float extent = glm::length(mesh.GetBoundsMax() - mesh.GetBoundsMin());
+		glm::mat4 mvp = glm::ortho(-0.6f, 0.6f, -0.6f, 0.6f, -1.0f, 1.0f)
+			* glm::rotate(glm::mat4(1.0f), 0.6f, glm::vec3(0.3f, 1.0f, 0.0f))
+			* glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / extent))
+			* glm::translate(glm::mat4(1.0f), -center);
+
+		mesh.Update(0.0f, 1.0f, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		shader.Bind();
+		shader.SetUniformMat4f("u_MVP", mvp);
+		shader.SetUniform1i("u_Mode", mode);
+
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		mesh.Draw(shader);
+
+		std::vector<unsigned char> pixels(size * size * 4);
+		glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		return pixels;
+	}
+
+	/*
+		Vertex format memory and a render comparison: each format is drawn offscreen (normals and uvs as colours) and
+		compared against the float formats. Run it under a software driver (e.g. Mesa llvmpipe with
+		LIBGL_ALWAYS_SOFTWARE=1) for a reproducible reference.
+	*/
+	void RunVertexFormats(std::ostream& out) {
+		const int size = 256;
+		const int tolerance = 8; //Per channel, out of 255
+		const double maxDifferingFraction = 0.005;
+
+		GLuint framebuffer, colorBuffer, depthBuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glViewport(0, 0, size, size);
+		glEnable(GL_DEPTH_TEST);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			out << "offscreen framebuffer incomplete, skipping render comparison" << std::endl;
+		} else {
+			out << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+			Shader shader("res/shaders/VertexFormatCheck.shader");
+			const VertexFormat formats[] = { VertexFormat::Separate, VertexFormat::Interleaved, VertexFormat::Compact };
+
+			for (const std::string& asset : MeshAssets()) {
+				out << asset << std::endl;
+				std::vector<unsigned char> reference[2];
+				for (VertexFormat format : formats) {
+					Mesh mesh(asset, 1, format);
+					Mesh::MemoryReport report = mesh.GetMemoryReport();
+					out << "  " << VertexEncoder::GetName(format) << ": GPU vertices " << report.gpuVertices / 1024 << " KB ("
+						<< (double)report.gpuVertices / mesh.GetNumVertices() << " B/vertex), indices " << report.gpuIndices / 1024
+						<< " KB, CPU " << report.GetCpuTotal() / 1024 << " KB (faces " << report.cpuFaces / 1024 << " KB, adjacency "
+						<< report.cpuAdjacency / 1024 << " KB)" << std::endl;
+
+					for (int mode = 0; mode < 2; mode++) {
+						std::vector<unsigned char> pixels = RenderMesh(mesh, shader, mode, size);
+						if (reference[mode].empty()) {
+							reference[mode] = pixels;
+							continue;
+						}
+
+						int differing = 0, maxDifference = 0;
+						for (size_t i = 0; i < pixels.size(); i += 4) {
+							int difference = 0;
+							for (int c = 0; c < 3; c++) {
+								difference = std::max(difference, std::abs((int)pixels[i + c] - (int)reference[mode][i + c]));
+							}
+							maxDifference = std::max(maxDifference, difference);
+							differing += difference > tolerance;
+						}
+						double fraction = (double)differing / (size * size);
+						out << "    " << (mode == 0 ? "normals" : "uvs") << ": " << differing << " pixels differ by more than " << tolerance
+							<< " (max " << maxDifference << "), " << (fraction <= maxDifferingFraction ? "PASS" : "FAIL") << std::endl;
+					}
+				}
+			}
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+}
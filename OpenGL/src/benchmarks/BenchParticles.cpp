@@ -0,0 +1,531 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <tuple>
+
+#include <GL/glew.h>
+
+#include "particles/ParticleBackend.h"
+#include "particles/ParticleCollider.h"
+#include "particles/ParticleKernels.h"
+#include "particles/ParticlePool.h"
+#include "particles/ParticleSorter.h"
+#include "particles/SpatialHashGrid.h"
+#include "util/ThreadPool.h"
+
+#include "glm/glm.hpp"
+
+namespace Benchmark {
+
+	static const float FRAME_TIME = 1.0f / 60.0f;
+	static const glm::vec3 GRAVITY(0.0f, -9.81f, 0.0f);
+
+	/* Particle struct and slot search of the old TestParticle, for comparison */
+	struct AosParticle {
+		glm::vec3 pos, speed;
+		unsigned char r, g, b, a;
+		float size, angle, weight;
+		float life;
+		float cameradistance;
+	};
+
+	static int FindUnused(const std::vector<AosParticle>& particles, int& lastUsed) {
+		for (int i = lastUsed; i < (int)particles.size(); i++) {
+			if (particles[i].life < 0.0f) {
+				return lastUsed = i;
+			}
+		}
+		for (int i = 0; i < lastUsed; i++) {
+			if (particles[i].life < 0.0f) {
+				return lastUsed = i;
+			}
+		}
+		return 0;
+	}
+
+	/*
+		Steady state emitter: count particles with lifetimes spread over a few seconds, and every frame the ones that
+		died are replaced, so about 1% of the particles are killed and spawned per frame
+	*/
+	void RunParticlePool(std::ostream& out) {
+		const int counts[] = { 10000, 100000, 1000000 };
+		const int frames = 120;
+		for (int count : counts) {
+			std::mt19937 rng(5);
+			std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+			std::uniform_real_distribution<float> lifetime(0.5f, 3.0f);
+			auto velocity = [&]() { return glm::vec3(uniform(rng), 10.0f + uniform(rng), uniform(rng)); };
+
+			ParticlePool pool(count);
+			while (!pool.IsFull()) {
+				pool.Spawn(glm::vec3(0.0f), velocity(), 0xffffffffu, 0.2f, lifetime(rng));
+			}
+			int killed = 0;
+			double updateMs = 0.0, spawnMs = 0.0;
+			for (int frame = 0; frame < frames; frame++) {
+				int died = 0;
+				updateMs += TimeMs([&]() { died = pool.Update(FRAME_TIME, GRAVITY); });
+				spawnMs += TimeMs([&]() {
+					for (int i = 0; i < died; i++) {
+						pool.Spawn(glm::vec3(0.0f), velocity(), 0xffffffffu, 0.2f, lifetime(rng));
+					}
+				});
+				killed += died;
+			}
+			updateMs /= frames;
+			spawnMs /= frames;
+			out << count << " particles (" << pool.GetMemoryUsage() / (1024.0 * 1024.0) << " MB), " << killed / frames << " killed and spawned per frame" << std::endl;
+			out << "  SoA pool: update " << updateMs << " ms (" << count / updateMs << " particles/ms), spawn " << spawnMs << " ms" << std::endl;
+
+			/* The same emitter on AoS slots with twice the capacity, scanned in full every frame */
+			std::vector<AosParticle> slots(2 * count);
+			for (AosParticle& p : slots) {
+				p.life = -1.0f;
+			}
+			int lastUsed = 0;
+			for (int i = 0; i < count; i++) {
+				AosParticle& p = slots[FindUnused(slots, lastUsed)];
+				p.pos = glm::vec3(0.0f); p.speed = velocity(); p.size = 0.2f; p.life = lifetime(rng);
+			}
+			updateMs = 0.0; spawnMs = 0.0;
+			for (int frame = 0; frame < frames; frame++) {
+				int died = 0;
+				updateMs += TimeMs([&]() {
+					for (AosParticle& p : slots) {
+						if (p.life > 0.0f) {
+							p.life -= FRAME_TIME;
+							if (p.life > 0.0f) {
+								p.speed += GRAVITY * FRAME_TIME;
+								p.pos += p.speed * FRAME_TIME;
+							} else {
+								p.life = -1.0f;
+								died++;
+							}
+						}
+					}
+				});
+				spawnMs += TimeMs([&]() {
+					for (int i = 0; i < died; i++) {
+						AosParticle& p = slots[FindUnused(slots, lastUsed)];
+						p.pos = glm::vec3(0.0f); p.speed = velocity(); p.size = 0.2f; p.life = lifetime(rng);
+					}
+				});
+			}
+			updateMs /= frames;
+			spawnMs /= frames;
+			out << "  AoS slots: update " << updateMs << " ms (" << count / updateMs << " particles/ms), spawn " << spawnMs << " ms" << std::endl;
+		}
+	}
+
+	/* count particles from a fixed seed, so every run starts from the same state */
+	static void FillPool(ParticlePool& pool, int count) {
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> lifetime(0.5f, 3.0f);
+		pool.SetCapacity(count);
+		while (!pool.IsFull()) {
+			glm::vec3 position(uniform(rng), uniform(rng), uniform(rng));
+			pool.Spawn(position, glm::vec3(uniform(rng), 10.0f + uniform(rng), uniform(rng)), (uint32_t)rng(), 0.2f, lifetime(rng));
+		}
+	}
+
+	/* Live particles and outputs of two runs are bitwise identical */
+	static bool SameParticles(const ParticlePool& a, const ParticlePool& b) {
+		if (a.GetCount() != b.GetCount()) {
+			return false;
+		}
+		for (int c = 0; c < ParticlePool::NUM_CHANNELS; c++) {
+			ParticlePool::Channel channel = (ParticlePool::Channel)c;
+			if (std::memcmp(a.GetChannel(channel), b.GetChannel(channel), a.GetCount() * sizeof(float)) != 0) {
+				return false;
+			}
+		}
+		return std::memcmp(a.GetColors(), b.GetColors(), a.GetCount() * sizeof(uint32_t)) == 0;
+	}
+
+	/* Buffers a simulation pass writes to, sized for count particles */
+	struct ParticleUpload {
+		std::vector<float> positionSize, depths;
+		std::vector<uint32_t> colors;
+
+		ParticleOutput Resize(int count) {
+			positionSize.resize((size_t)count * 4);
+			depths.resize(count);
+			colors.resize(count);
+			ParticleOutput output;
+			output.positionSize = positionSize.data();
+			output.colors = colors.data();
+			output.depths = depths.data();
+			output.eye = glm::vec3(0.0f, 5.0f, 20.0f);
+			return output;
+		}
+		bool operator==(const ParticleUpload& other) const {
+			return positionSize == other.positionSize && depths == other.depths && colors == other.colors;
+		}
+	};
+
+	/*
+		The fused simulate-and-pack pass on each instruction set, against integrating and then packing separately,
+		and then the whole update (including the compaction) from 1 to N threads. Every run must match the serial
+		scalar run bit for bit.
+	*/
+	void RunParticleKernels(std::ostream& out) {
+		const int count = 1000000;
+		const int frames = 60;
+		out << count << " particles, " << frames << " frames of " << FRAME_TIME * 1000.0f << " ms" << std::endl;
+
+		/* Reference: scalar kernel, one thread */
+		ParticlePool reference;
+		ParticleUpload referenceUpload;
+		FillPool(reference, count);
+		for (int frame = 0; frame < frames; frame++) {
+			ParticleOutput output = referenceUpload.Resize(reference.GetCount());
+			ParticleStreams streams = reference.GetStreams();
+			ParticleKernels::Simulate(streams, 0, reference.GetCount(), FRAME_TIME, GRAVITY, output, ParticleKernels::Path::Scalar);
+		}
+
+		/* Integrate only, then pack in a second pass, as the pool did before the kernels */
+		{
+			ParticlePool pool;
+			ParticleUpload upload;
+			FillPool(pool, count);
+			double ms = 0.0;
+			for (int frame = 0; frame < frames; frame++) {
+				ParticleOutput output = upload.Resize(pool.GetCount());
+				ParticleStreams streams = pool.GetStreams();
+				ms += TimeMs([&]() {
+					ParticleKernels::Simulate(streams, 0, pool.GetCount(), FRAME_TIME, GRAVITY, ParticleOutput(), ParticleKernels::Path::Scalar);
+					pool.Pack(output.positionSize, output.colors);
+				});
+			}
+			ms /= frames;
+			out << "  scalar integrate, then pack: " << ms << " ms (" << count / ms << " particles/ms)" << std::endl;
+		}
+
+		const ParticleKernels::Path paths[] = { ParticleKernels::Path::Scalar, ParticleKernels::Path::SSE, ParticleKernels::Path::AVX2 };
+		for (ParticleKernels::Path path : paths) {
+			const char* name = ParticleKernels::GetName(path);
+			if (!ParticleKernels::IsSupported(path)) {
+				out << "  " << name << ": not supported by this CPU" << std::endl;
+				continue;
+			}
+			ParticlePool pool;
+			ParticleUpload upload;
+			FillPool(pool, count);
+			double ms = 0.0;
+			for (int frame = 0; frame < frames; frame++) {
+				ParticleOutput output = upload.Resize(pool.GetCount());
+				ParticleStreams streams = pool.GetStreams();
+				ms += TimeMs([&]() { ParticleKernels::Simulate(streams, 0, pool.GetCount(), FRAME_TIME, GRAVITY, output, path); });
+			}
+			ms /= frames;
+			bool same = SameParticles(pool, reference) && upload == referenceUpload;
+			out << "  " << name << " fused simulate and pack: " << ms << " ms (" << count / ms << " particles/ms), "
+				<< (same ? "same result" : "DIFFERENT RESULT") << std::endl;
+		}
+
+		/* Whole updates with compaction; the reference here is the serial update */
+		ParticlePool serial;
+		ParticleUpload serialUpload;
+		FillPool(serial, count);
+		for (int frame = 0; frame < frames; frame++) {
+			serial.Update(FRAME_TIME, GRAVITY, serialUpload.Resize(serial.GetCount()));
+		}
+
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		double oneThreadMs = 0.0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+			ThreadPool threadPool(threads);
+			ParticlePool pool;
+			ParticleUpload upload;
+			FillPool(pool, count);
+			double ms = 0.0;
+			int killed = 0;
+			for (int frame = 0; frame < frames; frame++) {
+				ParticleOutput output = upload.Resize(pool.GetCount());
+				ms += TimeMs([&]() { killed += pool.Update(FRAME_TIME, GRAVITY, output, &threadPool); });
+			}
+			ms /= frames;
+			if (threads == 1) {
+				oneThreadMs = ms;
+			}
+			bool same = SameParticles(pool, serial) && upload == serialUpload;
+			out << "  update on " << threads << " thread(s): " << ms << " ms (" << count / ms << " particles/ms, speedup " << oneThreadMs / ms
+				<< "x), " << killed / frames << " killed per frame, " << (same ? "same state" : "DIFFERENT STATE") << std::endl;
+			if (threads == maxThreads) {
+				break;
+			}
+		}
+	}
+
+	/*
+		Back-to-front ordering of a steady state emitter, timing only the sort: std::sort over every slot as
+		TestParticle used to, against the radix sort of the live particles and the coherent sort that starts from the
+		previous frame's order. The fountain shoots fast particles past an orbiting camera; the smoke drifts slowly in
+		front of a still one, which is where the previous order stays nearly sorted. All sorts must produce the same
+		depth sequence.
+	*/
+	void RunParticleSort(std::ostream& out) {
+		struct Scene {
+			const char* name;
+			float speed, spread, orbit; //Upward speed and its random spread, camera turn per frame in radians
+			glm::vec3 acceleration;
+		};
+		const Scene scenes[] = {
+			{ "fountain", 10.0f, 1.0f, 0.01f, GRAVITY },
+			{ "smoke", 0.2f, 0.05f, 0.0f, glm::vec3(0.0f) },
+		};
+		const int counts[] = { 10000, 100000, 1000000 };
+		const int warmupFrames = 180;
+		const int frames = 30;
+		for (const Scene& scene : scenes) {
+			out << scene.name << ":" << std::endl;
+			for (int count : counts) {
+				std::mt19937 rng(11);
+				std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+				std::uniform_real_distribution<float> lifetime(0.5f, 3.0f);
+				auto spawn = [&](ParticlePool& pool) {
+					glm::vec3 position(uniform(rng), uniform(rng), uniform(rng));
+					glm::vec3 velocity = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * scene.spread + glm::vec3(0.0f, scene.speed, 0.0f);
+					pool.Spawn(position, velocity, (uint32_t)rng(), 0.2f, lifetime(rng));
+				};
+				ParticlePool pool(count);
+				while (!pool.IsFull()) {
+					spawn(pool);
+				}
+
+				ParticleSorter radix, coherent;
+				std::vector<float> depths;
+				std::vector<int> all;
+				double stdMs = 0.0, radixMs = 0.0, coherentMs = 0.0;
+				int live = 0, coherentFrames = 0, displaced = 0;
+				bool same = true;
+				for (int frame = 0; frame < warmupFrames + frames; frame++) {
+					const int slots = pool.GetCount();
+					depths.resize(slots);
+					ParticleOutput output;
+					output.depths = depths.data();
+					float angle = scene.orbit * frame;
+					output.eye = glm::vec3(20.0f * std::sin(angle), 5.0f, 20.0f * std::cos(angle));
+					int died = pool.Update(FRAME_TIME, scene.acceleration, output);
+					for (int i = 0; i < died; i++) {
+						spawn(pool);
+					}
+					if (frame < warmupFrames) {
+						continue;
+					}
+
+					all.resize(slots);
+					stdMs += TimeMs([&]() {
+						for (int i = 0; i < slots; i++) {
+							all[i] = i;
+						}
+						std::sort(all.begin(), all.end(), [&](int a, int b) { return depths[a] > depths[b]; });
+					});
+					radixMs += TimeMs([&]() { live = radix.Sort(depths.data(), slots); });
+					coherentMs += TimeMs([&]() { coherent.Sort(depths.data(), slots, ParticleSorter::Mode::Coherent); });
+					if (coherent.WasCoherent()) {
+						coherentFrames++;
+						displaced += coherent.GetNumDisplaced();
+					}
+
+					/* Ties may come out in any order, so compare the depths */
+					same = same && live == slots - died && (int)coherent.GetOrder().size() == live;
+					for (int i = 0; i < live && same; i++) {
+						float depth = depths[all[i]];
+						same = depth >= 0.0f && depths[radix.GetOrder()[i]] == depth && depths[coherent.GetOrder()[i]] == depth;
+					}
+				}
+				stdMs /= frames;
+				radixMs /= frames;
+				coherentMs /= frames;
+				out << "  " << count << " slots, " << live << " alive: std::sort of all slots " << stdMs << " ms" << std::endl;
+				out << "    radix sort of the live ones: " << radixMs << " ms (" << stdMs / radixMs << "x)" << std::endl;
+				out << "    coherent: " << coherentMs << " ms (" << stdMs / coherentMs << "x), built on the previous order in " << coherentFrames
+					<< " of " << frames << " frames with " << (coherentFrames > 0 ? displaced / coherentFrames : 0) << " particles set aside, "
+					<< (same ? "same order" : "DIFFERENT ORDER") << std::endl;
+			}
+		}
+	}
+
+	/*
+		Spatial hash grid over particles spread uniformly through a 10 m cube, with the query radius set for about 30
+		neighbours per particle (a typical SPH support). Times the build on 1 to N threads, checking that it does not
+		depend on the thread count, SPH density queries against brute force on a sample, and a collision pass.
+	*/
+	void RunParticleGrid(std::ostream& out) {
+		const float PI = 3.14159265358979f;
+		const int counts[] = { 100000, 1000000 };
+		const float side = 10.0f;
+		const float neighbours = 30.0f;
+		const int repeats = 10;
+		const int samples = 1000;
+		unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		for (int count : counts) {
+			std::mt19937 rng(13);
+			std::uniform_real_distribution<float> uniform(0.0f, side);
+			std::vector<float> x(count), y(count), z(count);
+			for (int i = 0; i < count; i++) {
+				x[i] = uniform(rng); y[i] = uniform(rng); z[i] = uniform(rng);
+			}
+			const float radius = std::cbrt(neighbours * side * side * side / (count * 4.0f / 3.0f * PI));
+			out << count << " particles, query radius " << radius << " m:" << std::endl;
+
+			SpatialHashGrid serial;
+			serial.Build(x.data(), y.data(), z.data(), count, radius);
+			for (unsigned int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2) {
+				ThreadPool threadPool(threads);
+				SpatialHashGrid grid;
+				double ms = 0.0;
+				for (int r = 0; r < repeats; r++) {
+					ms += TimeMs([&]() { grid.Build(x.data(), y.data(), z.data(), count, radius, &threadPool); });
+				}
+				ms /= repeats;
+				bool same = grid.GetOrder() == serial.GetOrder();
+				out << "  build on " << threads << " thread(s): " << ms << " ms (" << count / ms / 1000.0 << " M particles/s), "
+					<< grid.GetNumBuckets() << " buckets, " << grid.GetMemoryUsage() / (1024.0 * 1024.0) << " MB, " << (same ? "same grid" : "DIFFERENT GRID") << std::endl;
+				if (threads == maxThreads) {
+					break;
+				}
+			}
+
+			/* Density at every particle, then brute force on a sample */
+			std::vector<float> densities(count);
+			double ms = TimeMs([&]() { serial.ComputeDensities(radius, 1.0f, densities.data(), &ThreadPool::Global()); });
+			long long found = 0;
+			for (int slot = 0; slot < count; slot++) {
+				serial.ForEachNeighbour(serial.GetPosition(slot), radius, [&](int, float) { found++; });
+			}
+			const float poly6 = 315.0f / (64.0f * PI * std::pow(radius, 9.0f));
+			float maxError = 0.0f;
+			for (int s = 0; s < samples; s++) {
+				int i = (int)(rng() % count);
+				float density = 0.0f;
+				for (int j = 0; j < count; j++) {
+					float dx = x[j] - x[i], dy = y[j] - y[i], dz = z[j] - z[i];
+					float w = radius * radius - (dx * dx + dy * dy + dz * dz);
+					density += w >= 0.0f ? w * w * w : 0.0f;
+				}
+				maxError = std::max(maxError, std::abs(poly6 * density - densities[i]) / (poly6 * density));
+			}
+			out << "  density queries: " << ms << " ms (" << count / ms / 1000.0 << " M queries/s, " << (double)found / count
+				<< " neighbours each), largest error against brute force " << maxError << std::endl;
+
+			/* One collision pass over particles as wide as the query radius */
+			ParticlePool pool(count);
+			for (int i = 0; i < count; i++) {
+				pool.Spawn(glm::vec3(x[i], y[i], z[i]), glm::vec3(uniform(rng), uniform(rng), uniform(rng)) - glm::vec3(0.5f * side), 0xffffffffu, radius, 1.0f);
+			}
+			ParticleCollider collider;
+			ms = TimeMs([&]() { collider.Collide(pool.GetStreams(), count, &ThreadPool::Global()); });
+			out << "  collision pass: " << ms << " ms, " << collider.GetNumContacts() << " contacts" << std::endl;
+		}
+	}
+
+	/* A particle read back from a backend, ordered by the parts that come straight from its spawn id and age */
+	struct BackendParticle {
+		uint32_t color;
+		float life, size;
+		glm::vec3 position, velocity;
+
+		inline bool operator<(const BackendParticle& other) const {
+			return std::tie(color, life, size) < std::tie(other.color, other.life, other.size);
+		}
+	};
+
+	static std::vector<BackendParticle> ReadParticles(ParticleBackend& backend) {
+		ParticlePool pool;
+		backend.ReadBack(pool);
+		std::vector<BackendParticle> particles(pool.GetCount());
+		for (int i = 0; i < pool.GetCount(); i++) {
+			particles[i].color = pool.GetColors()[i];
+			particles[i].life = pool.GetChannel(ParticlePool::LIFE)[i];
+			particles[i].size = pool.GetChannel(ParticlePool::SIZE)[i];
+			particles[i].position = pool.GetPosition(i);
+			particles[i].velocity = glm::vec3(pool.GetChannel(ParticlePool::VELOCITY_X)[i], pool.GetChannel(ParticlePool::VELOCITY_Y)[i], pool.GetChannel(ParticlePool::VELOCITY_Z)[i]);
+		}
+		std::sort(particles.begin(), particles.end());
+		return particles;
+	}
+
+	/*
+		The CPU and GPU backends run the same emitter side by side (without collisions, which only the CPU backend
+		has), each frame timed to completion, and the particles they end up with are compared. The GPU may round
+		differently (contracting into FMA, say), so positions and velocities are compared relative to their size.
+		The last run spawns more than fits, so both backends replace their oldest particles every frame.
+	*/
+	void RunParticleBackends(std::ostream& out) {
+		struct Run {
+			int capacity;
+			bool saturated;
+		};
+		const Run runs[] = { { 100000, false }, { 1000000, false }, { 100000, true } };
+		const int frames = 90;
+		const float tolerance = 1e-4f;
+		out << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+		/* Draws need a complete framebuffer even with rasterization off, and a headless context has no default one */
+		GLuint framebuffer, colorBuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+		ParticleEmitter emitter;
+		emitter.lifetime = 1.0f;
+		for (const Run& run : runs) {
+			/*
+				Close to full once the first particles start dying, or full after a whole number of frames well
+				within the lifetime, so that both backends replace whole frames' worth and hold the same particles
+			*/
+			const int capacity = run.capacity;
+			const int numNew = run.saturated ? capacity / 25 : (int)(0.9f * capacity * FRAME_TIME / emitter.lifetime);
+			const glm::vec3 eye(0.0f, 5.0f, 10.0f);
+			std::unique_ptr<ParticleBackend> backends[ParticleBackend::NUM_TYPES];
+			double ms[ParticleBackend::NUM_TYPES] = {};
+			for (int t = 0; t < ParticleBackend::NUM_TYPES; t++) {
+				backends[t] = ParticleBackend::Create((ParticleBackend::Type)t, capacity, &ThreadPool::Global());
+			}
+			static_cast<CpuParticleBackend&>(*backends[(int)ParticleBackend::Type::CPU]).GetSettings().collisions = false;
+			glFinish();
+
+			for (int frame = 0; frame < frames; frame++) {
+				for (int t = 0; t < ParticleBackend::NUM_TYPES; t++) {
+					ms[t] += TimeMs([&]() {
+						backends[t]->Update(FRAME_TIME, emitter, numNew, eye);
+						glFinish();
+					});
+				}
+			}
+
+			out << capacity << " slots, " << numNew << " spawned per frame, " << frames << " frames:" << std::endl;
+			for (int t = 0; t < ParticleBackend::NUM_TYPES; t++) {
+				out << "  " << ParticleBackend::GetName((ParticleBackend::Type)t) << ": " << ms[t] / frames << " ms per frame, "
+					<< backends[t]->GetCount() << " particles, " << backends[t]->GetMemoryUsage() / (1024.0 * 1024.0) << " MB" << std::endl;
+			}
+
+			const std::vector<BackendParticle> cpu = ReadParticles(*backends[(int)ParticleBackend::Type::CPU]);
+			const std::vector<BackendParticle> gpu = ReadParticles(*backends[(int)ParticleBackend::Type::GPU]);
+			bool same = cpu.size() == gpu.size();
+			float positionError = 0.0f, velocityError = 0.0f;
+			for (size_t i = 0; same && i < cpu.size(); i++) {
+				same = cpu[i].color == gpu[i].color && cpu[i].life == gpu[i].life;
+				positionError = std::max(positionError, glm::length(cpu[i].position - gpu[i].position) / std::max(1.0f, glm::length(cpu[i].position)));
+				velocityError = std::max(velocityError, glm::length(cpu[i].velocity - gpu[i].velocity) / std::max(1.0f, glm::length(cpu[i].velocity)));
+			}
+			out << "  read back " << cpu.size() << " (CPU) and " << gpu.size() << " (GPU) particles, largest relative error: position "
+				<< positionError << ", velocity " << velocityError << ", " << (same && positionError <= tolerance && velocityError <= tolerance ? "same particles" : "DIFFERENT PARTICLES") << std::endl;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+
+}
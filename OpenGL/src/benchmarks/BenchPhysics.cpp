@@ -0,0 +1,556 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Mesh.h"
+#include "io/ObjParser.h"
+#include "geometry/ConvexHull.h"
+#include "geometry/TransformBatch.h"
+#include "physics/BroadPhase.h"
+#include "physics/KallayKernel.h"
+#include "physics/MassProperties.h"
+#include "physics/NarrowPhase.h"
+#include "physics/PhysicsWorld.h"
+#include "physics/InertiaTensor.h"
+#include "util/ThreadPool.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+namespace Benchmark {
+
+	/* Largest absolute difference between two sets of mass properties (mass, centre of mass and tensor entries) */
+	static float MaxDifference(const InertiaTensor::MassProps& a, float mass, const glm::vec3& com, const glm::mat3& I) {
+		float difference = std::abs(a.mass - mass);
+		for (int i = 0; i < 3; i++) {
+			difference = std::max(difference, std::abs(a.com[i] - com[i]));
+			for (int j = 0; j < 3; j++) {
+				difference = std::max(difference, std::abs(a.Ibody[i][j] - I[i][j]));
+			}
+		}
+		return difference;
+	}
+
+	void RunMassProperties(std::ostream& out) {
+		const float PI = 3.14159265358979323846f;
+		ThreadPool& pool = ThreadPool::Global();
+		out << "threads: " << pool.GetNumThreads() << ", face block " << InertiaTensor::FACE_BLOCK_SIZE << std::endl;
+
+		const Mesh::SphereDivisions resolutions[] = { Mesh::res16, Mesh::res32, Mesh::res64, Mesh::res128, Mesh::res256 };
+		std::vector<std::unique_ptr<Mesh>> spheres;
+		std::vector<InertiaTensor::MassProps> single;
+		double singleMs = 0.0;
+
+		for (Mesh::SphereDivisions res : resolutions) {
+			spheres.emplace_back(Mesh::Sphere(res, 1));
+			Mesh& sphere = *spheres.back();
+			int iterations = sphere.GetNumFaces() < 100000 ? 20 : 5;
+
+			InertiaTensor::MassProps serial, parallel;
+			double serialMs = TimeMs([&]() { serial = InertiaTensor::Compute(sphere.GetFaces(), 1.0f); }, iterations);
+			double parallelMs = TimeMs([&]() { parallel = InertiaTensor::Compute(sphere.GetFaces(), 1.0f, &pool); }, iterations);
+			single.push_back(parallel);
+			singleMs += parallelMs;
+
+			std::unique_ptr<MassProperties> kallay;
+			double kallayMs = TimeMs([&]() { kallay = std::make_unique<MassProperties>(sphere); }, iterations);
+			const MassProps& reference = kallay->GetMassProps();
+
+			/* Unit sphere at unit density: m = 4/3 pi, I = 2/5 m about every axis */
+			float exactMass = 4.0f / 3.0f * PI;
+			float exactI = 0.4f * exactMass;
+
+			out << "sphere res" << (int)res << ": " << sphere.GetNumFaces() << " faces, mass " << parallel.mass << " (exact " << exactMass
+				<< "), Ixx " << parallel.Ibody[0][0] << " (exact " << exactI << ")" << std::endl;
+			out << "  serial:   " << serialMs << " ms" << std::endl;
+			out << "  parallel: " << parallelMs << " ms (speedup " << serialMs / parallelMs << "x), "
+				<< (MaxDifference(serial, parallel.mass, parallel.com, parallel.Ibody) == 0.0f ? "identical to serial" : "DIFFERS FROM SERIAL") << std::endl;
+			/* Two different integrations of the same mesh, so they agree up to float rounding of the results */
+			float kallayDifference = MaxDifference(parallel, reference.mass, reference.com, reference.I);
+			out << "  Kallay:   " << kallayMs << " ms, max difference " << kallayDifference << ", "
+				<< (kallayDifference <= 1e-4f ? "matches MassProperties" : "DIFFERS FROM MASSPROPERTIES") << std::endl;
+		}
+
+		/* All spheres in one batch */
+		std::vector<const Mesh*> meshes;
+		for (const std::unique_ptr<Mesh>& sphere : spheres) {
+			meshes.push_back(sphere.get());
+		}
+		std::vector<InertiaTensor::MassProps> batched;
+		double batchMs = TimeMs([&]() { InertiaTensor::ComputeBatch(meshes, 1.0f, batched, &pool); }, 5);
+
+		bool identical = true;
+		for (size_t i = 0; i < meshes.size(); i++) {
+			identical = identical && MaxDifference(batched[i], single[i].mass, single[i].com, single[i].Ibody) == 0.0f;
+		}
+		out << "batch of " << meshes.size() << " spheres: " << batchMs << " ms (one at a time " << singleMs << " ms), "
+			<< (identical ? "identical to single mesh results" : "DIFFERS FROM SINGLE MESH RESULTS") << std::endl;
+	}
+
+	/* The per-triangle loop MassProperties used before KallayKernel: signed volumes, plain double sums */
+	static KallaySums ReferenceKallaySums(const std::vector<float>& pos, const std::vector<unsigned int>& inds) {
+		KallaySums sums;
+		int numTriangles = (int)inds.size() / 3;
+		for (int idx = 0; idx < numTriangles; idx++) {
+			const float* p[3] = { &pos[inds[idx * 3] * 3], &pos[inds[idx * 3 + 1] * 3], &pos[inds[idx * 3 + 2] * 3] };
+			double x1 = p[0][0], y1 = p[0][1], z1 = p[0][2], x2 = p[1][0], y2 = p[1][1], z2 = p[1][2], x3 = p[2][0], y3 = p[2][1], z3 = p[2][2];
+			double v = x1 * y2*z3 + y1 * z2*x3 + x2 * y3*z1 - (x3*y2*z1 + x2 * y1*z3 + y3 * z2*x1);
+			double x4 = x1 + x2 + x3, y4 = y1 + y2 + y3, z4 = z1 + z2 + z3;
+			sums.m += v;
+			sums.Cx += v * x4; sums.Cy += v * y4; sums.Cz += v * z4;
+			sums.xx += v * (x1*x1 + x2 * x2 + x3 * x3 + x4 * x4);
+			sums.yy += v * (y1*y1 + y2 * y2 + y3 * y3 + y4 * y4);
+			sums.zz += v * (z1*z1 + z2 * z2 + z3 * z3 + z4 * z4);
+			sums.yx += v * (y1*x1 + y2 * x2 + y3 * x3 + y4 * x4);
+			sums.zx += v * (z1*x1 + z2 * x2 + z3 * x3 + z4 * x4);
+			sums.zy += v * (z1*y1 + z2 * y2 + z3 * y3 + z4 * y4);
+		}
+		return sums;
+	}
+
+	/* Largest difference between two sets of sums, relative to the largest sum */
+	static double MaxRelativeDifference(const KallaySums& a, const KallaySums& b) {
+		const double* x = &a.m;
+		const double* y = &b.m;
+		double scale = 0.0, difference = 0.0;
+		for (int i = 0; i < 10; i++) {
+			scale = std::max(scale, std::abs(y[i]));
+			difference = std::max(difference, std::abs(x[i] - y[i]));
+		}
+		return scale > 0.0 ? difference / scale : difference;
+	}
+
+	void RunKallay(std::ostream& out) {
+		ObjMeshData data;
+		if (!ObjParser::ParseFile("res/meshes/suzanne.obj", data)) {
+			out << "unable to load res/meshes/suzanne.obj" << std::endl;
+			return;
+		}
+		const std::vector<float>& pos = data.positions;
+		const std::vector<unsigned int>& inds = data.positionIndices;
+		int numTriangles = (int)inds.size() / 3;
+		const int iterations = 200;
+
+		KallaySums reference;
+		double referenceMs = TimeMs([&]() { reference = ReferenceKallaySums(pos, inds); }, iterations);
+		out << "suzanne.obj: " << numTriangles << " triangles" << std::endl;
+		out << "  reference loop: " << referenceMs << " ms (" << numTriangles / (referenceMs * 1000.0) << " M triangles/s)" << std::endl;
+
+		const KallayKernel::Path paths[] = { KallayKernel::Path::Scalar, KallayKernel::Path::SSE, KallayKernel::Path::AVX2 };
+		for (KallayKernel::Path path : paths) {
+			const char* name = KallayKernel::GetName(path);
+			if (!KallayKernel::IsSupported(path)) {
+				out << "  " << name << ": not supported by this CPU" << std::endl;
+				continue;
+			}
+
+			KallaySums sums;
+			double ms = TimeMs([&]() {
+				sums = KallaySums();
+				KallayKernel::Accumulate(pos.data(), inds.data(), numTriangles, sums, path);
+			}, iterations);
+			out << "  " << name << ": " << ms << " ms (" << numTriangles / (ms * 1000.0) << " M triangles/s, speedup " << referenceMs / ms
+				<< "x), relative error vs reference " << MaxRelativeDifference(sums, reference) << std::endl;
+		}
+	}
+
+	/* Boxes drifting and spinning inside a cube that keeps the number of boxes per unit volume fixed */
+	struct BoxScene {
+		TransformArrays transforms;
+		std::vector<glm::vec3> positions, velocities, spinAxes;
+		std::vector<glm::quat> rotations;
+		std::vector<float> spinRates, hx, hy, hz;
+		float halfSize = 0.0f;
+
+		explicit BoxScene(int count) {
+			std::mt19937 rng(13);
+			std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+			std::uniform_real_distribution<float> size(0.2f, 0.6f);
+			halfSize = 0.5f * 2.5f * std::cbrt((float)count);
+			transforms.Resize(count);
+			positions.resize(count); velocities.resize(count); spinAxes.resize(count); rotations.resize(count);
+			spinRates.resize(count); hx.resize(count); hy.resize(count); hz.resize(count);
+			for (int i = 0; i < count; i++) {
+				/* One box in a hundred is much larger, which the grid has to put on a coarser level */
+				float scale = i % 100 == 0 ? 6.0f : 1.0f;
+				hx[i] = size(rng) * scale; hy[i] = size(rng) * scale; hz[i] = size(rng) * scale;
+				positions[i] = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * halfSize;
+				velocities[i] = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 2.0f;
+				spinAxes[i] = glm::normalize(glm::vec3(uniform(rng), uniform(rng), uniform(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+				spinRates[i] = uniform(rng) * 3.0f;
+				rotations[i] = glm::angleAxis(uniform(rng) * 3.14159265f, spinAxes[i]);
+				transforms.Set(i, positions[i], rotations[i], glm::vec3(1.0f));
+			}
+		}
+
+		void Step(float dt) {
+			for (int i = 0; i < transforms.GetCount(); i++) {
+				positions[i] += velocities[i] * dt;
+				for (int axis = 0; axis < 3; axis++) {
+					if (std::abs(positions[i][axis]) > halfSize) {
+						velocities[i][axis] = -velocities[i][axis];
+					}
+				}
+				rotations[i] = glm::normalize(glm::angleAxis(spinRates[i] * dt, spinAxes[i]) * rotations[i]);
+				transforms.Set(i, positions[i], rotations[i], glm::vec3(1.0f));
+			}
+		}
+	};
+
+	void RunBroadPhase(std::ostream& out) {
+		ThreadPool& pool = ThreadPool::Global();
+		out << "threads: " << pool.GetNumThreads() << std::endl;
+		const float dt = 1.0f / 60.0f;
+
+		const int counts[] = { 1000, 10000, 100000 };
+		for (int count : counts) {
+			BoxScene scene(count);
+			BoundsArrays bounds;
+			SweepAndPrune sap;
+			MultiLevelGrid grid;
+			std::vector<BodyPair> sapPairs, gridPairs;
+			const int frames = count <= 10000 ? 30 : 10;
+
+			/* First frame: both start from scratch, checked against every pair and a serial run */
+			bounds.Update(scene.transforms.GetBatch(), scene.hx.data(), scene.hy.data(), scene.hz.data(), &pool);
+			double sapBuildMs = TimeMs([&]() { sap.FindPairs(bounds, sapPairs, &pool); });
+			double gridBuildMs = TimeMs([&]() { grid.FindPairs(bounds, gridPairs, &pool); });
+
+			std::vector<BodyPair> serialPairs;
+			MultiLevelGrid serialGrid;
+			serialGrid.FindPairs(bounds, serialPairs);
+			bool valid = sapPairs == gridPairs && serialPairs == gridPairs;
+			if (count <= 10000) {
+				std::vector<BodyPair> reference;
+				for (int a = 0; a < count; a++) {
+					for (int b = a + 1; b < count; b++) {
+						if (bounds.Overlap(a, b)) {
+							reference.push_back({ a, b });
+						}
+					}
+				}
+				valid = valid && reference == sapPairs;
+			}
+
+			/* Then the boxes move: SAP repairs its order, the grid is rebuilt */
+			double updateMs = 0.0, sapMs = 0.0, gridMs = 0.0;
+			int64_t swaps = 0;
+			size_t totalPairs = 0;
+			for (int frame = 0; frame < frames; frame++) {
+				scene.Step(dt);
+				updateMs += TimeMs([&]() { bounds.Update(scene.transforms.GetBatch(), scene.hx.data(), scene.hy.data(), scene.hz.data(), &pool); });
+				sapMs += TimeMs([&]() { sap.FindPairs(bounds, sapPairs, &pool); });
+				gridMs += TimeMs([&]() { grid.FindPairs(bounds, gridPairs, &pool); });
+				swaps += sap.GetLastSwaps();
+				totalPairs += sapPairs.size();
+				valid = valid && sapPairs == gridPairs;
+			}
+
+			out << count << " boxes: " << totalPairs / frames << " pairs per frame, " << (valid ? "pair lists identical" : "PAIR LISTS DIFFER")
+				<< (count <= 10000 ? " (and match all-pairs test)" : "") << std::endl;
+			out << "  bounds update: " << updateMs / frames << " ms" << std::endl;
+			out << "  sweep and prune: " << sapMs / frames << " ms per frame (first frame " << sapBuildMs << " ms), "
+				<< (double)swaps / frames / count << " swaps per box, " << sap.GetMemoryUsage() / 1024 << " KB" << std::endl;
+			out << "  multi-level grid: " << gridMs / frames << " ms per frame (first frame " << gridBuildMs << " ms), " << grid.GetNumLevels()
+				<< " levels, " << grid.GetNumCells() << " cells, " << grid.GetMemoryUsage() / 1024 << " KB" << std::endl;
+		}
+	}
+
+	static glm::quat RandomRotation(std::mt19937& rng) {
+		std::normal_distribution<float> normal;
+		return glm::normalize(glm::quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+	}
+
+	/* Largest errors of narrow phase contacts against the exact answer */
+	struct ContactErrors {
+		float depth = 0.0f, normal = 0.0f; //Normal error as 1 - cos(angle)
+		int separated = 0, penetrating = 0;
+
+		void Add(const ContactPoint& contact, float exactDepth, const glm::vec3& exactNormal) {
+			depth = std::max(depth, std::abs(contact.depth - exactDepth));
+			normal = std::max(normal, 1.0f - glm::dot(contact.normal, exactNormal));
+			(exactDepth > 0.0f ? penetrating : separated)++;
+		}
+	};
+
+	static void Report(std::ostream& out, const char* name, const ContactErrors& errors) {
+		out << "  " << name << ": " << errors.separated << " apart, " << errors.penetrating << " penetrating, max depth error " << errors.depth
+			<< ", max normal error (1 - cos) " << errors.normal << std::endl;
+	}
+
+	/* Pairs per second of Collide over a list of shape pairs */
+	static void ReportThroughput(std::ostream& out, const std::string& name, const std::vector<ConvexShape>& a, const std::vector<ConvexShape>& b) {
+		int contacts = 0;
+		double ms = TimeMs([&]() {
+			contacts = 0;
+			ContactPoint contact;
+			for (size_t i = 0; i < a.size(); i++) {
+				contacts += NarrowPhase::Collide(a[i], b[i], contact) ? 1 : 0;
+			}
+		}, 5);
+		out << "  " << name << ": " << a.size() / (ms * 1000.0) << " M pairs/s (" << 100 * contacts / (int)a.size() << "% in contact)" << std::endl;
+	}
+
+	void RunNarrowPhase(std::ostream& out) {
+		const int numPairs = 20000;
+		const float FAR_AWAY = 1e30f; //Contact distance that makes Collide report separated pairs too
+		std::mt19937 rng(17);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> size(0.2f, 2.0f);
+
+		out << "accuracy against analytic contacts (" << numPairs << " random pairs each):" << std::endl;
+
+		ContactErrors sphereSphere;
+		for (int i = 0; i < numPairs; i++) {
+			ConvexShape a = ConvexShape::Sphere(size(rng), glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 2.0f);
+			ConvexShape b = ConvexShape::Sphere(size(rng), glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 2.0f);
+			ContactPoint contact;
+			NarrowPhase::Collide(a, b, contact, FAR_AWAY);
+			glm::vec3 d = b.position - a.position;
+			sphereSphere.Add(contact, a.radius + b.radius - glm::length(d), glm::normalize(d));
+		}
+		Report(out, "sphere-sphere", sphereSphere);
+
+		/* Box A, sphere B: the closest point of the box to the centre, or the nearest face if the centre is inside */
+		ContactErrors boxSphere;
+		for (int i = 0; i < numPairs; i++) {
+			glm::vec3 h(size(rng), size(rng), size(rng));
+			ConvexShape a = ConvexShape::Box(h, glm::vec3(uniform(rng), uniform(rng), uniform(rng)), RandomRotation(rng));
+			ConvexShape b = ConvexShape::Sphere(size(rng) * 0.5f, a.position + glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 3.0f);
+			ContactPoint contact;
+			NarrowPhase::Collide(a, b, contact, FAR_AWAY);
+
+			glm::vec3 c = a.ToLocal(b.position);
+			glm::vec3 q = glm::clamp(c, -h, h);
+			if (q != c) {
+				boxSphere.Add(contact, b.radius - glm::length(c - q), a.rotation * glm::normalize(c - q));
+			} else {
+				glm::vec3 inside = h - glm::abs(c);
+				int axis = inside.x < inside.y ? (inside.x < inside.z ? 0 : 2) : (inside.y < inside.z ? 1 : 2);
+				glm::vec3 n(0.0f);
+				n[axis] = c[axis] < 0.0f ? -1.0f : 1.0f;
+				boxSphere.Add(contact, b.radius + inside[axis], a.rotation * n);
+			}
+		}
+		Report(out, "box-sphere", boxSphere);
+
+		/* Axis aligned boxes: the gap along each axis, or the smallest overlap */
+		ConvexHull unitCube;
+		std::vector<float> corners;
+		for (int c = 0; c < 8; c++) {
+			corners.insert(corners.end(), { c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? 1.0f : -1.0f });
+		}
+		unitCube.Build(corners);
+		ContactErrors boxBox, hullHull;
+		for (int i = 0; i < numPairs; i++) {
+			glm::vec3 ha(size(rng), size(rng), size(rng)), hb(size(rng), size(rng), size(rng));
+			glm::vec3 d = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 4.0f;
+			ConvexShape a = ConvexShape::Box(ha, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			ConvexShape b = ConvexShape::Box(hb, d, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			ContactPoint contact;
+			NarrowPhase::Collide(a, b, contact, FAR_AWAY);
+
+			glm::vec3 gap = glm::abs(d) - (ha + hb);
+			float exactDepth;
+			glm::vec3 exactNormal(0.0f);
+			if (gap.x < 0.0f && gap.y < 0.0f && gap.z < 0.0f) {
+				int axis = gap.x > gap.y ? (gap.x > gap.z ? 0 : 2) : (gap.y > gap.z ? 1 : 2);
+				exactDepth = -gap[axis];
+				exactNormal[axis] = d[axis] < 0.0f ? -1.0f : 1.0f;
+			} else {
+				glm::vec3 apart = glm::max(gap, glm::vec3(0.0f));
+				exactDepth = -glm::length(apart);
+				exactNormal = glm::normalize(apart * glm::sign(d));
+			}
+			boxBox.Add(contact, exactDepth, exactNormal);
+
+			/* The same boxes as hulls: a unit cube hull can't be scaled, so compare at the cube's size */
+			ConvexShape hullA = ConvexShape::Hull(unitCube, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			ConvexShape hullB = ConvexShape::Hull(unitCube, d, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			NarrowPhase::Collide(hullA, hullB, contact, FAR_AWAY);
+			gap = glm::abs(d) - glm::vec3(2.0f);
+			exactNormal = glm::vec3(0.0f);
+			if (gap.x < 0.0f && gap.y < 0.0f && gap.z < 0.0f) {
+				int axis = gap.x > gap.y ? (gap.x > gap.z ? 0 : 2) : (gap.y > gap.z ? 1 : 2);
+				exactDepth = -gap[axis];
+				exactNormal[axis] = d[axis] < 0.0f ? -1.0f : 1.0f;
+			} else {
+				glm::vec3 apart = glm::max(gap, glm::vec3(0.0f));
+				exactDepth = -glm::length(apart);
+				exactNormal = glm::normalize(apart * glm::sign(d));
+			}
+			hullHull.Add(contact, exactDepth, exactNormal);
+		}
+		Report(out, "box-box (axis aligned)", boxBox);
+		Report(out, "cube hull-cube hull (axis aligned)", hullHull);
+
+		/* Throughput on randomly placed and rotated pairs, about half of them in contact */
+		ObjMeshData suzanne;
+		ConvexHull suzanneHull;
+		if (ObjParser::ParseFile("res/meshes/suzanne.obj", suzanne)) {
+			suzanneHull.Build(suzanne.positions);
+		}
+		std::vector<ConvexShape> spheresA, spheresB, boxesA, boxesB, hullsA, hullsB;
+		for (int i = 0; i < numPairs; i++) {
+			glm::vec3 pa = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 1.5f;
+			glm::vec3 pb = glm::vec3(uniform(rng), uniform(rng), uniform(rng)) * 1.5f;
+			spheresA.push_back(ConvexShape::Sphere(0.75f, pa));
+			spheresB.push_back(ConvexShape::Sphere(0.75f, pb));
+			boxesA.push_back(ConvexShape::Box(glm::vec3(0.6f), pa, RandomRotation(rng)));
+			boxesB.push_back(ConvexShape::Box(glm::vec3(0.6f), pb, RandomRotation(rng)));
+			hullsA.push_back(ConvexShape::Hull(suzanneHull, pa, RandomRotation(rng)));
+			hullsB.push_back(ConvexShape::Hull(suzanneHull, pb, RandomRotation(rng)));
+		}
+		out << "throughput (Collide):" << std::endl;
+		ReportThroughput(out, "sphere-sphere", spheresA, spheresB);
+		ReportThroughput(out, "box-sphere", boxesA, spheresB);
+		ReportThroughput(out, "box-box", boxesA, boxesB);
+		ReportThroughput(out, "suzanne hull-hull (" + std::to_string(suzanneHull.GetVertices().size()) + " vertices)", hullsA, hullsB);
+
+		/* A box settling on a larger one: the manifold should build up the four corners and keep them */
+		ConvexShape ground = ConvexShape::Box(glm::vec3(4.0f, 0.5f, 4.0f), glm::vec3(0.0f, -0.5f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		ContactManifold manifold(0.02f);
+		int reused = 0;
+		const int frames = 30;
+		for (int frame = 0; frame < frames; frame++) {
+			/* Rock the box slightly so that each frame's deepest point is a different corner */
+			float angle = 0.004f * std::sin(frame * 1.3f);
+			glm::vec3 axis = glm::normalize(glm::vec3(std::cos(frame * 2.1f), 0.0f, std::sin(frame * 2.1f)));
+			ConvexShape box = ConvexShape::Box(glm::vec3(0.5f), glm::vec3(0.0f, 0.495f, 0.0f), glm::angleAxis(angle, axis));
+			manifold.Update(ground, box);
+			for (int i = 0; i < manifold.GetNumPoints(); i++) {
+				reused += manifold.GetPoint(i).lifetime > 0 ? 1 : 0;
+			}
+		}
+		out << "resting box manifold after " << frames << " frames: " << manifold.GetNumPoints() << " points, depths";
+		for (int i = 0; i < manifold.GetNumPoints(); i++) {
+			out << " " << manifold.GetPoint(i).depth;
+		}
+		out << ", " << reused << " point-frames carried over" << std::endl;
+	}
+
+	/* Static ground slab whose top face is at y = 0 */
+	static void AddGround(PhysicsWorld& world, float halfSize) {
+		world.AddBody(BodyDesc::Box(glm::vec3(halfSize, 0.5f, halfSize), 0.0f, glm::vec3(0.0f, -0.5f, 0.0f)));
+	}
+
+	/* Towers of unit cubes resting on the ground, each tower its own island */
+	static void BuildStacks(PhysicsWorld& world, int towersPerSide, int height) {
+		const float spacing = 2.5f;
+		AddGround(world, towersPerSide * spacing);
+		for (int x = 0; x < towersPerSide; x++) {
+			for (int z = 0; z < towersPerSide; z++) {
+				glm::vec3 base = glm::vec3(x - 0.5f * (towersPerSide - 1), 0.0f, z - 0.5f * (towersPerSide - 1)) * spacing;
+				for (int level = 0; level < height; level++) {
+					world.AddBody(BodyDesc::Box(glm::vec3(0.5f), 1.0f, base + glm::vec3(0.0f, 0.5f + level, 0.0f)));
+				}
+			}
+		}
+	}
+
+	/* Boxes of assorted sizes dropped at random onto the ground, far enough apart that most land alone */
+	static void BuildScattered(PhysicsWorld& world, int count) {
+		std::mt19937 rng(23);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> size(0.2f, 0.6f);
+		const float halfSize = 1.5f * std::sqrt((float)count);
+		AddGround(world, halfSize + 2.0f);
+		for (int i = 0; i < count; i++) {
+			glm::vec3 position(uniform(rng) * halfSize, 2.0f + 1.5f * uniform(rng), uniform(rng) * halfSize);
+			BodyDesc box = BodyDesc::Box(glm::vec3(size(rng), size(rng), size(rng)), 1.0f, position, RandomRotation(rng));
+			box.angularVelocity = glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+			world.AddBody(box);
+		}
+	}
+
+	static bool SameState(const PhysicsWorld& a, const PhysicsWorld& b) {
+		for (int i = 0; i < a.GetNumBodies(); i++) {
+			glm::vec3 pa = a.GetPosition(i), pb = b.GetPosition(i);
+			glm::quat qa = a.GetRotation(i), qb = b.GetRotation(i);
+			if (std::memcmp(&pa, &pb, sizeof(pa)) != 0 || std::memcmp(&qa, &qb, sizeof(qa)) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/* Steps a scene serially and on the pool, and reports the time per step and bodies simulated per millisecond */
+	template<typename Build>
+	static void ReportWorld(std::ostream& out, const std::string& name, Build&& build, int steps, PhysicsWorld& world) {
+		ThreadPool& pool = ThreadPool::Global();
+		PhysicsWorld serial;
+		build(serial);
+		build(world);
+		double serialMs = TimeMs([&]() {
+			for (int s = 0; s < steps; s++) {
+				serial.Step();
+			}
+		});
+		double poolMs = TimeMs([&]() {
+			for (int s = 0; s < steps; s++) {
+				world.Step(&pool);
+			}
+		});
+		const PhysicsWorld::StepStats& stats = world.GetStepStats();
+		const int bodies = world.GetNumBodies();
+		out << name << ": " << bodies << " bodies, " << stats.numPairs << " pairs, " << stats.numContacts << " contacts, " << stats.numIslands
+			<< " islands (largest " << stats.largestIsland << ")" << std::endl;
+		out << "  " << serialMs / steps << " ms/step serial (" << bodies * steps / serialMs << " bodies/ms), " << poolMs / steps << " ms/step on "
+			<< pool.GetNumThreads() << " thread(s) (" << bodies * steps / poolMs << " bodies/ms), " << (SameState(serial, world) ? "same state" : "STATES DIFFER")
+			<< std::endl;
+		out << "  last step: broad phase " << stats.broadPhaseMs << " ms, narrow phase " << stats.narrowPhaseMs << " ms, solver " << stats.solveMs
+			<< " ms, integration " << stats.integrateMs << " ms" << std::endl;
+	}
+
+	/*
+		Towers should stay where they were put, for as long as they are left standing: reports how far the top boxes
+		drifted and sank, loudly if either is more than a hundredth of the height
+	*/
+	static void ReportStacks(std::ostream& out, int towers, int height, int steps) {
+		PhysicsWorld stacked;
+		ReportWorld(out, std::to_string(towers * towers) + " towers of " + std::to_string(height) + " boxes, " + std::to_string(steps) + " steps",
+			[&](PhysicsWorld& world) { BuildStacks(world, towers, height); }, steps, stacked);
+		float drift = 0.0f, sink = 0.0f;
+		for (int t = 0; t < towers * towers; t++) {
+			int top = 1 + t * height + height - 1;
+			glm::vec3 p = stacked.GetPosition(top);
+			float expectedY = 0.5f + (height - 1);
+			int x = t / towers, z = t % towers;
+			glm::vec2 base = glm::vec2(x - 0.5f * (towers - 1), z - 0.5f * (towers - 1)) * 2.5f;
+			drift = std::max(drift, glm::length(glm::vec2(p.x, p.z) - base));
+			sink = std::max(sink, expectedY - p.y);
+		}
+		const float tolerance = 0.01f * height;
+		out << "  top boxes drifted at most " << drift << " and sank at most " << sink
+			<< (drift > tolerance || sink > tolerance ? ", TOWERS MOVED MORE THAN " : ", within ") << tolerance << std::endl;
+	}
+
+	void RunRigidBodies(std::ostream& out) {
+		const int steps = 180; //Three seconds at 60 Hz, long enough for everything dropped to come to rest
+		const int stackSteps = 1200; //Twenty seconds, long enough for a slow lean to show
+		out << "threads: " << ThreadPool::Global().GetNumThreads() << ", steps of " << PhysicsWorld::Settings().timeStep * 1000.0f << " ms" << std::endl;
+
+		ReportStacks(out, 10, 10, stackSteps);
+		ReportStacks(out, 3, 20, stackSteps);
+
+		const int counts[] = { 1000, 4000 };
+		for (int count : counts) {
+			PhysicsWorld scattered;
+			ReportWorld(out, std::to_string(count) + " scattered boxes, " + std::to_string(steps) + " steps",
+				[&](PhysicsWorld& world) { BuildScattered(world, count); }, steps, scattered);
+			float lowest = FLT_MAX, fastest = 0.0f;
+			for (int i = 1; i < scattered.GetNumBodies(); i++) {
+				lowest = std::min(lowest, scattered.GetPosition(i).y);
+				fastest = std::max(fastest, glm::length(scattered.GetLinearVelocity(i)));
+			}
+			out << "  lowest centre " << lowest << " (ground at 0), fastest body " << fastest << " m/s" << std::endl;
+		}
+	}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+	Timing helpers and the benchmark entry points listed in the Benchmarks test (see tests/TestBenchmark.cpp).
+	Each entry point writes a human readable report to the given stream.
+*/
+namespace Benchmark {
+
+	/* Runs fn the given number of times and returns the mean wall-clock time in milliseconds */
+	template<typename F>
+	double TimeMs(F&& fn, int iterations = 1) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			fn();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double, std::milli> duration = end - start;
+		return duration.count() / (double)iterations;
+	}
+
+	/* Mesh assets shipped in res/meshes, used by several benchmarks */
+	inline const std::vector<std::string>& MeshAssets() {
+		static const std::vector<std::string> assets = { "res/meshes/suzanne.obj", "res/meshes/earth.obj" };
+		return assets;
+	}
+
+	/* Geometry (BenchGeometry.cpp) */
+	void RunAdjacency(std::ostream& out);
+	void RunTransformBatch(std::ostream& out);
+	void RunWindingNumberBuild(std::ostream& out);
+	void RunWindingNumberQueries(std::ostream& out);
+	void RunRayCasting(std::ostream& out);
+	void RunIntersectKernels(std::ostream& out);
+	void RunPicking(std::ostream& out);
+	void RunSpatialProperties(std::ostream& out);
+	void RunSignedDistanceField(std::ostream& out);
+	void RunConvexHull(std::ostream& out);
+
+	/* Mesh loading (BenchMesh.cpp) */
+	void RunObjParsing(std::ostream& out);
+	void RunObjScaling(std::ostream& out);
+	void RunMeshCache(std::ostream& out);
+	void RunVertexFormats(std::ostream& out);
+
+	/* Physics (BenchPhysics.cpp) */
+	void RunMassProperties(std::ostream& out);
+	void RunKallay(std::ostream& out);
+	void RunBroadPhase(std::ostream& out);
+	void RunNarrowPhase(std::ostream& out);
+	void RunRigidBodies(std::ostream& out);
+
+	/* Particles (BenchParticles.cpp) */
+	void RunParticlePool(std::ostream& out);
+	void RunParticleKernels(std::ostream& out);
+	void RunParticleSort(std::ostream& out);
+	void RunParticleGrid(std::ostream& out);
+	void RunParticleBackends(std::ostream& out);
+
+}
@@ -0,0 +1,35 @@
+#include "Check.h"
+
+namespace Check {
+
+	namespace {
+
+		struct Entry {
+			const char* name;
+			bool (*run)(std::ostream& out);
+		};
+
+		const Entry CHECKS[] = {
+			{ "Vertex buffer layouts", VertexLayouts },
+			{ "Sphere winding", SphereWinding },
+			{ "Picking instances", Picking },
+			{ "CPU and GPU particle backends", ParticleBackends },
+		};
+
+	}
+
+	int RunAll(std::ostream& out) {
+		int numFailed = 0;
+		for (const Entry& check : CHECKS) {
+			out << "-- " << check.name << std::endl;
+			if (check.run(out)) {
+				out << "  passed" << std::endl;
+			} else {
+				numFailed++;
+			}
+		}
+		out << (numFailed == 0 ? "All checks passed" : "SOME CHECKS FAILED") << " (" << numFailed << " of " << sizeof(CHECKS) / sizeof(CHECKS[0]) << " failed)" << std::endl;
+		return numFailed;
+	}
+
+}
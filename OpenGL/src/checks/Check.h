@@ -0,0 +1,34 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/*
+	Deterministic self checks, run from the Benchmarks test and by starting the application with --check. Unlike
+	the benchmarks they compare results against known answers: each check reports what it compared to the given
+	stream and returns false if anything differed.
+*/
+namespace Check {
+
+	/* Runs every check and returns the number that failed */
+	int RunAll(std::ostream& out);
+
+	/* Writes a FAILED line for a mismatch and returns condition, so checks can accumulate "ok &= Expect(...)" */
+	inline bool Expect(std::ostream& out, bool condition, const std::string& what) {
+		if (!condition) {
+			out << "  FAILED: " << what << std::endl;
+		}
+		return condition;
+	}
+
+	/* Geometry (CheckGeometry.cpp) */
+	bool Picking(std::ostream& out);
+
+	/* Mesh (CheckMesh.cpp) */
+	bool VertexLayouts(std::ostream& out);
+	bool SphereWinding(std::ostream& out);
+
+	/* Particles (CheckParticles.cpp) */
+	bool ParticleBackends(std::ostream& out);
+
+}
@@ -0,0 +1,89 @@
+#include "Check.h"
+
+#include "Mesh.h"
+#include "geometry/Picker.h"
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace Check {
+
+	/*
+		Places instances of the unit cube at known positions, heights, rotations about y and scales, and fires rays
+		straight down onto each one. The nearest instance and the distance to its top face are known exactly, so the
+		multi-instance path (bounds, ordering by entry distance, local space BVH traversal) is checked against them.
+		A box stacked over another must shadow it, a ray between the boxes must miss, and after SetTransform the
+		moved box must be hit at its new place only.
+	*/
+	bool Picking(std::ostream& out) {
+		const int NUM_INSTANCES = 8;
+		const float RAY_HEIGHT = 20.0f;
+		const float TOLERANCE = 1.0e-4f;
+
+		std::unique_ptr<Mesh> cube(Mesh::Cube(1));
+		const MeshBVH& bvh = cube->GetBVH();
+
+		/* Instance i stands at (centres[i].x, centres[i].y, centres[i].z) with height heights[i]; the cube spans [-0.5, 0.5] */
+		std::vector<glm::vec3> centres;
+		std::vector<float> heights;
+		Picker picker;
+		for (int i = 0; i < NUM_INSTANCES; i++) {
+			glm::vec3 centre(4.0f * (i % 4), 0.5f * i, 4.0f * (i / 4));
+			float height = 1.0f + 0.25f * i;
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), centre);
+			model = glm::rotate(model, 0.3f * i, glm::vec3(0.0f, 1.0f, 0.0f));
+			model = glm::scale(model, glm::vec3(1.0f, height, 1.5f));
+			centres.push_back(centre);
+			heights.push_back(height);
+			picker.AddInstance(bvh, model);
+		}
+		/* A flat box above instance 0, which hides it from above */
+		const int stacked = picker.AddInstance(bvh, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 0.0f)), glm::vec3(2.0f, 0.5f, 2.0f)));
+		centres.push_back(glm::vec3(0.0f, 5.0f, 0.0f));
+		heights.push_back(0.5f);
+
+		bool ok = true;
+		int numRays = 0;
+		auto expectHit = [&](const glm::vec3& x, int expectedInstance, float expectedT, const char* what) {
+			Ray ray;
+			ray.origin = glm::vec3(x.x, RAY_HEIGHT, x.z);
+			ray.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+			Picker::Hit hit;
+			picker.Pick(ray, hit);
+			numRays++;
+			const bool hitOk = hit.instance == expectedInstance
+				&& (expectedInstance == Picker::NO_HIT || std::abs(hit.t - expectedT) <= TOLERANCE);
+			if (!hitOk) {
+				std::ostringstream message;
+				message << what << " at (" << x.x << ", " << x.z << "): instance " << hit.instance << " at t " << hit.t
+					<< ", expected instance " << expectedInstance << " at t " << expectedT;
+				ok = Expect(out, false, message.str());
+			}
+		};
+		auto topT = [&](int instance) { return RAY_HEIGHT - (centres[instance].y + 0.5f * heights[instance]); };
+
+		for (int i = 1; i < NUM_INSTANCES; i++) {
+			expectHit(centres[i], i, topT(i), "box");
+			expectHit(centres[i] + glm::vec3(0.3f, 0.0f, -0.3f), i, topT(i), "box off centre");
+		}
+		expectHit(centres[0], stacked, topT(stacked), "stacked box");
+		expectHit(centres[0] + glm::vec3(0.0f, 0.0f, 2.0f), Picker::NO_HIT, 0.0f, "between boxes");
+
+		/* Move instance 3 out to (20, 1, 20) */
+		const int moved = 3;
+		const glm::vec3 oldCentre = centres[moved];
+		centres[moved] = glm::vec3(20.0f, 1.0f, 20.0f);
+		picker.SetTransform(moved, glm::scale(glm::translate(glm::mat4(1.0f), centres[moved]), glm::vec3(1.0f, heights[moved], 1.0f)));
+		expectHit(oldCentre, Picker::NO_HIT, 0.0f, "moved box, old place");
+		expectHit(centres[moved], moved, topT(moved), "moved box, new place");
+
+		out << "  " << picker.GetNumInstances() << " instances, " << numRays << " rays" << std::endl;
+		return ok;
+	}
+
+}
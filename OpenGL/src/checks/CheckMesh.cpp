@@ -0,0 +1,176 @@
+#include "Check.h"
+
+#include "Mesh.h"
+#include "VertexBufferLayout.h"
+#include "VertexFormat.h"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+namespace Check {
+
+	namespace {
+
+		/* Reads component c of an attribute of the given type at data */
+		float ReadComponent(const unsigned char* data, const VertexBufferElement& element, int c) {
+			switch (element.type) {
+				case GL_FLOAT: {
+					float value;
+					std::memcpy(&value, data + c * sizeof(float), sizeof(value));
+					return value;
+				}
+				case GL_HALF_FLOAT: {
+					uint16_t value;
+					std::memcpy(&value, data + c * sizeof(uint16_t), sizeof(value));
+					return VertexEncoder::HalfToFloat(value);
+				}
+				case GL_UNSIGNED_SHORT: {
+					uint16_t value;
+					std::memcpy(&value, data + c * sizeof(uint16_t), sizeof(value));
+					return value / 65535.0f;
+				}
+				case GL_INT_2_10_10_10_REV: {
+					uint32_t value;
+					std::memcpy(&value, data, sizeof(value));
+					return VertexEncoder::UnpackNormal(value)[c];
+				}
+			}
+			return NAN;
+		}
+
+	}
+
+	/*
+		Encodes three vertices in every vertex format and uv encoding, builds the layout Mesh gives the vertex array
+		and checks its stride and offsets against the known byte layouts (see VertexFormat.h). Each attribute is then
+		read back at its layout offset and compared to the source value, so a layout that disagrees with the encoder
+		is caught even where the sizes happen to add up.
+	*/
+	bool VertexLayouts(std::ostream& out) {
+		const float positions[] = { 1.0f, 2.0f, 3.0f, -0.5f, 0.25f, 4.0f, 0.0f, -8.0f, 0.125f };
+		const float normals[] = { 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -0.6f, 0.8f };
+		const float unitTexCoords[] = { 0.0f, 1.0f, 0.5f, 0.25f, 1.0f, 0.0f };
+		const float wrappingTexCoords[] = { -1.0f, 2.0f, 1.5f, 0.5f, 0.0f, 3.0f };
+
+		struct Case {
+			const char* name;
+			VertexFormat format;
+			const float* texCoords;
+			unsigned int stride;
+			unsigned int offsets[3];
+			unsigned int numElements;
+			float tolerance[3]; //Position, normal, uv
+		};
+		const Case cases[] = {
+			{ "interleaved",				VertexFormat::Interleaved,	unitTexCoords,		32, { 0, 12, 24 }, 3, { 0.0f, 0.0f, 0.0f } },
+			{ "interleaved, no uvs",		VertexFormat::Interleaved,	nullptr,			24, { 0, 12, 0 }, 2, { 0.0f, 0.0f, 0.0f } },
+			{ "compact",					VertexFormat::Compact,		unitTexCoords,		16, { 0, 8, 12 }, 3, { 0.0f, 2.0f / 511.0f, 1.0f / 65535.0f } },
+			{ "compact, wrapping uvs",		VertexFormat::Compact,		wrappingTexCoords,	16, { 0, 8, 12 }, 3, { 0.0f, 2.0f / 511.0f, 0.0f } },
+			{ "compact, no uvs",			VertexFormat::Compact,		nullptr,			12, { 0, 8, 0 }, 2, { 0.0f, 2.0f / 511.0f, 0.0f } },
+		};
+
+		bool ok = true;
+		for (const Case& test : cases) {
+			VertexSource source;
+			source.numVertices = 3;
+			source.positions = positions;
+			source.normals = normals;
+			source.texCoords = test.texCoords;
+
+			EncodedVertices encoded;
+			VertexEncoder::Encode(test.format, source, encoded);
+			VertexBufferLayout layout;
+			Mesh::GetVertexLayout(test.format, encoded, layout);
+			const std::vector<VertexBufferElement> elements = layout.GetElements();
+
+			std::ostringstream what;
+			what << test.name << ": stride " << layout.GetStride() << " (encoder " << encoded.stride << ", expected " << test.stride << "), " << elements.size() << " attributes";
+			out << "  " << what.str() << std::endl;
+			bool caseOk = Expect(out, layout.GetStride() == test.stride && encoded.stride == test.stride, what.str());
+			caseOk &= Expect(out, elements.size() == test.numElements, what.str());
+			caseOk &= Expect(out, encoded.data.size() == 3 * (size_t)test.stride, std::string(test.name) + ": encoded buffer size");
+			if (!caseOk) {
+				ok = false;
+				continue;
+			}
+
+			const float* attributes[3] = { positions, normals, test.texCoords };
+			const int components[3] = { 3, 3, 2 };
+			for (unsigned int e = 0; e < elements.size(); e++) {
+				std::ostringstream offset;
+				offset << test.name << ": attribute " << e << " at offset " << layout.GetOffset(e) << ", expected " << test.offsets[e];
+				if (!Expect(out, layout.GetOffset(e) == test.offsets[e], offset.str())) {
+					ok = false;
+					continue;
+				}
+				for (int v = 0; v < 3; v++) {
+					const unsigned char* data = &encoded.data[v * test.stride + layout.GetOffset(e)];
+					for (int c = 0; c < components[e]; c++) {
+						const float expected = attributes[e][v * components[e] + c];
+						const float actual = ReadComponent(data, elements[e], c);
+						if (!(std::abs(actual - expected) <= test.tolerance[e])) {
+							std::ostringstream value;
+							value << test.name << ": attribute " << e << " of vertex " << v << " reads " << actual << ", expected " << expected;
+							ok = Expect(out, false, value.str());
+						}
+					}
+				}
+			}
+		}
+		return ok;
+	}
+
+	/*
+		Mesh::Sphere at every resolution must be closed and wound outwards, which the mass properties rely on: every
+		directed edge is used by exactly one face and its reverse by exactly one other, every face normal points away
+		from the centre, and the enclosed volume is positive and below that of the unit sphere it is inscribed in.
+	*/
+	bool SphereWinding(std::ostream& out) {
+		const Mesh::SphereDivisions resolutions[] = { Mesh::res18, Mesh::res16, Mesh::res32, Mesh::res64, Mesh::res128 };
+		const double SPHERE_VOLUME = 4.0 / 3.0 * 3.14159265358979323846;
+
+		bool ok = true;
+		for (Mesh::SphereDivisions resolution : resolutions) {
+			std::unique_ptr<Mesh> sphere(Mesh::Sphere(resolution, 1));
+			const std::vector<unsigned int>& indices = sphere->GetIndices();
+			const std::vector<float>& positions = sphere->GetPositions();
+			auto position = [&](unsigned int v) { return glm::dvec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]); };
+
+			std::map<std::pair<unsigned int, unsigned int>, int> directedEdges;
+			int numInwardFaces = 0;
+			double volume = 0.0;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				const unsigned int v[3] = { indices[i], indices[i + 1], indices[i + 2] };
+				for (int e = 0; e < 3; e++) {
+					directedEdges[std::make_pair(v[e], v[(e + 1) % 3])]++;
+				}
+				const glm::dvec3 p0 = position(v[0]), p1 = position(v[1]), p2 = position(v[2]);
+				const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				if (glm::dot(normal, p0 + p1 + p2) <= 0.0) {
+					numInwardFaces++;
+				}
+				volume += glm::dot(p0, glm::cross(p1, p2)) / 6.0;
+			}
+
+			int numUnpairedEdges = 0;
+			for (const auto& edge : directedEdges) {
+				auto reverse = directedEdges.find(std::make_pair(edge.first.second, edge.first.first));
+				if (edge.second != 1 || reverse == directedEdges.end() || reverse->second != 1) {
+					numUnpairedEdges++;
+				}
+			}
+
+			std::ostringstream what;
+			what << "sphere " << (int)resolution << ": " << indices.size() / 3 << " faces, " << numUnpairedEdges << " unpaired edges, "
+				<< numInwardFaces << " inward faces, volume " << volume;
+			out << "  " << what.str() << std::endl;
+			ok &= Expect(out, numUnpairedEdges == 0 && numInwardFaces == 0 && volume > 0.5 * SPHERE_VOLUME && volume < SPHERE_VOLUME, what.str());
+		}
+		return ok;
+	}
+
+}
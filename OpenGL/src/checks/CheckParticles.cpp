@@ -0,0 +1,111 @@
+#include "Check.h"
+
+#include <GL/glew.h>
+
+#include "particles/ParticleBackend.h"
+#include "particles/ParticlePool.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace Check {
+
+	namespace {
+
+		struct Particle {
+			uint32_t color;
+			float life, size;
+			glm::vec3 position, velocity;
+
+			inline bool operator<(const Particle& other) const {
+				return std::tie(color, life, size) < std::tie(other.color, other.life, other.size);
+			}
+		};
+
+		/* The live particles of the backend, in an order that does not depend on the backend */
+		std::vector<Particle> ReadParticles(ParticleBackend& backend) {
+			ParticlePool pool;
+			backend.ReadBack(pool);
+			std::vector<Particle> particles(pool.GetCount());
+			for (int i = 0; i < pool.GetCount(); i++) {
+				particles[i].color = pool.GetColors()[i];
+				particles[i].life = pool.GetChannel(ParticlePool::LIFE)[i];
+				particles[i].size = pool.GetChannel(ParticlePool::SIZE)[i];
+				particles[i].position = pool.GetPosition(i);
+				particles[i].velocity = glm::vec3(pool.GetChannel(ParticlePool::VELOCITY_X)[i], pool.GetChannel(ParticlePool::VELOCITY_Y)[i], pool.GetChannel(ParticlePool::VELOCITY_Z)[i]);
+			}
+			std::sort(particles.begin(), particles.end());
+			return particles;
+		}
+
+	}
+
+	/*
+		Runs the CPU backend (without collisions, which the GPU backend does not have) and the GPU backend from empty
+		through the same emitter and time steps, past the lifetime so that particles die and, in the second run, the
+		oldest are replaced every step. Both must then hold the same particles: the same spawn colours, sizes and
+		remaining lives, and positions and velocities equal up to the rounding the GPU may do differently.
+	*/
+	bool ParticleBackends(std::ostream& out) {
+		const int CAPACITY = 20000;
+		const int STEPS = 90;
+		const float TIME_STEP = 1.0f / 60.0f;
+		const float TOLERANCE = 1e-4f; //Relative to the size of the position or velocity, or 1 if smaller
+
+		/* The draws need a complete framebuffer even with rasterization off, which a headless context lacks */
+		GLuint framebuffer, colorBuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+		ParticleEmitter emitter;
+		emitter.lifetime = 1.0f;
+		const glm::vec3 eye(0.0f, 5.0f, 10.0f);
+		/* Close to full once the first particles die, then more than fits every few steps */
+		const int spawnRates[] = { (int)(0.9f * CAPACITY * TIME_STEP / emitter.lifetime), CAPACITY / 25 };
+
+		bool ok = true;
+		for (int numNew : spawnRates) {
+			std::unique_ptr<ParticleBackend> cpuBackend = ParticleBackend::Create(ParticleBackend::Type::CPU, CAPACITY);
+			std::unique_ptr<ParticleBackend> gpuBackend = ParticleBackend::Create(ParticleBackend::Type::GPU, CAPACITY);
+			static_cast<CpuParticleBackend&>(*cpuBackend).GetSettings().collisions = false;
+			for (int step = 0; step < STEPS; step++) {
+				cpuBackend->Update(TIME_STEP, emitter, numNew, eye);
+				gpuBackend->Update(TIME_STEP, emitter, numNew, eye);
+			}
+
+			const std::vector<Particle> cpu = ReadParticles(*cpuBackend);
+			const std::vector<Particle> gpu = ReadParticles(*gpuBackend);
+			int numDifferent = 0;
+			float positionError = 0.0f, velocityError = 0.0f;
+			for (size_t i = 0; i < std::min(cpu.size(), gpu.size()); i++) {
+				if (cpu[i].color != gpu[i].color || cpu[i].life != gpu[i].life || cpu[i].size != gpu[i].size) {
+					numDifferent++;
+					continue;
+				}
+				positionError = std::max(positionError, glm::length(cpu[i].position - gpu[i].position) / std::max(1.0f, glm::length(cpu[i].position)));
+				velocityError = std::max(velocityError, glm::length(cpu[i].velocity - gpu[i].velocity) / std::max(1.0f, glm::length(cpu[i].velocity)));
+			}
+
+			std::ostringstream what;
+			what << numNew << " spawned per step, " << STEPS << " steps: " << cpu.size() << " (CPU) and " << gpu.size() << " (GPU) particles, "
+				<< numDifferent << " different, largest relative error: position " << positionError << ", velocity " << velocityError;
+			out << "  " << what.str() << std::endl;
+			ok &= Expect(out, !cpu.empty() && cpu.size() == gpu.size() && numDifferent == 0 && positionError <= TOLERANCE && velocityError <= TOLERANCE, what.str());
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteFramebuffers(1, &framebuffer);
+		return ok;
+	}
+
+}
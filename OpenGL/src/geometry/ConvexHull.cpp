@@ -0,0 +1,581 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "util/ThreadPool.h"
+
+namespace {
+
+	/* Points assigned to the initial faces per task */
+	const int ASSIGN_BLOCK_SIZE = 1 << 14;
+
+	/*
+		Working state of a build. Every face is a triangle whose half-edges are 3f, 3f + 1 and 3f + 2, so next is
+		implicit; removed faces stay in place (flagged) until the hull is compacted at the end.
+	*/
+	class HullBuilder {
+	public:
+		struct BuildFace {
+			glm::dvec3 normal;
+			double offset;
+			std::vector<int> outside; //Points above the face and no earlier face
+			int farthest = -1; //Outside point farthest above the face
+			double farthestDistance = 0.0;
+			int mark = 0;
+			bool removed = false;
+		};
+
+		struct BuildEdge {
+			int vertex; //Origin
+			int twin;
+		};
+
+		HullBuilder(const float* positions, int numPoints, double tolerance) : m_Positions(positions), m_NumPoints(numPoints), m_Tolerance(tolerance) {}
+
+		std::vector<BuildFace> faces;
+		std::vector<BuildEdge> edges;
+
+		inline glm::dvec3 Point(int i) const { return glm::dvec3(m_Positions[i * 3], m_Positions[i * 3 + 1], m_Positions[i * 3 + 2]); }
+		inline double Distance(const BuildFace& face, const glm::dvec3& p) const { return glm::dot(face.normal, p) + face.offset; }
+		static inline int Next(int edge) { return edge - edge % 3 + (edge + 1) % 3; }
+
+		bool Initialize(ThreadPool* pool);
+		void Expand(int maxVertices);
+
+	private:
+		const float* m_Positions;
+		int m_NumPoints;
+		double m_Tolerance;
+		int m_NumVertices = 0;
+		int m_Iteration = 0;
+		std::vector<int> m_FaceByTail; //Scratch for linking new faces, indexed by point
+
+		int AddFace(int a, int b, int c);
+		void AssignPoint(int point, const int* candidateFaces, int numCandidates);
+		bool AddPoint(int face);
+	};
+
+	int HullBuilder::AddFace(int a, int b, int c) {
+		int f = (int)faces.size();
+		faces.emplace_back();
+		BuildFace& face = faces.back();
+		glm::dvec3 pa = Point(a), pb = Point(b), pc = Point(c);
+		glm::dvec3 n = glm::cross(pb - pa, pc - pa);
+		double length = glm::length(n);
+		face.normal = length > 0.0 ? n / length : glm::dvec3(0.0);
+		face.offset = -glm::dot(face.normal, (pa + pb + pc) / 3.0);
+		edges.push_back(BuildEdge{ a, -1 });
+		edges.push_back(BuildEdge{ b, -1 });
+		edges.push_back(BuildEdge{ c, -1 });
+		return f;
+	}
+
+	/* Hands the point to the first candidate face it lies above, or drops it if it is inside all of them */
+	void HullBuilder::AssignPoint(int point, const int* candidateFaces, int numCandidates) {
+		glm::dvec3 p = Point(point);
+		for (int i = 0; i < numCandidates; i++) {
+			BuildFace& face = faces[candidateFaces[i]];
+			double distance = Distance(face, p);
+			if (distance > m_Tolerance) {
+				face.outside.push_back(point);
+				if (distance > face.farthestDistance) {
+					face.farthestDistance = distance;
+					face.farthest = point;
+				}
+				return;
+			}
+		}
+	}
+
+	bool HullBuilder::Initialize(ThreadPool* pool) {
+		/* Extreme points along each axis, then the farthest pair among them */
+		int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 1; i < m_NumPoints; i++) {
+			glm::dvec3 p = Point(i);
+			for (int axis = 0; axis < 3; axis++) {
+				if (p[axis] < Point(extremes[axis * 2])[axis]) extremes[axis * 2] = i;
+				if (p[axis] > Point(extremes[axis * 2 + 1])[axis]) extremes[axis * 2 + 1] = i;
+			}
+		}
+		int i0 = 0, i1 = 0;
+		double bestExtent = -1.0;
+		for (int axis = 0; axis < 3; axis++) {
+			double extent = Point(extremes[axis * 2 + 1])[axis] - Point(extremes[axis * 2])[axis];
+			if (extent > bestExtent) {
+				bestExtent = extent;
+				i0 = extremes[axis * 2];
+				i1 = extremes[axis * 2 + 1];
+			}
+		}
+		if (bestExtent <= m_Tolerance) {
+			return false;
+		}
+
+		/* Farthest from the line through them, then farthest from the plane through all three */
+		glm::dvec3 p0 = Point(i0), lineDir = glm::normalize(Point(i1) - p0);
+		int i2 = -1;
+		double bestDistance = m_Tolerance;
+		for (int i = 0; i < m_NumPoints; i++) {
+			glm::dvec3 c = glm::cross(Point(i) - p0, lineDir);
+			double distance = std::sqrt(glm::dot(c, c));
+			if (distance > bestDistance) {
+				bestDistance = distance;
+				i2 = i;
+			}
+		}
+		if (i2 < 0) {
+			return false;
+		}
+
+		glm::dvec3 planeNormal = glm::normalize(glm::cross(Point(i1) - p0, Point(i2) - p0));
+		int i3 = -1;
+		bestDistance = m_Tolerance;
+		double side = 0.0;
+		for (int i = 0; i < m_NumPoints; i++) {
+			double distance = glm::dot(Point(i) - p0, planeNormal);
+			if (std::abs(distance) > bestDistance) {
+				bestDistance = std::abs(distance);
+				side = distance;
+				i3 = i;
+			}
+		}
+		if (i3 < 0) {
+			return false;
+		}
+
+		/* The base faces away from the apex, and the sides run back along its edges */
+		if (side > 0.0) {
+			std::swap(i1, i2);
+		}
+		AddFace(i0, i1, i2);
+		AddFace(i1, i0, i3);
+		AddFace(i2, i1, i3);
+		AddFace(i0, i2, i3);
+		for (int e = 0; e < 12; e++) {
+			for (int t = 0; t < 12; t++) {
+				if (edges[e].vertex == edges[Next(t)].vertex && edges[Next(e)].vertex == edges[t].vertex) {
+					edges[e].twin = t;
+				}
+			}
+		}
+		m_NumVertices = 4;
+		m_FaceByTail.assign(m_NumPoints, -1);
+
+		/*
+			Every point only depends on the four initial planes, so blocks of points are assigned in parallel and the
+			lists are joined in block order, which gives the same lists as a serial pass
+		*/
+		const int initialFaces[4] = { 0, 1, 2, 3 };
+		const int numBlocks = (m_NumPoints + ASSIGN_BLOCK_SIZE - 1) / ASSIGN_BLOCK_SIZE;
+		std::vector<std::vector<int>> blockFaces(numBlocks);
+		auto assignBlock = [&](int block) {
+			int begin = block * ASSIGN_BLOCK_SIZE, end = std::min(begin + ASSIGN_BLOCK_SIZE, m_NumPoints);
+			std::vector<int>& assigned = blockFaces[block];
+			assigned.assign(end - begin, -1);
+			for (int i = begin; i < end; i++) {
+				if (i == i0 || i == i1 || i == i2 || i == i3) {
+					continue;
+				}
+				glm::dvec3 p = Point(i);
+				for (int f : initialFaces) {
+					if (Distance(faces[f], p) > m_Tolerance) {
+						assigned[i - begin] = f;
+						break;
+					}
+				}
+			}
+		};
+		ThreadPool::RunTasks(pool, numBlocks, assignBlock);
+		for (int block = 0; block < numBlocks; block++) {
+			for (int i = 0; i < (int)blockFaces[block].size(); i++) {
+				int f = blockFaces[block][i];
+				if (f >= 0) {
+					AssignPoint(block * ASSIGN_BLOCK_SIZE + i, &f, 1);
+				}
+			}
+		}
+		return true;
+	}
+
+	/* Adds the farthest outside point of the face to the hull; returns false if the point had to be dropped instead */
+	bool HullBuilder::AddPoint(int face) {
+		const int eye = faces[face].farthest;
+		const glm::dvec3 eyePoint = Point(eye);
+		const int visibleMark = 2 * ++m_Iteration, hiddenMark = visibleMark + 1;
+
+		/* Flood the faces the eye sees (lies above) from the face it was found on */
+		std::vector<int> visible(1, face);
+		faces[face].mark = visibleMark;
+		for (int i = 0; i < (int)visible.size(); i++) {
+			for (int k = 0; k < 3; k++) {
+				int neighbour = edges[visible[i] * 3 + k].twin / 3;
+				BuildFace& n = faces[neighbour];
+				if (n.mark == visibleMark || n.mark == hiddenMark) {
+					continue;
+				}
+				if (Distance(n, eyePoint) > -m_Tolerance) {
+					n.mark = visibleMark;
+					visible.push_back(neighbour);
+				} else {
+					n.mark = hiddenMark;
+				}
+			}
+		}
+
+		/* The horizon: edges of visible faces across which the neighbour is hidden. It has to be a simple loop. */
+		std::vector<int> horizon;
+		bool simple = true;
+		for (int f : visible) {
+			for (int k = 0; k < 3; k++) {
+				int e = f * 3 + k;
+				if (faces[edges[e].twin / 3].mark == hiddenMark) {
+					int tail = edges[e].vertex;
+					simple = simple && m_FaceByTail[tail] < 0;
+					m_FaceByTail[tail] = (int)horizon.size();
+					horizon.push_back(e);
+				}
+			}
+		}
+		for (int e : horizon) {
+			m_FaceByTail[edges[e].vertex] = -1;
+		}
+		if (!simple || horizon.size() < 3) {
+			/* Numerically inconsistent visibility; the point is within rounding of the hull, so leave it out */
+			std::vector<int>& outside = faces[face].outside;
+			outside.erase(std::find(outside.begin(), outside.end(), eye));
+			faces[face].farthest = -1;
+			faces[face].farthestDistance = 0.0;
+			for (int p : outside) {
+				double distance = Distance(faces[face], Point(p));
+				if (distance > faces[face].farthestDistance) {
+					faces[face].farthestDistance = distance;
+					faces[face].farthest = p;
+				}
+			}
+			return false;
+		}
+
+		/* A fan of new faces from the horizon to the eye; the side edges pair up through the tail of each horizon edge */
+		std::vector<int> newFaces(horizon.size());
+		for (size_t i = 0; i < horizon.size(); i++) {
+			int e = horizon[i];
+			int tail = edges[e].vertex, head = edges[Next(e)].vertex;
+			int twin = edges[e].twin;
+			int f = AddFace(tail, head, eye);
+			edges[f * 3].twin = twin;
+			edges[twin].twin = f * 3;
+			m_FaceByTail[tail] = f;
+			newFaces[i] = f;
+		}
+		for (int f : newFaces) {
+			int head = edges[f * 3 + 1].vertex;
+			int g = m_FaceByTail[head];
+			edges[f * 3 + 1].twin = g * 3 + 2;
+			edges[g * 3 + 2].twin = f * 3 + 1;
+		}
+
+		/*
+			Points seen by the removed faces either move to a new face or are now inside. So do the corners of removed
+			faces that are not on the horizon: a face the eye was within the tolerance of counts as visible, so such a
+			corner can end up just outside the new faces.
+		*/
+		std::vector<int> dropped;
+		for (int f : visible) {
+			std::vector<int> outside;
+			outside.swap(faces[f].outside);
+			faces[f].removed = true;
+			for (int p : outside) {
+				if (p != eye) {
+					AssignPoint(p, newFaces.data(), (int)newFaces.size());
+				}
+			}
+			for (int k = 0; k < 3; k++) {
+				int vertex = edges[f * 3 + k].vertex;
+				if (vertex != eye && m_FaceByTail[vertex] == -1) {
+					m_FaceByTail[vertex] = -2;
+					dropped.push_back(vertex);
+					AssignPoint(vertex, newFaces.data(), (int)newFaces.size());
+				}
+			}
+		}
+		for (int vertex : dropped) {
+			m_FaceByTail[vertex] = -1;
+		}
+		for (int f : newFaces) {
+			m_FaceByTail[edges[f * 3].vertex] = -1;
+		}
+		m_NumVertices++;
+		return true;
+	}
+
+	void HullBuilder::Expand(int maxVertices) {
+		if (maxVertices > 0) {
+			/* Always the farthest point over the whole hull, so a limited hull keeps the most prominent points */
+			while (m_NumVertices < maxVertices) {
+				int best = -1;
+				for (int f = 0; f < (int)faces.size(); f++) {
+					if (!faces[f].removed && faces[f].farthest >= 0 && (best < 0 || faces[f].farthestDistance > faces[best].farthestDistance)) {
+						best = f;
+					}
+				}
+				if (best < 0) {
+					break;
+				}
+				AddPoint(best);
+			}
+			return;
+		}
+
+		std::vector<int> pending;
+		for (int f = 0; f < (int)faces.size(); f++) {
+			pending.push_back(f);
+		}
+		while (!pending.empty()) {
+			int f = pending.back();
+			if (faces[f].removed || faces[f].farthest < 0) {
+				pending.pop_back();
+				continue;
+			}
+			size_t firstNew = faces.size();
+			AddPoint(f);
+			for (size_t g = firstNew; g < faces.size(); g++) {
+				pending.push_back((int)g);
+			}
+		}
+	}
+
+	struct Group {
+		glm::dvec3 normal;
+		double offset;
+		std::vector<int> faces;
+	};
+
+}
+
+bool ConvexHull::Build(const float* positions, int numPoints, int maxVertices, ThreadPool* pool) {
+	Clear();
+	if (numPoints < 4) {
+		return false;
+	}
+
+	/*
+		Rounding in the plane distances grows with the magnitude of the coordinates (as in Lloyd's QuickHull3D). The
+		build works in double, so its decisions are nearly exact for float input; the merge and the output planes are
+		float, and get the matching float tolerance.
+	*/
+	glm::vec3 maxAbs(0.0f);
+	for (int i = 0; i < numPoints; i++) {
+		maxAbs = glm::max(maxAbs, glm::abs(glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2])));
+	}
+	const double scale = (double)maxAbs.x + maxAbs.y + maxAbs.z;
+	m_Tolerance = (float)(3.0 * FLT_EPSILON * scale);
+
+	HullBuilder builder(positions, numPoints, 3.0 * DBL_EPSILON * scale);
+	if (!builder.Initialize(pool)) {
+		return false;
+	}
+	builder.Expand(maxVertices > 0 ? std::max(maxVertices, 4) : 0);
+
+	/*
+		Merge neighbouring triangles whose corners all lie within the tolerance of a seed triangle's plane. The seed
+		plane stays fixed while a group grows, so slowly curving regions do not drift into one polygon.
+	*/
+	std::vector<HullBuilder::BuildFace>& faces = builder.faces;
+	std::vector<HullBuilder::BuildEdge>& edges = builder.edges;
+	std::vector<int> groupOf(faces.size(), -1);
+	std::vector<Group> groups;
+	for (int seed = 0; seed < (int)faces.size(); seed++) {
+		if (faces[seed].removed || groupOf[seed] >= 0) {
+			continue;
+		}
+		Group group;
+		group.normal = faces[seed].normal;
+		group.offset = faces[seed].offset;
+		group.faces.push_back(seed);
+		groupOf[seed] = (int)groups.size();
+		for (int i = 0; i < (int)group.faces.size(); i++) {
+			for (int k = 0; k < 3; k++) {
+				int neighbour = edges[group.faces[i] * 3 + k].twin / 3;
+				if (groupOf[neighbour] >= 0 || glm::dot(faces[neighbour].normal, group.normal) <= 0.0) {
+					continue;
+				}
+				bool coplanar = true;
+				for (int c = 0; c < 3 && coplanar; c++) {
+					coplanar = std::abs(glm::dot(group.normal, builder.Point(edges[neighbour * 3 + c].vertex)) + group.offset) <= m_Tolerance;
+				}
+				if (coplanar) {
+					groupOf[neighbour] = (int)groups.size();
+					group.faces.push_back(neighbour);
+				}
+			}
+		}
+		groups.push_back(std::move(group));
+	}
+
+	/* Boundary loops of each group, in order; a group whose boundary is not a single loop goes back to triangles */
+	std::vector<std::vector<int>> loops;
+	std::vector<int> loopGroups;
+	std::vector<int> loopOfEdge(edges.size(), -1);
+	std::vector<int> edgeByTail(numPoints, -1);
+	for (size_t g = 0; g < groups.size(); g++) {
+		std::vector<int> boundary;
+		for (int f : groups[g].faces) {
+			for (int k = 0; k < 3; k++) {
+				int e = f * 3 + k;
+				if (groupOf[edges[e].twin / 3] != (int)g) {
+					boundary.push_back(e);
+				}
+			}
+		}
+
+		bool single = true;
+		for (int e : boundary) {
+			single = single && edgeByTail[edges[e].vertex] < 0;
+			edgeByTail[edges[e].vertex] = e;
+		}
+		std::vector<int> loop;
+		if (single) {
+			int e = boundary[0];
+			do {
+				loop.push_back(e);
+				e = edgeByTail[edges[HullBuilder::Next(e)].vertex];
+			} while (e != boundary[0] && e >= 0 && loop.size() <= boundary.size());
+			single = e == boundary[0] && loop.size() == boundary.size();
+		}
+		for (int e : boundary) {
+			edgeByTail[edges[e].vertex] = -1;
+		}
+
+		if (single) {
+			loops.push_back(std::move(loop));
+			loopGroups.push_back((int)g);
+		} else {
+			for (int f : groups[g].faces) {
+				loops.push_back(std::vector<int>{ f * 3, f * 3 + 1, f * 3 + 2 });
+				loopGroups.push_back((int)g);
+			}
+		}
+	}
+
+	/* Emit the loops as faces with contiguous half-edges, keeping only the vertices they use */
+	std::vector<int> vertexRemap(numPoints, -1);
+	std::vector<int> outputEdge(edges.size(), -1);
+	for (size_t l = 0; l < loops.size(); l++) {
+		const std::vector<int>& loop = loops[l];
+		Face face;
+		face.edge = (int)m_Edges.size();
+		face.numEdges = (int)loop.size();
+
+		/* Newell's method for the normal, through the centroid of the loop */
+		glm::dvec3 normal(0.0), centroid(0.0);
+		for (size_t i = 0; i < loop.size(); i++) {
+			glm::dvec3 a = builder.Point(edges[loop[i]].vertex), b = builder.Point(edges[loop[(i + 1) % loop.size()]].vertex);
+			normal += glm::dvec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+			centroid += a;
+		}
+		double length = glm::length(normal);
+		face.normal = glm::vec3(length > 0.0 ? normal / length : groups[loopGroups[l]].normal);
+		face.offset = (float)-glm::dot(glm::dvec3(face.normal), centroid / (double)loop.size());
+
+		for (size_t i = 0; i < loop.size(); i++) {
+			int vertex = edges[loop[i]].vertex;
+			if (vertexRemap[vertex] < 0) {
+				vertexRemap[vertex] = (int)m_Vertices.size();
+				m_Vertices.push_back(glm::vec3(builder.Point(vertex)));
+			}
+			outputEdge[loop[i]] = (int)m_Edges.size();
+			HalfEdge edge;
+			edge.vertex = vertexRemap[vertex];
+			edge.twin = -1;
+			edge.next = face.edge + (int)((i + 1) % loop.size());
+			edge.face = (int)m_Faces.size();
+			m_Edges.push_back(edge);
+		}
+		m_Faces.push_back(face);
+	}
+
+	/* Every emitted edge runs along a loop boundary, so its twin was emitted as well */
+	for (const std::vector<int>& loop : loops) {
+		for (int e : loop) {
+			m_Edges[outputEdge[e]].twin = outputEdge[edges[e].twin];
+		}
+	}
+	LinkNeighbours();
+	return true;
+}
+
+void ConvexHull::LinkNeighbours() {
+	/* Every half-edge leaving a vertex leads to one of its neighbours, so the counts are the out-degrees */
+	m_NeighbourOffsets.assign(m_Vertices.size() + 1, 0);
+	for (const HalfEdge& edge : m_Edges) {
+		m_NeighbourOffsets[edge.vertex + 1]++;
+	}
+	for (size_t v = 0; v < m_Vertices.size(); v++) {
+		m_NeighbourOffsets[v + 1] += m_NeighbourOffsets[v];
+	}
+	m_Neighbours.resize(m_Edges.size());
+	std::vector<int> fill(m_NeighbourOffsets.begin(), m_NeighbourOffsets.end() - 1);
+	for (const HalfEdge& edge : m_Edges) {
+		m_Neighbours[fill[edge.vertex]++] = m_Edges[edge.next].vertex;
+	}
+}
+
+void ConvexHull::Clear() {
+	m_Vertices.clear();
+	m_Faces.clear();
+	m_Edges.clear();
+	m_NeighbourOffsets.clear();
+	m_Neighbours.clear();
+	m_Tolerance = 0.0f;
+}
+
+int ConvexHull::Support(const glm::vec3& direction) const {
+	int best = -1;
+	float bestDot = -FLT_MAX;
+	for (int i = 0; i < (int)m_Vertices.size(); i++) {
+		float d = glm::dot(m_Vertices[i], direction);
+		if (d > bestDot) {
+			bestDot = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+int ConvexHull::Support(const glm::vec3& direction, int start) const {
+	/* Walking costs more than a scan on small hulls */
+	if (m_Vertices.size() <= 32 || start < 0 || start >= (int)m_Vertices.size()) {
+		return Support(direction);
+	}
+
+	/* Steepest ascent: move to the best neighbour until none is better */
+	int best = start;
+	float bestDot = glm::dot(m_Vertices[best], direction);
+	for (int current = -1; current != best; ) {
+		current = best;
+		for (int n = m_NeighbourOffsets[current]; n < m_NeighbourOffsets[current + 1]; n++) {
+			float d = glm::dot(m_Vertices[m_Neighbours[n]], direction);
+			if (d > bestDot) {
+				bestDot = d;
+				best = m_Neighbours[n];
+			}
+		}
+	}
+	return best;
+}
+
+bool ConvexHull::Contains(const glm::vec3& p, float tolerance) const {
+	for (const Face& face : m_Faces) {
+		if (glm::dot(face.normal, p) + face.offset > tolerance) {
+			return false;
+		}
+	}
+	return !m_Faces.empty();
+}
+
+size_t ConvexHull::GetMemoryUsage() const {
+	return m_Vertices.capacity() * sizeof(glm::vec3) + m_Faces.capacity() * sizeof(Face) + m_Edges.capacity() * sizeof(HalfEdge)
+		+ (m_NeighbourOffsets.capacity() + m_Neighbours.capacity()) * sizeof(int);
+}
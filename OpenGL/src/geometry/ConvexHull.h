@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+/*
+	Convex hull of a point cloud as a half-edge mesh of convex polygons, built with Quickhull (Barber, Dobkin and
+	Huhdanpaa 1996).
+
+	Starting from a tetrahedron of extreme points, every point outside the hull is assigned to a face it lies above;
+	the farthest point of a face is then added by removing every face it can see and connecting the horizon to it,
+	and the points of the removed faces are handed to the new faces. Plane tests during the build run in double, so
+	they are nearly exact for float input; at the end, triangles within the (float) tolerance of a common plane are
+	merged into polygons, and the hull is convex up to that tolerance.
+
+	With maxVertices set, points are added in order of distance from the hull until the limit is reached, which gives
+	a simplified hull that no longer needs to contain every point.
+*/
+class ConvexHull {
+public:
+	struct HalfEdge {
+		int vertex; //Origin vertex
+		int twin; //Half-edge running the other way, on the neighbouring face
+		int next; //Next half-edge of the same face, counter-clockwise seen from outside
+		int face;
+	};
+
+	struct Face {
+		glm::vec3 normal; //Unit outward normal
+		float offset; //dot(normal, p) + offset == 0 on the plane (as in Mesh::Face)
+		int edge; //First half-edge
+		int numEdges;
+	};
+
+	ConvexHull() {}
+
+	/* Returns false (and leaves the hull empty) if the points are all coplanar */
+	bool Build(const float* positions, int numPoints, int maxVertices = 0, ThreadPool* pool = nullptr);
+	bool Build(const std::vector<float>& positions, int maxVertices = 0, ThreadPool* pool = nullptr) {
+		return Build(positions.data(), (int)(positions.size() / 3), maxVertices, pool);
+	}
+	void Clear();
+
+	/* Hull vertex farthest along direction */
+	int Support(const glm::vec3& direction) const;
+	/*
+		The same by hill climbing over the vertex neighbours from start, which visits a small part of a large hull and
+		is nearly free when start is the answer from a nearby direction. Since faces within the tolerance of a plane
+		were merged, the vertex found may fall short of the farthest by about the tolerance.
+	*/
+	int Support(const glm::vec3& direction, int start) const;
+	/* Whether p is inside or within tolerance of every face */
+	bool Contains(const glm::vec3& p, float tolerance = 0.0f) const;
+
+	inline bool IsEmpty() const { return m_Faces.empty(); }
+	inline const std::vector<glm::vec3>& GetVertices() const { return m_Vertices; }
+	inline const std::vector<Face>& GetFaces() const { return m_Faces; }
+	inline const std::vector<HalfEdge>& GetEdges() const { return m_Edges; }
+	/* Distance within which points counted as on the hull in the last build */
+	inline float GetTolerance() const { return m_Tolerance; }
+
+	/* Size of the hull in bytes (for memory reporting) */
+	size_t GetMemoryUsage() const;
+
+private:
+	friend class MeshCache;
+
+	std::vector<glm::vec3> m_Vertices;
+	std::vector<Face> m_Faces;
+	std::vector<HalfEdge> m_Edges; //The edges of each face are contiguous, starting at Face::edge
+	std::vector<int> m_NeighbourOffsets, m_Neighbours; //Vertices joined to each vertex by an edge, in ranges of m_Neighbours
+	float m_Tolerance = 0.0f;
+
+	void LinkNeighbours();
+};
@@ -1,62 +1,286 @@
 #include "Geometry.h"
 
+#include <algorithm>
+#include <cmath>
 
-#include "Eigen/Core"
-#include "Eigen/Dense"
-//#include <Eigen/SVD>
-
-#include "glm/glm.hpp"
-#include "glm/gtc/matrix_transform.hpp"
-#include "glm/gtc/matrix_access.hpp"
+#include "util/ThreadPool.h"
 
+void PointMoments::Add(const glm::vec3& p) {
+	count++;
+	glm::dvec3 delta = glm::dvec3(p) - mean;
+	mean += delta / (double)count;
+	glm::dvec3 delta2 = glm::dvec3(p) - mean;
+	comoments[0] += delta.x * delta2.x; comoments[1] += delta.x * delta2.y; comoments[2] += delta.x * delta2.z;
+	comoments[3] += delta.y * delta2.y; comoments[4] += delta.y * delta2.z; comoments[5] += delta.z * delta2.z;
+	boundsMin = glm::min(boundsMin, p);
+	boundsMax = glm::max(boundsMax, p);
+}
 
-#include <iostream>
-#include <limits>
+void PointMoments::Merge(const PointMoments& other) {
+	if (other.count == 0) {
+		return;
+	}
+	if (count == 0) {
+		*this = other;
+		return;
+	}
 
+	double n = (double)count + (double)other.count;
+	glm::dvec3 delta = other.mean - mean;
+	double weight = (double)count * (double)other.count / n;
+	comoments[0] += other.comoments[0] + delta.x * delta.x * weight;
+	comoments[1] += other.comoments[1] + delta.x * delta.y * weight;
+	comoments[2] += other.comoments[2] + delta.x * delta.z * weight;
+	comoments[3] += other.comoments[3] + delta.y * delta.y * weight;
+	comoments[4] += other.comoments[4] + delta.y * delta.z * weight;
+	comoments[5] += other.comoments[5] + delta.z * delta.z * weight;
+	mean += delta * ((double)other.count / n);
+	count += other.count;
+	boundsMin = glm::min(boundsMin, other.boundsMin);
+	boundsMax = glm::max(boundsMax, other.boundsMax);
+}
 
-#define MIN_VAL -FLT_MAX
-#define MAX_VAL FLT_MAX
+glm::dmat3 PointMoments::GetCovariance() const {
+	if (count == 0) {
+		return glm::dmat3(0.0);
+	}
+	const double* c = comoments;
+	double inv = 1.0 / (double)count;
+	return glm::dmat3(
+		c[0] * inv, c[1] * inv, c[2] * inv,
+		c[1] * inv, c[3] * inv, c[4] * inv,
+		c[2] * inv, c[4] * inv, c[5] * inv);
+}
 
+/*
+	Moments of positions [begin, end) from plain sums taken relative to the block's first point, which is much
+	cheaper than a Welford update per point; the shift keeps the sums small enough that nothing cancels badly.
+*/
+static PointMoments AccumulateBlock(const float* positions, int begin, int end) {
+	PointMoments moments;
+	if (begin >= end) {
+		return moments;
+	}
 
-using namespace Eigen;
+	const float* first = positions + (size_t)begin * 3;
+	const glm::dvec3 shift(first[0], first[1], first[2]);
+	glm::vec3 boundsMin(first[0], first[1], first[2]), boundsMax = boundsMin;
+	double sx = 0.0, sy = 0.0, sz = 0.0;
+	double sxx = 0.0, sxy = 0.0, sxz = 0.0, syy = 0.0, syz = 0.0, szz = 0.0;
+	for (int i = begin; i < end; i++) {
+		const float* p = positions + (size_t)i * 3;
+		boundsMin.x = std::min(boundsMin.x, p[0]); boundsMax.x = std::max(boundsMax.x, p[0]);
+		boundsMin.y = std::min(boundsMin.y, p[1]); boundsMax.y = std::max(boundsMax.y, p[1]);
+		boundsMin.z = std::min(boundsMin.z, p[2]); boundsMax.z = std::max(boundsMax.z, p[2]);
 
+		double x = p[0] - shift.x, y = p[1] - shift.y, z = p[2] - shift.z;
+		sx += x; sy += y; sz += z;
+		sxx += x * x; sxy += x * y; sxz += x * z;
+		syy += y * y; syz += y * z; szz += z * z;
+	}
 
-void ComputeSpatialProperties(std::vector<float>* verts) {
-	const int numVerts = ((int)verts->size()) / 3;
-	glm::vec3 minPoint(MIN_VAL, MIN_VAL, MIN_VAL);
-	glm::vec3 maxPoint(MAX_VAL, MAX_VAL, MAX_VAL);
-	glm::vec3 centroid(0.0f);
+	double n = (double)(end - begin);
+	moments.count = end - begin;
+	moments.mean = shift + glm::dvec3(sx, sy, sz) / n;
+	moments.comoments[0] = sxx - sx * sx / n; moments.comoments[1] = sxy - sx * sy / n; moments.comoments[2] = sxz - sx * sz / n;
+	moments.comoments[3] = syy - sy * sy / n; moments.comoments[4] = syz - sy * sz / n; moments.comoments[5] = szz - sz * sz / n;
+	moments.boundsMin = boundsMin;
+	moments.boundsMax = boundsMax;
+	return moments;
+}
 
-	MatrixXf A(numVerts, 3);
+SpatialProperties ComputeSpatialProperties(const float* positions, int numPoints, ThreadPool* pool) {
+	SpatialProperties props;
+	if (numPoints <= 0) {
+		return props;
+	}
+	const int numBlocks = (numPoints + POINT_BLOCK_SIZE - 1) / POINT_BLOCK_SIZE;
 
-	for (int i = 0; i < numVerts; i++) {
+	/* Pass 1: moments per block, merged in block order */
+	std::vector<PointMoments> partials(numBlocks);
+	ThreadPool::RunTasks(pool, numBlocks, [&](int b) {
+		partials[b] = AccumulateBlock(positions, b * POINT_BLOCK_SIZE, std::min((b + 1) * POINT_BLOCK_SIZE, numPoints));
+	});
+	PointMoments moments;
+	for (const PointMoments& partial : partials) {
+		moments.Merge(partial);
+	}
 
-		float x = (*verts)[i * 3];
-		float y = (*verts)[i * 3 + 1];
-		float z = (*verts)[i * 3 + 2];
-		if (x > minPoint.x) { minPoint.x = x; }
-		if (y > minPoint.y) { minPoint.y = y; }
-		if (z > minPoint.z) { minPoint.z = z; }
+	props.numPoints = numPoints;
+	props.boundsMin = moments.boundsMin;
+	props.boundsMax = moments.boundsMax;
+	props.centroid = glm::vec3(moments.mean);
+	glm::dmat3 covariance = moments.GetCovariance();
+	props.covariance = glm::mat3(covariance);
 
-		centroid.x += x;
-		centroid.y += y;
-		centroid.z += z;
+	/* Principal axes, largest variance first, completed to a right-handed frame */
+	glm::dvec3 eigenvalues;
+	glm::dmat3 eigenvectors;
+	SymmetricEigen3(covariance, eigenvalues, eigenvectors);
+	glm::dvec3 axis0 = eigenvectors[2], axis1 = eigenvectors[1];
+	glm::dvec3 axis2 = glm::cross(axis0, axis1);
+	props.principalVariances = glm::vec3((float)eigenvalues[2], (float)eigenvalues[1], (float)eigenvalues[0]);
+	props.principalAxes = glm::mat3(glm::vec3(axis0), glm::vec3(axis1), glm::vec3(axis2));
 
-		A.row(i) << x, y, z;
+	/* Pass 2: extents of the points along the axes, relative to the centroid */
+	std::vector<glm::vec3> partialMin(numBlocks, glm::vec3(FLT_MAX)), partialMax(numBlocks, glm::vec3(-FLT_MAX));
+	const glm::mat3 axesT = glm::transpose(props.principalAxes);
+	const glm::vec3 centroid = props.centroid;
+	ThreadPool::RunTasks(pool, numBlocks, [&](int b) {
+		glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		int end = std::min((b + 1) * POINT_BLOCK_SIZE, numPoints);
+		for (int i = b * POINT_BLOCK_SIZE; i < end; i++) {
+			const float* p = positions + (size_t)i * 3;
+			glm::vec3 local = axesT * (glm::vec3(p[0], p[1], p[2]) - centroid);
+			lo = glm::min(lo, local);
+			hi = glm::max(hi, local);
+		}
+		partialMin[b] = lo;
+		partialMax[b] = hi;
+	});
+	glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for (int b = 0; b < numBlocks; b++) {
+		lo = glm::min(lo, partialMin[b]);
+		hi = glm::max(hi, partialMax[b]);
 	}
 
-	//https://stats.stackexchange.com/questions/134282/relationship-between-svd-and-pca-how-to-use-svd-to-perform-pca
-	//std::cout << A << std::endl;
+	props.obb.axes = props.principalAxes;
+	props.obb.center = centroid + props.principalAxes * ((lo + hi) * 0.5f);
+	props.obb.halfExtents = (hi - lo) * 0.5f;
+	return props;
+}
 
-	JacobiSVD<MatrixXf> svd(A, ComputeThinV);
-	std::cout << "Its singular values are:" << std::endl << svd.singularValues() << std::endl;
-	std::cout << "Its right singular vectors are the columns of the thin V matrix:" << std::endl << svd.matrixV() << std::endl;
-	int ti = 1;
+/* Unit vector along the row cross product of largest magnitude: the null space of a - eigenvalue * I (rank 2) */
+static glm::dvec3 EigenvectorFromRows(const glm::dmat3& a, double eigenvalue) {
+	glm::dvec3 row0(a[0][0] - eigenvalue, a[1][0], a[2][0]);
+	glm::dvec3 row1(a[0][1], a[1][1] - eigenvalue, a[2][1]);
+	glm::dvec3 row2(a[0][2], a[1][2], a[2][2] - eigenvalue);
+	glm::dvec3 r0xr1 = glm::cross(row0, row1), r0xr2 = glm::cross(row0, row2), r1xr2 = glm::cross(row1, row2);
+	double d0 = glm::dot(r0xr1, r0xr1), d1 = glm::dot(r0xr2, r0xr2), d2 = glm::dot(r1xr2, r1xr2);
 
+	if (d0 >= d1 && d0 >= d2) {
+		return r0xr1 / std::sqrt(d0);
+	}
+	if (d1 >= d2) {
+		return r0xr2 / std::sqrt(d1);
+	}
+	return r1xr2 / std::sqrt(d2);
+}
 
+/* Unit vectors u, v completing w to a right-handed orthonormal frame */
+static void OrthogonalComplement(const glm::dvec3& w, glm::dvec3& u, glm::dvec3& v) {
+	if (std::abs(w.x) > std::abs(w.y)) {
+		double invLength = 1.0 / std::sqrt(w.x * w.x + w.z * w.z);
+		u = glm::dvec3(-w.z * invLength, 0.0, w.x * invLength);
+	} else {
+		double invLength = 1.0 / std::sqrt(w.y * w.y + w.z * w.z);
+		u = glm::dvec3(0.0, w.z * invLength, -w.y * invLength);
+	}
+	v = glm::cross(w, u);
+}
 
+/*
+	Eigenvector for the middle eigenvalue, given the (exact) eigenvector of one of the others: restricted to the
+	plane orthogonal to it the problem is 2x2, which stays well conditioned even when two eigenvalues coincide.
+*/
+static glm::dvec3 EigenvectorInComplement(const glm::dmat3& a, const glm::dvec3& known, double eigenvalue) {
+	glm::dvec3 u, v;
+	OrthogonalComplement(known, u, v);
+	glm::dvec3 au = a * u, av = a * v;
+	double m00 = glm::dot(u, au) - eigenvalue;
+	double m01 = glm::dot(u, av);
+	double m11 = glm::dot(v, av) - eigenvalue;
+	double absM00 = std::abs(m00), absM01 = std::abs(m01), absM11 = std::abs(m11);
 
+	if (absM00 >= absM11) {
+		if (std::max(absM00, absM01) <= 0.0) {
+			return u;
+		}
+		if (absM00 >= absM01) {
+			m01 /= m00;
+			m00 = 1.0 / std::sqrt(1.0 + m01 * m01);
+			m01 *= m00;
+		} else {
+			m00 /= m01;
+			m01 = 1.0 / std::sqrt(1.0 + m00 * m00);
+			m00 *= m01;
+		}
+		return m01 * u - m00 * v;
+	}
 
+	if (std::max(absM11, absM01) <= 0.0) {
+		return u;
+	}
+	if (absM11 >= absM01) {
+		m01 /= m11;
+		m11 = 1.0 / std::sqrt(1.0 + m01 * m01);
+		m01 *= m11;
+	} else {
+		m11 /= m01;
+		m01 = 1.0 / std::sqrt(1.0 + m11 * m11);
+		m11 *= m01;
+	}
+	return m11 * u - m01 * v;
 }
 
+void SymmetricEigen3(const glm::dmat3& matrix, glm::dvec3& eigenvalues, glm::dmat3& eigenvectors) {
+	/* Scale to unit max element to keep the cubic's coefficients in range */
+	double maxAbs = 0.0;
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++) {
+			maxAbs = std::max(maxAbs, std::abs(matrix[c][r]));
+		}
+	}
+	if (maxAbs == 0.0) {
+		eigenvalues = glm::dvec3(0.0);
+		eigenvectors = glm::dmat3(1.0);
+		return;
+	}
+	glm::dmat3 a = matrix * (1.0 / maxAbs);
+
+	double offDiagonal = a[1][0] * a[1][0] + a[2][0] * a[2][0] + a[2][1] * a[2][1];
+	if (offDiagonal <= 0.0) {
+		/* Already diagonal: sort the diagonal, with the axes following along */
+		int order[3] = { 0, 1, 2 };
+		std::sort(order, order + 3, [&a](int i, int j) { return a[i][i] < a[j][j]; });
+		for (int k = 0; k < 3; k++) {
+			eigenvalues[k] = a[order[k]][order[k]] * maxAbs;
+			eigenvectors[k] = glm::dvec3(0.0);
+			eigenvectors[k][order[k]] = 1.0;
+		}
+		if (glm::dot(glm::cross(eigenvectors[0], eigenvectors[1]), eigenvectors[2]) < 0.0) {
+			eigenvectors[0] = -eigenvectors[0];
+		}
+		return;
+	}
+
+	/* Eigenvalues of b = (a - qI) / p are 2cos of angles a third apart (the trigonometric solution of the cubic) */
+	double q = (a[0][0] + a[1][1] + a[2][2]) / 3.0;
+	double b00 = a[0][0] - q, b11 = a[1][1] - q, b22 = a[2][2] - q;
+	double a01 = a[1][0], a02 = a[2][0], a12 = a[2][1];
+	double p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * offDiagonal) / 6.0);
+	double c00 = b11 * b22 - a12 * a12;
+	double c01 = a01 * b22 - a12 * a02;
+	double c02 = a01 * a12 - b11 * a02;
+	double halfDet = (b00 * c00 - a01 * c01 + a02 * c02) / (p * p * p) * 0.5;
+	halfDet = std::min(std::max(halfDet, -1.0), 1.0);
 
+	const double twoThirdsPi = 2.09439510239319549;
+	double angle = std::acos(halfDet) / 3.0;
+	double beta2 = std::cos(angle) * 2.0;
+	double beta0 = std::cos(angle + twoThirdsPi) * 2.0;
+	double beta1 = -(beta0 + beta2);
+	eigenvalues = glm::dvec3(q + p * beta0, q + p * beta1, q + p * beta2);
+
+	/* Solve for the eigenvalue furthest from the other two first, it is the best separated one */
+	if (halfDet >= 0.0) {
+		eigenvectors[2] = EigenvectorFromRows(a, eigenvalues[2]);
+		eigenvectors[1] = EigenvectorInComplement(a, eigenvectors[2], eigenvalues[1]);
+		eigenvectors[0] = glm::cross(eigenvectors[1], eigenvectors[2]);
+	} else {
+		eigenvectors[0] = EigenvectorFromRows(a, eigenvalues[0]);
+		eigenvectors[1] = EigenvectorInComplement(a, eigenvectors[0], eigenvalues[1]);
+		eigenvectors[2] = glm::cross(eigenvectors[0], eigenvectors[1]);
+	}
+	eigenvalues *= maxAbs;
+}
@@ -1,5 +1,63 @@
 #pragma once
 
+#include <cfloat>
 #include <vector>
 
-void ComputeSpatialProperties(std::vector<float>* verts);
\ No newline at end of file
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+/*
+	Single pass accumulator of a point set's bounds, mean and covariance (Welford's update), so the moments can be
+	gathered without keeping the points around. Accumulators over disjoint sets merge exactly (Chan et al.), which is
+	what lets blocks of points be reduced in parallel.
+*/
+struct PointMoments {
+	int count = 0;
+	glm::dvec3 mean = glm::dvec3(0.0);
+	double comoments[6] = {}; //Sums of (x - mean)(y - mean) products: xx, xy, xz, yy, yz, zz
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+
+	void Add(const glm::vec3& p);
+	void Merge(const PointMoments& other);
+
+	/* Population covariance (divided by count) */
+	glm::dmat3 GetCovariance() const;
+};
+
+/* Box with its own orthonormal, right-handed axes (the columns of axes), given as centre and half extents */
+struct OrientedBox {
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::mat3 axes = glm::mat3(1.0f);
+	glm::vec3 halfExtents = glm::vec3(0.0f);
+};
+
+struct SpatialProperties {
+	int numPoints = 0;
+	glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+	glm::vec3 centroid = glm::vec3(0.0f);
+	glm::mat3 covariance = glm::mat3(0.0f);
+	glm::vec3 principalVariances = glm::vec3(0.0f); //Eigenvalues of the covariance, largest first
+	glm::mat3 principalAxes = glm::mat3(1.0f); //Matching unit eigenvectors as columns (right-handed)
+	OrientedBox obb; //Along the principal axes
+};
+
+/* Points accumulated per task when the moments and the box extents are reduced in parallel */
+static const int POINT_BLOCK_SIZE = 1 << 16;
+
+/*
+	Bounds, centroid, covariance and principal axes of a point cloud (xyz triples), and the bounding box along those
+	axes. Two passes over the points, constant extra memory; with a pool, blocks of points are reduced in parallel
+	and merged in a fixed order, so the result does not depend on the number of threads.
+*/
+SpatialProperties ComputeSpatialProperties(const float* positions, int numPoints, ThreadPool* pool = nullptr);
+inline SpatialProperties ComputeSpatialProperties(const std::vector<float>& positions, ThreadPool* pool = nullptr) {
+	return ComputeSpatialProperties(positions.data(), (int)(positions.size() / 3), pool);
+}
+
+/*
+	Closed form eigen decomposition of a symmetric 3x3 matrix (Eberly, "A Robust Eigensolver for 3x3 Symmetric
+	Matrices"): eigenvalues in ascending order with unit eigenvectors as the matching columns, forming a rotation.
+*/
+void SymmetricEigen3(const glm::dmat3& a, glm::dvec3& eigenvalues, glm::dmat3& eigenvectors);
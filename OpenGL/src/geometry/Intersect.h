@@ -12,138 +12,78 @@ using namespace glm;
 class Intersect {
 
 public:
-	bool rayTriangleIntersect(const vec3 &orig, const vec3 &dir,
-		const vec3 &v0, const vec3 &v1, const vec3 &v2,
-		float &t, float &u, float &v) {
-		// compute plane's normal
-		vec3 v0v1 = v1 - v0;
-		vec3 v0v2 = v2 - v0;
-		// no need to normalize
-		vec3 N = cross(v0v1, v0v2); // N 
-		float denom = dot(N, N);
-
-		// Step 1: finding P
-
-		// check if ray and plane are parallel ?
-		float NdotRayDirection = dot(N, dir);
-		if (fabs(NdotRayDirection) < EPS) // almost 0 
-			return false; // they are parallel so they don't intersect ! 
-
-		// compute d parameter using equation 2
-		float d = dot(N, v0);
-
-		// compute t (equation 3)
-		t = (dot(N, orig) + d) / NdotRayDirection;
-		// check if the triangle is in behind the ray
-		if (t < 0) return false; // the triangle is behind 
-
-		// compute the intersection point using equation 1
-		vec3 P = orig + t * dir;
-
-		// Step 2: inside-outside test
-		vec3 C; // vector perpendicular to triangle's plane 
-
-		// edge 0
-		vec3 edge0 = v1 - v0;
-		vec3 vp0 = P - v0;
-		C = cross(edge0, vp0);
-		if (dot(N, C) < 0) return false; // P is on the right side 
-
-		// edge 1
-		vec3 edge1 = v2 - v1;
-		vec3 vp1 = P - v1;
-		C = cross(edge1, vp1);
-		if ((u = dot(N, C)) < 0)  return false; // P is on the right side 
-
-		// edge 2
-		vec3 edge2 = v0 - v2;
-		vec3 vp2 = P - v2;
-		C = cross(edge2, vp2);
-		if ((v = dot(N, C)) < 0) return false; // P is on the right side; 
-
-		u /= denom;
-		v /= denom;
-
-		return true; // this ray hits the triangle 
-	}
-
-	static bool RayTriangle(Face* f, vec3 rayOrigin, vec3 rayDir, float &t) {
-
-		vec3 normal = f->normal;
-		float area2 = normal.length();
-
-		// Step 1: finding P
-
-		// check if ray and plane are parallel ?
-		float NdotRayDirection = dot(normal, rayDir);
-		if (fabs(NdotRayDirection) < EPS) // almost 0 
-			return false; // they are parallel so they don't intersect ! 
+	/*
+		Moller-Trumbore against the triangle v0, v0 + e1, v0 + e2 (the form MeshBVH stores; pass v1 - v0 and v2 - v0
+		for three vertices), accepting hits with t in [tMin, tMax]. With cullBackFaces the triangle is only hit from
+		the side it is wound counter-clockwise on. u and v are the barycentric weights of the second and third vertex.
+	*/
+	static bool RayTriangleIntersect(const vec3 &orig, const vec3 &dir, const vec3 &v0, const vec3 &e1, const vec3 &e2,
+		float tMin, float tMax, bool cullBackFaces, float &t, float &u, float &v) {
+		vec3 pvec = cross(dir, e2);
+		float det = dot(e1, pvec);
 
-		// compute d parameter using equation 2
-		float d = dot(normal, f->p0);
-
-		// compute t (equation 3)
-		t = (dot(normal, rayOrigin) + d) / NdotRayDirection;
-		// check if the triangle is in behind the ray
-		if (t < 0) return false; // the triangle is behind 
-
-		// compute the intersection point using equation 1
-		vec3 P = rayOrigin + t * rayDir;
-
-		// Step 2: inside-outside test
-		vec3 C; // vector perpendicular to triangle's plane 
+		// if the determinant is negative the triangle is backfacing
+		// if the determinant is close to 0, the ray misses the triangle
+		if (cullBackFaces ? det < EPS : fabs(det) < EPS) return false;
 
-		// edge 0
-		vec3 edge0 = f->p1 - f->p0;
-		vec3 vp0 = P - f->p0;
-		C = cross(edge0, vp0);
-		if (dot(normal, C) < 0) return false; // P is on the right side 
+		float invDet = 1.0f / det;
 
-		// edge 1
-		vec3 edge1 = f->p2 - f->p1;
-		vec3 vp1 = P - f->p1;
-		C = cross(edge1, vp1);
-		if (dot(normal, C) < 0) return false; // P is on the right side 
+		vec3 tvec = orig - v0;
+		u = dot(tvec, pvec) * invDet;
+		if (u < 0.0f || u > 1.0f) return false;
 
-		// edge 2
-		vec3 edge2 = f->p0 - f->p2;
-		vec3 vp2 = P - f->p2;
-		C = cross(edge2, vp2);
-		if (dot(normal, C) < 0) return false; // P is on the right side 
+		vec3 qvec = cross(tvec, e1);
+		v = dot(dir, qvec) * invDet;
+		if (v < 0.0f || u + v > 1.0f) return false;
 
-		return true; // this ray hits the triangle 
+		t = dot(e2, qvec) * invDet;
+		return t >= tMin && t <= tMax;
 	}
 
-	bool RayTriangleIntersect(
-		const glm::vec3 &orig, const glm::vec3 &dir,
-		const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2,
-		float &t, float &u, float &v) {
-
-		glm::vec3 v0v1 = v1 - v0;
-		glm::vec3 v0v2 = v2 - v0;
-		glm::vec3 pvec = glm::cross(dir, v0v2);
-		float det = glm::dot(v0v1, pvec);
-
-		// if the determinant is negative the triangle is backfacing
-		// if the determinant is close to 0, the ray misses the triangle
-		if (det < EPS) return false;
-
-		// ray and triangle are parallel if det is close to 0
-		if (fabs(det) < EPS) return false;
-
-		float invDet = 1 / det;
+	/*
+		Closest point to p on the triangle given as v0 and the edges e1 = v1 - v0, e2 = v2 - v0 (Ericson, "Real-Time
+		Collision Detection" 5.1.5), found by which Voronoi region of the triangle p lies in; u and v are the
+		barycentric weights of v1 and v2
+	*/
+	static glm::vec3 ClosestPointTriangleEdges(const glm::vec3 &p, const glm::vec3 &v0, const glm::vec3 &e1, const glm::vec3 &e2, float &u, float &v) {
+		glm::vec3 ap = p - v0;
+		float d1 = glm::dot(e1, ap);
+		float d2 = glm::dot(e2, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) { u = 0.0f; v = 0.0f; return v0; } // vertex region of v0
+
+		glm::vec3 bp = ap - e1;
+		float d3 = glm::dot(e1, bp);
+		float d4 = glm::dot(e2, bp);
+		if (d3 >= 0.0f && d4 <= d3) { u = 1.0f; v = 0.0f; return v0 + e1; } // vertex region of v1
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { // edge v0 v1
+			u = d1 / (d1 - d3); v = 0.0f;
+			return v0 + e1 * u;
+		}
 
-		glm::vec3 tvec = orig - v0;
-		u = glm::dot(tvec, pvec) * invDet;
-		if (u < 0 || u > 1) return false;
+		glm::vec3 cp = ap - e2;
+		float d5 = glm::dot(e1, cp);
+		float d6 = glm::dot(e2, cp);
+		if (d6 >= 0.0f && d5 <= d6) { u = 0.0f; v = 1.0f; return v0 + e2; } // vertex region of v2
 
-		glm::vec3 qvec = glm::cross(tvec, v0v1);
-		v = glm::dot(dir, qvec) * invDet;
-		if (v < 0 || u + v > 1) return false;
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { // edge v0 v2
+			u = 0.0f; v = d2 / (d2 - d6);
+			return v0 + e2 * v;
+		}
 
-		t = glm::dot(v0v2, qvec) * invDet;
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) { // edge v1 v2
+			v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			u = 1.0f - v;
+			return v0 + e1 + (e2 - e1) * v;
+		}
 
-		return true;
+		float denom = 1.0f / (va + vb + vc); // inside the face
+		u = vb * denom;
+		v = vc * denom;
+		return v0 + e1 * u + e2 * v;
 	}
 
 	static bool RayPlane(const vec3 &n, const vec3 &planeOrigin, const vec3 &rayOrigin, const vec3 &rayDir, float &t) {
@@ -0,0 +1,367 @@
+#include "IntersectKernels.h"
+
+#include <cmath>
+
+#include "Intersect.h"
+#include "util/CpuFeatures.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* The SIMD paths must round exactly like the scalar test, so GCC may not fuse their multiplies and adds (MSVC never does) */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/* Smallest float not below EPS, so that |det| < DET_EPSILON in float matches the scalar test's |det| < EPS in double */
+static float DetEpsilon() {
+	float epsilon = (float)EPS;
+	if ((double)epsilon < EPS) {
+		epsilon = std::nextafter(epsilon, 1.0f);
+	}
+	return epsilon;
+}
+static const float DET_EPSILON = DetEpsilon();
+
+static bool RayTrianglesScalar(const Ray& ray, const TrianglePacket& p, int begin, int end, RayHit& hit) {
+	bool found = false;
+	for (int i = begin; i < end; i++) {
+		float t, u, v;
+		if (Intersect::RayTriangleIntersect(ray.origin, ray.direction, glm::vec3(p.v0x[i], p.v0y[i], p.v0z[i]),
+			glm::vec3(p.e1x[i], p.e1y[i], p.e1z[i]), glm::vec3(p.e2x[i], p.e2y[i], p.e2z[i]), ray.tMin, hit.t, false, t, u, v)) {
+			hit.face = i; hit.t = t; hit.u = u; hit.v = v;
+			found = true;
+		}
+	}
+	return found;
+}
+
+static int RaysTriangleScalar(const RayPacket& r, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, int face, RayHitPacket& hits, int begin, int end) {
+	int updated = 0;
+	for (int i = begin; i < end; i++) {
+		float t, u, v;
+		if (Intersect::RayTriangleIntersect(glm::vec3(r.ox[i], r.oy[i], r.oz[i]), glm::vec3(r.dx[i], r.dy[i], r.dz[i]), v0, e1, e2,
+			r.tMin[i], hits.t[i], false, t, u, v)) {
+			hits.t[i] = t; hits.u[i] = u; hits.v[i] = v; hits.face[i] = face;
+			updated++;
+		}
+	}
+	return updated;
+}
+
+/* Highest set bit of a non-zero lane mask: the last of several triangles at the same t, as the scalar loop picks */
+static inline int HighestLane(int mask) {
+	int lane = 0;
+	while (mask >>= 1) {
+		lane++;
+	}
+	return lane;
+}
+
+static inline int CountLanes(int mask) {
+	int count = 0;
+	for (; mask != 0; mask &= mask - 1) {
+		count++;
+	}
+	return count;
+}
+
+#if SIMD_X86
+namespace {
+
+	struct Vec3SSE { __m128 x, y, z; };
+
+	/* Same operation order as glm::cross and glm::dot, so every lane computes what the scalar test computes */
+	inline Vec3SSE Cross(const Vec3SSE& a, const Vec3SSE& b) {
+		Vec3SSE c;
+		c.x = _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(b.y, a.z));
+		c.y = _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(b.z, a.x));
+		c.z = _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(b.x, a.y));
+		return c;
+	}
+
+	inline __m128 Dot(const Vec3SSE& a, const Vec3SSE& b) {
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+	}
+
+	inline Vec3SSE Broadcast(const glm::vec3& v) {
+		Vec3SSE r = { _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z) };
+		return r;
+	}
+
+	/*
+		Intersect::RayTriangleIntersect (without back face culling) for four lanes; returns the mask of lanes that hit. The reject tests are the
+		scalar ones negated (rather than the accept tests) so that lanes with NaNs come out the same way too.
+	*/
+	inline __m128 MollerTrumbore(const Vec3SSE& orig, const Vec3SSE& dir, const Vec3SSE& v0, const Vec3SSE& e1, const Vec3SSE& e2,
+		const __m128& tMin, const __m128& tMax, __m128& t, __m128& u, __m128& v) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		Vec3SSE pvec = Cross(dir, e2);
+		__m128 det = Dot(e1, pvec);
+		__m128 invDet = _mm_div_ps(one, det);
+
+		Vec3SSE tvec = { _mm_sub_ps(orig.x, v0.x), _mm_sub_ps(orig.y, v0.y), _mm_sub_ps(orig.z, v0.z) };
+		u = _mm_mul_ps(Dot(tvec, pvec), invDet);
+		Vec3SSE qvec = Cross(tvec, e1);
+		v = _mm_mul_ps(Dot(dir, qvec), invDet);
+		t = _mm_mul_ps(Dot(e2, qvec), invDet);
+
+		__m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+		__m128 reject = _mm_cmplt_ps(absDet, _mm_set1_ps(DET_EPSILON));
+		reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmpgt_ps(u, one)));
+		reject = _mm_or_ps(reject, _mm_or_ps(_mm_cmplt_ps(v, zero), _mm_cmpgt_ps(_mm_add_ps(u, v), one)));
+		__m128 inRange = _mm_and_ps(_mm_cmpge_ps(t, tMin), _mm_cmple_ps(t, tMax));
+		return _mm_andnot_ps(reject, inRange);
+	}
+
+	inline __m128 Select(const __m128& mask, const __m128& a, const __m128& b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+}
+
+static bool RayTrianglesSSE(const Ray& ray, const TrianglePacket& p, int begin, int end, RayHit& hit) {
+	const Vec3SSE orig = Broadcast(ray.origin);
+	const Vec3SSE dir = Broadcast(ray.direction);
+	const __m128 tMin = _mm_set1_ps(ray.tMin);
+	const __m128 infinity = _mm_set1_ps(INFINITY);
+	bool found = false;
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		Vec3SSE v0 = { _mm_loadu_ps(p.v0x + i), _mm_loadu_ps(p.v0y + i), _mm_loadu_ps(p.v0z + i) };
+		Vec3SSE e1 = { _mm_loadu_ps(p.e1x + i), _mm_loadu_ps(p.e1y + i), _mm_loadu_ps(p.e1z + i) };
+		Vec3SSE e2 = { _mm_loadu_ps(p.e2x + i), _mm_loadu_ps(p.e2y + i), _mm_loadu_ps(p.e2z + i) };
+		__m128 t, u, v;
+		__m128 hitMask = MollerTrumbore(orig, dir, v0, e1, e2, tMin, _mm_set1_ps(hit.t), t, u, v);
+		int mask = _mm_movemask_ps(hitMask);
+		if (mask == 0) {
+			continue;
+		}
+
+		/* Nearest lane; the loop would have accepted every lane at that t in turn and kept the last */
+		__m128 tHit = Select(hitMask, t, infinity);
+		__m128 tNearest = _mm_min_ps(tHit, _mm_shuffle_ps(tHit, tHit, _MM_SHUFFLE(2, 3, 0, 1)));
+		tNearest = _mm_min_ps(tNearest, _mm_shuffle_ps(tNearest, tNearest, _MM_SHUFFLE(1, 0, 3, 2)));
+		int lane = HighestLane(_mm_movemask_ps(_mm_cmpeq_ps(tHit, tNearest)) & mask);
+
+		float ts[4], us[4], vs[4];
+		_mm_storeu_ps(ts, t); _mm_storeu_ps(us, u); _mm_storeu_ps(vs, v);
+		hit.face = i + lane; hit.t = ts[lane]; hit.u = us[lane]; hit.v = vs[lane];
+		found = true;
+	}
+	return RayTrianglesScalar(ray, p, i, end, hit) || found;
+}
+
+static int RaysTriangleSSE(const RayPacket& r, const glm::vec3& triV0, const glm::vec3& triE1, const glm::vec3& triE2, int face, RayHitPacket& hits, int begin, int end) {
+	const Vec3SSE v0 = Broadcast(triV0), e1 = Broadcast(triE1), e2 = Broadcast(triE2);
+	const __m128i faceIndex = _mm_set1_epi32(face);
+	int updated = 0;
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		Vec3SSE orig = { _mm_loadu_ps(r.ox + i), _mm_loadu_ps(r.oy + i), _mm_loadu_ps(r.oz + i) };
+		Vec3SSE dir = { _mm_loadu_ps(r.dx + i), _mm_loadu_ps(r.dy + i), _mm_loadu_ps(r.dz + i) };
+		__m128 tClosest = _mm_loadu_ps(hits.t + i);
+		__m128 t, u, v;
+		__m128 hitMask = MollerTrumbore(orig, dir, v0, e1, e2, _mm_loadu_ps(r.tMin + i), tClosest, t, u, v);
+		int mask = _mm_movemask_ps(hitMask);
+		if (mask == 0) {
+			continue;
+		}
+
+		_mm_storeu_ps(hits.t + i, Select(hitMask, t, tClosest));
+		_mm_storeu_ps(hits.u + i, Select(hitMask, u, _mm_loadu_ps(hits.u + i)));
+		_mm_storeu_ps(hits.v + i, Select(hitMask, v, _mm_loadu_ps(hits.v + i)));
+		__m128i faceMask = _mm_castps_si128(hitMask);
+		__m128i faces = _mm_loadu_si128((const __m128i*)(hits.face + i));
+		_mm_storeu_si128((__m128i*)(hits.face + i), _mm_or_si128(_mm_and_si128(faceMask, faceIndex), _mm_andnot_si128(faceMask, faces)));
+		updated += CountLanes(mask);
+	}
+	return updated + RaysTriangleScalar(r, triV0, triE1, triE2, face, hits, i, end);
+}
+
+namespace {
+
+	struct Vec3AVX { __m256 x, y, z; };
+
+	TARGET_AVX2 inline Vec3AVX Cross(const Vec3AVX& a, const Vec3AVX& b) {
+		Vec3AVX c;
+		c.x = _mm256_sub_ps(_mm256_mul_ps(a.y, b.z), _mm256_mul_ps(b.y, a.z));
+		c.y = _mm256_sub_ps(_mm256_mul_ps(a.z, b.x), _mm256_mul_ps(b.z, a.x));
+		c.z = _mm256_sub_ps(_mm256_mul_ps(a.x, b.y), _mm256_mul_ps(b.x, a.y));
+		return c;
+	}
+
+	TARGET_AVX2 inline __m256 Dot(const Vec3AVX& a, const Vec3AVX& b) {
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a.x, b.x), _mm256_mul_ps(a.y, b.y)), _mm256_mul_ps(a.z, b.z));
+	}
+
+	TARGET_AVX2 inline Vec3AVX Broadcast8(const glm::vec3& v) {
+		Vec3AVX r = { _mm256_set1_ps(v.x), _mm256_set1_ps(v.y), _mm256_set1_ps(v.z) };
+		return r;
+	}
+
+	/* Eight lane version of the SSE MollerTrumbore above, with the ordered predicates the _mm_cmp*_ps compares use */
+	TARGET_AVX2 inline __m256 MollerTrumbore(const Vec3AVX& orig, const Vec3AVX& dir, const Vec3AVX& v0, const Vec3AVX& e1, const Vec3AVX& e2,
+		const __m256& tMin, const __m256& tMax, __m256& t, __m256& u, __m256& v) {
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		Vec3AVX pvec = Cross(dir, e2);
+		__m256 det = Dot(e1, pvec);
+		__m256 invDet = _mm256_div_ps(one, det);
+
+		Vec3AVX tvec = { _mm256_sub_ps(orig.x, v0.x), _mm256_sub_ps(orig.y, v0.y), _mm256_sub_ps(orig.z, v0.z) };
+		u = _mm256_mul_ps(Dot(tvec, pvec), invDet);
+		Vec3AVX qvec = Cross(tvec, e1);
+		v = _mm256_mul_ps(Dot(dir, qvec), invDet);
+		t = _mm256_mul_ps(Dot(e2, qvec), invDet);
+
+		__m256 absDet = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), det);
+		__m256 reject = _mm256_cmp_ps(absDet, _mm256_set1_ps(DET_EPSILON), _CMP_LT_OS);
+		reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OS), _mm256_cmp_ps(u, one, _CMP_GT_OS)));
+		reject = _mm256_or_ps(reject, _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OS), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OS)));
+		__m256 inRange = _mm256_and_ps(_mm256_cmp_ps(t, tMin, _CMP_GE_OS), _mm256_cmp_ps(t, tMax, _CMP_LE_OS));
+		return _mm256_andnot_ps(reject, inRange);
+	}
+
+}
+
+TARGET_AVX2 static bool RayTrianglesAVX2(const Ray& ray, const TrianglePacket& p, int begin, int end, RayHit& hit) {
+	const Vec3AVX orig = Broadcast8(ray.origin);
+	const Vec3AVX dir = Broadcast8(ray.direction);
+	const __m256 tMin = _mm256_set1_ps(ray.tMin);
+	const __m256 infinity = _mm256_set1_ps(INFINITY);
+	bool found = false;
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		Vec3AVX v0 = { _mm256_loadu_ps(p.v0x + i), _mm256_loadu_ps(p.v0y + i), _mm256_loadu_ps(p.v0z + i) };
+		Vec3AVX e1 = { _mm256_loadu_ps(p.e1x + i), _mm256_loadu_ps(p.e1y + i), _mm256_loadu_ps(p.e1z + i) };
+		Vec3AVX e2 = { _mm256_loadu_ps(p.e2x + i), _mm256_loadu_ps(p.e2y + i), _mm256_loadu_ps(p.e2z + i) };
+		__m256 t, u, v;
+		__m256 hitMask = MollerTrumbore(orig, dir, v0, e1, e2, tMin, _mm256_set1_ps(hit.t), t, u, v);
+		int mask = _mm256_movemask_ps(hitMask);
+		if (mask == 0) {
+			continue;
+		}
+
+		__m256 tHit = _mm256_blendv_ps(infinity, t, hitMask);
+		__m256 tNearest = _mm256_min_ps(tHit, _mm256_permute_ps(tHit, _MM_SHUFFLE(2, 3, 0, 1)));
+		tNearest = _mm256_min_ps(tNearest, _mm256_permute_ps(tNearest, _MM_SHUFFLE(1, 0, 3, 2)));
+		tNearest = _mm256_min_ps(tNearest, _mm256_permute2f128_ps(tNearest, tNearest, 1));
+		int lane = HighestLane(_mm256_movemask_ps(_mm256_cmp_ps(tHit, tNearest, _CMP_EQ_OQ)) & mask);
+
+		float ts[8], us[8], vs[8];
+		_mm256_storeu_ps(ts, t); _mm256_storeu_ps(us, u); _mm256_storeu_ps(vs, v);
+		hit.face = i + lane; hit.t = ts[lane]; hit.u = us[lane]; hit.v = vs[lane];
+		found = true;
+	}
+	return RayTrianglesSSE(ray, p, i, end, hit) || found;
+}
+
+TARGET_AVX2 static int RaysTriangleAVX2(const RayPacket& r, const glm::vec3& triV0, const glm::vec3& triE1, const glm::vec3& triE2, int face, RayHitPacket& hits, int begin, int end) {
+	const Vec3AVX v0 = Broadcast8(triV0), e1 = Broadcast8(triE1), e2 = Broadcast8(triE2);
+	const __m256i faceIndex = _mm256_set1_epi32(face);
+	int updated = 0;
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		Vec3AVX orig = { _mm256_loadu_ps(r.ox + i), _mm256_loadu_ps(r.oy + i), _mm256_loadu_ps(r.oz + i) };
+		Vec3AVX dir = { _mm256_loadu_ps(r.dx + i), _mm256_loadu_ps(r.dy + i), _mm256_loadu_ps(r.dz + i) };
+		__m256 tClosest = _mm256_loadu_ps(hits.t + i);
+		__m256 t, u, v;
+		__m256 hitMask = MollerTrumbore(orig, dir, v0, e1, e2, _mm256_loadu_ps(r.tMin + i), tClosest, t, u, v);
+		int mask = _mm256_movemask_ps(hitMask);
+		if (mask == 0) {
+			continue;
+		}
+
+		_mm256_storeu_ps(hits.t + i, _mm256_blendv_ps(tClosest, t, hitMask));
+		_mm256_storeu_ps(hits.u + i, _mm256_blendv_ps(_mm256_loadu_ps(hits.u + i), u, hitMask));
+		_mm256_storeu_ps(hits.v + i, _mm256_blendv_ps(_mm256_loadu_ps(hits.v + i), v, hitMask));
+		__m256i faces = _mm256_loadu_si256((const __m256i*)(hits.face + i));
+		_mm256_storeu_si256((__m256i*)(hits.face + i), _mm256_blendv_epi8(faces, faceIndex, _mm256_castps_si256(hitMask)));
+		updated += CountLanes(mask);
+	}
+	return updated + RaysTriangleSSE(r, triV0, triE1, triE2, face, hits, i, end);
+}
+#endif
+
+bool IntersectKernels::RayTriangles(const Ray& ray, const TrianglePacket& triangles, RayHit& hit, Path path) {
+	/* Work on a copy so that hit is only written when something is found */
+	RayHit closest;
+	closest.t = ray.tMax;
+	bool found = false;
+
+	if (!IsSupported(path)) {
+		path = GetBestPath();
+	}
+#if SIMD_X86
+	if (path == Path::AVX2) {
+		found = RayTrianglesAVX2(ray, triangles, 0, triangles.count, closest);
+	} else if (path == Path::SSE) {
+		found = RayTrianglesSSE(ray, triangles, 0, triangles.count, closest);
+	} else
+#endif
+	{
+		found = RayTrianglesScalar(ray, triangles, 0, triangles.count, closest);
+	}
+
+	if (found) {
+		hit = closest;
+	}
+	return found;
+}
+
+int IntersectKernels::RaysTriangle(const RayPacket& rays, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, int face, RayHitPacket& hits, Path path) {
+	if (rays.count <= 0) {
+		return 0;
+	}
+
+	if (!IsSupported(path)) {
+		path = GetBestPath();
+	}
+#if SIMD_X86
+	if (path == Path::AVX2) {
+		return RaysTriangleAVX2(rays, v0, e1, e2, face, hits, 0, rays.count);
+	}
+	if (path == Path::SSE) {
+		return RaysTriangleSSE(rays, v0, e1, e2, face, hits, 0, rays.count);
+	}
+#endif
+	return RaysTriangleScalar(rays, v0, e1, e2, face, hits, 0, rays.count);
+}
+
+IntersectKernels::Path IntersectKernels::GetBestPath() {
+	if (IsSupported(Path::AVX2)) {
+		return Path::AVX2;
+	}
+	if (IsSupported(Path::SSE)) {
+		return Path::SSE;
+	}
+	return Path::Scalar;
+}
+
+bool IntersectKernels::IsSupported(Path path) {
+	switch (path) {
+#if SIMD_X86
+	case Path::SSE: return CpuFeatures::Get().sse2;
+	case Path::AVX2: return CpuFeatures::Get().avx2;
+#endif
+	case Path::Scalar: return true;
+	default: return false;
+	}
+}
+
+const char* IntersectKernels::GetName(Path path) {
+	switch (path) {
+	case Path::SSE: return "SSE";
+	case Path::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "MeshBVH.h"
+
+/*
+	Structure-of-arrays triangles in the form the Moller-Trumbore test wants them: vertex v0 and the edges
+	e1 = v1 - v0, e2 = v2 - v0. Each pointer addresses count floats.
+*/
+struct TrianglePacket {
+	const float* v0x = nullptr; const float* v0y = nullptr; const float* v0z = nullptr;
+	const float* e1x = nullptr; const float* e1y = nullptr; const float* e1z = nullptr;
+	const float* e2x = nullptr; const float* e2y = nullptr; const float* e2z = nullptr;
+	int count = 0;
+};
+
+/* Owning storage for a TrianglePacket, filled one triangle at a time */
+class TriangleArrays {
+public:
+	void Resize(int count) {
+		for (int c = 0; c < NUM_CHANNELS; c++) {
+			m_Channels[c].resize(count);
+		}
+	}
+	inline int GetCount() const { return (int)m_Channels[0].size(); }
+
+	inline void Set(int i, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+		glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+		m_Channels[0][i] = v0.x; m_Channels[1][i] = v0.y; m_Channels[2][i] = v0.z;
+		m_Channels[3][i] = e1.x; m_Channels[4][i] = e1.y; m_Channels[5][i] = e1.z;
+		m_Channels[6][i] = e2.x; m_Channels[7][i] = e2.y; m_Channels[8][i] = e2.z;
+	}
+
+	TrianglePacket GetPacket() const {
+		TrianglePacket packet;
+		packet.v0x = m_Channels[0].data(); packet.v0y = m_Channels[1].data(); packet.v0z = m_Channels[2].data();
+		packet.e1x = m_Channels[3].data(); packet.e1y = m_Channels[4].data(); packet.e1z = m_Channels[5].data();
+		packet.e2x = m_Channels[6].data(); packet.e2y = m_Channels[7].data(); packet.e2z = m_Channels[8].data();
+		packet.count = GetCount();
+		return packet;
+	}
+
+private:
+	static const int NUM_CHANNELS = 9;
+	std::vector<float> m_Channels[NUM_CHANNELS]; //v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z
+};
+
+/* Structure-of-arrays rays (origins, directions and the near end of each ray's interval); count entries each */
+struct RayPacket {
+	const float* ox = nullptr; const float* oy = nullptr; const float* oz = nullptr;
+	const float* dx = nullptr; const float* dy = nullptr; const float* dz = nullptr;
+	const float* tMin = nullptr;
+	int count = 0;
+};
+
+/* Closest hit so far of every ray in a RayPacket; t doubles as the far end of each ray's interval */
+struct RayHitPacket {
+	float* t = nullptr;
+	float* u = nullptr; float* v = nullptr;
+	int* face = nullptr; //Left untouched for rays that hit nothing
+};
+
+/*
+	Packet versions of Intersect::RayTriangleIntersect without back face culling, for picking and visibility queries
+	that test many triangles or many rays at once.
+
+	The SIMD paths evaluate 4 (SSE) or 8 (AVX2) triangles or rays at once, one per lane, with the same operation order
+	as the scalar test and without FMA contraction, so every path reports exactly the hits, t and barycentrics that
+	calling Intersect::RayTriangleIntersect in a loop would. That includes ties: like the loop, which accepts hits at
+	t <= closest, the later of two triangles at the same t wins.
+*/
+class IntersectKernels {
+public:
+	enum class Path { Scalar, SSE, AVX2 };
+
+	/* Closest of the packet's triangles along the ray; hit.face is the index in the packet */
+	static bool RayTriangles(const Ray& ray, const TrianglePacket& triangles, RayHit& hit, Path path);
+	static bool RayTriangles(const Ray& ray, const TrianglePacket& triangles, RayHit& hit) { return RayTriangles(ray, triangles, hit, GetBestPath()); }
+
+	/*
+		Tests every ray against one triangle, updating the hits of the rays for which it lies in [tMin, t] (with face
+		recorded as the given index). Returns how many hits were updated.
+	*/
+	static int RaysTriangle(const RayPacket& rays, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, int face, RayHitPacket& hits, Path path);
+	static int RaysTriangle(const RayPacket& rays, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, int face, RayHitPacket& hits) {
+		return RaysTriangle(rays, v0, e1, e2, face, hits, GetBestPath());
+	}
+
+	/* Widest path supported by the running CPU */
+	static Path GetBestPath();
+	static bool IsSupported(Path path);
+	static const char* GetName(Path path);
+};
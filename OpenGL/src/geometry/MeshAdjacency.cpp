@@ -0,0 +1,158 @@
+#include "MeshAdjacency.h"
+
+#include <cmath>
+#include <cstring>
+
+const int MeshAdjacency::NO_NEIGHBOUR;
+
+/* Finalizer from splitmix64, good enough avalanche for quantized coordinates and packed edge keys */
+static inline uint64_t HashMix(uint64_t x) {
+	x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static inline size_t NextPowerOfTwo(size_t n) {
+	size_t p = 16;
+	while (p < n) { p <<= 1; }
+	return p;
+}
+
+struct QuantizedPosition {
+	int64_t x, y, z;
+	bool operator==(const QuantizedPosition& that) const { return x == that.x && y == that.y && z == that.z; }
+};
+
+static inline int64_t Quantize(float value, float invTolerance) {
+	if (invTolerance > 0.0f) {
+		return (int64_t)std::floor((double)value * invTolerance + 0.5);
+	}
+
+	/* Exact welding: compare bit patterns (adding zero folds -0.0 into 0.0) */
+	float v = value + 0.0f;
+	int32_t bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	return bits;
+}
+
+void MeshAdjacency::Clear() {
+	m_WeldedVertices.clear();
+	m_NumWeldedVertices = 0;
+	m_FaceNeighbours.clear();
+	m_Edges.clear();
+	m_BoundaryEdges.clear();
+	m_NonManifoldEdges.clear();
+}
+
+void MeshAdjacency::WeldVertices(const float* positions, int numVertices, float weldTolerance) {
+	const float invTolerance = weldTolerance > 0.0f ? 1.0f / weldTolerance : 0.0f;
+	const size_t tableSize = NextPowerOfTwo((size_t)numVertices * 2);
+	const size_t mask = tableSize - 1;
+
+	/* Open addressing table mapping quantized position -> welded id */
+	std::vector<int> slots(tableSize, -1);
+	std::vector<QuantizedPosition> keys;
+	keys.reserve(numVertices);
+
+	m_WeldedVertices.resize(numVertices);
+	for (int i = 0; i < numVertices; i++) {
+		QuantizedPosition q = {
+			Quantize(positions[i * 3], invTolerance),
+			Quantize(positions[i * 3 + 1], invTolerance),
+			Quantize(positions[i * 3 + 2], invTolerance) };
+
+		size_t slot = HashMix((uint64_t)q.x * 73856093ULL ^ (uint64_t)q.y * 19349663ULL ^ (uint64_t)q.z * 83492791ULL) & mask;
+		while (slots[slot] != -1 && !(keys[slots[slot]] == q)) {
+			slot = (slot + 1) & mask;
+		}
+
+		if (slots[slot] == -1) {
+			slots[slot] = (int)keys.size();
+			keys.push_back(q);
+		}
+		m_WeldedVertices[i] = slots[slot];
+	}
+
+	m_NumWeldedVertices = (int)keys.size();
+}
+
+void MeshAdjacency::Build(const float* positions, int numVertices, const unsigned int* indices, int numFaces, float weldTolerance) {
+	Clear();
+	if (numFaces <= 0) {
+		return;
+	}
+
+	WeldVertices(positions, numVertices, weldTolerance);
+
+	m_FaceNeighbours.assign((size_t)numFaces * 3, NO_NEIGHBOUR);
+	m_Edges.reserve((size_t)numFaces * 3 / 2 + 1);
+
+	/* Face-edge slot (face * 3 + edge) through which each edge was first seen, so the first face can be linked later */
+	std::vector<int> firstFaceEdge;
+	firstFaceEdge.reserve(m_Edges.capacity());
+
+	const size_t tableSize = NextPowerOfTwo((size_t)numFaces * 4);
+	const size_t mask = tableSize - 1;
+	std::vector<int> slots(tableSize, -1);
+	std::vector<uint64_t> slotKeys(tableSize);
+
+	for (int f = 0; f < numFaces; f++) {
+		int w[3] = {
+			m_WeldedVertices[indices[f * 3]],
+			m_WeldedVertices[indices[f * 3 + 1]],
+			m_WeldedVertices[indices[f * 3 + 2]] };
+
+		for (int e = 0; e < 3; e++) {
+			int a = w[e];
+			int b = w[(e + 1) % 3];
+			if (a == b) {
+				continue; //Degenerate edge (collapsed by welding)
+			}
+			if (a > b) { int t = a; a = b; b = t; }
+
+			uint64_t key = ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+			size_t slot = HashMix(key) & mask;
+			while (slots[slot] != -1 && slotKeys[slot] != key) {
+				slot = (slot + 1) & mask;
+			}
+
+			if (slots[slot] == -1) {
+				slots[slot] = (int)m_Edges.size();
+				slotKeys[slot] = key;
+				m_Edges.push_back({ a, b, f, NO_NEIGHBOUR, 1 });
+				firstFaceEdge.push_back(f * 3 + e);
+				continue;
+			}
+
+			int edgeIndex = slots[slot];
+			Edge& edge = m_Edges[edgeIndex];
+			if (edge.f0 == f) {
+				continue; //Same face uses this edge twice (degenerate triangle)
+			}
+
+			if (edge.faceCount == 1) {
+				/* Second face on this edge: link the pair in both directions */
+				edge.f1 = f;
+				m_FaceNeighbours[firstFaceEdge[edgeIndex]] = f;
+				m_FaceNeighbours[f * 3 + e] = edge.f0;
+			}
+			edge.faceCount++;
+		}
+	}
+
+	for (int i = 0; i < (int)m_Edges.size(); i++) {
+		if (m_Edges[i].faceCount == 1) {
+			m_BoundaryEdges.push_back(i);
+		} else if (m_Edges[i].faceCount > 2) {
+			m_NonManifoldEdges.push_back(i);
+		}
+	}
+}
+
+size_t MeshAdjacency::GetMemoryUsage() const {
+	return m_WeldedVertices.capacity() * sizeof(int)
+		+ m_FaceNeighbours.capacity() * sizeof(int)
+		+ m_Edges.capacity() * sizeof(Edge)
+		+ (m_BoundaryEdges.capacity() + m_NonManifoldEdges.capacity()) * sizeof(int);
+}
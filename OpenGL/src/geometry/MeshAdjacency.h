@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Edge-keyed face adjacency for indexed triangle meshes.
+
+	Vertices are first welded by quantizing their positions onto a grid of size weldTolerance, so that faces which
+	only share positions (and not indices, e.g. the cube which duplicates corners for lighting) are still connected.
+	Every undirected welded edge is then hashed into an open addressing table that records the (up to) two faces
+	using it. The whole build is O(F) and produces flat arrays rather than per-face containers.
+*/
+class MeshAdjacency {
+public:
+	static const int NO_NEIGHBOUR = -1;
+
+	/* An undirected edge between two welded vertices, along with the faces that use it */
+	struct Edge {
+		int v0, v1; //Welded vertex ids (v0 < v1)
+		int f0, f1; //First two faces using the edge (f1 == NO_NEIGHBOUR for boundary edges)
+		int faceCount; //Total number of faces using the edge (> 2 for non-manifold edges)
+	};
+
+	MeshAdjacency() {}
+	~MeshAdjacency() {}
+
+	void Build(const float* positions, int numVertices, const unsigned int* indices, int numFaces, float weldTolerance = 1.0e-6f);
+	void Build(const std::vector<float>& positions, const std::vector<unsigned int>& indices, float weldTolerance = 1.0e-6f) {
+		Build(positions.data(), (int)(positions.size() / 3), indices.data(), (int)(indices.size() / 3), weldTolerance);
+	}
+	void Clear();
+
+	/* Face across edge (corner e, corner (e + 1) % 3) of the given face, or NO_NEIGHBOUR */
+	inline int GetNeighbour(int face, int edge) const { return m_FaceNeighbours[face * 3 + edge]; }
+	inline const std::vector<int>& GetFaceNeighbours() const { return m_FaceNeighbours; }
+
+	/* Welded vertex id for each original vertex */
+	inline const std::vector<int>& GetWeldedVertices() const { return m_WeldedVertices; }
+	inline int GetNumWeldedVertices() const { return m_NumWeldedVertices; }
+
+	inline const std::vector<Edge>& GetEdges() const { return m_Edges; }
+	inline const std::vector<int>& GetBoundaryEdges() const { return m_BoundaryEdges; }
+	inline const std::vector<int>& GetNonManifoldEdges() const { return m_NonManifoldEdges; }
+	inline int GetNumFaces() const { return (int)(m_FaceNeighbours.size() / 3); }
+	inline bool IsClosedManifold() const { return m_BoundaryEdges.empty() && m_NonManifoldEdges.empty(); }
+
+	/* Size of the adjacency data in bytes (for memory reporting) */
+	size_t GetMemoryUsage() const;
+
+private:
+	friend class MeshCache;
+
+	std::vector<int> m_WeldedVertices;
+	int m_NumWeldedVertices = 0;
+	std::vector<int> m_FaceNeighbours; //3 entries per face
+	std::vector<Edge> m_Edges;
+	std::vector<int> m_BoundaryEdges; //Indices into m_Edges
+	std::vector<int> m_NonManifoldEdges; //Indices into m_Edges
+
+	void WeldVertices(const float* positions, int numVertices, float weldTolerance);
+};
@@ -0,0 +1,404 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Intersect.h"
+
+/* Cost of a node visit relative to one ray-triangle test, for the surface area heuristic */
+static const float TRAVERSAL_COST = 1.0f;
+
+/* Traversal leaves at most one sibling per level on the stack */
+static const int STACK_SIZE = MeshBVH::MAX_DEPTH + 2;
+
+namespace {
+
+	struct Bounds {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+
+		inline void Grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+		inline void Grow(const Bounds& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+		inline float HalfArea() const {
+			glm::vec3 e = max - min;
+			return (e.x < 0.0f) ? 0.0f : e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+	};
+
+}
+
+/* Entry and exit distances of the ray through the node's box (slab test), clipped to [tMin, tMax] */
+static inline bool RayBox(const MeshBVH::Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float& tEnter) {
+	glm::vec3 t0 = (node.boundsMin - origin) * invDir;
+	glm::vec3 t1 = (node.boundsMax - origin) * invDir;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+	float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+	tEnter = enter;
+	return enter <= exit;
+}
+
+/* Squared distance from p to the node's box (0 inside it) */
+static inline float PointBoxDistance2(const MeshBVH::Node& node, const glm::vec3& p) {
+	glm::vec3 d = glm::max(glm::max(node.boundsMin - p, p - node.boundsMax), glm::vec3(0.0f));
+	return glm::dot(d, d);
+}
+
+/* Division that maps a zero direction component to a huge (rather than infinite) slope, avoiding 0 * inf = NaN */
+static inline glm::vec3 SafeInverse(const glm::vec3& d) {
+	const float big = 1.0e30f;
+	return glm::vec3(
+		d.x != 0.0f ? 1.0f / d.x : big,
+		d.y != 0.0f ? 1.0f / d.y : big,
+		d.z != 0.0f ? 1.0f / d.z : big);
+}
+
+void MeshBVH::Build(const float* positions, int numVertices, const unsigned int* indices, int numFaces, int maxLeafSize) {
+	Clear();
+	if (numFaces <= 0 || numVertices <= 0) {
+		return;
+	}
+	maxLeafSize = std::max(maxLeafSize, 1);
+
+	auto vertex = [positions](unsigned int i) { return glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]); };
+
+	std::vector<Bounds> faceBounds(numFaces);
+	std::vector<glm::vec3> centroids(numFaces);
+	std::vector<int> faceOrder(numFaces);
+	for (int f = 0; f < numFaces; f++) {
+		Bounds& b = faceBounds[f];
+		b.Grow(vertex(indices[f * 3]));
+		b.Grow(vertex(indices[f * 3 + 1]));
+		b.Grow(vertex(indices[f * 3 + 2]));
+		centroids[f] = (b.min + b.max) * 0.5f;
+		faceOrder[f] = f;
+	}
+
+	/* A binary tree with single face leaves has 2F - 1 nodes, so this never reallocates */
+	m_Nodes.reserve(2 * numFaces);
+	m_Nodes.push_back(Node{ glm::vec3(0.0f), 0, glm::vec3(0.0f), numFaces });
+
+	struct Task { int node; int depth; };
+	std::vector<Task> stack;
+	stack.push_back(Task{ 0, 0 });
+
+	while (!stack.empty()) {
+		Task task = stack.back();
+		stack.pop_back();
+
+		const int first = m_Nodes[task.node].first;
+		const int count = m_Nodes[task.node].count;
+
+		Bounds nodeBounds, centroidBounds;
+		for (int i = first; i < first + count; i++) {
+			nodeBounds.Grow(faceBounds[faceOrder[i]]);
+			centroidBounds.Grow(centroids[faceOrder[i]]);
+		}
+		m_Nodes[task.node].boundsMin = nodeBounds.min;
+		m_Nodes[task.node].boundsMax = nodeBounds.max;
+
+		if (count <= maxLeafSize || task.depth >= MAX_DEPTH) {
+			continue;
+		}
+
+		/* Binned SAH: sweep the bin boundaries of every axis and keep the cheapest split */
+		float bestCost = (float)count * nodeBounds.HalfArea();
+		int bestAxis = -1, bestSplit = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			if (extent <= 0.0f) {
+				continue;
+			}
+			float scale = (float)BIN_COUNT / extent;
+
+			Bounds bins[BIN_COUNT];
+			int binCounts[BIN_COUNT] = {};
+			for (int i = first; i < first + count; i++) {
+				int f = faceOrder[i];
+				int bin = std::min((int)((centroids[f][axis] - centroidBounds.min[axis]) * scale), BIN_COUNT - 1);
+				bins[bin].Grow(faceBounds[f]);
+				binCounts[bin]++;
+			}
+
+			/* Right to left sweep stores the right-hand cost of every split, the left to right sweep completes it */
+			float rightArea[BIN_COUNT];
+			int rightCount[BIN_COUNT];
+			Bounds accum;
+			int accumCount = 0;
+			for (int b = BIN_COUNT - 1; b > 0; b--) {
+				accum.Grow(bins[b]);
+				accumCount += binCounts[b];
+				rightArea[b] = accum.HalfArea();
+				rightCount[b] = accumCount;
+			}
+
+			accum = Bounds();
+			accumCount = 0;
+			for (int b = 1; b < BIN_COUNT; b++) {
+				accum.Grow(bins[b - 1]);
+				accumCount += binCounts[b - 1];
+				if (accumCount == 0 || rightCount[b] == 0) {
+					continue;
+				}
+				float cost = TRAVERSAL_COST * nodeBounds.HalfArea() + accumCount * accum.HalfArea() + rightCount[b] * rightArea[b];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		if (bestAxis < 0) {
+			continue; //No split is cheaper than testing every triangle (or all centroids coincide)
+		}
+
+		float splitMin = centroidBounds.min[bestAxis];
+		float splitScale = (float)BIN_COUNT / (centroidBounds.max[bestAxis] - splitMin);
+		int* middle = std::partition(faceOrder.data() + first, faceOrder.data() + first + count, [&](int f) {
+			return std::min((int)((centroids[f][bestAxis] - splitMin) * splitScale), BIN_COUNT - 1) < bestSplit;
+		});
+		int leftCount = (int)(middle - (faceOrder.data() + first));
+		if (leftCount == 0 || leftCount == count) {
+			continue;
+		}
+
+		int left = (int)m_Nodes.size();
+		m_Nodes.push_back(Node{ glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount });
+		m_Nodes.push_back(Node{ glm::vec3(0.0f), first + leftCount, glm::vec3(0.0f), count - leftCount });
+		m_Nodes[task.node].first = left;
+		m_Nodes[task.node].count = 0;
+
+		stack.push_back(Task{ left + 1, task.depth + 1 });
+		stack.push_back(Task{ left, task.depth + 1 });
+	}
+	m_Nodes.shrink_to_fit();
+
+	/* Leaves index straight into the triangle array, which is laid out in leaf order */
+	m_Triangles.resize(numFaces);
+	for (int i = 0; i < numFaces; i++) {
+		int f = faceOrder[i];
+		glm::vec3 v0 = vertex(indices[f * 3]);
+		m_Triangles[i] = Triangle{ v0, vertex(indices[f * 3 + 1]) - v0, vertex(indices[f * 3 + 2]) - v0, f };
+	}
+}
+
+void MeshBVH::Clear() {
+	m_Nodes.clear();
+	m_Nodes.shrink_to_fit();
+	m_Triangles.clear();
+	m_Triangles.shrink_to_fit();
+}
+
+bool MeshBVH::ClosestHit(const Ray& ray, RayHit& hit) const {
+	if (m_Nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3 invDir = SafeInverse(ray.direction);
+	float closestT = ray.tMax;
+	int closestFace = NO_HIT;
+	float closestU = 0.0f, closestV = 0.0f;
+
+	float tEnter;
+	if (!RayBox(m_Nodes[0], ray.origin, invDir, ray.tMin, closestT, tEnter)) {
+		return false;
+	}
+
+	int stack[STACK_SIZE];
+	float stackEnter[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackEnter[stackSize++] = tEnter;
+
+	while (stackSize > 0) {
+		--stackSize;
+		if (stackEnter[stackSize] > closestT) {
+			continue; //A closer hit was found since this node was pushed
+		}
+		const Node& node = m_Nodes[stack[stackSize]];
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				const Triangle& tri = m_Triangles[i];
+				float t, u, v;
+				if (Intersect::RayTriangleIntersect(ray.origin, ray.direction, tri.v0, tri.e1, tri.e2, ray.tMin, closestT, false, t, u, v)) {
+					closestT = t;
+					closestFace = tri.face;
+					closestU = u;
+					closestV = v;
+				}
+			}
+			continue;
+		}
+
+		float tLeft, tRight;
+		bool hitLeft = RayBox(m_Nodes[node.first], ray.origin, invDir, ray.tMin, closestT, tLeft);
+		bool hitRight = RayBox(m_Nodes[node.first + 1], ray.origin, invDir, ray.tMin, closestT, tRight);
+
+		/* Push the farther child first so the nearer one is popped (and shrinks closestT) first */
+		int nearChild = node.first, farChild = node.first + 1;
+		float tNear = tLeft, tFar = tRight;
+		bool hitNear = hitLeft, hitFar = hitRight;
+		if (hitLeft && hitRight && tRight < tLeft) {
+			std::swap(nearChild, farChild);
+			std::swap(tNear, tFar);
+		} else if (!hitLeft) {
+			nearChild = node.first + 1;
+			tNear = tRight;
+			hitNear = hitRight;
+			hitFar = false;
+		}
+		if (hitFar) {
+			stack[stackSize] = farChild;
+			stackEnter[stackSize++] = tFar;
+		}
+		if (hitNear) {
+			stack[stackSize] = nearChild;
+			stackEnter[stackSize++] = tNear;
+		}
+	}
+
+	if (closestFace == NO_HIT) {
+		return false;
+	}
+	hit.face = closestFace;
+	hit.t = closestT;
+	hit.u = closestU;
+	hit.v = closestV;
+	return true;
+}
+
+bool MeshBVH::AnyHit(const Ray& ray) const {
+	if (m_Nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3 invDir = SafeInverse(ray.direction);
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = m_Nodes[stack[--stackSize]];
+		float tEnter;
+		if (!RayBox(node, ray.origin, invDir, ray.tMin, ray.tMax, tEnter)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				const Triangle& tri = m_Triangles[i];
+				float t, u, v;
+				if (Intersect::RayTriangleIntersect(ray.origin, ray.direction, tri.v0, tri.e1, tri.e2, ray.tMin, ray.tMax, false, t, u, v)) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.first + 1;
+		stack[stackSize++] = node.first;
+	}
+	return false;
+}
+
+bool MeshBVH::ClosestPoint(const glm::vec3& p, float maxDistance, PointHit& hit) const {
+	if (m_Nodes.empty()) {
+		return false;
+	}
+
+	float closestDistance2 = maxDistance < FLT_MAX ? maxDistance * maxDistance : FLT_MAX;
+	int closestFace = NO_HIT;
+	glm::vec3 closestPoint(0.0f);
+	float closestU = 0.0f, closestV = 0.0f;
+
+	float rootDistance2 = PointBoxDistance2(m_Nodes[0], p);
+	if (rootDistance2 > closestDistance2) {
+		return false;
+	}
+
+	int stack[STACK_SIZE];
+	float stackDistance2[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackDistance2[stackSize++] = rootDistance2;
+
+	while (stackSize > 0) {
+		--stackSize;
+		if (stackDistance2[stackSize] > closestDistance2) {
+			continue; //A closer point was found since this node was pushed
+		}
+		const Node& node = m_Nodes[stack[stackSize]];
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				const Triangle& tri = m_Triangles[i];
+				float u, v;
+				glm::vec3 q = Intersect::ClosestPointTriangleEdges(p, tri.v0, tri.e1, tri.e2, u, v);
+				glm::vec3 d = q - p;
+				float distance2 = glm::dot(d, d);
+				if (distance2 <= closestDistance2 && (distance2 < closestDistance2 || closestFace == NO_HIT)) {
+					closestDistance2 = distance2;
+					closestFace = tri.face;
+					closestPoint = q;
+					closestU = u;
+					closestV = v;
+				}
+			}
+			continue;
+		}
+
+		/* Push the farther child first so the nearer one is popped (and shrinks the search radius) first */
+		int nearChild = node.first, farChild = node.first + 1;
+		float dNear = PointBoxDistance2(m_Nodes[nearChild], p);
+		float dFar = PointBoxDistance2(m_Nodes[farChild], p);
+		if (dFar < dNear) {
+			std::swap(nearChild, farChild);
+			std::swap(dNear, dFar);
+		}
+		if (dFar <= closestDistance2) {
+			stack[stackSize] = farChild;
+			stackDistance2[stackSize++] = dFar;
+		}
+		if (dNear <= closestDistance2) {
+			stack[stackSize] = nearChild;
+			stackDistance2[stackSize++] = dNear;
+		}
+	}
+
+	if (closestFace == NO_HIT) {
+		return false;
+	}
+	hit.face = closestFace;
+	hit.distance = std::sqrt(closestDistance2);
+	hit.point = closestPoint;
+	hit.u = closestU;
+	hit.v = closestV;
+	return true;
+}
+
+int MeshBVH::GetDepth() const {
+	if (m_Nodes.empty()) {
+		return 0;
+	}
+
+	int depth = 0;
+	std::vector<std::pair<int, int>> stack(1, std::make_pair(0, 1));
+	while (!stack.empty()) {
+		std::pair<int, int> entry = stack.back();
+		stack.pop_back();
+		depth = std::max(depth, entry.second);
+		const Node& node = m_Nodes[entry.first];
+		if (node.count == 0) {
+			stack.push_back(std::make_pair(node.first, entry.second + 1));
+			stack.push_back(std::make_pair(node.first + 1, entry.second + 1));
+		}
+	}
+	return depth;
+}
+
+size_t MeshBVH::GetMemoryUsage() const {
+	return m_Nodes.capacity() * sizeof(Node) + m_Triangles.capacity() * sizeof(Triangle);
+}
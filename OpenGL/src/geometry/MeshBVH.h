@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+/* Ray for mesh queries; hits count for origin + t * direction with t in [tMin, tMax] */
+struct Ray {
+	glm::vec3 origin = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); //Need not be normalized (t is in multiples of it)
+	float tMin = 0.0f;
+	float tMax = FLT_MAX;
+};
+
+struct RayHit {
+	int face = -1; //Face index in the mesh (MeshBVH::NO_HIT if nothing was hit)
+	float t = FLT_MAX;
+	float u = 0.0f, v = 0.0f; //Barycentric weights of the face's second and third vertex
+};
+
+struct PointHit {
+	int face = -1; //Face holding the closest point (MeshBVH::NO_HIT if none was within range)
+	float distance = FLT_MAX;
+	glm::vec3 point = glm::vec3(0.0f);
+	float u = 0.0f, v = 0.0f; //Barycentric weights of the face's second and third vertex
+};
+
+/*
+	Bounding volume hierarchy over the triangles of an indexed mesh, for ray casting.
+
+	The tree is built top-down with the surface area heuristic evaluated over BIN_COUNT bins of triangle centroids
+	per axis, and stored as a flat array of 32 byte nodes: the two children of an interior node are adjacent, and the
+	triangles of each leaf are contiguous, stored as a vertex plus two edges in leaf order so the traversal never
+	touches the original index or position arrays. Closest-hit traversal visits the nearer child first and skips any
+	node whose box is entered beyond the closest hit so far; any-hit traversal stops at the first intersection.
+	Closest-point queries work the same way with the distance from the query point to each box.
+*/
+class MeshBVH {
+public:
+	static const int NO_HIT = -1;
+	static const int BIN_COUNT = 16;
+	static const int MAX_DEPTH = 64;
+
+	struct Node {
+		glm::vec3 boundsMin;
+		int first; //Leaf: first triangle; interior: left child (the right child is first + 1)
+		glm::vec3 boundsMax;
+		int count; //Triangles in a leaf, 0 for interior nodes
+	};
+
+	MeshBVH() {}
+	~MeshBVH() {}
+
+	void Build(const float* positions, int numVertices, const unsigned int* indices, int numFaces, int maxLeafSize = 4);
+	void Build(const std::vector<float>& positions, const std::vector<unsigned int>& indices, int maxLeafSize = 4) {
+		Build(positions.data(), (int)(positions.size() / 3), indices.data(), (int)(indices.size() / 3), maxLeafSize);
+	}
+	void Clear();
+
+	/* Nearest hit along the ray; returns false (and leaves hit untouched) if there is none */
+	bool ClosestHit(const Ray& ray, RayHit& hit) const;
+
+	/* Whether anything is hit along the ray, e.g. for shadow and visibility queries */
+	bool AnyHit(const Ray& ray) const;
+
+	/* Closest point on the mesh to p no further than maxDistance; returns false (and leaves hit untouched) if there is none */
+	bool ClosestPoint(const glm::vec3& p, float maxDistance, PointHit& hit) const;
+
+	inline bool IsEmpty() const { return m_Nodes.empty(); }
+	inline int GetNumFaces() const { return (int)m_Triangles.size(); }
+	inline const std::vector<Node>& GetNodes() const { return m_Nodes; }
+	int GetDepth() const;
+
+	/* Size of the tree in bytes (for memory reporting) */
+	size_t GetMemoryUsage() const;
+
+private:
+	/* Triangle in the form the intersection test wants it: v0 and the edges v1 - v0, v2 - v0 */
+	struct Triangle {
+		glm::vec3 v0, e1, e2;
+		int face;
+	};
+
+	std::vector<Node> m_Nodes;
+	std::vector<Triangle> m_Triangles;
+};
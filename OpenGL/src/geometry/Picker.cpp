@@ -0,0 +1,151 @@
+#include "Picker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Camera.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+/* Entry distance of the ray into the box, or false if it misses it within [tMin, tMax] */
+static bool RayBox(const Ray& ray, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float& tEnter) {
+	float enter = ray.tMin, exit = ray.tMax;
+	for (int axis = 0; axis < 3; axis++) {
+		float origin = ray.origin[axis], direction = ray.direction[axis];
+		if (direction == 0.0f) {
+			if (origin < boundsMin[axis] || origin > boundsMax[axis]) {
+				return false;
+			}
+			continue;
+		}
+		float invDir = 1.0f / direction;
+		float t0 = (boundsMin[axis] - origin) * invDir;
+		float t1 = (boundsMax[axis] - origin) * invDir;
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		enter = std::max(enter, t0);
+		exit = std::min(exit, t1);
+		if (enter > exit) {
+			return false;
+		}
+	}
+	tEnter = enter;
+	return true;
+}
+
+Ray Picker::CursorRay(float cursorX, float cursorY, float width, float height, const glm::mat4& view, const glm::mat4& proj) {
+	/* Window pixels to normalized device coordinates (y points up in NDC, down in the window) */
+	float ndcX = 2.0f * cursorX / width - 1.0f;
+	float ndcY = 1.0f - 2.0f * cursorY / height;
+
+	glm::mat4 inverseViewProj = glm::inverse(proj * view);
+	glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+	Ray ray;
+	ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+	ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+	return ray;
+}
+
+Ray Picker::CursorRay(float cursorX, float cursorY, float width, float height, Camera& camera, float nearPlane, float farPlane) {
+	glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), camera.m_AspectRatio, nearPlane, farPlane);
+	return CursorRay(cursorX, cursorY, width, height, camera.GetViewMatrix(), proj);
+}
+
+int Picker::AddInstance(const MeshBVH& bvh, const glm::mat4& model) {
+	Instance instance;
+	instance.bvh = &bvh;
+	m_Instances.push_back(instance);
+	SetTransform((int)m_Instances.size() - 1, model);
+	return (int)m_Instances.size() - 1;
+}
+
+void Picker::SetTransform(int instance, const glm::mat4& model) {
+	Instance& target = m_Instances[instance];
+	target.model = model;
+	target.inverseModel = glm::inverse(model);
+	UpdateBounds(target);
+}
+
+void Picker::Clear() {
+	m_Instances.clear();
+	m_Candidates.clear();
+}
+
+void Picker::UpdateBounds(Instance& instance) {
+	if (instance.bvh->IsEmpty()) {
+		/* Inverted box, which no ray enters */
+		instance.boundsMin = glm::vec3(FLT_MAX);
+		instance.boundsMax = glm::vec3(-FLT_MAX);
+		return;
+	}
+
+	/* Transformed box of the root node: the centre moves with the model, the half extents by |rotation * scale| */
+	const MeshBVH::Node& root = instance.bvh->GetNodes()[0];
+	glm::vec3 center = (root.boundsMin + root.boundsMax) * 0.5f;
+	glm::vec3 halfExtent = (root.boundsMax - root.boundsMin) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(instance.model * glm::vec4(center, 1.0f));
+	glm::vec3 worldHalfExtent(0.0f);
+	for (int c = 0; c < 3; c++) {
+		worldHalfExtent += glm::abs(glm::vec3(instance.model[c])) * halfExtent[c];
+	}
+	instance.boundsMin = worldCenter - worldHalfExtent;
+	instance.boundsMax = worldCenter + worldHalfExtent;
+}
+
+bool Picker::Pick(const Ray& ray, Hit& hit, float budgetMs) {
+	auto start = std::chrono::high_resolution_clock::now();
+	hit = Hit();
+
+	m_Candidates.clear();
+	for (int i = 0; i < (int)m_Instances.size(); i++) {
+		float tEnter;
+		if (RayBox(ray, m_Instances[i].boundsMin, m_Instances[i].boundsMax, tEnter)) {
+			m_Candidates.push_back(Candidate{ tEnter, i });
+		}
+	}
+	std::sort(m_Candidates.begin(), m_Candidates.end(), [](const Candidate& a, const Candidate& b) {
+		return a.tEnter < b.tEnter || (a.tEnter == b.tEnter && a.instance < b.instance);
+	});
+
+	for (const Candidate& candidate : m_Candidates) {
+		if (candidate.tEnter > hit.t) {
+			break; //This and every remaining box start beyond the closest hit
+		}
+		if (budgetMs > 0.0f && hit.instancesTested > 0) {
+			std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			if (elapsed.count() > budgetMs) {
+				hit.complete = false;
+				break;
+			}
+		}
+
+		/* The direction is not renormalized, so t means the same in local and world space */
+		const Instance& instance = m_Instances[candidate.instance];
+		Ray localRay;
+		localRay.origin = glm::vec3(instance.inverseModel * glm::vec4(ray.origin, 1.0f));
+		localRay.direction = glm::vec3(instance.inverseModel * glm::vec4(ray.direction, 0.0f));
+		localRay.tMin = ray.tMin;
+		localRay.tMax = std::min(ray.tMax, hit.t);
+
+		RayHit localHit;
+		if (instance.bvh->ClosestHit(localRay, localHit)) {
+			hit.instance = candidate.instance;
+			hit.face = localHit.face;
+			hit.t = localHit.t;
+			hit.u = localHit.u;
+			hit.v = localHit.v;
+		}
+		hit.instancesTested++;
+	}
+
+	if (hit.instance == NO_HIT) {
+		return false;
+	}
+	hit.point = ray.origin + ray.direction * hit.t;
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cfloat>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "MeshBVH.h"
+
+class Camera;
+
+/*
+	Mouse picking over a set of mesh instances. Each instance is a mesh's BVH placed in the world with a model matrix.
+
+	A pick first tests the ray against every instance's world space bounding box, then visits the instances it passes
+	in order of entry distance, casting the ray into each one's local space and through its BVH. The search stops as
+	soon as the next box starts beyond the closest hit so far, or once the time budget is spent, in which case the
+	closest hit among the instances tested so far is returned and the hit is flagged as incomplete. The budget is
+	checked between instances, so a pick can overrun it by one BVH traversal.
+*/
+class Picker {
+public:
+	static const int NO_HIT = -1;
+
+	struct Hit {
+		int instance = NO_HIT;
+		int face = MeshBVH::NO_HIT;
+		float t = FLT_MAX; //Along the world space ray
+		glm::vec3 point = glm::vec3(0.0f); //World space
+		float u = 0.0f, v = 0.0f; //Barycentric weights of the face's second and third vertex
+		int instancesTested = 0; //Instances whose BVH was traversed
+		bool complete = true; //False if the time budget ran out before every candidate was tested
+	};
+
+	/* World space ray through a cursor position in window pixels (origin at the top left, as GLFW reports it) */
+	static Ray CursorRay(float cursorX, float cursorY, float width, float height, const glm::mat4& view, const glm::mat4& proj);
+	/* Same, with the camera's view and a perspective projection from its zoom and aspect ratio */
+	static Ray CursorRay(float cursorX, float cursorY, float width, float height, Camera& camera, float nearPlane = 1.0f, float farPlane = 1000.0f);
+
+	/* The BVH is referenced, not copied, and must outlive the instance; returns the instance index */
+	int AddInstance(const MeshBVH& bvh, const glm::mat4& model);
+	void SetTransform(int instance, const glm::mat4& model);
+	void Clear();
+
+	inline int GetNumInstances() const { return (int)m_Instances.size(); }
+
+	/* Closest hit along the ray; budgetMs <= 0 means no time limit */
+	bool Pick(const Ray& ray, Hit& hit, float budgetMs = 0.0f);
+
+private:
+	struct Instance {
+		const MeshBVH* bvh;
+		glm::mat4 model, inverseModel;
+		glm::vec3 boundsMin, boundsMax; //World space
+	};
+
+	struct Candidate {
+		float tEnter;
+		int instance;
+	};
+
+	std::vector<Instance> m_Instances;
+	std::vector<Candidate> m_Candidates; //Scratch for Pick
+
+	void UpdateBounds(Instance& instance);
+};
@@ -0,0 +1,287 @@
+#include "SignedDistanceField.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "MeshBVH.h"
+#include "WindingNumberQuery.h"
+#include "io/MappedFile.h"
+#include "io/MeshCache.h"
+#include "util/ThreadPool.h"
+
+namespace {
+
+	const char MAGIC[4] = { 'S', 'D', 'F', 'B' };
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		int32_t brickDimensions[3];
+		uint32_t numAllocatedBricks;
+		float origin[3];
+		float voxelSize;
+		float bandWidth;
+		uint32_t brickSize; //Guards against files written with another BRICK_SIZE
+		uint64_t fileSize;
+	};
+
+	/* Bricks classified per task; the allocated bricks are filled one per task */
+	const int CLASSIFY_BLOCK_SIZE = 64;
+
+}
+
+void SignedDistanceField::Bake(const MeshBVH& bvh, const WindingNumberQuery& windingNumber, const BakeSettings& settings, ThreadPool* pool) {
+	Clear();
+	if (bvh.IsEmpty() || settings.resolution <= 0) {
+		return;
+	}
+
+	const MeshBVH::Node& root = bvh.GetNodes()[0];
+	glm::vec3 extent = root.boundsMax - root.boundsMin;
+	float longest = std::max(std::max(extent.x, extent.y), extent.z);
+	m_VoxelSize = longest > 0.0f ? longest / (float)settings.resolution : 1.0f;
+	m_BandWidth = std::max(settings.bandWidth, 1.0f) * m_VoxelSize;
+
+	/* Pad by the band and a cell, so the outermost samples are always clamped and the field is continuous at the edge */
+	float padding = m_BandWidth + m_VoxelSize;
+	m_Origin = root.boundsMin - glm::vec3(padding);
+	glm::ivec3 cells = glm::ivec3(glm::ceil((extent + glm::vec3(2.0f * padding)) / m_VoxelSize));
+	m_BrickDimensions = glm::max((cells + glm::ivec3(BRICK_SIZE - 1)) / BRICK_SIZE, glm::ivec3(1));
+
+	const int numBricks = m_BrickDimensions.x * m_BrickDimensions.y * m_BrickDimensions.z;
+	const float brickWorldSize = BRICK_SIZE * m_VoxelSize;
+	auto brickCoordinates = [this](int brick) {
+		return glm::ivec3(brick % m_BrickDimensions.x, (brick / m_BrickDimensions.x) % m_BrickDimensions.y,
+			brick / (m_BrickDimensions.x * m_BrickDimensions.y));
+	};
+
+	/*
+		A brick needs samples if the surface comes within the band of any point in it, which is certainly the case if
+		it comes within half a diagonal plus the band of the centre. Any other brick lies entirely on one side, given by
+		the winding number at its centre.
+	*/
+	const float reach = 0.5f * std::sqrt(3.0f) * brickWorldSize + m_BandWidth;
+	m_BrickTable.resize(numBricks);
+	ThreadPool::RunTasks(pool, (numBricks + CLASSIFY_BLOCK_SIZE - 1) / CLASSIFY_BLOCK_SIZE, [&](int block) {
+		for (int b = block * CLASSIFY_BLOCK_SIZE, end = std::min(b + CLASSIFY_BLOCK_SIZE, numBricks); b < end; b++) {
+			glm::vec3 center = m_Origin + (glm::vec3(brickCoordinates(b)) + glm::vec3(0.5f)) * brickWorldSize;
+			PointHit hit;
+			if (bvh.ClosestPoint(center, reach, hit)) {
+				m_BrickTable[b] = 0;
+			} else {
+				bool inside = std::abs(windingNumber.Compute(center, settings.accuracyScale)) >= WindingNumberQuery::INSIDE_THRESHOLD;
+				m_BrickTable[b] = inside ? EMPTY_INSIDE : EMPTY_OUTSIDE;
+			}
+		}
+	});
+
+	/* Storage is handed out in brick order, so the layout does not depend on the threads */
+	std::vector<int> allocated;
+	for (int b = 0; b < numBricks; b++) {
+		if (m_BrickTable[b] >= 0) {
+			m_BrickTable[b] = (int)allocated.size();
+			allocated.push_back(b);
+		}
+	}
+	m_Samples.resize(allocated.size() * BRICK_SAMPLE_COUNT);
+
+	ThreadPool::RunTasks(pool, (int)allocated.size(), [&](int i) {
+		glm::ivec3 firstCell = brickCoordinates(allocated[i]) * BRICK_SIZE;
+		float* samples = &m_Samples[(size_t)i * BRICK_SAMPLE_COUNT];
+		for (int z = 0; z < BRICK_SAMPLES; z++) {
+			for (int y = 0; y < BRICK_SAMPLES; y++) {
+				for (int x = 0; x < BRICK_SAMPLES; x++) {
+					glm::vec3 p = m_Origin + glm::vec3(firstCell + glm::ivec3(x, y, z)) * m_VoxelSize;
+					PointHit hit;
+					float distance = bvh.ClosestPoint(p, m_BandWidth, hit) ? hit.distance : m_BandWidth;
+					bool inside = std::abs(windingNumber.Compute(p, settings.accuracyScale)) >= WindingNumberQuery::INSIDE_THRESHOLD;
+					*samples++ = inside ? -distance : distance;
+				}
+			}
+		}
+	});
+
+	/* The centre test is conservative: bricks whose samples all came out clamped to one side are dropped again */
+	int kept = 0;
+	for (int i = 0; i < (int)allocated.size(); i++) {
+		const float* samples = &m_Samples[(size_t)i * BRICK_SAMPLE_COUNT];
+		bool allOutside = true, allInside = true;
+		for (int s = 0; s < BRICK_SAMPLE_COUNT; s++) {
+			allOutside = allOutside && samples[s] >= m_BandWidth;
+			allInside = allInside && samples[s] <= -m_BandWidth;
+		}
+		if (allOutside || allInside) {
+			m_BrickTable[allocated[i]] = allInside ? EMPTY_INSIDE : EMPTY_OUTSIDE;
+			continue;
+		}
+		if (kept != i) {
+			std::memcpy(&m_Samples[(size_t)kept * BRICK_SAMPLE_COUNT], samples, BRICK_SAMPLE_COUNT * sizeof(float));
+		}
+		m_BrickTable[allocated[i]] = kept++;
+	}
+	m_Samples.resize((size_t)kept * BRICK_SAMPLE_COUNT);
+	m_Samples.shrink_to_fit();
+}
+
+void SignedDistanceField::Bake(const std::vector<float>& positions, const std::vector<unsigned int>& indices, const BakeSettings& settings, ThreadPool* pool) {
+	MeshBVH bvh;
+	bvh.Build(positions, indices);
+	WindingNumberQuery windingNumber;
+	windingNumber.Build(positions, indices);
+	Bake(bvh, windingNumber, settings, pool);
+}
+
+void SignedDistanceField::Clear() {
+	m_Origin = glm::vec3(0.0f);
+	m_VoxelSize = 1.0f;
+	m_BandWidth = 0.0f;
+	m_BrickDimensions = glm::ivec3(0);
+	m_BrickTable.clear();
+	m_BrickTable.shrink_to_fit();
+	m_Samples.clear();
+	m_Samples.shrink_to_fit();
+}
+
+bool SignedDistanceField::Save(const std::string& filepath) const {
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.numAllocatedBricks = (uint32_t)GetNumAllocatedBricks();
+	for (int i = 0; i < 3; i++) {
+		header.brickDimensions[i] = m_BrickDimensions[i];
+		header.origin[i] = m_Origin[i];
+	}
+	header.voxelSize = m_VoxelSize;
+	header.bandWidth = m_BandWidth;
+	header.brickSize = BRICK_SIZE;
+	header.fileSize = sizeof(Header) + m_BrickTable.size() * sizeof(int) + m_Samples.size() * sizeof(float);
+
+	const MeshCache::FileBlock blocks[] = {
+		{ &header, sizeof(Header) },
+		{ m_BrickTable.data(), m_BrickTable.size() * sizeof(int) },
+		{ m_Samples.data(), m_Samples.size() * sizeof(float) }
+	};
+	if (!MeshCache::WriteFileAtomic(filepath, blocks, 3)) {
+		std::cout << "Unable to write signed distance field " << filepath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool SignedDistanceField::Load(const std::string& filepath) {
+	Clear();
+	std::unique_ptr<MappedFile> file(new MappedFile(filepath));
+	if (!file->IsOpen() || file->GetSize() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, file->GetData(), sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.brickSize != BRICK_SIZE
+		|| header.fileSize != file->GetSize() || header.brickDimensions[0] <= 0 || header.brickDimensions[1] <= 0 || header.brickDimensions[2] <= 0) {
+		return false;
+	}
+
+	const uint64_t numBricks = (uint64_t)header.brickDimensions[0] * header.brickDimensions[1] * header.brickDimensions[2];
+	const uint64_t numSamples = (uint64_t)header.numAllocatedBricks * BRICK_SAMPLE_COUNT;
+	if (numBricks > INT32_MAX || header.numAllocatedBricks > numBricks
+		|| sizeof(Header) + numBricks * sizeof(int) + numSamples * sizeof(float) != header.fileSize) {
+		return false;
+	}
+
+	const char* data = file->GetData() + sizeof(Header);
+	std::vector<int> brickTable(numBricks);
+	std::memcpy(brickTable.data(), data, numBricks * sizeof(int));
+	for (int entry : brickTable) {
+		if (entry < EMPTY_INSIDE || entry >= (int)header.numAllocatedBricks) {
+			return false;
+		}
+	}
+
+	m_BrickTable = std::move(brickTable);
+	m_Samples.resize(numSamples);
+	std::memcpy(m_Samples.data(), data + numBricks * sizeof(int), numSamples * sizeof(float));
+	m_BrickDimensions = glm::ivec3(header.brickDimensions[0], header.brickDimensions[1], header.brickDimensions[2]);
+	m_Origin = glm::vec3(header.origin[0], header.origin[1], header.origin[2]);
+	m_VoxelSize = header.voxelSize;
+	m_BandWidth = header.bandWidth;
+	return true;
+}
+
+float SignedDistanceField::Interpolate(const glm::vec3& local, glm::vec3* gradient) const {
+	const glm::ivec3 cells = GetCellDimensions();
+	glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(local)), glm::ivec3(0), cells - glm::ivec3(1));
+	glm::vec3 f = local - glm::vec3(cell);
+
+	glm::ivec3 brick = cell / BRICK_SIZE;
+	int entry = m_BrickTable[(brick.z * m_BrickDimensions.y + brick.y) * m_BrickDimensions.x + brick.x];
+	if (entry < 0) {
+		if (gradient) {
+			*gradient = glm::vec3(0.0f);
+		}
+		return entry == EMPTY_INSIDE ? -m_BandWidth : m_BandWidth;
+	}
+
+	glm::ivec3 c = cell - brick * BRICK_SIZE;
+	const float* s = &m_Samples[(size_t)entry * BRICK_SAMPLE_COUNT + (c.z * BRICK_SAMPLES + c.y) * BRICK_SAMPLES + c.x];
+	const int dy = BRICK_SAMPLES, dz = BRICK_SAMPLES * BRICK_SAMPLES;
+	float s000 = s[0], s100 = s[1], s010 = s[dy], s110 = s[dy + 1];
+	float s001 = s[dz], s101 = s[dz + 1], s011 = s[dz + dy], s111 = s[dz + dy + 1];
+
+	float c00 = s000 + (s100 - s000) * f.x;
+	float c10 = s010 + (s110 - s010) * f.x;
+	float c01 = s001 + (s101 - s001) * f.x;
+	float c11 = s011 + (s111 - s011) * f.x;
+	float c0 = c00 + (c10 - c00) * f.y;
+	float c1 = c01 + (c11 - c01) * f.y;
+
+	if (gradient) {
+		float dx0 = (s100 - s000) + ((s110 - s010) - (s100 - s000)) * f.y;
+		float dx1 = (s101 - s001) + ((s111 - s011) - (s101 - s001)) * f.y;
+		float dx = dx0 + (dx1 - dx0) * f.z;
+		float dyValue = (c10 - c00) + ((c11 - c01) - (c10 - c00)) * f.z;
+		*gradient = glm::vec3(dx, dyValue, c1 - c0) / m_VoxelSize;
+	}
+	return c0 + (c1 - c0) * f.z;
+}
+
+float SignedDistanceField::Sample(const glm::vec3& p) const {
+	if (m_BrickTable.empty()) {
+		return FLT_MAX;
+	}
+
+	glm::vec3 local = (p - m_Origin) / m_VoxelSize;
+	glm::vec3 clamped = glm::clamp(local, glm::vec3(0.0f), glm::vec3(GetCellDimensions()));
+	if (clamped == local) {
+		return Interpolate(local, nullptr);
+	}
+	return Interpolate(clamped, nullptr) + glm::length(local - clamped) * m_VoxelSize;
+}
+
+float SignedDistanceField::SampleGradient(const glm::vec3& p, glm::vec3& gradient) const {
+	if (m_BrickTable.empty()) {
+		gradient = glm::vec3(0.0f);
+		return FLT_MAX;
+	}
+
+	glm::vec3 local = (p - m_Origin) / m_VoxelSize;
+	glm::vec3 clamped = glm::clamp(local, glm::vec3(0.0f), glm::vec3(GetCellDimensions()));
+	if (clamped == local) {
+		return Interpolate(local, &gradient);
+	}
+
+	/* Outside the grid: walk to the nearest point on it, which lies beyond the band */
+	glm::vec3 outside = (local - clamped) * m_VoxelSize;
+	float distance = glm::length(outside);
+	gradient = outside / distance;
+	return Interpolate(clamped, nullptr) + distance;
+}
+
+size_t SignedDistanceField::GetMemoryUsage() const {
+	return m_BrickTable.capacity() * sizeof(int) + m_Samples.capacity() * sizeof(float);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class MeshBVH;
+class ThreadPool;
+class WindingNumberQuery;
+
+/*
+	Narrow band signed distance field of a triangle mesh on a sparse grid of bricks, negative inside.
+
+	The grid covers the mesh bounds padded by the band and is split into bricks of BRICK_SIZE^3 cells. Only bricks
+	within reach of the surface store samples; each holds its own (BRICK_SIZE + 1)^3 corner samples, duplicating the
+	faces it shares with its neighbours so that every trilinear lookup reads a single brick. Every other brick just
+	records which side of the surface it is on, and distances beyond the band are clamped to +-band.
+
+	Distances come from closest-point queries against the mesh BVH and signs from the generalized winding number, so
+	meshes with holes or self-intersections get a sensible inside as well. Bricks are baked in parallel, each one on
+	its own, so the field does not depend on the number of threads.
+*/
+class SignedDistanceField {
+public:
+	static const int BRICK_SIZE = 8; //Cells along each side of a brick
+	static const int BRICK_SAMPLES = BRICK_SIZE + 1; //Samples along each side of a brick
+	static const int BRICK_SAMPLE_COUNT = BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES;
+
+	/* Brick table entries other than a brick index */
+	static const int EMPTY_OUTSIDE = -1;
+	static const int EMPTY_INSIDE = -2;
+
+	static const uint32_t VERSION = 1;
+
+	struct BakeSettings {
+		int resolution = 64; //Cells along the longest side of the mesh bounds
+		float bandWidth = 3.0f; //Half width of the stored band, in cells
+		float accuracyScale = 2.0f; //Passed on to the winding number queries
+	};
+
+	SignedDistanceField() {}
+
+	/* Bakes the mesh the BVH and winding number query were built from (both over the same triangles) */
+	void Bake(const MeshBVH& bvh, const WindingNumberQuery& windingNumber, const BakeSettings& settings, ThreadPool* pool = nullptr);
+	/* Same, building the BVH and winding number query first */
+	void Bake(const std::vector<float>& positions, const std::vector<unsigned int>& indices, const BakeSettings& settings, ThreadPool* pool = nullptr);
+	void Clear();
+
+	/* Binary file with the grid layout, the brick table and the brick samples */
+	bool Save(const std::string& filepath) const;
+	bool Load(const std::string& filepath);
+
+	/*
+		Trilinearly interpolated signed distance at p. Outside the grid this is the distance to the grid plus the
+		value at the nearest point on it, which is never less than the true distance there.
+	*/
+	float Sample(const glm::vec3& p) const;
+	/* Sample, along with the gradient of the interpolated field (zero where the distance is clamped) */
+	float SampleGradient(const glm::vec3& p, glm::vec3& gradient) const;
+
+	inline bool IsEmpty() const { return m_BrickTable.empty(); }
+	inline const glm::vec3& GetOrigin() const { return m_Origin; }
+	inline float GetVoxelSize() const { return m_VoxelSize; }
+	inline float GetBandWidth() const { return m_BandWidth; }
+	inline glm::ivec3 GetCellDimensions() const { return m_BrickDimensions * BRICK_SIZE; }
+	inline const glm::ivec3& GetBrickDimensions() const { return m_BrickDimensions; }
+	inline int GetNumBricks() const { return (int)m_BrickTable.size(); }
+	inline int GetNumAllocatedBricks() const { return (int)(m_Samples.size() / BRICK_SAMPLE_COUNT); }
+
+	/* Size of the brick table and samples in bytes (for memory reporting) */
+	size_t GetMemoryUsage() const;
+
+private:
+	glm::vec3 m_Origin = glm::vec3(0.0f);
+	float m_VoxelSize = 1.0f;
+	float m_BandWidth = 0.0f; //In world units
+	glm::ivec3 m_BrickDimensions = glm::ivec3(0);
+	std::vector<int> m_BrickTable; //Brick index, EMPTY_OUTSIDE or EMPTY_INSIDE per brick, x fastest
+	std::vector<float> m_Samples; //BRICK_SAMPLE_COUNT per allocated brick, x fastest
+
+	/* Value and gradient at a point inside the grid, in grid (cell) coordinates */
+	float Interpolate(const glm::vec3& local, glm::vec3* gradient) const;
+};
@@ -0,0 +1,181 @@
+#include "TransformBatch.h"
+#include "util/CpuFeatures.h"
+
+/* The SIMD paths must round exactly like the scalar one, so GCC may not fuse the multiplies and adds (MSVC never does) */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+static void BuildMatricesScalar(const TransformBatch& b, int begin, int end, float* out) {
+	for (int i = begin; i < end; i++) {
+		float x = b.qx[i], y = b.qy[i], z = b.qz[i], w = b.qw[i];
+		float x2 = x + x, y2 = y + y, z2 = z + z;
+		float xx = x * x2, yy = y * y2, zz = z * z2;
+		float xy = x * y2, xz = x * z2, yz = y * z2;
+		float wx = w * x2, wy = w * y2, wz = w * z2;
+		float sx = b.sx[i], sy = b.sy[i], sz = b.sz[i];
+
+		float* m = out + (size_t)i * 16;
+		m[0] = (1.0f - (yy + zz)) * sx; m[1] = (xy + wz) * sx; m[2] = (xz - wy) * sx; m[3] = 0.0f;
+		m[4] = (xy - wz) * sy; m[5] = (1.0f - (xx + zz)) * sy; m[6] = (yz + wx) * sy; m[7] = 0.0f;
+		m[8] = (xz + wy) * sz; m[9] = (yz - wx) * sz; m[10] = (1.0f - (xx + yy)) * sz; m[11] = 0.0f;
+		m[12] = b.px[i]; m[13] = b.py[i]; m[14] = b.pz[i]; m[15] = 1.0f;
+	}
+}
+
+#if SIMD_X86
+static void BuildMatricesSSE(const TransformBatch& b, int begin, int end, float* out) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(b.qx + i), y = _mm_loadu_ps(b.qy + i), z = _mm_loadu_ps(b.qz + i), w = _mm_loadu_ps(b.qw + i);
+		__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 sx = _mm_loadu_ps(b.sx + i), sy = _mm_loadu_ps(b.sy + i), sz = _mm_loadu_ps(b.sz + i);
+
+		/* Row r of these holds element r of the column for each of the four instances */
+		__m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+		__m128 c0y = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+		__m128 c0z = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+		__m128 c0w = zero;
+		__m128 c1x = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+		__m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+		__m128 c1z = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+		__m128 c1w = zero;
+		__m128 c2x = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+		__m128 c2y = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+		__m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+		__m128 c2w = zero;
+		__m128 c3x = _mm_loadu_ps(b.px + i), c3y = _mm_loadu_ps(b.py + i), c3z = _mm_loadu_ps(b.pz + i), c3w = one;
+
+		/* After transposing, c*x holds the column for instance 0, c*y for instance 1, ... */
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+		_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+		float* m = out + (size_t)i * 16;
+		_mm_storeu_ps(m + 0, c0x); _mm_storeu_ps(m + 4, c1x); _mm_storeu_ps(m + 8, c2x); _mm_storeu_ps(m + 12, c3x);
+		_mm_storeu_ps(m + 16, c0y); _mm_storeu_ps(m + 20, c1y); _mm_storeu_ps(m + 24, c2y); _mm_storeu_ps(m + 28, c3y);
+		_mm_storeu_ps(m + 32, c0z); _mm_storeu_ps(m + 36, c1z); _mm_storeu_ps(m + 40, c2z); _mm_storeu_ps(m + 44, c3z);
+		_mm_storeu_ps(m + 48, c0w); _mm_storeu_ps(m + 52, c1w); _mm_storeu_ps(m + 56, c2w); _mm_storeu_ps(m + 60, c3w);
+	}
+	BuildMatricesScalar(b, i, end, out);
+}
+
+/* Transposes four rows of eight lanes: the low half of rk is the 4-vector for lane k, the high half for lane k + 4 */
+TARGET_AVX2 static inline void Transpose4x8(__m256 a, __m256 b, __m256 c, __m256 d, __m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+	__m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpackhi_ps(a, b);
+	__m256 t2 = _mm256_unpacklo_ps(c, d), t3 = _mm256_unpackhi_ps(c, d);
+	r0 = _mm256_shuffle_ps(t0, t2, 0x44);
+	r1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+	r2 = _mm256_shuffle_ps(t1, t3, 0x44);
+	r3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+}
+
+TARGET_AVX2 static void BuildMatricesAVX2(const TransformBatch& b, int begin, int end, float* out) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(b.qx + i), y = _mm256_loadu_ps(b.qy + i), z = _mm256_loadu_ps(b.qz + i), w = _mm256_loadu_ps(b.qw + i);
+		__m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+		__m256 sx = _mm256_loadu_ps(b.sx + i), sy = _mm256_loadu_ps(b.sy + i), sz = _mm256_loadu_ps(b.sz + i);
+
+		/* Same operation order as the scalar path (no FMA contraction) so that every path gives identical results */
+		__m256 c0[4], c1[4], c2[4], c3[4];
+		Transpose4x8(_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+			_mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+			_mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+			zero, c0[0], c0[1], c0[2], c0[3]);
+		Transpose4x8(_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+			zero, c1[0], c1[1], c1[2], c1[3]);
+		Transpose4x8(_mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+			_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+			zero, c2[0], c2[1], c2[2], c2[3]);
+		Transpose4x8(_mm256_loadu_ps(b.px + i), _mm256_loadu_ps(b.py + i), _mm256_loadu_ps(b.pz + i), one,
+			c3[0], c3[1], c3[2], c3[3]);
+
+		float* m = out + (size_t)i * 16;
+		for (int k = 0; k < 4; k++) {
+			float* lo = m + k * 16;
+			float* hi = m + (k + 4) * 16;
+			_mm_storeu_ps(lo + 0, _mm256_castps256_ps128(c0[k]));
+			_mm_storeu_ps(lo + 4, _mm256_castps256_ps128(c1[k]));
+			_mm_storeu_ps(lo + 8, _mm256_castps256_ps128(c2[k]));
+			_mm_storeu_ps(lo + 12, _mm256_castps256_ps128(c3[k]));
+			_mm_storeu_ps(hi + 0, _mm256_extractf128_ps(c0[k], 1));
+			_mm_storeu_ps(hi + 4, _mm256_extractf128_ps(c1[k], 1));
+			_mm_storeu_ps(hi + 8, _mm256_extractf128_ps(c2[k], 1));
+			_mm_storeu_ps(hi + 12, _mm256_extractf128_ps(c3[k], 1));
+		}
+	}
+	BuildMatricesSSE(b, i, end, out);
+}
+#endif
+
+void TransformKernels::BuildMatrices(const TransformBatch& batch, glm::mat4* out, Path path) {
+	if (batch.count <= 0) {
+		return;
+	}
+	float* dst = &out[0][0][0];
+
+	if (!IsSupported(path)) {
+		path = GetBestPath();
+	}
+#if SIMD_X86
+	if (path == Path::AVX2) {
+		BuildMatricesAVX2(batch, 0, batch.count, dst);
+		return;
+	}
+	if (path == Path::SSE) {
+		BuildMatricesSSE(batch, 0, batch.count, dst);
+		return;
+	}
+#endif
+	BuildMatricesScalar(batch, 0, batch.count, dst);
+}
+
+TransformKernels::Path TransformKernels::GetBestPath() {
+	if (IsSupported(Path::AVX2)) {
+		return Path::AVX2;
+	}
+	if (IsSupported(Path::SSE)) {
+		return Path::SSE;
+	}
+	return Path::Scalar;
+}
+
+bool TransformKernels::IsSupported(Path path) {
+	switch (path) {
+#if SIMD_X86
+	case Path::SSE: return CpuFeatures::Get().sse2;
+	case Path::AVX2: return CpuFeatures::Get().avx2;
+#endif
+	case Path::Scalar: return true;
+	default: return false;
+	}
+}
+
+const char* TransformKernels::GetName(Path path) {
+	switch (path) {
+	case Path::SSE: return "SSE";
+	case Path::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+/*
+	Structure-of-arrays input for building instance matrices: translation, unit quaternion rotation and per-axis
+	scale for count instances. Each pointer addresses count floats.
+*/
+struct TransformBatch {
+	const float* px = nullptr; const float* py = nullptr; const float* pz = nullptr;
+	const float* qx = nullptr; const float* qy = nullptr; const float* qz = nullptr; const float* qw = nullptr;
+	const float* sx = nullptr; const float* sy = nullptr; const float* sz = nullptr;
+	int count = 0;
+};
+
+/* Owning storage for a TransformBatch, filled one instance at a time */
+class TransformArrays {
+public:
+	void Resize(int count) {
+		for (int c = 0; c < NUM_CHANNELS; c++) {
+			m_Channels[c].resize(count);
+		}
+	}
+	inline int GetCount() const { return (int)m_Channels[0].size(); }
+
+	inline void Set(int i, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		m_Channels[0][i] = position.x; m_Channels[1][i] = position.y; m_Channels[2][i] = position.z;
+		m_Channels[3][i] = rotation.x; m_Channels[4][i] = rotation.y; m_Channels[5][i] = rotation.z; m_Channels[6][i] = rotation.w;
+		m_Channels[7][i] = scale.x; m_Channels[8][i] = scale.y; m_Channels[9][i] = scale.z;
+	}
+
+	TransformBatch GetBatch() const {
+		TransformBatch batch;
+		batch.px = m_Channels[0].data(); batch.py = m_Channels[1].data(); batch.pz = m_Channels[2].data();
+		batch.qx = m_Channels[3].data(); batch.qy = m_Channels[4].data(); batch.qz = m_Channels[5].data(); batch.qw = m_Channels[6].data();
+		batch.sx = m_Channels[7].data(); batch.sy = m_Channels[8].data(); batch.sz = m_Channels[9].data();
+		batch.count = GetCount();
+		return batch;
+	}
+
+private:
+	static const int NUM_CHANNELS = 10;
+	std::vector<float> m_Channels[NUM_CHANNELS]; //px, py, pz, qx, qy, qz, qw, sx, sy, sz
+};
+
+/*
+	Batch TRS kernel: out[i] = translate(p[i]) * mat4_cast(q[i]) * scale(s[i]) in glm's column-major layout.
+
+	The SIMD paths compute the rotation terms for 4 (SSE) or 8 (AVX2) instances at once, one instance per lane,
+	then transpose the lanes into columns and store whole matrices sequentially. Output is written with unaligned
+	stores, so out may point straight into a mapped (write-combined) buffer. The paths give identical results.
+*/
+class TransformKernels {
+public:
+	enum class Path { Scalar, SSE, AVX2 };
+
+	static void BuildMatrices(const TransformBatch& batch, glm::mat4* out, Path path);
+	static void BuildMatrices(const TransformBatch& batch, glm::mat4* out) { BuildMatrices(batch, out, GetBestPath()); }
+
+	/* Widest path supported by the running CPU */
+	static Path GetBestPath();
+	static bool IsSupported(Path path);
+	static const char* GetName(Path path);
+};
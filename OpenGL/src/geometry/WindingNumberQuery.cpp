@@ -0,0 +1,137 @@
+#include "WindingNumberQuery.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/ThreadPool.h"
+
+constexpr float WindingNumberQuery::INSIDE_THRESHOLD;
+
+/* Points evaluated per task; large enough to amortize scheduling, small enough to balance uneven query costs */
+static const int QUERY_BLOCK_SIZE = 256;
+static const int MORTON_BLOCK_SIZE = 1 << 14;
+
+static const float INV_FOUR_PI = 0.0795774715f;
+
+/* Spreads the low 10 bits of v so there are two zero bits between each */
+static inline uint32_t ExpandBits(uint32_t v) {
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+static inline uint32_t Quantize(float value, float minValue, float scale) {
+	float q = (value - minValue) * scale;
+	/* Also maps NaN to 0 */
+	return (q > 0.0f) ? (uint32_t)std::min(q, 1023.0f) : 0u;
+}
+
+void WindingNumberQuery::Build(const float* positions, int numVertices, const unsigned int* indices, int numFaces, int order) {
+	Clear();
+
+	m_Positions.resize(numVertices);
+	for (int i = 0; i < numVertices; i++) {
+		m_Positions[i] = HDK_Sample::UT_Vector3T<float>(positions + i * 3);
+	}
+	m_Triangles.assign(indices, indices + numFaces * 3);
+
+	if (numFaces > 0) {
+		m_SolidAngle.init(numFaces, m_Triangles.data(), numVertices, m_Positions.data(), order);
+	}
+}
+
+void WindingNumberQuery::Clear() {
+	m_SolidAngle.clear();
+	m_Positions.clear();
+	m_Triangles.clear();
+}
+
+float WindingNumberQuery::Compute(const glm::vec3& point, float accuracyScale) const {
+	if (m_Triangles.empty()) {
+		return 0.0f;
+	}
+	const float p[3] = { point.x, point.y, point.z };
+	return m_SolidAngle.computeSolidAngle(HDK_Sample::UT_Vector3T<float>(p), accuracyScale) * INV_FOUR_PI;
+}
+
+void WindingNumberQuery::MortonOrder(const PointBatch& points, std::vector<int>& order, ThreadPool& pool) {
+	const int count = points.count;
+	order.resize(count);
+	if (count == 0) {
+		return;
+	}
+
+	float minP[3] = { points.x[0], points.y[0], points.z[0] };
+	float maxP[3] = { minP[0], minP[1], minP[2] };
+	for (int i = 1; i < count; i++) {
+		minP[0] = std::min(minP[0], points.x[i]); maxP[0] = std::max(maxP[0], points.x[i]);
+		minP[1] = std::min(minP[1], points.y[i]); maxP[1] = std::max(maxP[1], points.y[i]);
+		minP[2] = std::min(minP[2], points.z[i]); maxP[2] = std::max(maxP[2], points.z[i]);
+	}
+
+	/* One scale for all axes so the curve follows the points' actual proximity */
+	float extent = std::max(maxP[0] - minP[0], std::max(maxP[1] - minP[1], maxP[2] - minP[2]));
+	float scale = extent > 0.0f ? 1023.0f / extent : 0.0f;
+
+	/* Code in the high half, point index in the low half: sorting the keys sorts the indices, ties in input order */
+	std::vector<uint64_t> keys(count);
+	pool.ParallelFor(0, count, MORTON_BLOCK_SIZE, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			uint32_t code = (ExpandBits(Quantize(points.x[i], minP[0], scale)) << 2)
+				| (ExpandBits(Quantize(points.y[i], minP[1], scale)) << 1)
+				| ExpandBits(Quantize(points.z[i], minP[2], scale));
+			keys[i] = ((uint64_t)code << 32) | (uint32_t)i;
+		}
+	});
+	std::sort(keys.begin(), keys.end());
+
+	for (int i = 0; i < count; i++) {
+		order[i] = (int)(uint32_t)keys[i];
+	}
+}
+
+template<typename F>
+void WindingNumberQuery::Evaluate(const PointBatch& points, ThreadPool& pool, float accuracyScale, F&& store) const {
+	if (points.count == 0) {
+		return;
+	}
+	if (m_Triangles.empty()) {
+		for (int i = 0; i < points.count; i++) {
+			store(i, 0.0f);
+		}
+		return;
+	}
+
+	std::vector<int> order;
+	MortonOrder(points, order, pool);
+
+	pool.ParallelFor(0, points.count, QUERY_BLOCK_SIZE, [&](int begin, int end) {
+		for (int k = begin; k < end; k++) {
+			int i = order[k];
+			const float p[3] = { points.x[i], points.y[i], points.z[i] };
+			store(i, m_SolidAngle.computeSolidAngle(HDK_Sample::UT_Vector3T<float>(p), accuracyScale) * INV_FOUR_PI);
+		}
+	});
+}
+
+void WindingNumberQuery::ComputeBatch(const PointBatch& points, float* windingNumbers, ThreadPool& pool, float accuracyScale) const {
+	Evaluate(points, pool, accuracyScale, [windingNumbers](int i, float windingNumber) {
+		windingNumbers[i] = windingNumber;
+	});
+}
+
+void WindingNumberQuery::ComputeBatch(const PointBatch& points, float* windingNumbers, float accuracyScale) const {
+	ComputeBatch(points, windingNumbers, ThreadPool::Global(), accuracyScale);
+}
+
+void WindingNumberQuery::ClassifyBatch(const PointBatch& points, uint8_t* inside, ThreadPool& pool, float accuracyScale) const {
+	Evaluate(points, pool, accuracyScale, [inside](int i, float windingNumber) {
+		inside[i] = std::abs(windingNumber) >= INSIDE_THRESHOLD ? 1 : 0;
+	});
+}
+
+void WindingNumberQuery::ClassifyBatch(const PointBatch& points, uint8_t* inside, float accuracyScale) const {
+	ClassifyBatch(points, inside, ThreadPool::Global(), accuracyScale);
+}
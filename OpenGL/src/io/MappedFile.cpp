@@ -0,0 +1,80 @@
+#include "MappedFile.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filepath) : m_Filepath(filepath) {
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cout << "Unable to open file " << filepath << std::endl;
+		return;
+	}
+	m_FileHandle = file;
+	m_Opened = true;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	m_Size = (size_t)size.QuadPart;
+	if (m_Size == 0) {
+		return; //Empty files cannot be mapped
+	}
+
+	m_MappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_MappingHandle) {
+		m_Data = (const char*)MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (!m_Data) {
+		std::cout << "Unable to map file " << filepath << std::endl;
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (m_Data) { UnmapViewOfFile(m_Data); }
+	if (m_MappingHandle) { CloseHandle(m_MappingHandle); }
+	if (m_FileHandle) { CloseHandle(m_FileHandle); }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filepath) : m_Filepath(filepath) {
+	m_FileDescriptor = open(filepath.c_str(), O_RDONLY);
+	if (m_FileDescriptor < 0) {
+		std::cout << "Unable to open file " << filepath << std::endl;
+		return;
+	}
+	m_Opened = true;
+
+	struct stat info;
+	fstat(m_FileDescriptor, &info);
+	m_Size = (size_t)info.st_size;
+	if (m_Size == 0) {
+		return; //Empty files cannot be mapped
+	}
+
+	void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+	if (data == MAP_FAILED) {
+		std::cout << "Unable to map file " << filepath << std::endl;
+		return;
+	}
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+	m_Data = (const char*)data;
+}
+
+MappedFile::~MappedFile() {
+	if (m_Data) { munmap((void*)m_Data, m_Size); }
+	if (m_FileDescriptor >= 0) { close(m_FileDescriptor); }
+}
+
+#endif
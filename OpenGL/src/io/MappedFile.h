@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+	Read-only memory mapping of a whole file. The mapping lives as long as the object, so any pointers into
+	GetData() must not outlive it.
+*/
+class MappedFile {
+public:
+	MappedFile(const std::string& filepath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline bool IsOpen() const { return m_Data != nullptr || (m_Opened && m_Size == 0); }
+	inline const char* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+	inline const std::string& GetFilepath() const { return m_Filepath; }
+
+private:
+	std::string m_Filepath;
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_Opened = false;
+
+#ifdef _WIN32
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+#else
+	int m_FileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,339 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace {
+
+	enum Section {
+		SECTION_POSITIONS,
+		SECTION_NORMALS,
+		SECTION_TEX_COORDS,
+		SECTION_INDICES,
+		SECTION_FACE_PLANES,
+		SECTION_WELDED_VERTICES,
+		SECTION_FACE_NEIGHBOURS,
+		SECTION_EDGES,
+		SECTION_BOUNDARY_EDGES,
+		SECTION_NON_MANIFOLD_EDGES,
+		SECTION_HULL_VERTICES,
+		SECTION_HULL_FACES,
+		SECTION_HULL_EDGES,
+		NUM_SECTIONS
+	};
+
+	/* Sections are aligned so that the mapped arrays can be read in place (and by SIMD loads) */
+	const size_t SECTION_ALIGNMENT = 16;
+	const char MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourcePathHash;
+		uint64_t sourceSize;
+		uint64_t sourceContentHash;
+		uint64_t fileSize;
+
+		uint32_t numVertices, numIndices, numFaces, hasNormals, hasTexCoords;
+		uint32_t numWeldedVertices, numEdges, numBoundaryEdges, numNonManifoldEdges;
+		uint32_t numHullVertices, numHullFaces, numHullEdges;
+		float hullTolerance;
+		float boundsMin[3], boundsMax[3];
+
+		uint64_t sectionOffsets[NUM_SECTIONS];
+		uint64_t sectionSizes[NUM_SECTIONS];
+	};
+
+	/* FNV-1a */
+	uint64_t HashPath(const std::string& path) {
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (char c : path) {
+			hash = (hash ^ (unsigned char)c) * 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	bool GetFileSize(const std::string& path, uint64_t& size) {
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(path.c_str(), &info) != 0) {
+			return false;
+		}
+#else
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			return false;
+		}
+#endif
+		size = (uint64_t)info.st_size;
+		return true;
+	}
+
+	/*
+		Hash of the source contents, so that a file saved again within the resolution of its modification time (or
+		with its time reset) is still noticed. Four independent FNV-1a style lanes over 8 byte words keep it at
+		memory speed.
+	*/
+	bool HashContents(const std::string& path, uint64_t& hash) {
+		MappedFile file(path);
+		if (!file.IsOpen()) {
+			return false;
+		}
+		const unsigned char* data = (const unsigned char*)file.GetData();
+		const size_t size = file.GetSize();
+		const uint64_t prime = 0x100000001b3ULL;
+		uint64_t lanes[4] = { 0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL, 0x9ce484222325cbf2ULL, 0x2325cbf29ce48422ULL };
+		size_t i = 0;
+		for (; i + 32 <= size; i += 32) {
+			for (int lane = 0; lane < 4; lane++) {
+				uint64_t word;
+				std::memcpy(&word, data + i + lane * 8, sizeof(word));
+				lanes[lane] = (lanes[lane] ^ word) * prime;
+			}
+		}
+		for (; i < size; i++) {
+			lanes[0] = (lanes[0] ^ data[i]) * prime;
+		}
+		hash = (uint64_t)size;
+		for (int lane = 0; lane < 4; lane++) {
+			hash = (hash ^ lanes[lane]) * prime;
+		}
+		return true;
+	}
+
+	inline size_t AlignUp(size_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	}
+
+}
+
+std::string MeshCache::GetCookedPath(const std::string& sourcePath) {
+	return sourcePath + ".cooked";
+}
+
+bool MeshCache::Load(const std::string& sourcePath, CookedMesh& cooked) {
+	uint64_t sourceSize = 0;
+	if (!GetFileSize(sourcePath, sourceSize)) {
+		return false;
+	}
+
+	/* A missing cooked file is the normal first-run case, so check for it before MappedFile reports an error */
+	const std::string cookedPath = GetCookedPath(sourcePath);
+	uint64_t cookedSize = 0;
+	if (!GetFileSize(cookedPath, cookedSize) || cookedSize < sizeof(Header)) {
+		return false;
+	}
+
+	std::unique_ptr<MappedFile> file(new MappedFile(cookedPath));
+	if (!file->IsOpen() || file->GetSize() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, file->GetData(), sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.fileSize != file->GetSize()
+		|| header.sourcePathHash != HashPath(sourcePath) || header.sourceSize != sourceSize) {
+		return false;
+	}
+	uint64_t sourceContentHash = 0;
+	if (!HashContents(sourcePath, sourceContentHash) || header.sourceContentHash != sourceContentHash) {
+		return false;
+	}
+
+	/* Every section has to lie inside the file and have the size implied by the counts */
+	const uint64_t expectedSizes[NUM_SECTIONS] = {
+		header.numVertices * 3 * sizeof(float),
+		header.hasNormals ? header.numVertices * 3 * sizeof(float) : 0,
+		header.hasTexCoords ? header.numVertices * 2 * sizeof(float) : 0,
+		header.numIndices * sizeof(unsigned int),
+		header.numFaces * sizeof(glm::vec4),
+		header.numVertices * sizeof(int),
+		header.numFaces * 3 * sizeof(int),
+		header.numEdges * sizeof(MeshAdjacency::Edge),
+		header.numBoundaryEdges * sizeof(int),
+		header.numNonManifoldEdges * sizeof(int),
+		header.numHullVertices * sizeof(glm::vec3),
+		header.numHullFaces * sizeof(ConvexHull::Face),
+		header.numHullEdges * sizeof(ConvexHull::HalfEdge)
+	};
+	for (int s = 0; s < NUM_SECTIONS; s++) {
+		if (header.sectionSizes[s] != expectedSizes[s] || header.sectionOffsets[s] % SECTION_ALIGNMENT != 0
+			|| header.sectionOffsets[s] + header.sectionSizes[s] > header.fileSize) {
+			return false;
+		}
+	}
+
+	/* Mesh indexes the vertices and faces with these without further checks */
+	const char* base = file->GetData();
+	const unsigned int* indices = (const unsigned int*)(base + header.sectionOffsets[SECTION_INDICES]);
+	const int* faceNeighbours = (const int*)(base + header.sectionOffsets[SECTION_FACE_NEIGHBOURS]);
+	if ((uint64_t)header.numIndices != (uint64_t)header.numFaces * 3) {
+		return false;
+	}
+	for (uint32_t i = 0; i < header.numIndices; i++) {
+		if (indices[i] >= header.numVertices) {
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < header.numFaces * 3; i++) {
+		if (faceNeighbours[i] != MeshAdjacency::NO_NEIGHBOUR && (faceNeighbours[i] < 0 || (uint32_t)faceNeighbours[i] >= header.numFaces)) {
+			return false;
+		}
+	}
+
+	cooked.numVertices = (int)header.numVertices;
+	cooked.numIndices = (int)header.numIndices;
+	cooked.numFaces = (int)header.numFaces;
+	cooked.hasNormals = header.hasNormals != 0;
+	cooked.hasTexCoords = header.hasTexCoords != 0;
+	cooked.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	cooked.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	cooked.positions = (const float*)(base + header.sectionOffsets[SECTION_POSITIONS]);
+	cooked.normals = cooked.hasNormals ? (const float*)(base + header.sectionOffsets[SECTION_NORMALS]) : nullptr;
+	cooked.texCoords = cooked.hasTexCoords ? (const float*)(base + header.sectionOffsets[SECTION_TEX_COORDS]) : nullptr;
+	cooked.indices = indices;
+	cooked.facePlanes = (const glm::vec4*)(base + header.sectionOffsets[SECTION_FACE_PLANES]);
+
+	cooked.numWeldedVertices = (int)header.numWeldedVertices;
+	cooked.numEdges = (int)header.numEdges;
+	cooked.numBoundaryEdges = (int)header.numBoundaryEdges;
+	cooked.numNonManifoldEdges = (int)header.numNonManifoldEdges;
+	cooked.weldedVertices = (const int*)(base + header.sectionOffsets[SECTION_WELDED_VERTICES]);
+	cooked.faceNeighbours = faceNeighbours;
+	cooked.edges = (const MeshAdjacency::Edge*)(base + header.sectionOffsets[SECTION_EDGES]);
+	cooked.boundaryEdges = (const int*)(base + header.sectionOffsets[SECTION_BOUNDARY_EDGES]);
+	cooked.nonManifoldEdges = (const int*)(base + header.sectionOffsets[SECTION_NON_MANIFOLD_EDGES]);
+
+	cooked.numHullVertices = (int)header.numHullVertices;
+	cooked.numHullFaces = (int)header.numHullFaces;
+	cooked.numHullEdges = (int)header.numHullEdges;
+	cooked.hullTolerance = header.hullTolerance;
+	cooked.hullVertices = (const glm::vec3*)(base + header.sectionOffsets[SECTION_HULL_VERTICES]);
+	cooked.hullFaces = (const ConvexHull::Face*)(base + header.sectionOffsets[SECTION_HULL_FACES]);
+	cooked.hullEdges = (const ConvexHull::HalfEdge*)(base + header.sectionOffsets[SECTION_HULL_EDGES]);
+	cooked.file = std::move(file);
+	return true;
+}
+
+bool MeshCache::Save(const std::string& sourcePath, const std::vector<float>& positions, const std::vector<float>& normals,
+	const std::vector<float>& texCoords, const std::vector<unsigned int>& indices, const std::vector<glm::vec4>& facePlanes,
+	const MeshAdjacency& adjacency, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const ConvexHull& hull) {
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.sourcePathHash = HashPath(sourcePath);
+	if (!GetFileSize(sourcePath, header.sourceSize) || !HashContents(sourcePath, header.sourceContentHash)) {
+		return false;
+	}
+
+	const int numVertices = (int)(positions.size() / 3);
+	header.numVertices = numVertices;
+	header.numIndices = (uint32_t)indices.size();
+	header.numFaces = (uint32_t)facePlanes.size();
+	header.hasNormals = !normals.empty() && normals.size() >= positions.size();
+	header.hasTexCoords = !texCoords.empty() && texCoords.size() >= (size_t)numVertices * 2;
+	header.numWeldedVertices = adjacency.GetNumWeldedVertices();
+	header.numEdges = (uint32_t)adjacency.GetEdges().size();
+	header.numBoundaryEdges = (uint32_t)adjacency.GetBoundaryEdges().size();
+	header.numNonManifoldEdges = (uint32_t)adjacency.GetNonManifoldEdges().size();
+	header.numHullVertices = (uint32_t)hull.m_Vertices.size();
+	header.numHullFaces = (uint32_t)hull.m_Faces.size();
+	header.numHullEdges = (uint32_t)hull.m_Edges.size();
+	header.hullTolerance = hull.m_Tolerance;
+	for (int i = 0; i < 3; i++) {
+		header.boundsMin[i] = boundsMin[i];
+		header.boundsMax[i] = boundsMax[i];
+	}
+	if (adjacency.GetWeldedVertices().size() != (size_t)numVertices || adjacency.GetFaceNeighbours().size() != facePlanes.size() * 3) {
+		return false;
+	}
+
+	const void* sectionData[NUM_SECTIONS] = {
+		positions.data(), normals.data(), texCoords.data(), indices.data(), facePlanes.data(),
+		adjacency.m_WeldedVertices.data(), adjacency.m_FaceNeighbours.data(), adjacency.m_Edges.data(),
+		adjacency.m_BoundaryEdges.data(), adjacency.m_NonManifoldEdges.data(),
+		hull.m_Vertices.data(), hull.m_Faces.data(), hull.m_Edges.data()
+	};
+	header.sectionSizes[SECTION_POSITIONS] = positions.size() * sizeof(float);
+	header.sectionSizes[SECTION_NORMALS] = header.hasNormals ? numVertices * 3 * sizeof(float) : 0;
+	header.sectionSizes[SECTION_TEX_COORDS] = header.hasTexCoords ? numVertices * 2 * sizeof(float) : 0;
+	header.sectionSizes[SECTION_INDICES] = indices.size() * sizeof(unsigned int);
+	header.sectionSizes[SECTION_FACE_PLANES] = facePlanes.size() * sizeof(glm::vec4);
+	header.sectionSizes[SECTION_WELDED_VERTICES] = adjacency.m_WeldedVertices.size() * sizeof(int);
+	header.sectionSizes[SECTION_FACE_NEIGHBOURS] = adjacency.m_FaceNeighbours.size() * sizeof(int);
+	header.sectionSizes[SECTION_EDGES] = adjacency.m_Edges.size() * sizeof(MeshAdjacency::Edge);
+	header.sectionSizes[SECTION_BOUNDARY_EDGES] = adjacency.m_BoundaryEdges.size() * sizeof(int);
+	header.sectionSizes[SECTION_NON_MANIFOLD_EDGES] = adjacency.m_NonManifoldEdges.size() * sizeof(int);
+	header.sectionSizes[SECTION_HULL_VERTICES] = hull.m_Vertices.size() * sizeof(glm::vec3);
+	header.sectionSizes[SECTION_HULL_FACES] = hull.m_Faces.size() * sizeof(ConvexHull::Face);
+	header.sectionSizes[SECTION_HULL_EDGES] = hull.m_Edges.size() * sizeof(ConvexHull::HalfEdge);
+
+	size_t offset = AlignUp(sizeof(Header));
+	for (int s = 0; s < NUM_SECTIONS; s++) {
+		header.sectionOffsets[s] = offset;
+		offset = AlignUp(offset + header.sectionSizes[s]);
+	}
+	header.fileSize = offset;
+
+	std::vector<char> buffer(offset, 0);
+	std::memcpy(buffer.data(), &header, sizeof(Header));
+	for (int s = 0; s < NUM_SECTIONS; s++) {
+		if (header.sectionSizes[s] > 0) {
+			std::memcpy(&buffer[header.sectionOffsets[s]], sectionData[s], header.sectionSizes[s]);
+		}
+	}
+
+	const std::string cookedPath = GetCookedPath(sourcePath);
+	const FileBlock block = { buffer.data(), buffer.size() };
+	if (!WriteFileAtomic(cookedPath, &block, 1)) {
+		std::cout << "Unable to write cooked mesh " << cookedPath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::WriteFileAtomic(const std::string& filepath, const FileBlock* blocks, int numBlocks) {
+	const std::string tempPath = filepath + ".tmp";
+	bool written = false;
+	{
+		std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+		for (int b = 0; b < numBlocks && stream; b++) {
+			stream.write((const char*)blocks[b].data, blocks[b].size);
+		}
+		stream.close();
+		written = !stream.fail();
+	}
+
+	/* rename does not replace an existing file on Windows */
+	if (written) {
+		std::remove(filepath.c_str());
+		written = std::rename(tempPath.c_str(), filepath.c_str()) == 0;
+	}
+	if (!written) {
+		std::remove(tempPath.c_str());
+	}
+	return written;
+}
+
+void MeshCache::LoadAdjacency(const CookedMesh& cooked, MeshAdjacency& adjacency) {
+	adjacency.m_WeldedVertices.assign(cooked.weldedVertices, cooked.weldedVertices + cooked.numVertices);
+	adjacency.m_NumWeldedVertices = cooked.numWeldedVertices;
+	adjacency.m_FaceNeighbours.assign(cooked.faceNeighbours, cooked.faceNeighbours + cooked.numFaces * 3);
+	adjacency.m_Edges.assign(cooked.edges, cooked.edges + cooked.numEdges);
+	adjacency.m_BoundaryEdges.assign(cooked.boundaryEdges, cooked.boundaryEdges + cooked.numBoundaryEdges);
+	adjacency.m_NonManifoldEdges.assign(cooked.nonManifoldEdges, cooked.nonManifoldEdges + cooked.numNonManifoldEdges);
+}
+
+void MeshCache::LoadConvexHull(const CookedMesh& cooked, ConvexHull& hull) {
+	hull.m_Vertices.assign(cooked.hullVertices, cooked.hullVertices + cooked.numHullVertices);
+	hull.m_Faces.assign(cooked.hullFaces, cooked.hullFaces + cooked.numHullFaces);
+	hull.m_Edges.assign(cooked.hullEdges, cooked.hullEdges + cooked.numHullEdges);
+	hull.m_Tolerance = cooked.hullTolerance;
+	hull.LinkNeighbours();
+}
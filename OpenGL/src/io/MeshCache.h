@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "geometry/ConvexHull.h"
+#include "geometry/MeshAdjacency.h"
+
+#include "glm/glm.hpp"
+
+/*
+	Versioned binary "cooked mesh" cache. The first load of a source file writes <source>.cooked next to it with
+	everything Mesh otherwise recomputes on startup: the vertex positions, normals and texture coordinates, the
+	indices, face planes, edge adjacency, bounds and the convex hull. Each array is stored once, in the layout Mesh
+	keeps it in, and later loads memory map the file and hand out pointers straight into the mapping, so every array
+	is a single copy out of the mapped pages and nothing is parsed.
+
+	A cooked file is only used if its version, source path hash, source size and a hash of the source contents all
+	match, and its indices and face neighbours are in range; anything else (including a truncated file) is treated
+	as a miss and the source is cooked again.
+*/
+class MeshCache {
+public:
+	static const uint32_t VERSION = 3;
+
+	/* Read-only view of a mapped cooked file; all pointers stay valid for the lifetime of the object */
+	struct CookedMesh {
+		std::unique_ptr<MappedFile> file;
+
+		int numVertices = 0, numIndices = 0, numFaces = 0;
+		bool hasNormals = false, hasTexCoords = false;
+		glm::vec3 boundsMin, boundsMax;
+
+		const float* positions = nullptr; //x, y, z per vertex
+		const float* normals = nullptr; //x, y, z per vertex if hasNormals
+		const float* texCoords = nullptr; //u, v per vertex if hasTexCoords
+		const unsigned int* indices = nullptr;
+		const glm::vec4* facePlanes = nullptr; //Normal and offset per face
+
+		int numWeldedVertices = 0, numEdges = 0, numBoundaryEdges = 0, numNonManifoldEdges = 0;
+		const int* weldedVertices = nullptr;
+		const int* faceNeighbours = nullptr;
+		const MeshAdjacency::Edge* edges = nullptr;
+		const int* boundaryEdges = nullptr;
+		const int* nonManifoldEdges = nullptr;
+
+		int numHullVertices = 0, numHullFaces = 0, numHullEdges = 0;
+		float hullTolerance = 0.0f;
+		const glm::vec3* hullVertices = nullptr;
+		const ConvexHull::Face* hullFaces = nullptr;
+		const ConvexHull::HalfEdge* hullEdges = nullptr;
+	};
+
+	static std::string GetCookedPath(const std::string& sourcePath);
+
+	/* Maps the cooked file for sourcePath if it is present and up to date */
+	static bool Load(const std::string& sourcePath, CookedMesh& cooked);
+
+	/* Writes the cooked file for sourcePath (normals and texCoords may be empty) */
+	static bool Save(const std::string& sourcePath, const std::vector<float>& positions, const std::vector<float>& normals,
+		const std::vector<float>& texCoords, const std::vector<unsigned int>& indices, const std::vector<glm::vec4>& facePlanes,
+		const MeshAdjacency& adjacency, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const ConvexHull& hull);
+
+	/* Copies the cooked adjacency into a MeshAdjacency */
+	static void LoadAdjacency(const CookedMesh& cooked, MeshAdjacency& adjacency);
+
+	/* Copies the cooked convex hull into a ConvexHull (empty if the mesh has none) */
+	static void LoadConvexHull(const CookedMesh& cooked, ConvexHull& hull);
+
+	struct FileBlock {
+		const void* data;
+		size_t size;
+	};
+
+	/*
+		Writes the blocks one after another to a temporary file and renames it over filepath, so that an interrupted
+		write never leaves a file that looks complete. On failure the temporary file is removed and false returned.
+	*/
+	static bool WriteFileAtomic(const std::string& filepath, const FileBlock* blocks, int numBlocks);
+};
@@ -0,0 +1,428 @@
+#include "ObjParser.h"
+
+#include "MappedFile.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+static const double POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static inline bool IsDigit(char c) { return (unsigned char)(c - '0') < 10; }
+
+/* Whether p starts an optionally signed run of digits */
+static inline bool StartsNumber(const char* p, const char* end) {
+	if (p < end && (*p == '-' || *p == '+')) {
+		p++;
+	}
+	return p < end && IsDigit(*p);
+}
+
+static inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && IsSpace(*p)) { p++; }
+	return p;
+}
+
+static inline const char* SkipLine(const char* p, const char* end) {
+	const char* newline = (const char*)std::memchr(p, '\n', end - p);
+	return newline ? newline + 1 : end;
+}
+
+void ObjMeshData::Clear() {
+	positions.clear();
+	normals.clear();
+	texCoords.clear();
+	positionIndices.clear();
+	normalIndices.clear();
+	textureIndices.clear();
+	invalidIndices = 0;
+	fileSize = 0;
+	parseSeconds = 0.0;
+}
+
+const char* ObjParser::ParseFloat(const char* p, const char* end, float& value) {
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	/* Accumulate up to 19 significant digits exactly in an integer, the rest only shift the exponent */
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (p < end && IsDigit(*p)) {
+		if (significantDigits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			significantDigits += (mantissa != 0);
+		} else {
+			exponent++;
+		}
+		anyDigits = true;
+		p++;
+	}
+
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && IsDigit(*p)) {
+			if (significantDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				significantDigits += (mantissa != 0);
+				exponent--;
+			}
+			anyDigits = true;
+			p++;
+		}
+	}
+
+	if (!anyDigits) {
+		return start;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		int exponentValue = 0;
+		const char* exponentEnd = ParseInt(p + 1, end, exponentValue);
+		if (exponentEnd != p + 1) {
+			/* Anything past the clamp is already 0 or infinite as a float, and the sum cannot overflow */
+			exponent += std::max(-1000, std::min(exponentValue, 1000));
+			p = exponentEnd;
+		} else if (StartsNumber(p + 1, end)) {
+			return start; //Exponent out of the range of an int
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent < 0) {
+		result = (-exponent <= 22) ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+	} else if (exponent > 0) {
+		result = (exponent <= 22) ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+	}
+
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+const char* ObjParser::ParseInt(const char* p, const char* end, int& value) {
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	if (p == end || !IsDigit(*p)) {
+		return start;
+	}
+
+	/* Accumulate the magnitude in 64 bits and reject it as soon as it leaves the range of an int */
+	const long long limit = negative ? -(long long)INT_MIN : (long long)INT_MAX;
+	long long result = 0;
+	while (p < end && IsDigit(*p)) {
+		result = result * 10 + (*p - '0');
+		if (result > limit) {
+			return start;
+		}
+		p++;
+	}
+
+	value = (int)(negative ? -result : result);
+	return p;
+}
+
+ObjParser::Counts ObjParser::CountElements(const char* begin, const char* end) {
+	Counts counts;
+	const char* p = begin;
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (p + 1 < end && p[0] == 'v') {
+			if (IsSpace(p[1])) { counts.positions++; }
+			else if (p[1] == 'n') { counts.normals++; }
+			else if (p[1] == 't') { counts.texCoords++; }
+		} else if (p + 1 < end && p[0] == 'f' && IsSpace(p[1])) {
+			/* Count the corners so polygons reserve the right number of triangles */
+			int corners = 0;
+			const char* q = p + 1;
+			while (q < end && *q != '\n') {
+				q = SkipSpaces(q, end);
+				if (q < end && *q != '\n') {
+					corners++;
+					while (q < end && !IsSpace(*q) && *q != '\n') { q++; }
+				}
+			}
+			counts.triangles += corners > 2 ? corners - 2 : 0;
+			p = q;
+		}
+		p = SkipLine(p, end);
+	}
+	return counts;
+}
+
+const char* ObjParser::ParseFaceLine(const char* p, const char* end, ObjMeshData& data, const Counts& base, const Counts& totals) {
+	const int numPositions = (int)(base.positions + data.positions.size() / 3);
+	const int numNormals = (int)(base.normals + data.normals.size() / 3);
+	const int numTexCoords = (int)(base.texCoords + data.texCoords.size() / 2);
+
+	/*
+		OBJ indices are 1-based, negative indices are relative to the end of the list read so far. An index of 0 or
+		one that lands outside the attributes of the file is counted as invalid and replaced with 0
+	*/
+	auto resolve = [&](int index, int count, size_t total) {
+		long long resolved = index > 0 ? (long long)index - 1 : index < 0 ? (long long)count + index : -1;
+		if (resolved < 0 || resolved >= (long long)total) {
+			if (data.invalidIndices++ == 0) {
+				std::cout << "Face index " << index << " out of range (" << total << " attributes)" << std::endl;
+			}
+			return 0u;
+		}
+		return (unsigned int)resolved;
+	};
+
+	/* ParseInt rejects numbers outside the range of an int, which as indices are out of range as well */
+	auto rejectedIndex = [&](const char* q) {
+		if (!StartsNumber(q, end)) {
+			return false;
+		}
+		if (data.invalidIndices++ == 0) {
+			const char* digitsEnd = q + 1;
+			while (digitsEnd < end && IsDigit(*digitsEnd)) { digitsEnd++; }
+			std::cout << "Face index " << std::string(q, digitsEnd) << " out of range" << std::endl;
+		}
+		return true;
+	};
+
+	unsigned int first[3] = { 0, 0, 0 }, previous[3] = { 0, 0, 0 };
+	int vertexCount = 0;
+
+	while (true) {
+		p = SkipSpaces(p, end);
+		if (p >= end || *p == '\n') {
+			break;
+		}
+
+		int v = 0, t = 0, n = 0;
+		const char* q = ParseInt(p, end, v);
+		if (q == p && rejectedIndex(p)) {
+			break;
+		}
+		if (q == p) {
+			std::cout << "Could not parse face corner: " << std::string(p, std::find(p, end, '\n')) << std::endl;
+			break;
+		}
+		p = q;
+
+		bool cornerHasTexture = false, cornerHasNormal = false;
+		if (p < end && *p == '/') {
+			p++;
+			q = ParseInt(p, end, t);
+			if (q == p && rejectedIndex(p)) {
+				break;
+			}
+			cornerHasTexture = (q != p);
+			p = q;
+			if (p < end && *p == '/') {
+				p++;
+				q = ParseInt(p, end, n);
+				if (q == p && rejectedIndex(p)) {
+					break;
+				}
+				cornerHasNormal = (q != p);
+				p = q;
+			}
+		}
+
+		const unsigned int position = resolve(v, numPositions, totals.positions);
+		unsigned int corner[3] = {
+			position,
+			cornerHasNormal ? resolve(n, numNormals, totals.normals) : position,
+			cornerHasTexture ? resolve(t, numTexCoords, totals.texCoords) : 0 };
+
+		/* Every corner after the third closes another triangle with the previous and first corners */
+		if (vertexCount >= 3) {
+			data.positionIndices.push_back(previous[0]);
+			data.normalIndices.push_back(previous[1]);
+			if (cornerHasTexture) { data.textureIndices.push_back(previous[2]); }
+		}
+
+		data.positionIndices.push_back(corner[0]);
+		data.normalIndices.push_back(corner[1]);
+		if (cornerHasTexture) { data.textureIndices.push_back(corner[2]); }
+
+		if (vertexCount >= 3) {
+			data.positionIndices.push_back(first[0]);
+			data.normalIndices.push_back(first[1]);
+			if (cornerHasTexture) { data.textureIndices.push_back(first[2]); }
+		}
+
+		if (vertexCount == 0) {
+			std::memcpy(first, corner, sizeof(corner));
+		}
+		std::memcpy(previous, corner, sizeof(corner));
+		vertexCount++;
+
+		/* Skip anything unexpected up to the next corner */
+		while (p < end && !IsSpace(*p) && *p != '\n') { p++; }
+	}
+
+	return p;
+}
+
+void ObjParser::Reserve(ObjMeshData& data, const Counts& counts) {
+	data.positions.reserve(data.positions.size() + counts.positions * 3);
+	data.normals.reserve(data.normals.size() + counts.normals * 3);
+	data.texCoords.reserve(data.texCoords.size() + counts.texCoords * 2);
+	data.positionIndices.reserve(data.positionIndices.size() + counts.triangles * 3);
+	data.normalIndices.reserve(data.normalIndices.size() + counts.triangles * 3);
+	if (counts.texCoords > 0) {
+		data.textureIndices.reserve(data.textureIndices.size() + counts.triangles * 3);
+	}
+}
+
+void ObjParser::Parse(const char* begin, const char* end, ObjMeshData& data) {
+	const Counts totals = CountElements(begin, end);
+	Reserve(data, totals);
+	ParseRange(begin, end, data, Counts(), totals);
+}
+
+void ObjParser::ParseRange(const char* begin, const char* end, ObjMeshData& data, const Counts& base, const Counts& totals) {
+	const char* p = begin;
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (p >= end) {
+			break;
+		}
+
+		/* Components per attribute keyword (0 means the line is not a vertex attribute) */
+		int components = 0;
+		std::vector<float>* target = nullptr;
+		if (p[0] == 'v' && p + 1 < end) {
+			if (IsSpace(p[1])) { target = &data.positions; components = 3; p += 1; }
+			else if (p[1] == 'n' && p + 2 < end && IsSpace(p[2])) { target = &data.normals; components = 3; p += 2; }
+			else if (p[1] == 't' && p + 2 < end && IsSpace(p[2])) { target = &data.texCoords; components = 2; p += 2; }
+		} else if (p[0] == 'f' && p + 1 < end && IsSpace(p[1])) {
+			p = ParseFaceLine(p + 1, end, data, base, totals);
+		}
+
+		/* Extra components (w, vertex colours, 3D texture coordinates) are ignored */
+		bool valid = true;
+		for (int c = 0; c < components; c++) {
+			float value = 0.0f;
+			if (valid) {
+				p = SkipSpaces(p, end);
+				const char* q = ParseFloat(p, end, value);
+				if (q == p) {
+					/* Keep the attribute streams aligned by zero-filling the remaining components */
+					std::cout << "Could not parse string: " << std::string(p, std::find(p, end, '\n')) << std::endl;
+					valid = false;
+				}
+				p = q;
+			}
+			target->push_back(value);
+		}
+
+		/* Comments, mtllib, usemtl, o, g, s and anything else are skipped */
+		p = SkipLine(p, end);
+	}
+}
+
+template<typename T>
+static void AppendChunks(std::vector<T> ObjMeshData::* member, const std::vector<ObjMeshData>& chunks, ObjMeshData& data, ThreadPool& pool) {
+	std::vector<size_t> offsets(chunks.size() + 1, 0);
+	for (size_t c = 0; c < chunks.size(); c++) {
+		offsets[c + 1] = offsets[c] + (chunks[c].*member).size();
+	}
+
+	std::vector<T>& target = data.*member;
+	target.resize(offsets.back());
+	pool.Run((int)chunks.size(), [&](int c) {
+		const std::vector<T>& source = chunks[c].*member;
+		if (!source.empty()) {
+			std::memcpy(&target[offsets[c]], source.data(), source.size() * sizeof(T));
+		}
+	});
+}
+
+void ObjParser::ParseChunked(const char* begin, const char* end, ObjMeshData& data, ThreadPool& pool) {
+	/* A few chunks per thread keeps the load balanced when line lengths vary through the file */
+	const size_t minChunkBytes = 256 * 1024;
+	const size_t size = (size_t)(end - begin);
+	int numChunks = (int)std::min<size_t>(size / minChunkBytes, pool.GetNumThreads() * 4);
+	if (numChunks <= 1) {
+		Parse(begin, end, data);
+		return;
+	}
+
+	/* Split at line boundaries: each chunk starts just after the first newline at or past its nominal start */
+	std::vector<const char*> bounds(numChunks + 1);
+	bounds[0] = begin;
+	bounds[numChunks] = end;
+	for (int c = 1; c < numChunks; c++) {
+		const char* nominal = begin + (size * c) / numChunks;
+		bounds[c] = std::max(bounds[c - 1], SkipLine(nominal - 1, end));
+	}
+
+	std::vector<Counts> counts(numChunks);
+	pool.Run(numChunks, [&](int c) { counts[c] = CountElements(bounds[c], bounds[c + 1]); });
+
+	/* Exclusive prefix sum gives the number of attributes preceding each chunk, and the last one the file's totals */
+	std::vector<Counts> bases(numChunks + 1);
+	for (int c = 1; c <= numChunks; c++) {
+		bases[c].positions = bases[c - 1].positions + counts[c - 1].positions;
+		bases[c].normals = bases[c - 1].normals + counts[c - 1].normals;
+		bases[c].texCoords = bases[c - 1].texCoords + counts[c - 1].texCoords;
+		bases[c].triangles = bases[c - 1].triangles + counts[c - 1].triangles;
+	}
+
+	std::vector<ObjMeshData> chunks(numChunks);
+	pool.Run(numChunks, [&](int c) {
+		Reserve(chunks[c], counts[c]);
+		ParseRange(bounds[c], bounds[c + 1], chunks[c], bases[c], bases[numChunks]);
+	});
+	for (const ObjMeshData& chunk : chunks) {
+		data.invalidIndices += chunk.invalidIndices;
+	}
+
+	AppendChunks(&ObjMeshData::positions, chunks, data, pool);
+	AppendChunks(&ObjMeshData::normals, chunks, data, pool);
+	AppendChunks(&ObjMeshData::texCoords, chunks, data, pool);
+	AppendChunks(&ObjMeshData::positionIndices, chunks, data, pool);
+	AppendChunks(&ObjMeshData::normalIndices, chunks, data, pool);
+	AppendChunks(&ObjMeshData::textureIndices, chunks, data, pool);
+}
+
+bool ObjParser::ParseFile(const std::string& filepath, ObjMeshData& data, ThreadPool* pool) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	MappedFile file(filepath);
+	if (!file.IsOpen()) {
+		return false;
+	}
+
+	data.Clear();
+	data.fileSize = file.GetSize();
+	if (pool && file.GetSize() >= CHUNKED_PARSE_THRESHOLD) {
+		ParseChunked(file.GetData(), file.GetData() + file.GetSize(), data, *pool);
+	} else {
+		Parse(file.GetData(), file.GetData() + file.GetSize(), data);
+	}
+	if (data.invalidIndices > 0) {
+		std::cout << filepath << ": " << data.invalidIndices << " face indices out of range, not loading it" << std::endl;
+		data.Clear();
+		return false;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> duration = end - start;
+	data.parseSeconds = duration.count();
+	return true;
+}
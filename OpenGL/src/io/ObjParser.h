@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/* Raw attribute streams and triangulated face indices of a Wavefront .OBJ file (indices are 0-based) */
+struct ObjMeshData {
+	std::vector<float> positions; //x, y, z per "v"
+	std::vector<float> normals; //x, y, z per "vn"
+	std::vector<float> texCoords; //u, v per "vt"
+	std::vector<unsigned int> positionIndices; //Three per triangle
+	std::vector<unsigned int> normalIndices; //Three per triangle
+	std::vector<unsigned int> textureIndices; //Three per triangle, empty if the faces carry no uv indices
+	size_t invalidIndices = 0; //Face indices past the attributes in the file, or 0; ParseFile fails if there are any
+
+	size_t fileSize = 0;
+	double parseSeconds = 0.0;
+
+	void Clear();
+	inline double GetThroughputMBs() const { return parseSeconds > 0.0 ? (fileSize / (1024.0 * 1024.0)) / parseSeconds : 0.0; }
+};
+
+/*
+	Zero-copy .OBJ loader. The file is memory mapped and scanned in place with a hand-written tokenizer; a first
+	counting pass pre-sizes the output arrays so that the parsing pass never reallocates.
+
+	Faces with more than three corners are split into triangles the same way Mesh::ParseMeshFile always has:
+	every corner after the third emits (previous corner, corner, first corner), which for quads gives (a b c)(c d a).
+	Corners without a normal index reuse their position index. Face indices are checked against the number of
+	attributes in the whole file, so a file whose faces point past its attributes fails to load.
+
+	Large files can be parsed in chunks split at line boundaries: every chunk is counted in parallel, a prefix sum
+	over the counts gives each chunk its attribute offsets (needed to resolve negative indices), the chunks are
+	parsed in parallel and finally copied into place. The result is identical to the serial parse.
+*/
+class ObjParser {
+public:
+	/* Files at least this large are parsed in chunks when a thread pool is given */
+	static const size_t CHUNKED_PARSE_THRESHOLD = 4 * 1024 * 1024;
+
+	static bool ParseFile(const std::string& filepath, ObjMeshData& data, ThreadPool* pool = nullptr);
+	static void Parse(const char* begin, const char* end, ObjMeshData& data);
+	static void ParseChunked(const char* begin, const char* end, ObjMeshData& data, ThreadPool& pool);
+
+	/*
+		Number-parsing primitives (locale independent, no allocation). They return the position after the number, or p on
+		failure, which includes an integer (or float exponent) outside the range of an int
+	*/
+	static const char* ParseFloat(const char* p, const char* end, float& value);
+	static const char* ParseInt(const char* p, const char* end, int& value);
+
+private:
+	struct Counts {
+		size_t positions = 0, normals = 0, texCoords = 0, triangles = 0;
+	};
+
+	static Counts CountElements(const char* begin, const char* end);
+	static void Reserve(ObjMeshData& data, const Counts& counts);
+	static void ParseRange(const char* begin, const char* end, ObjMeshData& data, const Counts& base, const Counts& totals);
+	static const char* ParseFaceLine(const char* p, const char* end, ObjMeshData& data, const Counts& base, const Counts& totals);
+};
@@ -0,0 +1,239 @@
+#include "ObjVertexBuilder.h"
+
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+void ObjVertexData::Clear() {
+	positions.clear();
+	normals.clear();
+	texCoords.clear();
+	indices.clear();
+}
+
+namespace {
+
+	struct CornerKey {
+		unsigned int position, normal, texture;
+
+		inline bool operator==(const CornerKey& other) const {
+			return position == other.position && normal == other.normal && texture == other.texture;
+		}
+	};
+
+	inline uint64_t HashMix(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	inline CornerKey GetCornerKey(const ObjMeshData& data, int corner) {
+		CornerKey key;
+		key.position = data.positionIndices[corner];
+		key.normal = data.normalIndices[corner];
+		key.texture = data.textureIndices.empty() ? 0 : data.textureIndices[corner];
+		return key;
+	}
+
+	inline uint64_t HashCornerKey(const CornerKey& key) {
+		return HashMix(((uint64_t)key.position << 32 | key.normal) ^ HashMix(key.texture + 0x9e3779b97f4a7c15ULL));
+	}
+
+	/* Open addressing map from corner key to the first corner that used it */
+	class CornerTable {
+	public:
+		explicit CornerTable(size_t expectedKeys) {
+			size_t capacity = 16;
+			while (capacity < expectedKeys * 2) {
+				capacity *= 2;
+			}
+			m_Slots.assign(capacity, Slot());
+		}
+
+		/* Returns the first corner inserted with this key, inserting corner if the key is new */
+		int FindOrInsert(const CornerKey& key, uint64_t hash, int corner) {
+			if ((m_Count + 1) * 10 > m_Slots.size() * 7) {
+				Grow();
+			}
+
+			size_t mask = m_Slots.size() - 1;
+			for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+				Slot& slot = m_Slots[i];
+				if (slot.corner < 0) {
+					slot.key = key;
+					slot.hash = hash;
+					slot.corner = corner;
+					m_Count++;
+					return corner;
+				}
+				if (slot.hash == hash && slot.key == key) {
+					return slot.corner;
+				}
+			}
+		}
+
+	private:
+		struct Slot {
+			CornerKey key;
+			uint64_t hash = 0;
+			int corner = -1;
+		};
+
+		std::vector<Slot> m_Slots;
+		size_t m_Count = 0;
+
+		void Grow() {
+			std::vector<Slot> old(m_Slots.size() * 2);
+			old.swap(m_Slots);
+			size_t mask = m_Slots.size() - 1;
+			for (const Slot& slot : old) {
+				if (slot.corner >= 0) {
+					size_t i = (size_t)slot.hash & mask;
+					while (m_Slots[i].corner >= 0) {
+						i = (i + 1) & mask;
+					}
+					m_Slots[i] = slot;
+				}
+			}
+		}
+	};
+
+	/* Copies the attributes referenced by a corner into vertex slot v (missing attributes are left at zero) */
+	inline void WriteVertex(const ObjMeshData& data, const CornerKey& key, int v, ObjVertexData& vertices) {
+		if ((size_t)key.position * 3 + 2 < data.positions.size()) {
+			std::memcpy(&vertices.positions[v * 3], &data.positions[key.position * 3], 3 * sizeof(float));
+		}
+		if (!vertices.normals.empty() && (size_t)key.normal * 3 + 2 < data.normals.size()) {
+			std::memcpy(&vertices.normals[v * 3], &data.normals[key.normal * 3], 3 * sizeof(float));
+		}
+		if (!vertices.texCoords.empty() && (size_t)key.texture * 2 + 1 < data.texCoords.size()) {
+			std::memcpy(&vertices.texCoords[v * 2], &data.texCoords[key.texture * 2], 2 * sizeof(float));
+		}
+	}
+
+	void AllocateVertices(const ObjMeshData& data, int numVertices, int numCorners, ObjVertexData& vertices) {
+		vertices.positions.assign(numVertices * 3, 0.0f);
+		vertices.normals.assign(data.normals.empty() ? 0 : numVertices * 3, 0.0f);
+		vertices.texCoords.assign(data.textureIndices.empty() ? 0 : numVertices * 2, 0.0f);
+		vertices.indices.resize(numCorners);
+	}
+
+}
+
+void ObjVertexBuilder::Build(const ObjMeshData& data, ObjVertexData& vertices) {
+	const int numCorners = (int)data.positionIndices.size();
+	CornerTable table(data.positions.size() / 3);
+
+	/* First pass numbers the unique keys, second pass fills the attributes once their count is known */
+	std::vector<int> firstCorners;
+	firstCorners.reserve(data.positions.size() / 3);
+	std::vector<unsigned int> indices(numCorners);
+	for (int c = 0; c < numCorners; c++) {
+		CornerKey key = GetCornerKey(data, c);
+		int first = table.FindOrInsert(key, HashCornerKey(key), c);
+		if (first == c) {
+			indices[c] = (unsigned int)firstCorners.size();
+			firstCorners.push_back(c);
+		} else {
+			indices[c] = indices[first];
+		}
+	}
+
+	AllocateVertices(data, (int)firstCorners.size(), numCorners, vertices);
+	vertices.indices = std::move(indices);
+	for (int v = 0; v < (int)firstCorners.size(); v++) {
+		WriteVertex(data, GetCornerKey(data, firstCorners[v]), v, vertices);
+	}
+}
+
+void ObjVertexBuilder::Build(const ObjMeshData& data, ObjVertexData& vertices, ThreadPool& pool) {
+	const int numCorners = (int)data.positionIndices.size();
+	const int numPartitions = (int)pool.GetNumThreads();
+	if (numCorners < PARALLEL_CORNER_THRESHOLD || numPartitions == 1) {
+		Build(data, vertices);
+		return;
+	}
+
+	const int grainSize = 1 << 14;
+	const int numBlocks = (numCorners + grainSize - 1) / grainSize;
+	std::vector<uint64_t> hashes(numCorners);
+	pool.ParallelFor(0, numCorners, grainSize, [&](int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			hashes[c] = HashCornerKey(GetCornerKey(data, c));
+		}
+	});
+	auto getPartition = [&](int c) { return (int)((hashes[c] >> 40) % numPartitions); };
+
+	/*
+		Counting sort of the corners by partition: every block counts its corners per partition, a prefix sum over
+		(partition, block) gives each block its place in every partition, and the blocks scatter their corners in
+		order, so each partition lists its corners in corner order
+	*/
+	std::vector<int> partitionOffsets(numPartitions * numBlocks + 1, 0);
+	pool.Run(numBlocks, [&](int block) {
+		for (int c = block * grainSize, end = std::min(c + grainSize, numCorners); c < end; c++) {
+			partitionOffsets[getPartition(c) * numBlocks + block + 1]++;
+		}
+	});
+	for (int i = 0; i < numPartitions * numBlocks; i++) {
+		partitionOffsets[i + 1] += partitionOffsets[i];
+	}
+	std::vector<int> partitionStarts(numPartitions + 1);
+	for (int partition = 0; partition <= numPartitions; partition++) {
+		partitionStarts[partition] = partitionOffsets[partition * numBlocks];
+	}
+	std::vector<int> byPartition(numCorners);
+	pool.Run(numBlocks, [&](int block) {
+		for (int c = block * grainSize, end = std::min(c + grainSize, numCorners); c < end; c++) {
+			byPartition[partitionOffsets[getPartition(c) * numBlocks + block]++] = c;
+		}
+	});
+
+	/* Each partition owns the keys whose hash falls into it; inserting in corner order keeps "first corner" well defined */
+	std::vector<int> firstCorner(numCorners);
+	pool.Run(numPartitions, [&](int partition) {
+		CornerTable table(data.positions.size() / 3 / numPartitions);
+		for (int i = partitionStarts[partition]; i < partitionStarts[partition + 1]; i++) {
+			const int c = byPartition[i];
+			firstCorner[c] = table.FindOrInsert(GetCornerKey(data, c), hashes[c], c);
+		}
+	});
+
+	/* Exclusive prefix sum over the first-corner flags gives vertex ids in the same order as the serial build */
+	std::vector<int> blockOffsets(numBlocks + 1, 0);
+	pool.Run(numBlocks, [&](int block) {
+		int count = 0;
+		for (int c = block * grainSize, end = std::min(c + grainSize, numCorners); c < end; c++) {
+			count += (firstCorner[c] == c);
+		}
+		blockOffsets[block + 1] = count;
+	});
+	for (int block = 0; block < numBlocks; block++) {
+		blockOffsets[block + 1] += blockOffsets[block];
+	}
+
+	AllocateVertices(data, blockOffsets[numBlocks], numCorners, vertices);
+	pool.Run(numBlocks, [&](int block) {
+		int v = blockOffsets[block];
+		for (int c = block * grainSize, end = std::min(c + grainSize, numCorners); c < end; c++) {
+			if (firstCorner[c] == c) {
+				vertices.indices[c] = v;
+				WriteVertex(data, GetCornerKey(data, c), v++, vertices);
+			}
+		}
+	});
+
+	/* First corners always precede their duplicates, so their ids are all written by now */
+	pool.ParallelFor(0, numCorners, grainSize, [&](int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			if (firstCorner[c] != c) {
+				vertices.indices[c] = vertices.indices[firstCorner[c]];
+			}
+		}
+	});
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "ObjParser.h"
+
+class ThreadPool;
+
+/* Renderable vertex streams with one entry per unique (position, normal, uv) corner */
+struct ObjVertexData {
+	std::vector<float> positions; //x, y, z per vertex
+	std::vector<float> normals; //x, y, z per vertex, empty if the file has no normals
+	std::vector<float> texCoords; //u, v per vertex, empty if the faces carry no uv indices
+	std::vector<unsigned int> indices; //Three per triangle
+
+	void Clear();
+};
+
+/*
+	De-indexes the separate position/normal/uv index streams of an .OBJ into a single index buffer. Every distinct
+	(position, normal, uv) triple becomes one vertex, so seams keep both sets of attributes instead of the first
+	corner's attributes winning. Vertices are numbered in order of first use.
+
+	The parallel build hashes every corner and counting sorts the corners by hash partition in one pass, keeping
+	them in order within each partition. Each thread then inserts the keys of its own partition (in corner order, so
+	each key still records its first corner), and the first corners are numbered with a prefix sum. It produces
+	exactly the same output as the serial build.
+*/
+class ObjVertexBuilder {
+public:
+	/* Meshes with fewer corners than this are always built serially */
+	static const int PARALLEL_CORNER_THRESHOLD = 1 << 18;
+
+	static void Build(const ObjMeshData& data, ObjVertexData& vertices);
+	static void Build(const ObjMeshData& data, ObjVertexData& vertices, ThreadPool& pool);
+};
@@ -0,0 +1,333 @@
+#include "ParticleBackend.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "Renderer.h"
+#include "StreamingBuffer.h"
+#include "VertexBuffer.h"
+
+// Per particle data in the layout of the particle shader: x, y, z, size as floats, then r, g, b, a bytes, then the
+// draw order as one index per instance. The sizes keep every region 16 byte aligned for the texture buffers
+static const unsigned int POSITION_SIZE_BYTES = 4 * sizeof(GLfloat);
+static const unsigned int COLOR_BYTES = 4 * sizeof(GLubyte);
+static const unsigned int INDEX_BYTES = sizeof(GLint);
+
+/* PCG hash (Jarzynski and Olano 2020), as in res/shaders/ParticleSimulate.shader */
+static inline uint32_t Hash(uint32_t v) {
+	uint32_t state = v * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+/* Next uniform number in [0, 1) from a hash chain, exact in a float */
+static inline float Uniform(uint32_t& state) {
+	state = Hash(state);
+	return (float)(state >> 8u) * (1.0f / 16777216.0f);
+}
+
+ParticleBackend::ParticleBackend(int capacity) : m_Capacity(capacity) {
+	m_VAO = std::make_unique<VertexArray>();
+	m_VAO->Bind();
+
+	// The 4 vertices of the billboard, shared by all the particles thanks to instancing
+	static const GLfloat quad[] = {
+		-0.5f, -0.5f, 0.0f,
+		0.5f, -0.5f, 0.0f,
+		-0.5f, 0.5f, 0.0f,
+		0.5f, 0.5f, 0.0f,
+	};
+	m_QuadBuffer = std::make_unique<VertexBuffer>(quad, sizeof(quad));
+	GLCall(glEnableVertexAttribArray(0));
+	m_QuadBuffer->Bind();
+	GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+	GLCall(glVertexAttribDivisor(0, 0));
+
+	// The particle drawn by each instance, pointed at by the backend
+	GLCall(glEnableVertexAttribArray(1));
+	GLCall(glVertexAttribDivisor(1, 1));
+}
+
+ParticleBackend::~ParticleBackend() {
+}
+
+std::unique_ptr<ParticleBackend> ParticleBackend::Create(Type type, int capacity, ThreadPool* pool) {
+	switch (type) {
+	case Type::GPU: return std::unique_ptr<ParticleBackend>(new GpuParticleBackend(capacity));
+	default: return std::unique_ptr<ParticleBackend>(new CpuParticleBackend(capacity, pool));
+	}
+}
+
+const char* ParticleBackend::GetName(Type type) {
+	switch (type) {
+	case Type::GPU: return "GPU (transform feedback)";
+	default: return "CPU";
+	}
+}
+
+void ParticleBackend::GetSpawn(uint32_t id, const ParticleEmitter& emitter, glm::vec3& velocity, uint32_t& color, float& size) {
+	uint32_t state = id;
+	float x = Uniform(state) * 2.0f - 1.0f;
+	float y = Uniform(state) * 2.0f - 1.0f;
+	float z = Uniform(state) * 2.0f - 1.0f;
+	velocity = emitter.velocity + glm::vec3(x, y, z) * emitter.spread;
+	state = Hash(state);
+	color = (state & 0x00ffffffu) | (((state >> 24u) / 3u) << 24u);
+	size = emitter.minSize + Uniform(state) * (emitter.maxSize - emitter.minSize);
+}
+
+void ParticleBackend::DrawInstances(Shader& shader, unsigned int positionSizeTexture, unsigned int colorTexture, int firstPositionSize, int firstColor, int count) {
+	shader.SetUniform1i("u_PositionSize", 1);
+	shader.SetUniform1i("u_Colors", 2);
+	shader.SetUniform1i("u_FirstPositionSize", firstPositionSize);
+	shader.SetUniform1i("u_FirstColor", firstColor);
+	GLCall(glActiveTexture(GL_TEXTURE1));
+	GLCall(glBindTexture(GL_TEXTURE_BUFFER, positionSizeTexture));
+	GLCall(glActiveTexture(GL_TEXTURE2));
+	GLCall(glBindTexture(GL_TEXTURE_BUFFER, colorTexture));
+	GLCall(glActiveTexture(GL_TEXTURE0));
+
+	m_VAO->Bind();
+	GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count));
+}
+
+
+CpuParticleBackend::CpuParticleBackend(int capacity, ThreadPool* pool) : ParticleBackend(capacity), m_Pool(pool), m_Particles(capacity) {
+	// The positions/sizes and colors (normalized bytes) of the particles live in a streaming buffer, read by the
+	// vertex shader through texture buffers at the particle index given by attribute 1. The texture buffers cover
+	// the whole streaming buffer and the offsets are set each frame in Update once the region is known; the regions
+	// never grow, so they stay aligned for both formats
+	m_Stream = std::make_unique<StreamingBuffer>(GL_ARRAY_BUFFER, capacity * (POSITION_SIZE_BYTES + COLOR_BYTES + INDEX_BYTES));
+	GLCall(glGenTextures(1, &m_PositionSizeTexture));
+	GLCall(glGenTextures(1, &m_ColorTexture));
+}
+
+CpuParticleBackend::~CpuParticleBackend() {
+	GLCall(glDeleteTextures(1, &m_PositionSizeTexture));
+	GLCall(glDeleteTextures(1, &m_ColorTexture));
+}
+
+void CpuParticleBackend::Update(float deltaTime, const ParticleEmitter& emitter, int numNew, const glm::vec3& eye) {
+	numNew = std::max(0, std::min(numNew, m_Capacity));
+
+	// Collide the particles with each other and with the ground plane before they move on
+	if (m_Settings.collisions) {
+		m_Collider.Collide(m_Particles.GetStreams(), m_Particles.GetCount(), m_Pool);
+	}
+
+	// Make room by killing the oldest particles, the ones with the least life left, as the GPU ring overwrites
+	// them. Killing moves the last particle into the hole, so the highest indices go first
+	const int excess = m_Particles.GetCount() + numNew - m_Capacity;
+	if (excess > 0) {
+		const float* life = m_Particles.GetChannel(ParticlePool::LIFE);
+		m_Oldest.resize(m_Particles.GetCount());
+		for (int i = 0; i < (int)m_Oldest.size(); i++) {
+			m_Oldest[i] = i;
+		}
+		std::nth_element(m_Oldest.begin(), m_Oldest.begin() + (excess - 1), m_Oldest.end(), [life](int a, int b) {
+			return life[a] < life[b] || (life[a] == life[b] && a < b);
+		});
+		std::sort(m_Oldest.begin(), m_Oldest.begin() + excess, std::greater<int>());
+		for (int k = 0; k < excess; k++) {
+			m_Particles.Kill(m_Oldest[k]);
+		}
+	}
+
+	for (int k = 0; k < numNew; k++) {
+		glm::vec3 velocity;
+		uint32_t color;
+		float size;
+		GetSpawn(m_NextSpawnId + (uint32_t)k, emitter, velocity, color, size);
+		m_Particles.Spawn(emitter.position, velocity, color, size, emitter.lifetime);
+	}
+	m_NextSpawnId += (uint32_t)numNew;
+
+	// Simulate the particles and write them into this frame's region of the streaming buffer in the same pass;
+	// the ones whose life runs out are written with no size and then removed from the pool
+	int count = m_Particles.GetCount();
+	unsigned char* streamData = (unsigned char*)m_Stream->Map(count * (POSITION_SIZE_BYTES + COLOR_BYTES + INDEX_BYTES));
+	m_Depths.resize(count);
+	ParticleOutput output;
+	output.positionSize = (float*)streamData;
+	output.colors = (uint32_t*)(streamData + count * POSITION_SIZE_BYTES);
+	output.depths = m_Depths.data();
+	output.eye = eye;
+	m_Particles.Update(deltaTime, emitter.acceleration, output, m_Pool);
+
+	// Draw back to front for blending: order the live particles by decreasing distance to the camera, and upload
+	// the order rather than moving the particle data
+	m_DrawCount = m_Sorter.Sort(m_Depths.data(), count, m_Settings.coherentSort ? ParticleSorter::Mode::Coherent : ParticleSorter::Mode::Radix);
+	const std::vector<int>& order = m_Sorter.GetOrder();
+	std::copy(order.begin(), order.end(), (GLint*)(streamData + count * (POSITION_SIZE_BYTES + COLOR_BYTES)));
+
+	// Point the texture buffers and the per instance index at the region just written
+	size_t positionOffset = m_Stream->Unmap();
+	size_t colorOffset = positionOffset + count * POSITION_SIZE_BYTES;
+	size_t indexOffset = colorOffset + count * COLOR_BYTES;
+	m_FirstPositionSize = (int)(positionOffset / POSITION_SIZE_BYTES);
+	m_FirstColor = (int)(colorOffset / COLOR_BYTES);
+	GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_PositionSizeTexture));
+	GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_Stream->GetRendererID()));
+	GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_ColorTexture));
+	GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, m_Stream->GetRendererID()));
+	m_VAO->Bind();
+	m_Stream->Bind();
+	GLCall(glVertexAttribIPointer(1, 1, GL_INT, 0, (void*)indexOffset));
+}
+
+void CpuParticleBackend::Draw(Shader& shader) {
+	DrawInstances(shader, m_PositionSizeTexture, m_ColorTexture, m_FirstPositionSize, m_FirstColor, m_DrawCount);
+	m_Stream->Fence();
+}
+
+
+GpuParticleBackend::GpuParticleBackend(int capacity) : ParticleBackend(capacity) {
+	m_SimulateShader = std::make_unique<Shader>("res/shaders/ParticleSimulate.shader");
+
+	// Both sets start out dead: no life and no size
+	const unsigned int streamBytes[NUM_STREAMS] = { POSITION_SIZE_BYTES, POSITION_SIZE_BYTES, COLOR_BYTES };
+	std::vector<unsigned char> zeros((size_t)capacity * POSITION_SIZE_BYTES, 0);
+	for (int set = 0; set < 2; set++) {
+		GLCall(glGenBuffers(NUM_STREAMS, m_Buffers[set]));
+		for (int s = 0; s < NUM_STREAMS; s++) {
+			GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[set][s]));
+			GLCall(glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * streamBytes[s], zeros.data(), GL_DYNAMIC_COPY));
+		}
+
+		// Input of the simulation pass reading this set
+		m_SimulateVAOs[set] = std::make_unique<VertexArray>();
+		m_SimulateVAOs[set]->Bind();
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[set][POSITION_SIZE]));
+		GLCall(glEnableVertexAttribArray(0));
+		GLCall(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, (void*)0));
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[set][VELOCITY_LIFE]));
+		GLCall(glEnableVertexAttribArray(1));
+		GLCall(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0));
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[set][COLOR]));
+		GLCall(glEnableVertexAttribArray(2));
+		GLCall(glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, 0, (void*)0));
+
+		// Texture buffers for drawing this set with the particle shader
+		GLCall(glGenTextures(2, m_Textures[set]));
+		GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_Textures[set][0]));
+		GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_Buffers[set][POSITION_SIZE]));
+		GLCall(glBindTexture(GL_TEXTURE_BUFFER, m_Textures[set][1]));
+		GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, m_Buffers[set][COLOR]));
+	}
+
+	// Instances draw the slots from the oldest batch onwards, which may wrap round the ring, so the slot indices go
+	// round twice and Draw starts the attribute at the oldest slot
+	std::vector<GLint> slots(2 * (size_t)capacity);
+	for (size_t i = 0; i < slots.size(); i++) {
+		slots[i] = (GLint)(i % capacity);
+	}
+	GLCall(glGenBuffers(1, &m_IndexBuffer));
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_IndexBuffer));
+	GLCall(glBufferData(GL_ARRAY_BUFFER, slots.size() * sizeof(GLint), slots.data(), GL_STATIC_DRAW));
+}
+
+GpuParticleBackend::~GpuParticleBackend() {
+	for (int set = 0; set < 2; set++) {
+		GLCall(glDeleteBuffers(NUM_STREAMS, m_Buffers[set]));
+		GLCall(glDeleteTextures(2, m_Textures[set]));
+	}
+	GLCall(glDeleteBuffers(1, &m_IndexBuffer));
+}
+
+/* The eye is not needed: the particles are not depth sorted */
+void GpuParticleBackend::Update(float deltaTime, const ParticleEmitter& emitter, int numNew, const glm::vec3& /*eye*/) {
+	numNew = std::max(0, std::min(numNew, m_Capacity));
+	if (m_Capacity == 0) {
+		return;
+	}
+
+	// Age the batches as the shader ages their particles, then add the new one and drop the particles it overwrote
+	// and the batches that died
+	for (Batch& batch : m_Batches) {
+		batch.life = batch.life > 0.0f ? batch.life - deltaTime : batch.life;
+	}
+	if (numNew > 0) {
+		m_Batches.push_back(Batch{ numNew, emitter.lifetime > 0.0f ? emitter.lifetime - deltaTime : emitter.lifetime });
+		m_Span += numNew;
+	}
+	while (m_Span > m_Capacity) {
+		Batch& oldest = m_Batches.front();
+		int overwritten = std::min(oldest.count, m_Span - m_Capacity);
+		oldest.count -= overwritten;
+		m_Span -= overwritten;
+		if (oldest.count == 0) {
+			m_Batches.pop_front();
+		}
+	}
+	while (!m_Batches.empty() && m_Batches.front().life <= 0.0f) {
+		m_Span -= m_Batches.front().count;
+		m_Batches.pop_front();
+	}
+	m_Count = 0;
+	for (const Batch& batch : m_Batches) {
+		m_Count += batch.life > 0.0f ? batch.count : 0;
+	}
+
+	m_SimulateShader->Bind();
+	m_SimulateShader->SetUniform1f("u_DeltaTime", deltaTime);
+	m_SimulateShader->SetUniform3f("u_VelocityStep", emitter.acceleration * deltaTime);
+	m_SimulateShader->SetUniform1ui("u_Capacity", (unsigned int)m_Capacity);
+	m_SimulateShader->SetUniform1ui("u_EmitFirst", (unsigned int)m_NextSlot);
+	m_SimulateShader->SetUniform1ui("u_EmitCount", (unsigned int)numNew);
+	m_SimulateShader->SetUniform1ui("u_SpawnBase", m_NextSpawnId);
+	m_SimulateShader->SetUniform3f("u_EmitterPosition", emitter.position);
+	m_SimulateShader->SetUniform3f("u_EmitterVelocity", emitter.velocity);
+	m_SimulateShader->SetUniform1f("u_Spread", emitter.spread);
+	m_SimulateShader->SetUniform1f("u_Lifetime", emitter.lifetime);
+	m_SimulateShader->SetUniform1f("u_MinSize", emitter.minSize);
+	m_SimulateShader->SetUniform1f("u_MaxSize", emitter.maxSize);
+
+	// One point per slot from the current set into the other one, with nothing rasterized
+	const int next = 1 - m_Current;
+	GLCall(glEnable(GL_RASTERIZER_DISCARD));
+	m_SimulateVAOs[m_Current]->Bind();
+	for (int s = 0; s < NUM_STREAMS; s++) {
+		GLCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, s, m_Buffers[next][s]));
+	}
+	GLCall(glBeginTransformFeedback(GL_POINTS));
+	GLCall(glDrawArrays(GL_POINTS, 0, m_Capacity));
+	GLCall(glEndTransformFeedback());
+	for (int s = 0; s < NUM_STREAMS; s++) {
+		GLCall(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, s, 0));
+	}
+	GLCall(glDisable(GL_RASTERIZER_DISCARD));
+
+	m_Current = next;
+	m_NextSlot = (m_NextSlot + numNew) % m_Capacity;
+	m_NextSpawnId += (uint32_t)numNew;
+}
+
+void GpuParticleBackend::Draw(Shader& shader) {
+	const int oldest = (m_NextSlot - m_Span + m_Capacity) % std::max(m_Capacity, 1);
+	m_VAO->Bind();
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_IndexBuffer));
+	GLCall(glVertexAttribIPointer(1, 1, GL_INT, 0, (void*)((size_t)oldest * INDEX_BYTES)));
+	DrawInstances(shader, m_Textures[m_Current][0], m_Textures[m_Current][1], 0, 0, m_Span);
+}
+
+void GpuParticleBackend::ReadBack(ParticlePool& pool) {
+	std::vector<glm::vec4> positionSize(m_Capacity), velocityLife(m_Capacity);
+	std::vector<uint32_t> colors(m_Capacity);
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[m_Current][POSITION_SIZE]));
+	GLCall(glGetBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_Capacity * POSITION_SIZE_BYTES, positionSize.data()));
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[m_Current][VELOCITY_LIFE]));
+	GLCall(glGetBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_Capacity * POSITION_SIZE_BYTES, velocityLife.data()));
+	GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_Buffers[m_Current][COLOR]));
+	GLCall(glGetBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_Capacity * COLOR_BYTES, colors.data()));
+
+	pool.SetCapacity(m_Capacity);
+	for (int i = 0; i < m_Capacity; i++) {
+		if (velocityLife[i].w > 0.0f) {
+			pool.Spawn(glm::vec3(positionSize[i]), glm::vec3(velocityLife[i]), colors[i], positionSize[i].w, velocityLife[i].w);
+		}
+	}
+}
+
+size_t GpuParticleBackend::GetMemoryUsage() const {
+	return 2 * (size_t)m_Capacity * (2 * POSITION_SIZE_BYTES + COLOR_BYTES) + 2 * (size_t)m_Capacity * INDEX_BYTES;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "particles/ParticleCollider.h"
+#include "particles/ParticlePool.h"
+#include "particles/ParticleSorter.h"
+
+class Shader;
+class StreamingBuffer;
+class ThreadPool;
+class VertexArray;
+class VertexBuffer;
+
+/* Where and how particles are spawned. Every backend spawns the same particles from the same emitter */
+struct ParticleEmitter {
+	glm::vec3 position = glm::vec3(0.0f, 0.0f, -20.0f);
+	glm::vec3 velocity = glm::vec3(0.0f, 10.0f, 0.0f);
+	float spread = 1.5f; //Largest random change of each velocity component
+	float lifetime = 5.0f;
+	float minSize = 0.1f, maxSize = 0.6f;
+	glm::vec3 acceleration = glm::vec3(0.0f, -9.81f * 0.5f, 0.0f);
+};
+
+/*
+	Simulates and draws particles with the particle shader. Each update spawns a number of particles from an
+	emitter and then advances every particle by the time step; the random velocity, colour and size of a particle
+	come from a hash of its spawn id (GetSpawn), so backends given the same emitters and time steps hold the same
+	particles, up to rounding, and ReadBack can compare them.
+*/
+class ParticleBackend {
+public:
+	enum class Type { CPU, GPU };
+	static const int NUM_TYPES = 2;
+
+	virtual ~ParticleBackend();
+
+	virtual Type GetType() const = 0;
+
+	/*
+		Spawns numNew particles (no more than the capacity), replacing the oldest ones if there is no room, and
+		advances all the particles by deltaTime. eye is the camera position
+	*/
+	virtual void Update(float deltaTime, const ParticleEmitter& emitter, int numNew, const glm::vec3& eye) = 0;
+
+	/* Draws the particles; the shader is bound and has its camera uniforms set */
+	virtual void Draw(Shader& shader) = 0;
+
+	/* Copies the live particles into pool, in no particular order */
+	virtual void ReadBack(ParticlePool& pool) = 0;
+
+	virtual int GetCount() const = 0;
+	inline int GetCapacity() const { return m_Capacity; }
+	virtual size_t GetMemoryUsage() const = 0;
+
+	static std::unique_ptr<ParticleBackend> Create(Type type, int capacity, ThreadPool* pool = nullptr);
+	static const char* GetName(Type type);
+
+	/* Random part of the particle with the given spawn id. Mirrored by res/shaders/ParticleSimulate.shader */
+	static void GetSpawn(uint32_t id, const ParticleEmitter& emitter, glm::vec3& velocity, uint32_t& color, float& size);
+
+protected:
+	int m_Capacity;
+	uint32_t m_NextSpawnId = 0;
+	/* Billboard quad as attribute 0, and attribute 1 left for the per instance particle index */
+	std::unique_ptr<VertexArray> m_VAO;
+	std::unique_ptr<VertexBuffer> m_QuadBuffer;
+
+	explicit ParticleBackend(int capacity);
+
+	/* Binds the texture buffers of the particle data to units 1 and 2 and draws count instances */
+	void DrawInstances(Shader& shader, unsigned int positionSizeTexture, unsigned int colorTexture, int firstPositionSize, int firstColor, int count);
+};
+
+/*
+	Simulation on the CPU in a ParticlePool, optionally with collisions, and depth sorted for blending. The pool
+	writes the particles into a region of a streaming buffer in the same pass, together with the draw order.
+
+	A full pool makes room by killing the particles with the least life left. The pool keeps no spawn order, so
+	among particles spawned by the same update the ones killed may differ from the ones the GPU ring overwrites.
+*/
+class CpuParticleBackend : public ParticleBackend {
+public:
+	struct Settings {
+		bool collisions = true; //Ground plane, and each other if the collider says so
+		bool coherentSort = false;
+	};
+
+	CpuParticleBackend(int capacity, ThreadPool* pool = nullptr);
+	~CpuParticleBackend();
+
+	Type GetType() const override { return Type::CPU; }
+	void Update(float deltaTime, const ParticleEmitter& emitter, int numNew, const glm::vec3& eye) override;
+	void Draw(Shader& shader) override;
+	void ReadBack(ParticlePool& pool) override { pool = m_Particles; }
+	int GetCount() const override { return m_Particles.GetCount(); }
+	size_t GetMemoryUsage() const override { return m_Particles.GetMemoryUsage(); }
+
+	inline Settings& GetSettings() { return m_Settings; }
+	inline ParticleCollider& GetCollider() { return m_Collider; }
+	inline const ParticleSorter& GetSorter() const { return m_Sorter; }
+	inline const StreamingBuffer& GetStream() const { return *m_Stream; }
+
+private:
+	Settings m_Settings;
+	ThreadPool* m_Pool;
+	ParticlePool m_Particles;
+	ParticleCollider m_Collider;
+	ParticleSorter m_Sorter;
+	std::vector<float> m_Depths; //Squared distance of each particle to the camera, as written by the last update
+	std::vector<int> m_Oldest; //Scratch for picking the particles to kill when the pool is full
+	int m_DrawCount = 0;
+	std::unique_ptr<StreamingBuffer> m_Stream;
+	unsigned int m_PositionSizeTexture = 0, m_ColorTexture = 0; //Texture buffers over the stream
+	int m_FirstPositionSize = 0, m_FirstColor = 0; //Texels of this frame's region
+};
+
+/*
+	Simulation on the GPU with transform feedback (GL 3.3): the particle state stays in two sets of vertex buffers,
+	and every update runs res/shaders/ParticleSimulate.shader over one set with rasterization off, capturing the
+	result into the other. The CPU only sets the emitter uniforms.
+
+	The slots form a ring: each update respawns the next numNew slots, overwriting the oldest particles if the ring
+	is full. Particles are drawn straight from the state, oldest first with no depth sort, and a dead particle keeps
+	its slot with a size of 0 until it is respawned. The CPU keeps the spawn time of every batch, so it knows which
+	slots hold live particles without reading anything back.
+*/
+class GpuParticleBackend : public ParticleBackend {
+public:
+	explicit GpuParticleBackend(int capacity);
+	~GpuParticleBackend();
+
+	Type GetType() const override { return Type::GPU; }
+	void Update(float deltaTime, const ParticleEmitter& emitter, int numNew, const glm::vec3& eye) override;
+	void Draw(Shader& shader) override;
+	void ReadBack(ParticlePool& pool) override;
+	int GetCount() const override { return m_Count; }
+	size_t GetMemoryUsage() const override;
+
+private:
+	enum Stream { POSITION_SIZE, VELOCITY_LIFE, COLOR, NUM_STREAMS };
+
+	/* Particles spawned by one update, in consecutive slots */
+	struct Batch {
+		int count;
+		float life;
+	};
+
+	std::unique_ptr<Shader> m_SimulateShader;
+	unsigned int m_Buffers[2][NUM_STREAMS] = {}; //Two sets of state, read and written in turn
+	std::unique_ptr<VertexArray> m_SimulateVAOs[2];
+	unsigned int m_Textures[2][2] = {}; //Position and size, colour texture buffers over each set
+	unsigned int m_IndexBuffer = 0; //Slot of every instance, twice round the ring
+	int m_Current = 0; //Set holding the current state
+	int m_NextSlot = 0;
+	std::deque<Batch> m_Batches; //From the oldest batch with live particles
+	int m_Count = 0, m_Span = 0; //Live particles, and slots from the oldest batch to the next slot
+};
@@ -0,0 +1,87 @@
+#include "ParticleCollider.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/ThreadPool.h"
+
+void ParticleCollider::Collide(const ParticleStreams& streams, int count, ThreadPool* pool) {
+	const int blockSize = SpatialHashGrid::BLOCK_SIZE;
+	const int numBlocks = (count + blockSize - 1) / blockSize;
+	const float restitution = m_Settings.restitution;
+	const float ground = m_Settings.groundHeight;
+	m_NumContacts = 0;
+
+	float maxSize = 0.0f;
+	for (int i = 0; i < count; i++) {
+		maxSize = std::max(maxSize, streams.size[i]);
+	}
+	if (!m_Settings.particleCollisions || maxSize <= 0.0f) {
+		m_Grid.Clear();
+		ThreadPool::RunTasks(pool, numBlocks, [&](int block) {
+			for (int i = block * blockSize, end = std::min(i + blockSize, count); i < end; i++) {
+				float radius = 0.5f * streams.size[i];
+				if (streams.py[i] - radius < ground) {
+					streams.py[i] = ground + radius;
+					streams.vy[i] = streams.vy[i] < 0.0f ? -streams.vy[i] * restitution : streams.vy[i];
+				}
+			}
+		});
+		return;
+	}
+
+	/* Particles touch when their centres are closer than the sum of their radii, which is at most maxSize */
+	m_Grid.Build(streams.px, streams.py, streams.pz, count, maxSize, pool);
+	const std::vector<int>& order = m_Grid.GetOrder();
+	for (int axis = 0; axis < 3; axis++) {
+		m_Velocity[axis].resize(count);
+	}
+	m_Size.resize(count);
+	ThreadPool::RunTasks(pool, numBlocks, [&](int block) {
+		for (int slot = block * blockSize, end = std::min(slot + blockSize, count); slot < end; slot++) {
+			int i = order[slot];
+			m_Velocity[0][slot] = streams.vx[i]; m_Velocity[1][slot] = streams.vy[i]; m_Velocity[2][slot] = streams.vz[i];
+			m_Size[slot] = streams.size[i];
+		}
+	});
+
+	m_BlockContacts.assign(numBlocks, 0);
+	ThreadPool::RunTasks(pool, numBlocks, [&](int block) {
+		int contacts = 0;
+		for (int slot = block * blockSize, end = std::min(slot + blockSize, count); slot < end; slot++) {
+			const glm::vec3 position = m_Grid.GetPosition(slot);
+			const glm::vec3 velocity(m_Velocity[0][slot], m_Velocity[1][slot], m_Velocity[2][slot]);
+			const float size = m_Size[slot];
+			glm::vec3 push(0.0f), impulse(0.0f);
+			m_Grid.ForEachNeighbour(position, 0.5f * (size + maxSize), [&](int other, float distanceSquared) {
+				const float reach = 0.5f * (size + m_Size[other]);
+				if (other == slot || distanceSquared >= reach * reach) {
+					return;
+				}
+				/* Particles at the same point are split along y, in slot order */
+				const float distance = std::sqrt(distanceSquared);
+				const glm::vec3 normal = distance > 0.0f ? (position - m_Grid.GetPosition(other)) / distance : glm::vec3(0.0f, other < slot ? 1.0f : -1.0f, 0.0f);
+				push += normal * (0.5f * (reach - distance));
+				const float approach = glm::dot(velocity - glm::vec3(m_Velocity[0][other], m_Velocity[1][other], m_Velocity[2][other]), normal);
+				if (approach < 0.0f) {
+					impulse -= normal * (0.5f * (1.0f + restitution) * approach);
+				}
+				contacts += other < slot ? 1 : 0;
+			});
+
+			const int i = order[slot];
+			glm::vec3 p = position + push, v = velocity + impulse;
+			const float radius = 0.5f * size;
+			if (p.y - radius < ground) {
+				p.y = ground + radius;
+				v.y = v.y < 0.0f ? -v.y * restitution : v.y;
+			}
+			streams.px[i] = p.x; streams.py[i] = p.y; streams.pz[i] = p.z;
+			streams.vx[i] = v.x; streams.vy[i] = v.y; streams.vz[i] = v.z;
+		}
+		m_BlockContacts[block] = contacts;
+	});
+	for (int contacts : m_BlockContacts) {
+		m_NumContacts += contacts;
+	}
+}
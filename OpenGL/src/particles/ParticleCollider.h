@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "particles/ParticleKernels.h"
+#include "particles/SpatialHashGrid.h"
+
+class ThreadPool;
+
+/*
+	Collisions of particles with each other and with a horizontal ground plane, treating every particle as a sphere
+	as wide as its billboard. Run on the particle streams between simulation steps: the particles are hashed into a
+	SpatialHashGrid with cells as large as the largest particle, and each one is resolved against its neighbours.
+
+	Every particle is resolved against the state from before the pass (Jacobi rather than Gauss-Seidel): it moves
+	halfway out of every particle it overlaps, and gives up its share of the approaching velocity along each contact
+	normal, scaled by the restitution, as the particles have equal mass. Particles only write themselves, so the pass
+	runs in parallel in cell order and the result does not depend on the number of threads.
+*/
+class ParticleCollider {
+public:
+	struct Settings {
+		bool particleCollisions = true;
+		float restitution = 0.3f;
+		float groundHeight = 0.0f;
+	};
+
+	/* Resolves the count particles of the streams in place */
+	void Collide(const ParticleStreams& streams, int count, ThreadPool* pool = nullptr);
+
+	inline Settings& GetSettings() { return m_Settings; }
+	inline const SpatialHashGrid& GetGrid() const { return m_Grid; }
+	/* Overlapping pairs found by the last pass, each counted once */
+	inline int GetNumContacts() const { return m_NumContacts; }
+
+private:
+	Settings m_Settings;
+	SpatialHashGrid m_Grid;
+	std::vector<float> m_Velocity[3]; //In slot order, from before the pass
+	std::vector<float> m_Size; //In slot order
+	std::vector<int> m_BlockContacts;
+	int m_NumContacts = 0;
+};
@@ -0,0 +1,183 @@
+#include "ParticleKernels.h"
+
+#include <cstring>
+
+#include "util/CpuFeatures.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Every path must round exactly like the scalar one, so GCC may not fuse the multiplies and adds (MSVC never does) */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+static int SimulateScalar(const ParticleStreams& s, int begin, int end, float dt, const glm::vec3& acceleration, const ParticleOutput& out) {
+	const float dvx = acceleration.x * dt, dvy = acceleration.y * dt, dvz = acceleration.z * dt;
+	int dead = 0;
+	for (int i = begin; i < end; i++) {
+		float life = s.life[i] - dt;
+		float vx = s.vx[i] + dvx, vy = s.vy[i] + dvy, vz = s.vz[i] + dvz;
+		float px = s.px[i] + vx * dt, py = s.py[i] + vy * dt, pz = s.pz[i] + vz * dt;
+		s.life[i] = life;
+		s.vx[i] = vx; s.vy[i] = vy; s.vz[i] = vz;
+		s.px[i] = px; s.py[i] = py; s.pz[i] = pz;
+
+		bool alive = life > 0.0f;
+		dead += alive ? 0 : 1;
+		if (out.positionSize != nullptr) {
+			float* ps = out.positionSize + (size_t)i * 4;
+			ps[0] = px; ps[1] = py; ps[2] = pz; ps[3] = alive ? s.size[i] : 0.0f;
+		}
+		if (out.depths != nullptr) {
+			float dx = px - out.eye.x, dy = py - out.eye.y, dz = pz - out.eye.z;
+			out.depths[i] = alive ? dx * dx + dy * dy + dz * dz : -1.0f;
+		}
+	}
+	return dead;
+}
+
+#if SIMD_X86
+/* Number of lanes cleared in a movemask result */
+static inline int CountCleared(int mask, int numLanes) {
+	int set = 0;
+	for (; mask != 0; mask &= mask - 1) {
+		set++;
+	}
+	return numLanes - set;
+}
+
+static int SimulateSSE(const ParticleStreams& s, int begin, int end, float dt, const glm::vec3& acceleration, const ParticleOutput& out) {
+	const __m128 dt4 = _mm_set1_ps(dt), zero = _mm_setzero_ps();
+	const __m128 dvx = _mm_set1_ps(acceleration.x * dt), dvy = _mm_set1_ps(acceleration.y * dt), dvz = _mm_set1_ps(acceleration.z * dt);
+	const __m128 ex = _mm_set1_ps(out.eye.x), ey = _mm_set1_ps(out.eye.y), ez = _mm_set1_ps(out.eye.z), minusOne = _mm_set1_ps(-1.0f);
+
+	int dead = 0;
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 life = _mm_sub_ps(_mm_loadu_ps(s.life + i), dt4);
+		__m128 vx = _mm_add_ps(_mm_loadu_ps(s.vx + i), dvx), vy = _mm_add_ps(_mm_loadu_ps(s.vy + i), dvy), vz = _mm_add_ps(_mm_loadu_ps(s.vz + i), dvz);
+		__m128 px = _mm_add_ps(_mm_loadu_ps(s.px + i), _mm_mul_ps(vx, dt4));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(s.py + i), _mm_mul_ps(vy, dt4));
+		__m128 pz = _mm_add_ps(_mm_loadu_ps(s.pz + i), _mm_mul_ps(vz, dt4));
+		_mm_storeu_ps(s.life + i, life);
+		_mm_storeu_ps(s.vx + i, vx); _mm_storeu_ps(s.vy + i, vy); _mm_storeu_ps(s.vz + i, vz);
+		_mm_storeu_ps(s.px + i, px); _mm_storeu_ps(s.py + i, py); _mm_storeu_ps(s.pz + i, pz);
+
+		__m128 alive = _mm_cmpgt_ps(life, zero);
+		dead += CountCleared(_mm_movemask_ps(alive), 4);
+		if (out.positionSize != nullptr) {
+			__m128 x = px, y = py, z = pz, w = _mm_and_ps(_mm_loadu_ps(s.size + i), alive);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			float* ps = out.positionSize + (size_t)i * 4;
+			_mm_storeu_ps(ps + 0, x); _mm_storeu_ps(ps + 4, y); _mm_storeu_ps(ps + 8, z); _mm_storeu_ps(ps + 12, w);
+		}
+		if (out.depths != nullptr) {
+			__m128 dx = _mm_sub_ps(px, ex), dy = _mm_sub_ps(py, ey), dz = _mm_sub_ps(pz, ez);
+			__m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			_mm_storeu_ps(out.depths + i, _mm_or_ps(_mm_and_ps(alive, depth), _mm_andnot_ps(alive, minusOne)));
+		}
+	}
+	return dead + SimulateScalar(s, i, end, dt, acceleration, out);
+}
+
+/* Transposes four rows of eight lanes: the low half of rk is the 4-vector for lane k, the high half for lane k + 4 */
+TARGET_AVX2 static inline void Transpose4x8(__m256 a, __m256 b, __m256 c, __m256 d, __m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+	__m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpackhi_ps(a, b);
+	__m256 t2 = _mm256_unpacklo_ps(c, d), t3 = _mm256_unpackhi_ps(c, d);
+	r0 = _mm256_shuffle_ps(t0, t2, 0x44);
+	r1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+	r2 = _mm256_shuffle_ps(t1, t3, 0x44);
+	r3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+}
+
+TARGET_AVX2 static int SimulateAVX2(const ParticleStreams& s, int begin, int end, float dt, const glm::vec3& acceleration, const ParticleOutput& out) {
+	const __m256 dt8 = _mm256_set1_ps(dt), zero = _mm256_setzero_ps();
+	const __m256 dvx = _mm256_set1_ps(acceleration.x * dt), dvy = _mm256_set1_ps(acceleration.y * dt), dvz = _mm256_set1_ps(acceleration.z * dt);
+	const __m256 ex = _mm256_set1_ps(out.eye.x), ey = _mm256_set1_ps(out.eye.y), ez = _mm256_set1_ps(out.eye.z), minusOne = _mm256_set1_ps(-1.0f);
+
+	int dead = 0;
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 life = _mm256_sub_ps(_mm256_loadu_ps(s.life + i), dt8);
+		__m256 vx = _mm256_add_ps(_mm256_loadu_ps(s.vx + i), dvx), vy = _mm256_add_ps(_mm256_loadu_ps(s.vy + i), dvy), vz = _mm256_add_ps(_mm256_loadu_ps(s.vz + i), dvz);
+		__m256 px = _mm256_add_ps(_mm256_loadu_ps(s.px + i), _mm256_mul_ps(vx, dt8));
+		__m256 py = _mm256_add_ps(_mm256_loadu_ps(s.py + i), _mm256_mul_ps(vy, dt8));
+		__m256 pz = _mm256_add_ps(_mm256_loadu_ps(s.pz + i), _mm256_mul_ps(vz, dt8));
+		_mm256_storeu_ps(s.life + i, life);
+		_mm256_storeu_ps(s.vx + i, vx); _mm256_storeu_ps(s.vy + i, vy); _mm256_storeu_ps(s.vz + i, vz);
+		_mm256_storeu_ps(s.px + i, px); _mm256_storeu_ps(s.py + i, py); _mm256_storeu_ps(s.pz + i, pz);
+
+		__m256 alive = _mm256_cmp_ps(life, zero, _CMP_GT_OQ);
+		dead += CountCleared(_mm256_movemask_ps(alive), 8);
+		if (out.positionSize != nullptr) {
+			__m256 r[4];
+			Transpose4x8(px, py, pz, _mm256_and_ps(_mm256_loadu_ps(s.size + i), alive), r[0], r[1], r[2], r[3]);
+			float* ps = out.positionSize + (size_t)i * 4;
+			for (int k = 0; k < 4; k++) {
+				_mm_storeu_ps(ps + k * 4, _mm256_castps256_ps128(r[k]));
+				_mm_storeu_ps(ps + (k + 4) * 4, _mm256_extractf128_ps(r[k], 1));
+			}
+		}
+		if (out.depths != nullptr) {
+			__m256 dx = _mm256_sub_ps(px, ex), dy = _mm256_sub_ps(py, ey), dz = _mm256_sub_ps(pz, ez);
+			__m256 depth = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+			_mm256_storeu_ps(out.depths + i, _mm256_blendv_ps(minusOne, depth, alive));
+		}
+	}
+	return dead + SimulateSSE(s, i, end, dt, acceleration, out);
+}
+#endif
+
+int ParticleKernels::Simulate(const ParticleStreams& streams, int begin, int end, float deltaTime, const glm::vec3& acceleration,
+	const ParticleOutput& output, Path path) {
+	if (begin >= end) {
+		return 0;
+	}
+	if (output.colors != nullptr) {
+		std::memcpy(output.colors + begin, streams.colors + begin, (size_t)(end - begin) * sizeof(uint32_t));
+	}
+
+	if (!IsSupported(path)) {
+		path = GetBestPath();
+	}
+#if SIMD_X86
+	if (path == Path::AVX2) {
+		return SimulateAVX2(streams, begin, end, deltaTime, acceleration, output);
+	}
+	if (path == Path::SSE) {
+		return SimulateSSE(streams, begin, end, deltaTime, acceleration, output);
+	}
+#endif
+	return SimulateScalar(streams, begin, end, deltaTime, acceleration, output);
+}
+
+ParticleKernels::Path ParticleKernels::GetBestPath() {
+	if (IsSupported(Path::AVX2)) {
+		return Path::AVX2;
+	}
+	if (IsSupported(Path::SSE)) {
+		return Path::SSE;
+	}
+	return Path::Scalar;
+}
+
+bool ParticleKernels::IsSupported(Path path) {
+	switch (path) {
+#if SIMD_X86
+	case Path::SSE: return CpuFeatures::Get().sse2;
+	case Path::AVX2: return CpuFeatures::Get().avx2;
+#endif
+	case Path::Scalar: return true;
+	default: return false;
+	}
+}
+
+const char* ParticleKernels::GetName(Path path) {
+	switch (path) {
+	case Path::SSE: return "SSE";
+	case Path::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
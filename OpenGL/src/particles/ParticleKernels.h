@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+/* Particle state as one array per component, each pointer addressing the same range of particles */
+struct ParticleStreams {
+	float* px = nullptr; float* py = nullptr; float* pz = nullptr;
+	float* vx = nullptr; float* vy = nullptr; float* vz = nullptr;
+	float* life = nullptr;
+	const float* size = nullptr;
+	const uint32_t* colors = nullptr;
+};
+
+/*
+	Where a simulation pass writes the particles as it goes, indexed like the streams; any pointer may be null.
+	positionSize takes x, y, z, size floats per particle and colors the packed RGBA colours, the layout of the
+	particle shader; depths takes the squared distance to eye, or -1 for a particle that died.
+*/
+struct ParticleOutput {
+	float* positionSize = nullptr;
+	uint32_t* colors = nullptr;
+	float* depths = nullptr;
+	glm::vec3 eye = glm::vec3(0.0f);
+};
+
+/*
+	Fused particle update: ages the particles, integrates them under a constant acceleration (semi-implicit Euler)
+	and writes them to the output in the same pass, so each particle is read from memory once per frame.
+	Particles whose life runs out are written with a size of 0, which draws nothing, and are only counted: the
+	caller removes them afterwards.
+
+	The SIMD paths handle 4 (SSE) or 8 (AVX2) particles at a time, one per lane, and transpose the lanes to write
+	the interleaved positions and sizes. Every particle is independent and no path contracts into FMA, so all paths
+	give identical results, however the range is split between threads.
+*/
+class ParticleKernels {
+public:
+	enum class Path { Scalar, SSE, AVX2 };
+
+	/* Particles per task when a pass is split across a thread pool */
+	static const int BLOCK_SIZE = 4096;
+
+	/* Simulates particles [begin, end) and returns how many of them died */
+	static int Simulate(const ParticleStreams& streams, int begin, int end, float deltaTime, const glm::vec3& acceleration,
+		const ParticleOutput& output, Path path);
+	static int Simulate(const ParticleStreams& streams, int begin, int end, float deltaTime, const glm::vec3& acceleration,
+		const ParticleOutput& output) {
+		return Simulate(streams, begin, end, deltaTime, acceleration, output, GetBestPath());
+	}
+
+	static Path GetBestPath();
+	static bool IsSupported(Path path);
+	static const char* GetName(Path path);
+};
@@ -0,0 +1,114 @@
+#include "ParticlePool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/ThreadPool.h"
+
+ParticlePool::ParticlePool(int capacity) {
+	SetCapacity(capacity);
+}
+
+void ParticlePool::SetCapacity(int capacity) {
+	m_Capacity = capacity;
+	m_Count = 0;
+	for (int c = 0; c < NUM_CHANNELS; c++) {
+		m_Channels[c].assign(capacity, 0.0f);
+	}
+	m_Colors.assign(capacity, 0u);
+}
+
+int ParticlePool::Spawn(const glm::vec3& position, const glm::vec3& velocity, uint32_t color, float size, float life) {
+	if (m_Count == m_Capacity) {
+		return -1;
+	}
+	int i = m_Count++;
+	m_Channels[POSITION_X][i] = position.x; m_Channels[POSITION_Y][i] = position.y; m_Channels[POSITION_Z][i] = position.z;
+	m_Channels[VELOCITY_X][i] = velocity.x; m_Channels[VELOCITY_Y][i] = velocity.y; m_Channels[VELOCITY_Z][i] = velocity.z;
+	m_Channels[SIZE][i] = size;
+	m_Channels[LIFE][i] = life;
+	m_Colors[i] = color;
+	return i;
+}
+
+void ParticlePool::Kill(int index) {
+	int last = --m_Count;
+	if (index != last) {
+		for (int c = 0; c < NUM_CHANNELS; c++) {
+			m_Channels[c][index] = m_Channels[c][last];
+		}
+		m_Colors[index] = m_Colors[last];
+	}
+}
+
+int ParticlePool::Update(float deltaTime, const glm::vec3& acceleration, const ParticleOutput& output, ThreadPool* pool) {
+	const int count = m_Count;
+	const int blockSize = ParticleKernels::BLOCK_SIZE;
+	const int numBlocks = (count + blockSize - 1) / blockSize;
+	const ParticleStreams streams = GetStreams();
+	m_BlockDeaths.assign(numBlocks, 0);
+	auto simulate = [&](int block) {
+		int begin = block * blockSize;
+		int end = std::min(begin + blockSize, count);
+		m_BlockDeaths[block] = ParticleKernels::Simulate(streams, begin, end, deltaTime, acceleration, output);
+	};
+	ThreadPool::RunTasks(pool, numBlocks, simulate);
+
+	/* Compact from the back, skipping the blocks where nothing died, so each particle moved into a freed slot has already been checked */
+	const float* life = m_Channels[LIFE].data();
+	int killed = 0;
+	for (int block = numBlocks - 1; block >= 0; block--) {
+		if (m_BlockDeaths[block] == 0) {
+			continue;
+		}
+		int begin = block * blockSize;
+		for (int i = std::min(begin + blockSize, count) - 1; i >= begin; i--) {
+			if (life[i] <= 0.0f) {
+				Kill(i);
+				killed++;
+			}
+		}
+	}
+	return killed;
+}
+
+ParticleStreams ParticlePool::GetStreams() {
+	ParticleStreams streams;
+	streams.px = m_Channels[POSITION_X].data(); streams.py = m_Channels[POSITION_Y].data(); streams.pz = m_Channels[POSITION_Z].data();
+	streams.vx = m_Channels[VELOCITY_X].data(); streams.vy = m_Channels[VELOCITY_Y].data(); streams.vz = m_Channels[VELOCITY_Z].data();
+	streams.life = m_Channels[LIFE].data();
+	streams.size = m_Channels[SIZE].data();
+	streams.colors = m_Colors.data();
+	return streams;
+}
+
+void ParticlePool::Pack(float* positionSize, uint32_t* colors, const int* order) const {
+	const float* px = m_Channels[POSITION_X].data(); const float* py = m_Channels[POSITION_Y].data(); const float* pz = m_Channels[POSITION_Z].data();
+	const float* size = m_Channels[SIZE].data();
+	if (order == nullptr) {
+		for (int i = 0; i < m_Count; i++) {
+			positionSize[4 * i + 0] = px[i];
+			positionSize[4 * i + 1] = py[i];
+			positionSize[4 * i + 2] = pz[i];
+			positionSize[4 * i + 3] = size[i];
+		}
+		std::memcpy(colors, m_Colors.data(), m_Count * sizeof(uint32_t));
+		return;
+	}
+	for (int i = 0; i < m_Count; i++) {
+		int p = order[i];
+		positionSize[4 * i + 0] = px[p];
+		positionSize[4 * i + 1] = py[p];
+		positionSize[4 * i + 2] = pz[p];
+		positionSize[4 * i + 3] = size[p];
+		colors[i] = m_Colors[p];
+	}
+}
+
+size_t ParticlePool::GetMemoryUsage() const {
+	size_t bytes = m_Colors.capacity() * sizeof(uint32_t);
+	for (int c = 0; c < NUM_CHANNELS; c++) {
+		bytes += m_Channels[c].capacity() * sizeof(float);
+	}
+	return bytes;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "particles/ParticleKernels.h"
+
+class ThreadPool;
+
+/*
+	Fixed-capacity particle storage, one array per component. The live particles are always packed at the front,
+	[0, GetCount()), so spawning appends and killing moves the last live particle into the freed slot: both are
+	O(1), and every pass over the particles touches only the live ones. Killing reorders the particles, so indices
+	are only stable until the next Kill or Update.
+*/
+class ParticlePool {
+public:
+	enum Channel { POSITION_X, POSITION_Y, POSITION_Z, VELOCITY_X, VELOCITY_Y, VELOCITY_Z, SIZE, LIFE, NUM_CHANNELS };
+
+	explicit ParticlePool(int capacity = 0);
+
+	/* Resizes the storage and kills every particle */
+	void SetCapacity(int capacity);
+	void Clear() { m_Count = 0; }
+
+	/* Returns the index of the new particle, or -1 if the pool is full. The colour is RGBA, one byte each in memory order */
+	int Spawn(const glm::vec3& position, const glm::vec3& velocity, uint32_t color, float size, float life);
+	void Kill(int index);
+
+	/*
+		Ages the particles by deltaTime, moves them under a constant acceleration and writes them to output, all
+		in one pass of ParticleKernels::Simulate per block of particles (in parallel with a pool), then kills
+		those whose life has run out. The output is indexed by the particles as they were before the update, so
+		it holds GetCount() particles as counted beforehand, the dead ones with a size of 0. The result does not
+		depend on the number of threads. Returns the number of particles killed.
+	*/
+	int Update(float deltaTime, const glm::vec3& acceleration, const ParticleOutput& output = ParticleOutput(), ThreadPool* pool = nullptr);
+
+	/*
+		Writes the live particles in the layout of the particle shader: x, y, z, size floats to positionSize and
+		RGBA bytes to colors. With an order (GetCount() indices), particle order[i] is written i-th.
+	*/
+	void Pack(float* positionSize, uint32_t* colors, const int* order = nullptr) const;
+
+	inline int GetCount() const { return m_Count; }
+	inline int GetCapacity() const { return m_Capacity; }
+	inline bool IsFull() const { return m_Count == m_Capacity; }
+
+	ParticleStreams GetStreams();
+
+	inline float* GetChannel(Channel channel) { return m_Channels[channel].data(); }
+	inline const float* GetChannel(Channel channel) const { return m_Channels[channel].data(); }
+	inline uint32_t* GetColors() { return m_Colors.data(); }
+	inline const uint32_t* GetColors() const { return m_Colors.data(); }
+	inline glm::vec3 GetPosition(int index) const {
+		return glm::vec3(m_Channels[POSITION_X][index], m_Channels[POSITION_Y][index], m_Channels[POSITION_Z][index]);
+	}
+
+	size_t GetMemoryUsage() const;
+
+private:
+	int m_Count = 0;
+	int m_Capacity = 0;
+	std::vector<float> m_Channels[NUM_CHANNELS];
+	std::vector<uint32_t> m_Colors;
+	std::vector<int> m_BlockDeaths; //Per block of the last update
+};
@@ -0,0 +1,162 @@
+#include "ParticleSorter.h"
+
+#include <algorithm>
+#include <cstring>
+
+/* Farther particles get smaller keys; depth must not be negative */
+static inline uint32_t DepthKey(float depth) {
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return ~bits;
+}
+
+void ParticleSorter::RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch) {
+	const int DIGIT_BITS = 11;
+	const int NUM_BUCKETS = 1 << DIGIT_BITS;
+	const int NUM_DIGITS = 3;
+	const int count = (int)entries.size();
+	if (count < 2) {
+		return;
+	}
+
+	/* Histograms of every digit in one pass over the keys */
+	std::vector<int> offsets(NUM_DIGITS * NUM_BUCKETS, 0);
+	for (const Entry& entry : entries) {
+		for (int d = 0; d < NUM_DIGITS; d++) {
+			offsets[d * NUM_BUCKETS + ((entry.key >> (d * DIGIT_BITS)) & (NUM_BUCKETS - 1))]++;
+		}
+	}
+
+	scratch.resize(count);
+	for (int d = 0; d < NUM_DIGITS; d++) {
+		int* digitOffsets = offsets.data() + d * NUM_BUCKETS;
+		const int shift = d * DIGIT_BITS;
+		if (digitOffsets[(entries[0].key >> shift) & (NUM_BUCKETS - 1)] == count) {
+			continue;
+		}
+		int sum = 0;
+		for (int b = 0; b < NUM_BUCKETS; b++) {
+			int bucketCount = digitOffsets[b];
+			digitOffsets[b] = sum;
+			sum += bucketCount;
+		}
+		for (const Entry& entry : entries) {
+			scratch[digitOffsets[(entry.key >> shift) & (NUM_BUCKETS - 1)]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
+int ParticleSorter::Sort(const float* depths, int count, Mode mode) {
+	m_Coherent = false;
+	if (mode == Mode::Coherent) {
+		if (m_SortsUntilRetry > 0) {
+			m_SortsUntilRetry--;
+		} else if (SortCoherent(depths, count)) {
+			m_Coherent = true;
+			return (int)m_Order.size();
+		} else {
+			m_SortsUntilRetry = RETRY_INTERVAL;
+		}
+	}
+
+	/* Live particles in slot order, so the stable sort breaks ties by index */
+	m_Entries.clear();
+	for (int i = 0; i < count; i++) {
+		if (depths[i] >= 0.0f) {
+			m_Entries.push_back(Entry{ DepthKey(depths[i]), i });
+		}
+	}
+	RadixSort(m_Entries, m_Scratch);
+
+	const int numLive = (int)m_Entries.size();
+	m_Order.resize(numLive);
+	for (int i = 0; i < numLive; i++) {
+		m_Order[i] = m_Entries[i].index;
+	}
+	m_NumDisplaced = numLive;
+	return numLive;
+}
+
+bool ParticleSorter::SortCoherent(const float* depths, int count) {
+	const int maxDisplaced = count / MAX_DISPLACED_DIVISOR;
+	m_Seen.assign(count, 0);
+
+	/* The previous order without the particles that died or are gone, keyed by their new depths */
+	m_Scratch.clear();
+	for (int index : m_Order) {
+		if (index < count && depths[index] >= 0.0f) {
+			m_Seen[index] = 1;
+			m_Scratch.push_back(Entry{ DepthKey(depths[index]), index });
+		}
+	}
+
+	/*
+		Insert each particle into the sorted run. One that would have to move back further than the window is
+		out of place, unless the run ends in particles that are out of place themselves: a slot refilled with a
+		nearer particle is larger than what follows it in the previous order too. Those are set aside until the
+		particle fits. Looking two particles ahead keeps a pair of misplaced particles from emptying the run.
+	*/
+	m_Entries.clear();
+	m_Displaced.clear();
+	const int numPrevious = (int)m_Scratch.size();
+	for (int i = 0; i < numPrevious; i++) {
+		const Entry entry = m_Scratch[i];
+		for (;;) {
+			const int end = (int)m_Entries.size();
+			const int limit = std::max(0, end - INSERTION_WINDOW);
+			int at = end;
+			while (at > limit && m_Entries[at - 1].key > entry.key) {
+				at--;
+			}
+			if (at == 0 || m_Entries[at - 1].key <= entry.key) {
+				m_Entries.push_back(entry);
+				for (int k = end; k > at; k--) {
+					m_Entries[k] = m_Entries[k - 1];
+				}
+				m_Entries[at] = entry;
+				break;
+			}
+			uint32_t nextKey = i + 1 < numPrevious ? m_Scratch[i + 1].key : 0;
+			if (i + 2 < numPrevious) {
+				nextKey = std::max(nextKey, m_Scratch[i + 2].key);
+			}
+			bool tailOutOfPlace = m_Entries.back().key > nextKey;
+			m_Displaced.push_back(tailOutOfPlace ? m_Entries.back() : entry);
+			if ((int)m_Displaced.size() > maxDisplaced) {
+				return false;
+			}
+			if (!tailOutOfPlace) {
+				break;
+			}
+			m_Entries.pop_back();
+		}
+	}
+
+	/* Particles the previous order did not have: spawned since, or moved into a slot past its end */
+	for (int i = 0; i < count; i++) {
+		if (!m_Seen[i] && depths[i] >= 0.0f) {
+			m_Displaced.push_back(Entry{ DepthKey(depths[i]), i });
+			if ((int)m_Displaced.size() > maxDisplaced) {
+				return false;
+			}
+		}
+	}
+
+	/* Merge the set aside particles back in, straight into the order */
+	RadixSort(m_Displaced, m_Scratch);
+	const int numKept = (int)m_Entries.size(), numDisplaced = (int)m_Displaced.size();
+	m_Order.resize(numKept + numDisplaced);
+	int k = 0, d = 0, o = 0;
+	while (k < numKept && d < numDisplaced) {
+		m_Order[o++] = m_Displaced[d].key < m_Entries[k].key ? m_Displaced[d++].index : m_Entries[k++].index;
+	}
+	for (; k < numKept; k++) {
+		m_Order[o++] = m_Entries[k].index;
+	}
+	for (; d < numDisplaced; d++) {
+		m_Order[o++] = m_Displaced[d].index;
+	}
+	m_NumDisplaced = (int)m_Displaced.size();
+	return true;
+}
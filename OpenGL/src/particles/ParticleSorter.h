@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+	Back-to-front ordering of particles for alpha blending. Sort takes the depth of every particle as written by
+	ParticleKernels::Simulate (the squared distance to the eye, negative for a particle that died) and produces
+	the indices of the live particles only, farthest first, to be uploaded in place of moving the particle data.
+
+	The sort is a stable LSD radix sort of (key, index) pairs on a 32 bit key: the bits of a non-negative float
+	order like the float itself, and inverting them makes an ascending sort put the farthest particle first. One
+	histogram pass counts all three 11 bit digits, and a digit that every particle shares is skipped.
+
+	In Coherent mode Sort starts from the previous order instead, which is nearly sorted while the camera and the
+	particles move a little per frame. An insertion pass fixes up the particles that drifted a few places, sets
+	aside the ones that moved further (or whose slot was refilled by the pool when a particle died, or that were
+	just spawned), radix sorts those and merges them back. If too many particles have to be set aside it falls
+	back to sorting everything, and sorts everything for the next few frames before trying again.
+*/
+class ParticleSorter {
+public:
+	enum class Mode { Radix, Coherent };
+
+	/* How far back the insertion pass moves a particle before setting it aside */
+	static const int INSERTION_WINDOW = 8;
+	/* The coherent pass gives up when more than count / MAX_DISPLACED_DIVISOR particles are set aside */
+	static const int MAX_DISPLACED_DIVISOR = 8;
+	/* Sorts after a failed coherent pass that sort everything */
+	static const int RETRY_INTERVAL = 8;
+
+	/* Orders the live particles of [0, count) by decreasing depth and returns how many there are */
+	int Sort(const float* depths, int count, Mode mode = Mode::Radix);
+
+	/* Indices of the live particles from the last Sort, farthest first */
+	inline const std::vector<int>& GetOrder() const { return m_Order; }
+	/* Whether the last Sort was built on the previous order, and how many particles it had to set aside */
+	inline bool WasCoherent() const { return m_Coherent; }
+	inline int GetNumDisplaced() const { return m_NumDisplaced; }
+
+private:
+	struct Entry {
+		uint32_t key;
+		int index;
+	};
+
+	std::vector<int> m_Order;
+	std::vector<Entry> m_Entries, m_Scratch, m_Displaced;
+	std::vector<uint8_t> m_Seen; //Per slot, during a coherent pass
+	bool m_Coherent = false;
+	int m_NumDisplaced = 0;
+	int m_SortsUntilRetry = 0;
+
+	static void RadixSort(std::vector<Entry>& entries, std::vector<Entry>& scratch);
+	bool SortCoherent(const float* depths, int count);
+};
@@ -0,0 +1,125 @@
+#include "SpatialHashGrid.h"
+
+#include <cmath>
+
+#include "util/ThreadPool.h"
+
+void SpatialHashGrid::Build(const float* x, const float* y, const float* z, int count, float cellSize, ThreadPool* pool) {
+	m_CellSize = cellSize;
+	m_InverseCellSize = 1.0f / cellSize;
+	uint32_t numBuckets = 2 * NUM_RANGES;
+	while (numBuckets < 2u * (uint32_t)count) {
+		numBuckets <<= 1;
+	}
+	m_BucketMask = numBuckets - 1;
+	const int bucketsPerRange = (int)numBuckets / NUM_RANGES;
+	int rangeShift = 0;
+	while ((1 << rangeShift) < bucketsPerRange) {
+		rangeShift++;
+	}
+
+	const int numBlocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	m_Buckets.resize(count);
+	m_RangeOffsets.assign((size_t)numBlocks * NUM_RANGES, 0);
+	m_ByRange.resize(count);
+	m_Order.resize(count);
+	for (int axis = 0; axis < 3; axis++) {
+		m_Sorted[axis].resize(count);
+	}
+	m_BucketStart.resize(numBuckets + 1);
+	m_BucketStart[numBuckets] = count;
+
+	/* Pass 1: bucket of every point, and how many points of each block fall into each range of buckets */
+	ThreadPool::RunTasks(pool, numBlocks, [&](int block) {
+		int* rangeCounts = m_RangeOffsets.data() + (size_t)block * NUM_RANGES;
+		for (int i = block * BLOCK_SIZE, end = std::min(i + BLOCK_SIZE, count); i < end; i++) {
+			glm::ivec3 cell = GetCell(glm::vec3(x[i], y[i], z[i]));
+			uint32_t bucket = GetBucket(cell.x, cell.y, cell.z);
+			m_Buckets[i] = bucket;
+			rangeCounts[bucket >> rangeShift]++;
+		}
+	});
+
+	/* Ranges in order, and within a range the blocks in order */
+	m_RangeStart.resize(NUM_RANGES + 1);
+	int sum = 0;
+	for (int range = 0; range < NUM_RANGES; range++) {
+		m_RangeStart[range] = sum;
+		for (int block = 0; block < numBlocks; block++) {
+			int& offset = m_RangeOffsets[(size_t)block * NUM_RANGES + range];
+			int rangeCount = offset;
+			offset = sum;
+			sum += rangeCount;
+		}
+	}
+	m_RangeStart[NUM_RANGES] = sum;
+
+	/* Pass 2: scatter the points into their ranges */
+	ThreadPool::RunTasks(pool, numBlocks, [&](int block) {
+		int* offsets = m_RangeOffsets.data() + (size_t)block * NUM_RANGES;
+		for (int i = block * BLOCK_SIZE, end = std::min(i + BLOCK_SIZE, count); i < end; i++) {
+			m_ByRange[offsets[m_Buckets[i] >> rangeShift]++] = i;
+		}
+	});
+
+	/*
+		Pass 3: counting sort every range on its buckets. The bucket starts are summed up to the end of each bucket
+		and the points placed from the back, which leaves them in order and the starts where they belong.
+	*/
+	ThreadPool::RunTasks(pool, NUM_RANGES, [&](int range) {
+		const int begin = m_RangeStart[range], end = m_RangeStart[range + 1];
+		const uint32_t firstBucket = (uint32_t)range * bucketsPerRange;
+		int* bucketStart = m_BucketStart.data() + firstBucket;
+		std::fill(bucketStart, bucketStart + bucketsPerRange, 0);
+		for (int k = begin; k < end; k++) {
+			bucketStart[m_Buckets[m_ByRange[k]] - firstBucket]++;
+		}
+		int bucketEnd = begin;
+		for (int b = 0; b < bucketsPerRange; b++) {
+			bucketEnd += bucketStart[b];
+			bucketStart[b] = bucketEnd;
+		}
+		for (int k = end - 1; k >= begin; k--) {
+			const int i = m_ByRange[k];
+			const int slot = --bucketStart[m_Buckets[i] - firstBucket];
+			m_Order[slot] = i;
+			m_Sorted[0][slot] = x[i]; m_Sorted[1][slot] = y[i]; m_Sorted[2][slot] = z[i];
+		}
+	});
+}
+
+void SpatialHashGrid::Clear() {
+	m_Order.clear();
+	m_BucketStart.clear();
+	m_BucketMask = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		m_Sorted[axis].clear();
+	}
+}
+
+void SpatialHashGrid::ComputeDensities(float radius, float mass, float* densities, ThreadPool* pool) const {
+	const float PI = 3.14159265358979f;
+	radius = std::min(radius, m_CellSize);
+	const float radiusSquared = radius * radius;
+	const float poly6 = mass * 315.0f / (64.0f * PI * std::pow(radius, 9.0f));
+	const int count = GetCount();
+	ThreadPool::RunTasks(pool, (count + BLOCK_SIZE - 1) / BLOCK_SIZE, [&](int block) {
+		for (int slot = block * BLOCK_SIZE, end = std::min(slot + BLOCK_SIZE, count); slot < end; slot++) {
+			float density = 0.0f;
+			ForEachNeighbour(GetPosition(slot), radius, [&](int, float distanceSquared) {
+				float w = radiusSquared - distanceSquared;
+				density += w * w * w;
+			});
+			densities[m_Order[slot]] = poly6 * density;
+		}
+	});
+}
+
+size_t SpatialHashGrid::GetMemoryUsage() const {
+	size_t bytes = (m_BucketStart.capacity() + m_Order.capacity() + m_RangeOffsets.capacity() + m_RangeStart.capacity() + m_ByRange.capacity()) * sizeof(int);
+	bytes += m_Buckets.capacity() * sizeof(uint32_t);
+	for (int axis = 0; axis < 3; axis++) {
+		bytes += m_Sorted[axis].capacity() * sizeof(float);
+	}
+	return bytes;
+}
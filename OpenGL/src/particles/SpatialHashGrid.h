@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+
+/*
+	Uniform grid over points for fixed-radius neighbour queries, rebuilt from scratch every frame. Cells are hashed
+	into a power of two table of at least twice as many buckets as points, so the grid needs no bounds, and the
+	points are counting sorted by bucket into cell-ordered arrays that hold their positions as well. The hash is
+	linear in x, so a query reads one contiguous run of slots per row of cells and never touches the caller's arrays.
+
+	The build is parallel and deterministic. Blocks of points hash themselves and count how many fall into each of
+	a few hundred ranges of buckets, are scattered into the ranges in block order, and every range is then counting
+	sorted on its own, so the points of a bucket stay in index order whatever the number of threads.
+
+	A bucket may hold the points of several cells that hash alike; queries filter them out by distance.
+*/
+class SpatialHashGrid {
+public:
+	static const int BLOCK_SIZE = 4096;
+	static const int NUM_RANGES = 256;
+
+	/* Sorts count points into cells of cellSize, which bounds the radius of the queries */
+	void Build(const float* x, const float* y, const float* z, int count, float cellSize, ThreadPool* pool = nullptr);
+	void Clear();
+
+	/*
+		Calls fn(slot, distanceSquared) for every point within radius of position, including any point at position
+		itself. slot indexes the cell-ordered arrays, and GetIndex gives the point it holds. The radius is clamped to
+		the cell size, so a query visits the 3 x 3 x 3 cells around position (4 along an axis if rounding says so).
+	*/
+	template<typename Fn>
+	void ForEachNeighbour(const glm::vec3& position, float radius, Fn&& fn) const;
+
+	/* SPH density at every point: mass times the poly6 kernel summed over the points within radius. Indexed by point */
+	void ComputeDensities(float radius, float mass, float* densities, ThreadPool* pool = nullptr) const;
+
+	inline int GetCount() const { return (int)m_Order.size(); }
+	inline float GetCellSize() const { return m_CellSize; }
+	inline int GetNumBuckets() const { return (int)m_BucketMask + 1; }
+	inline int GetIndex(int slot) const { return m_Order[slot]; }
+	inline const std::vector<int>& GetOrder() const { return m_Order; }
+	inline glm::vec3 GetPosition(int slot) const { return glm::vec3(m_Sorted[0][slot], m_Sorted[1][slot], m_Sorted[2][slot]); }
+
+	size_t GetMemoryUsage() const;
+
+private:
+	float m_CellSize = 1.0f, m_InverseCellSize = 1.0f;
+	uint32_t m_BucketMask = 0;
+	std::vector<int> m_BucketStart; //First slot of every bucket, and the point count at the end
+	std::vector<int> m_Order; //Point in every slot
+	std::vector<float> m_Sorted[3]; //Point positions in slot order
+
+	/* Build scratch */
+	std::vector<uint32_t> m_Buckets; //Per point
+	std::vector<int> m_RangeOffsets; //Per block and range
+	std::vector<int> m_RangeStart; //Per range, and the point count at the end
+	std::vector<int> m_ByRange; //Points grouped by range
+
+	template<typename Fn>
+	inline void ForEachInRange(int begin, int end, const glm::vec3& position, float radiusSquared, Fn& fn) const {
+		const float* sx = m_Sorted[0].data(); const float* sy = m_Sorted[1].data(); const float* sz = m_Sorted[2].data();
+		for (int slot = begin; slot < end; slot++) {
+			float dx = sx[slot] - position.x, dy = sy[slot] - position.y, dz = sz[slot] - position.z;
+			float distanceSquared = dx * dx + dy * dy + dz * dz;
+			if (distanceSquared <= radiusSquared) {
+				fn(slot, distanceSquared);
+			}
+		}
+	}
+
+	inline glm::ivec3 GetCell(const glm::vec3& p) const { return glm::ivec3(glm::floor(p * m_InverseCellSize)); }
+	/* Linear in x, so that neighbouring cells along x land in consecutive buckets */
+	inline uint32_t GetBucket(int x, int y, int z) const {
+		return ((uint32_t)x + (uint32_t)y * 19349663u + (uint32_t)z * 83492791u) & m_BucketMask;
+	}
+};
+
+template<typename Fn>
+void SpatialHashGrid::ForEachNeighbour(const glm::vec3& position, float radius, Fn&& fn) const {
+	if (m_Order.empty()) {
+		return;
+	}
+	radius = std::min(radius, m_CellSize);
+	const float radiusSquared = radius * radius;
+	const glm::ivec3 first = GetCell(position - glm::vec3(radius)), last = GetCell(position + glm::vec3(radius));
+
+	/*
+		The buckets of a row of cells along x are consecutive, so each row is one run of slots. Rows whose buckets
+		overlap an earlier row's are rare, and go bucket by bucket skipping the buckets already visited.
+	*/
+	const uint32_t rowLength = (uint32_t)(last.x - first.x + 1);
+	uint32_t rowStarts[16];
+	int numRows = 0;
+	for (int cz = first.z; cz <= last.z; cz++) {
+		for (int cy = first.y; cy <= last.y; cy++) {
+			const uint32_t rowStart = GetBucket(first.x, cy, cz);
+			bool overlaps = rowStart + rowLength > m_BucketMask + 1;
+			for (int r = 0; r < numRows; r++) {
+				overlaps = overlaps || ((rowStart - rowStarts[r]) & m_BucketMask) < rowLength || ((rowStarts[r] - rowStart) & m_BucketMask) < rowLength;
+			}
+			if (!overlaps) {
+				ForEachInRange(m_BucketStart[rowStart], m_BucketStart[rowStart + rowLength], position, radiusSquared, fn);
+			} else {
+				for (uint32_t k = 0; k < rowLength; k++) {
+					const uint32_t bucket = (rowStart + k) & m_BucketMask;
+					bool visited = false;
+					for (int r = 0; r < numRows; r++) {
+						visited = visited || ((bucket - rowStarts[r]) & m_BucketMask) < rowLength;
+					}
+					if (!visited) {
+						ForEachInRange(m_BucketStart[bucket], m_BucketStart[bucket + 1], position, radiusSquared, fn);
+					}
+				}
+			}
+			rowStarts[numRows++] = rowStart;
+		}
+	}
+}
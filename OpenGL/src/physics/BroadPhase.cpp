@@ -0,0 +1,541 @@
+#include "BroadPhase.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "geometry/TransformBatch.h"
+#include "util/CpuFeatures.h"
+#include "util/ThreadPool.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Bodies (or cells) per parallel task; pairs are gathered per block and merged in block order */
+static const int BLOCK_SIZE = 1024;
+
+/* Insertion sort gives up and falls back to a full sort past this many swaps per body */
+static const int MAX_SWAPS_PER_BODY = 32;
+
+/* Largest grid cell coordinate, so that a key holds the 4 bit level and three coordinates */
+static const int GRID_MAX_COORDINATE = (1 << 19) - 1;
+
+static inline int NumBlocks(int count) {
+	return (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+static inline int BlockEnd(int block, int count) {
+	return std::min((block + 1) * BLOCK_SIZE, count);
+}
+
+/* Concatenates the pairs found per block, with a counting sort on a followed by sorting each run on b */
+static void MergePairs(const std::vector<std::vector<BodyPair>>& blockPairs, int numBodies, std::vector<BodyPair>& pairs) {
+	std::vector<int> offsets(numBodies + 1, 0);
+	size_t total = 0;
+	for (const std::vector<BodyPair>& block : blockPairs) {
+		for (const BodyPair& pair : block) {
+			offsets[pair.a + 1]++;
+		}
+		total += block.size();
+	}
+	for (int i = 0; i < numBodies; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	pairs.resize(total);
+	std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+	for (const std::vector<BodyPair>& block : blockPairs) {
+		for (const BodyPair& pair : block) {
+			pairs[cursor[pair.a]++] = pair;
+		}
+	}
+	for (int i = 0; i < numBodies; i++) {
+		if (offsets[i + 1] - offsets[i] > 1) {
+			std::sort(pairs.begin() + offsets[i], pairs.begin() + offsets[i + 1]);
+		}
+	}
+}
+
+void BoundsArrays::Update(const TransformBatch& transforms, const float* hx, const float* hy, const float* hz, ThreadPool* pool) {
+	const int count = transforms.count;
+	Resize(count);
+	float* minX = m_Min[0].data(); float* minY = m_Min[1].data(); float* minZ = m_Min[2].data();
+	float* maxX = m_Max[0].data(); float* maxY = m_Max[1].data(); float* maxZ = m_Max[2].data();
+	const TransformBatch& t = transforms;
+
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		for (int i = block * BLOCK_SIZE, end = BlockEnd(block, count); i < end; i++) {
+			float x = t.qx[i], y = t.qy[i], z = t.qz[i], w = t.qw[i];
+			float x2 = x + x, y2 = y + y, z2 = z + z;
+			float xx = x * x2, yy = y * y2, zz = z * z2;
+			float xy = x * y2, xz = x * z2, yz = y * z2;
+			float wx = w * x2, wy = w * y2, wz = w * z2;
+
+			/* Scaled half extents along the local axes, then |R| times those */
+			float ex = t.sx[i] * hx[i], ey = t.sy[i] * hy[i], ez = t.sz[i] * hz[i];
+			float halfX = std::abs((1.0f - (yy + zz)) * ex) + std::abs((xy - wz) * ey) + std::abs((xz + wy) * ez);
+			float halfY = std::abs((xy + wz) * ex) + std::abs((1.0f - (xx + zz)) * ey) + std::abs((yz - wx) * ez);
+			float halfZ = std::abs((xz - wy) * ex) + std::abs((yz + wx) * ey) + std::abs((1.0f - (xx + yy)) * ez);
+
+			minX[i] = t.px[i] - halfX; maxX[i] = t.px[i] + halfX;
+			minY[i] = t.py[i] - halfY; maxY[i] = t.py[i] + halfY;
+			minZ[i] = t.pz[i] - halfZ; maxZ[i] = t.pz[i] + halfZ;
+		}
+	});
+}
+
+std::unique_ptr<BroadPhase> BroadPhase::Create(Type type) {
+	switch (type) {
+	case Type::MultiLevelGrid: return std::unique_ptr<BroadPhase>(new MultiLevelGrid());
+	default: return std::unique_ptr<BroadPhase>(new SweepAndPrune());
+	}
+}
+
+const char* BroadPhase::GetName(Type type) {
+	switch (type) {
+	case Type::MultiLevelGrid: return "Multi-level grid";
+	default: return "Sweep and prune";
+	}
+}
+
+void SweepAndPrune::Clear() {
+	m_Axis = -1;
+	m_Order.clear();
+	m_Keys.clear();
+	for (std::vector<float>& sorted : m_Sorted) {
+		sorted.clear();
+	}
+	m_LastSwaps = 0;
+	m_BlockPairs.clear();
+}
+
+size_t SweepAndPrune::GetMemoryUsage() const {
+	size_t bytes = m_Order.capacity() * sizeof(int) + m_Keys.capacity() * sizeof(float);
+	for (const std::vector<float>& sorted : m_Sorted) {
+		bytes += sorted.capacity() * sizeof(float);
+	}
+	for (const std::vector<BodyPair>& block : m_BlockPairs) {
+		bytes += block.capacity() * sizeof(BodyPair);
+	}
+	return bytes;
+}
+
+void SweepAndPrune::Rebuild(const BoundsArrays& bounds) {
+	const int count = bounds.GetCount();
+
+	/* Sweep along the axis with the largest variance of the body centres */
+	double sum[3] = { 0.0, 0.0, 0.0 }, sumSquares[3] = { 0.0, 0.0, 0.0 };
+	for (int axis = 0; axis < 3; axis++) {
+		const float* min = bounds.GetMinArray(axis).data();
+		const float* max = bounds.GetMaxArray(axis).data();
+		for (int i = 0; i < count; i++) {
+			double c = 0.5 * ((double)min[i] + (double)max[i]);
+			sum[axis] += c;
+			sumSquares[axis] += c * c;
+		}
+	}
+	m_Axis = 0;
+	double bestVariance = -1.0;
+	for (int axis = 0; axis < 3; axis++) {
+		double variance = sumSquares[axis] - sum[axis] * sum[axis] / std::max(count, 1);
+		if (variance > bestVariance) {
+			bestVariance = variance;
+			m_Axis = axis;
+		}
+	}
+
+	const float* min = bounds.GetMinArray(m_Axis).data();
+	m_Order.resize(count);
+	for (int i = 0; i < count; i++) {
+		m_Order[i] = i;
+	}
+	std::sort(m_Order.begin(), m_Order.end(), [min](int a, int b) { return min[a] < min[b] || (min[a] == min[b] && a < b); });
+	m_Keys.resize(count);
+	for (int k = 0; k < count; k++) {
+		m_Keys[k] = min[m_Order[k]];
+	}
+}
+
+void SweepAndPrune::FindPairs(const BoundsArrays& bounds, std::vector<BodyPair>& pairs, ThreadPool* pool) {
+	const int count = bounds.GetCount();
+	pairs.clear();
+
+	m_LastSwaps = 0;
+	if (m_Axis < 0 || (int)m_Order.size() != count) {
+		Rebuild(bounds);
+	} else {
+		/* Refresh the keys in the previous order and restore it with insertion sort */
+		const float* min = bounds.GetMinArray(m_Axis).data();
+		for (int k = 0; k < count; k++) {
+			m_Keys[k] = min[m_Order[k]];
+		}
+
+		const int64_t maxSwaps = (int64_t)count * MAX_SWAPS_PER_BODY;
+		int64_t swaps = 0;
+		for (int k = 1; k < count && swaps <= maxSwaps; k++) {
+			float key = m_Keys[k];
+			int body = m_Order[k];
+			int j = k;
+			while (j > 0 && m_Keys[j - 1] > key) {
+				m_Keys[j] = m_Keys[j - 1];
+				m_Order[j] = m_Order[j - 1];
+				j--;
+			}
+			m_Keys[j] = key;
+			m_Order[j] = body;
+			swaps += k - j;
+		}
+		m_LastSwaps = swaps;
+
+		/* The bodies moved too far for insertion sort to pay off */
+		if (swaps > maxSwaps) {
+			Rebuild(bounds);
+		}
+	}
+	if (count < 2) {
+		return;
+	}
+
+	/* Gather the other bounds into sweep order, so the sweep reads them sequentially */
+	const int axis1 = (m_Axis + 1) % 3, axis2 = (m_Axis + 2) % 3;
+	const float* sources[5] = { bounds.GetMaxArray(m_Axis).data(), bounds.GetMinArray(axis1).data(), bounds.GetMaxArray(axis1).data(),
+		bounds.GetMinArray(axis2).data(), bounds.GetMaxArray(axis2).data() };
+	for (std::vector<float>& sorted : m_Sorted) {
+		sorted.resize(count);
+	}
+	const int* order = m_Order.data();
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		for (int c = 0; c < 5; c++) {
+			const float* source = sources[c];
+			float* sorted = m_Sorted[c].data();
+			for (int k = block * BLOCK_SIZE, end = BlockEnd(block, count); k < end; k++) {
+				sorted[k] = source[order[k]];
+			}
+		}
+	});
+
+	const float* keys = m_Keys.data();
+	const float* max0 = m_Sorted[0].data();
+	const float* min1 = m_Sorted[1].data(); const float* max1 = m_Sorted[2].data();
+	const float* min2 = m_Sorted[3].data(); const float* max2 = m_Sorted[4].data();
+
+	m_BlockPairs.resize(NumBlocks(count));
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		std::vector<BodyPair>& blockPairs = m_BlockPairs[block];
+		blockPairs.clear();
+		for (int k = block * BLOCK_SIZE, end = BlockEnd(block, count); k < end; k++) {
+			const int a = order[k];
+			float endA = max0[k];
+			float minA1 = min1[k], maxA1 = max1[k], minA2 = min2[k], maxA2 = max2[k];
+			int s = k + 1;
+#if SIMD_X86
+			/* Four candidates at a time; the keys are sorted, so the candidates in range are a prefix of the four */
+			const __m128 endA4 = _mm_set1_ps(endA);
+			const __m128 minA14 = _mm_set1_ps(minA1), maxA14 = _mm_set1_ps(maxA1), minA24 = _mm_set1_ps(minA2), maxA24 = _mm_set1_ps(maxA2);
+			for (; s + 4 <= count; s += 4) {
+				int inRange = _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(keys + s), endA4));
+				__m128 overlap1 = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min1 + s), maxA14), _mm_cmple_ps(minA14, _mm_loadu_ps(max1 + s)));
+				__m128 overlap2 = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(min2 + s), maxA24), _mm_cmple_ps(minA24, _mm_loadu_ps(max2 + s)));
+				int hits = _mm_movemask_ps(_mm_and_ps(overlap1, overlap2)) & inRange;
+				for (int lane = 0; hits != 0; lane++, hits >>= 1) {
+					if (hits & 1) {
+						int b = order[s + lane];
+						blockPairs.push_back(a < b ? BodyPair{ a, b } : BodyPair{ b, a });
+					}
+				}
+				if (inRange != 0xF) {
+					s = count;
+				}
+			}
+#endif
+			for (; s < count && keys[s] <= endA; s++) {
+				if (min1[s] <= maxA1 && minA1 <= max1[s] && min2[s] <= maxA2 && minA2 <= max2[s]) {
+					int b = order[s];
+					blockPairs.push_back(a < b ? BodyPair{ a, b } : BodyPair{ b, a });
+				}
+			}
+		}
+	});
+	MergePairs(m_BlockPairs, count, pairs);
+}
+
+void MultiLevelGrid::Clear() {
+	m_Origin = glm::vec3(0.0f);
+	m_CellSize = 1.0f;
+	m_NumLevels = 0;
+	m_CoordinateBits = 1;
+	m_Boxes.clear();
+	m_Levels.clear();
+	m_Ranges.clear();
+	m_EntryOffsets.clear();
+	m_QueryOffsets.clear();
+	m_Entries.clear();
+	m_EntryBoxes.clear();
+	m_Queries.clear();
+	m_Scratch.clear();
+	m_Cells.clear();
+	m_BlockPairs.clear();
+}
+
+size_t MultiLevelGrid::GetMemoryUsage() const {
+	size_t bytes = m_Boxes.capacity() * sizeof(Box) + m_Levels.capacity() * sizeof(uint8_t) + m_Ranges.capacity() * sizeof(CellRange) +
+		(m_EntryOffsets.capacity() + m_QueryOffsets.capacity()) * sizeof(int) +
+		(m_Entries.capacity() + m_Queries.capacity() + m_Scratch.capacity()) * sizeof(Entry) +
+		m_EntryBoxes.capacity() * sizeof(Box) + m_Cells.capacity() * sizeof(Cell);
+	for (const std::vector<BodyPair>& block : m_BlockPairs) {
+		bytes += block.capacity() * sizeof(BodyPair);
+	}
+	return bytes;
+}
+
+glm::ivec3 MultiLevelGrid::CellCoordinates(const glm::vec3& p) const {
+	const float scale = 1.0f / m_CellSize;
+	glm::ivec3 cell;
+	for (int axis = 0; axis < 3; axis++) {
+		/* Clamped to be non-negative first, so truncation rounds down */
+		float c = (p[axis] - m_Origin[axis]) * scale;
+		cell[axis] = (int)std::min(std::max(c, 0.0f), (float)GRID_MAX_COORDINATE);
+	}
+	return cell;
+}
+
+uint64_t MultiLevelGrid::CellKey(int level, const glm::ivec3& cell) const {
+	const int bits = m_CoordinateBits;
+	return ((uint64_t)level << (3 * bits)) | ((uint64_t)cell.x << (2 * bits)) | ((uint64_t)cell.y << bits) | (uint64_t)cell.z;
+}
+
+/* Stable LSD radix sort of entries on the low keyBits bits of their key, 11 bits per pass */
+template<typename T>
+static void RadixSortByKey(std::vector<T>& entries, std::vector<T>& scratch, int keyBits) {
+	const int DIGIT_BITS = 11;
+	const int NUM_BUCKETS = 1 << DIGIT_BITS;
+	scratch.resize(entries.size());
+	std::vector<int> offsets(NUM_BUCKETS);
+	for (int shift = 0; shift < keyBits; shift += DIGIT_BITS) {
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (const T& entry : entries) {
+			offsets[(entry.key >> shift) & (NUM_BUCKETS - 1)]++;
+		}
+		int sum = 0;
+		for (int& offset : offsets) {
+			int bucketCount = offset;
+			offset = sum;
+			sum += bucketCount;
+		}
+		for (const T& entry : entries) {
+			scratch[offsets[(entry.key >> shift) & (NUM_BUCKETS - 1)]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
+void MultiLevelGrid::FindPairs(const BoundsArrays& bounds, std::vector<BodyPair>& pairs, ThreadPool* pool) {
+	const int count = bounds.GetCount();
+	pairs.clear();
+	if (count == 0) {
+		Clear();
+		return;
+	}
+	const int numBlocks = NumBlocks(count);
+
+	/* Pass 1: copy the bounds into boxes, and find the world bounds and the range of body extents per block */
+	struct BlockExtents {
+		glm::vec3 min, max;
+		float smallest, largest;
+	};
+	std::vector<BlockExtents> extents(numBlocks);
+	m_Boxes.resize(count);
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		BlockExtents e = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), FLT_MAX, 0.0f };
+		for (int i = block * BLOCK_SIZE, end = BlockEnd(block, count); i < end; i++) {
+			Box& box = m_Boxes[i];
+			box.min = bounds.GetMin(i);
+			box.max = bounds.GetMax(i);
+			e.min = glm::min(e.min, box.min);
+			e.max = glm::max(e.max, box.max);
+			glm::vec3 size = box.max - box.min;
+			float extent = std::max(size.x, std::max(size.y, size.z));
+			if (extent > 0.0f) {
+				e.smallest = std::min(e.smallest, extent);
+			}
+			e.largest = std::max(e.largest, extent);
+		}
+		extents[block] = e;
+	});
+	BlockExtents world = extents[0];
+	for (int b = 1; b < numBlocks; b++) {
+		world.min = glm::min(world.min, extents[b].min);
+		world.max = glm::max(world.max, extents[b].max);
+		world.smallest = std::min(world.smallest, extents[b].smallest);
+		world.largest = std::max(world.largest, extents[b].largest);
+	}
+
+	/* The finest cells fit the smallest body, but not so small that the world needs more coordinates than a key holds */
+	glm::vec3 worldSize = world.max - world.min;
+	float worldExtent = std::max(worldSize.x, std::max(worldSize.y, worldSize.z));
+	m_Origin = world.min;
+	m_CellSize = world.smallest < FLT_MAX ? world.smallest : std::max(worldExtent, 1.0f);
+	m_CellSize = std::max(m_CellSize, worldExtent / (float)(GRID_MAX_COORDINATE / 2));
+	m_CellSize = std::max(m_CellSize, FLT_MIN);
+	m_NumLevels = 1;
+	while (m_NumLevels < MAX_LEVELS && std::ldexp(m_CellSize, m_NumLevels - 1) < world.largest) {
+		m_NumLevels++;
+	}
+	glm::ivec3 maxCell = CellCoordinates(world.max);
+	int maxCoordinate = std::max(maxCell.x, std::max(maxCell.y, maxCell.z));
+	m_CoordinateBits = 1;
+	while ((maxCoordinate >> m_CoordinateBits) != 0) {
+		m_CoordinateBits++;
+	}
+	const int keyBits = 3 * m_CoordinateBits + 4;
+
+	/* Pass 2: the level of each body and the cells it overlaps */
+	m_Levels.resize(count);
+	m_Ranges.resize(count);
+	std::vector<uint32_t> blockLevels(numBlocks, 0);
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		uint32_t levelMask = 0;
+		for (int i = block * BLOCK_SIZE, end = BlockEnd(block, count); i < end; i++) {
+			glm::vec3 size = m_Boxes[i].max - m_Boxes[i].min;
+			float extent = std::max(size.x, std::max(size.y, size.z));
+			int level = 0;
+			for (float size = m_CellSize; level < m_NumLevels - 1 && size < extent; size *= 2.0f) {
+				level++;
+			}
+			m_Levels[i] = (uint8_t)level;
+			m_Ranges[i] = CellRange{ CellCoordinates(m_Boxes[i].min), CellCoordinates(m_Boxes[i].max) };
+			levelMask |= 1u << level;
+		}
+		blockLevels[block] = levelMask;
+	});
+	uint32_t levelMask = 0;
+	for (uint32_t mask : blockLevels) {
+		levelMask |= mask;
+	}
+
+	/* Pass 3: the cells of each body on its own level (entries) and on the occupied coarser levels (queries) */
+	m_EntryOffsets.resize(count + 1);
+	m_QueryOffsets.resize(count + 1);
+	m_EntryOffsets[0] = m_QueryOffsets[0] = 0;
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		for (int i = block * BLOCK_SIZE, end = BlockEnd(block, count); i < end; i++) {
+			int numQueries = 0;
+			for (int level = m_Levels[i]; level < m_NumLevels; level++) {
+				if (levelMask & (1u << level)) {
+					glm::ivec3 range = (m_Ranges[i].hi >> level) - (m_Ranges[i].lo >> level) + 1;
+					int numCells = range.x * range.y * range.z;
+					if (level == m_Levels[i]) {
+						m_EntryOffsets[i + 1] = numCells;
+					} else {
+						numQueries += numCells;
+					}
+				}
+			}
+			m_QueryOffsets[i + 1] = numQueries;
+		}
+	});
+	for (int i = 0; i < count; i++) {
+		m_EntryOffsets[i + 1] += m_EntryOffsets[i];
+		m_QueryOffsets[i + 1] += m_QueryOffsets[i];
+	}
+	m_Entries.resize(m_EntryOffsets[count]);
+	m_Queries.resize(m_QueryOffsets[count]);
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		for (int i = block * BLOCK_SIZE, end = BlockEnd(block, count); i < end; i++) {
+			Entry* entry = m_Entries.data() + m_EntryOffsets[i];
+			Entry* query = m_Queries.data() + m_QueryOffsets[i];
+			for (int level = m_Levels[i]; level < m_NumLevels; level++) {
+				if (!(levelMask & (1u << level))) {
+					continue;
+				}
+				Entry*& out = level == m_Levels[i] ? entry : query;
+				glm::ivec3 lo = m_Ranges[i].lo >> level, hi = m_Ranges[i].hi >> level;
+				for (int z = lo.z; z <= hi.z; z++) {
+					for (int y = lo.y; y <= hi.y; y++) {
+						for (int x = lo.x; x <= hi.x; x++) {
+							*out++ = Entry{ CellKey(level, glm::ivec3(x, y, z)), i };
+						}
+					}
+				}
+			}
+		}
+	});
+
+	/* Entries and queries were written in body order, so the stable sort leaves each cell's bodies in order */
+	RadixSortByKey(m_Entries, m_Scratch, keyBits);
+	RadixSortByKey(m_Queries, m_Scratch, keyBits);
+
+	/* Cells are the runs of equal keys */
+	const int numEntries = (int)m_Entries.size();
+	m_Cells.clear();
+	for (int e = 0; e < numEntries; e++) {
+		if (e == 0 || m_Entries[e].key != m_Entries[e - 1].key) {
+			m_Cells.push_back({ m_Entries[e].key, e, 0 });
+		}
+		m_Cells.back().count++;
+	}
+	m_EntryBoxes.resize(numEntries);
+	ThreadPool::RunTasks(pool, NumBlocks(numEntries), [&](int block) {
+		for (int e = block * BLOCK_SIZE, end = BlockEnd(block, numEntries); e < end; e++) {
+			m_EntryBoxes[e] = m_Boxes[m_Entries[e].body];
+		}
+	});
+
+	/* Pass 4: bodies against the other bodies of the same cell, then the queries against the cells they hit */
+	const int numCells = (int)m_Cells.size();
+	const int numQueries = (int)m_Queries.size();
+	const int numCellBlocks = NumBlocks(numCells);
+	m_BlockPairs.resize(numCellBlocks + NumBlocks(numQueries));
+	ThreadPool::RunTasks(pool, NumBlocks(numCells), [&](int block) {
+		std::vector<BodyPair>& blockPairs = m_BlockPairs[block];
+		blockPairs.clear();
+		for (int c = block * BLOCK_SIZE, end = BlockEnd(block, numCells); c < end; c++) {
+			const Cell& cell = m_Cells[c];
+			const int level = (int)(cell.key >> (3 * m_CoordinateBits));
+			for (int e = cell.first; e < cell.first + cell.count; e++) {
+				const Box& boxA = m_EntryBoxes[e];
+				for (int f = e + 1; f < cell.first + cell.count; f++) {
+					const Box& boxB = m_EntryBoxes[f];
+					if (!Overlap(boxA, boxB)) {
+						continue;
+					}
+					/* Report the pair from one cell only */
+					if (CellKey(level, CellCoordinates(glm::max(boxA.min, boxB.min)) >> level) == cell.key) {
+						blockPairs.push_back(BodyPair{ m_Entries[e].body, m_Entries[f].body });
+					}
+				}
+			}
+		}
+	});
+	ThreadPool::RunTasks(pool, NumBlocks(numQueries), [&](int block) {
+		std::vector<BodyPair>& blockPairs = m_BlockPairs[numCellBlocks + block];
+		blockPairs.clear();
+		const int begin = block * BLOCK_SIZE, end = BlockEnd(block, numQueries);
+
+		/* Both lists are sorted by key, so after one search the cells are found by walking forward */
+		int c = (int)(std::lower_bound(m_Cells.begin(), m_Cells.end(), m_Queries[begin].key,
+			[](const Cell& cell, uint64_t key) { return cell.key < key; }) - m_Cells.begin());
+		for (int q = begin; q < end && c < numCells; q++) {
+			const Entry& query = m_Queries[q];
+			while (c < numCells && m_Cells[c].key < query.key) {
+				c++;
+			}
+			if (c == numCells || m_Cells[c].key != query.key) {
+				continue;
+			}
+			const Cell& cell = m_Cells[c];
+			const int level = (int)(cell.key >> (3 * m_CoordinateBits));
+			const int a = query.body;
+			const Box& boxA = m_Boxes[a];
+			for (int e = cell.first; e < cell.first + cell.count; e++) {
+				const Box& boxB = m_EntryBoxes[e];
+				if (Overlap(boxA, boxB) && CellKey(level, CellCoordinates(glm::max(boxA.min, boxB.min)) >> level) == cell.key) {
+					int b = m_Entries[e].body;
+					blockPairs.push_back(a < b ? BodyPair{ a, b } : BodyPair{ b, a });
+				}
+			}
+		}
+	});
+	MergePairs(m_BlockPairs, count, pairs);
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class ThreadPool;
+struct TransformBatch;
+
+/* World space axis aligned bounds of many bodies, one array per coordinate */
+class BoundsArrays {
+public:
+	void Resize(int count) {
+		for (int axis = 0; axis < 3; axis++) {
+			m_Min[axis].resize(count);
+			m_Max[axis].resize(count);
+		}
+	}
+	inline int GetCount() const { return (int)m_Min[0].size(); }
+
+	inline void Set(int i, const glm::vec3& min, const glm::vec3& max) {
+		for (int axis = 0; axis < 3; axis++) {
+			m_Min[axis][i] = min[axis];
+			m_Max[axis][i] = max[axis];
+		}
+	}
+	inline glm::vec3 GetMin(int i) const { return glm::vec3(m_Min[0][i], m_Min[1][i], m_Min[2][i]); }
+	inline glm::vec3 GetMax(int i) const { return glm::vec3(m_Max[0][i], m_Max[1][i], m_Max[2][i]); }
+
+	inline const std::vector<float>& GetMinArray(int axis) const { return m_Min[axis]; }
+	inline const std::vector<float>& GetMaxArray(int axis) const { return m_Max[axis]; }
+
+	/* Touching bounds count as overlapping */
+	inline bool Overlap(int a, int b) const {
+		return m_Min[0][a] <= m_Max[0][b] && m_Min[0][b] <= m_Max[0][a] &&
+			m_Min[1][a] <= m_Max[1][b] && m_Min[1][b] <= m_Max[1][a] &&
+			m_Min[2][a] <= m_Max[2][b] && m_Min[2][b] <= m_Max[2][a];
+	}
+
+	/*
+		Bounds of boxes centred on the transform origins: the half extents (hx, hy, hz per body, in local space) are
+		scaled and rotated, so each half size is |R S| h. Resizes to the batch count.
+	*/
+	void Update(const TransformBatch& transforms, const float* hx, const float* hy, const float* hz, ThreadPool* pool = nullptr);
+
+private:
+	std::vector<float> m_Min[3];
+	std::vector<float> m_Max[3];
+};
+
+/* Two bodies with overlapping bounds, a < b */
+struct BodyPair {
+	int a, b;
+
+	inline bool operator==(const BodyPair& other) const { return a == other.a && b == other.b; }
+	inline bool operator<(const BodyPair& other) const { return a < other.a || (a == other.a && b < other.b); }
+};
+
+/*
+	Broad phase collision detection: finds every pair of bodies whose bounds overlap. The pair list is sorted by a
+	and then b, so every implementation gives the same list for the same bounds, whatever the number of threads.
+
+	Implementations may keep state from one call to the next to exploit temporal coherence; bodies are identified
+	by their index into the bounds arrays, and a change in the body count starts over.
+*/
+class BroadPhase {
+public:
+	enum class Type { SweepAndPrune, MultiLevelGrid };
+	static const int NUM_TYPES = 2;
+
+	virtual ~BroadPhase() {}
+
+	virtual Type GetType() const = 0;
+	virtual void FindPairs(const BoundsArrays& bounds, std::vector<BodyPair>& pairs, ThreadPool* pool = nullptr) = 0;
+	/* Drops the state kept between calls */
+	virtual void Clear() = 0;
+
+	/* Size of the internal state in bytes (for memory reporting) */
+	virtual size_t GetMemoryUsage() const = 0;
+
+	static std::unique_ptr<BroadPhase> Create(Type type);
+	static const char* GetName(Type type);
+};
+
+/*
+	Incremental sweep and prune on one axis. The bodies are kept in order of their minimum on the sweep axis, and
+	since bodies move little between frames, re-sorting the order with insertion sort takes close to linear time.
+	The sweep then tests each body against the bodies that start before it ends, on the other two axes.
+
+	The sweep axis is the one with the largest spread of body centres, chosen whenever the order is rebuilt (on the
+	first call and whenever the body count changes).
+*/
+class SweepAndPrune final : public BroadPhase {
+public:
+	Type GetType() const override { return Type::SweepAndPrune; }
+	void FindPairs(const BoundsArrays& bounds, std::vector<BodyPair>& pairs, ThreadPool* pool = nullptr) override;
+	void Clear() override;
+	size_t GetMemoryUsage() const override;
+
+	inline int GetAxis() const { return m_Axis; }
+	/* Swaps made by the insertion sort in the last call (0 after a rebuild) */
+	inline int64_t GetLastSwaps() const { return m_LastSwaps; }
+
+private:
+	int m_Axis = -1;
+	std::vector<int> m_Order; //Body indices by minimum on the sweep axis
+	std::vector<float> m_Keys; //Minimum on the sweep axis, in sweep order
+	std::vector<float> m_Sorted[5]; //Maximum on the sweep axis, then minimum and maximum on the other two, in sweep order
+	int64_t m_LastSwaps = 0;
+	std::vector<std::vector<BodyPair>> m_BlockPairs;
+
+	void Rebuild(const BoundsArrays& bounds);
+};
+
+/*
+	Hierarchical uniform grid (as in Mirtich 1996 and Ericson, Real-Time Collision Detection 7.2). Level l has cells
+	of size cellSize * 2^l, where cellSize is the smallest body extent, and each body is inserted at the first level
+	whose cells are at least as big as the body, so it overlaps at most 8 cells there whatever the spread of sizes.
+
+	Rather than hashing cells, the grid is rebuilt every call by radix sorting (cell key, body) entries, which keeps
+	memory access sequential. Bodies sharing a cell are tested against each other, and each body looks itself up in
+	the occupied coarser levels by sorting its queries the same way and merging them with the cells. A pair that
+	shares several cells is reported only from the cell holding the minimum corner of the intersection of the bounds.
+*/
+class MultiLevelGrid final : public BroadPhase {
+public:
+	static const int MAX_LEVELS = 16;
+
+	Type GetType() const override { return Type::MultiLevelGrid; }
+	void FindPairs(const BoundsArrays& bounds, std::vector<BodyPair>& pairs, ThreadPool* pool = nullptr) override;
+	void Clear() override;
+	size_t GetMemoryUsage() const override;
+
+	inline float GetCellSize() const { return m_CellSize; }
+	inline int GetNumCells() const { return (int)m_Cells.size(); }
+	inline int GetNumLevels() const { return m_NumLevels; }
+
+private:
+	struct Entry {
+		uint64_t key; //Level, then cell coordinates
+		int body;
+	};
+
+	struct Box {
+		glm::vec3 min, max;
+	};
+
+	static inline bool Overlap(const Box& a, const Box& b) {
+		return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+	}
+
+	struct Cell {
+		uint64_t key;
+		int first, count; //Range in m_Entries
+	};
+
+	/* Cells overlapped on level 0; since cell sizes double, level l coordinates are these shifted right by l */
+	struct CellRange {
+		glm::ivec3 lo, hi;
+	};
+
+	glm::vec3 m_Origin = glm::vec3(0.0f);
+	float m_CellSize = 1.0f;
+	int m_NumLevels = 0;
+	int m_CoordinateBits = 1;
+	std::vector<Box> m_Boxes; //Per body
+	std::vector<uint8_t> m_Levels; //Per body
+	std::vector<CellRange> m_Ranges; //Per body
+	std::vector<int> m_EntryOffsets, m_QueryOffsets; //Per body, plus one
+	std::vector<Entry> m_Entries; //Cells of each body on its own level, sorted by key and then body
+	std::vector<Box> m_EntryBoxes; //Bounds of each entry's body, in entry order
+	std::vector<Entry> m_Queries; //Cells of each body on the occupied coarser levels, sorted the same way
+	std::vector<Entry> m_Scratch;
+	std::vector<Cell> m_Cells; //Sorted by key
+	std::vector<std::vector<BodyPair>> m_BlockPairs;
+
+	/* Level 0 cell holding p */
+	glm::ivec3 CellCoordinates(const glm::vec3& p) const;
+	uint64_t CellKey(int level, const glm::ivec3& cell) const;
+};
@@ -1,10 +1,13 @@
 #include "InertiaTensor.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <vector>
 
+#include "util/ThreadPool.h"
+
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/matrix_access.hpp"
@@ -75,35 +78,21 @@ void readPolyhedron(char *name, POLYHEDRON *p) {
    ============================================================================
 */
 
-int InertiaTensor::A;   /* alpha */
-int InertiaTensor::B;   /* beta */
-int InertiaTensor::C;   /* gamma */
-
-/* projection integrals */
-float InertiaTensor::P1, InertiaTensor::Pa, InertiaTensor::Pb, 
-InertiaTensor::Paa, InertiaTensor::Pab, InertiaTensor::Pbb, 
-InertiaTensor::Paaa, InertiaTensor::Paab, InertiaTensor::Pabb, InertiaTensor::Pbbb;
-
-/* face integrals */
-float InertiaTensor::Fa, InertiaTensor::Fb, InertiaTensor::Fc,
-InertiaTensor::Faa, InertiaTensor::Fbb, InertiaTensor::Fcc,
-InertiaTensor::Faaa, InertiaTensor::Fbbb, InertiaTensor::Fccc, InertiaTensor::Faab, InertiaTensor::Fbbc, InertiaTensor::Fcca;
-
-/* volume integrals */
-float InertiaTensor::T0, InertiaTensor::T1[3], InertiaTensor::T2[3], InertiaTensor::TP[3];
-
 /* compute various integrations over projection of face */
-void InertiaTensor::compProjectionIntegrals(Face * f) {
-	float a0, a1, da;
-	float b0, b1, db;
-	float a0_2, a0_3, a0_4, b0_2, b0_3, b0_4;
-	float a1_2, a1_3, b1_2, b1_3;
-	float C1, Ca, Caa, Caaa, Cb, Cbb, Cbbb;
-	float Cab, Kab, Caab, Kaab, Cabb, Kabb;
+void InertiaTensor::compProjectionIntegrals(const Face& f, int A, int B, ProjectionIntegrals& p) {
+	double a0, a1, da;
+	double b0, b1, db;
+	double a0_2, a0_3, a0_4, b0_2, b0_3, b0_4;
+	double a1_2, a1_3, b1_2, b1_3;
+	double C1, Ca, Caa, Caaa, Cb, Cbb, Cbbb;
+	double Cab, Kab, Caab, Kaab, Cabb, Kabb;
 	int i;
 
+	double P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb;
 	P1 = Pa = Pb = Paa = Pab = Pbb = Paaa = Paab = Pabb = Pbbb = 0.0;
 
+	const glm::vec3* verts[3] = { &f.p0, &f.p1, &f.p2 };
+
 	int numVerts = 3;
 	for (i = 0; i < numVerts; i++) {
 		/*
@@ -112,10 +101,10 @@ void InertiaTensor::compProjectionIntegrals(Face * f) {
 		a1 = f->poly->verts[f->verts[(i + 1) % numVerts]][A];
 		b1 = f->poly->verts[f->verts[(i + 1) % numVerts]][B];
 		*/
-		a0 = f->verts[i][A];
-		b0 = f->verts[i][B];
-		a1 = f->verts[(i + 1) % numVerts][A];
-		b1 = f->verts[(i + 1) % numVerts][B];
+		a0 = (*verts[i])[A];
+		b0 = (*verts[i])[B];
+		a1 = (*verts[(i + 1) % numVerts])[A];
+		b1 = (*verts[(i + 1) % numVerts])[B];
 
 		da = a1 - a0;
 		db = b1 - b0;
@@ -154,17 +143,23 @@ void InertiaTensor::compProjectionIntegrals(Face * f) {
 	Pab /= 24.0;
 	Paab /= 60.0;
 	Pabb /= -60.0;
+
+	p = { P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb };
 }
 
-void InertiaTensor::compFaceIntegrals(Face *f) {
-	float w;
-	float k1, k2, k3, k4;
-	glm::vec3 n;
+void InertiaTensor::compFaceIntegrals(const Face& f, int A, int B, int C, FaceIntegrals& fi) {
+	double w;
+	double k1, k2, k3, k4;
+	glm::dvec3 n;
 
-	compProjectionIntegrals(f);
+	ProjectionIntegrals p;
+	compProjectionIntegrals(f, A, B, p);
+	const double P1 = p.P1, Pa = p.Pa, Pb = p.Pb, Paa = p.Paa, Pab = p.Pab, Pbb = p.Pbb,
+		Paaa = p.Paaa, Paab = p.Paab, Pabb = p.Pabb, Pbbb = p.Pbbb;
+	double Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca;
 
-	w = f->offset;
-	n = f->normal;
+	w = f.offset;
+	n = glm::dvec3(f.normal);
 	k1 = 1 / n[C]; k2 = k1 * k1; k3 = k2 * k1; k4 = k3 * k1;
 
 	Fa = k1 * Pa;
@@ -187,47 +182,106 @@ void InertiaTensor::compFaceIntegrals(Face *f) {
 	Fbbc = -k2 * (n[A] * Pabb + n[B] * Pbbb + w * Pbb);
 	Fcca = k3 * (SQR(n[A])*Paaa + 2 * n[A] * n[B] * Paab + SQR(n[B])*Pabb
 		+ w * (2 * (n[A] * Paa + n[B] * Pab) + w * Pa));
-}
 
-void InertiaTensor::compVolumeIntegrals(std::shared_ptr<Mesh> mesh) {
-	Face *f;
-	float nx, ny, nz;
-	int i;
+	fi = { Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca };
+}
 
-	T0 = T1[X] = T1[Y] = T1[Z]
-		= T2[X] = T2[Y] = T2[Z]
-		= TP[X] = TP[Y] = TP[Z] = 0;
+InertiaTensor::VolumeIntegrals& InertiaTensor::VolumeIntegrals::operator+=(const VolumeIntegrals& other) {
+	T0 += other.T0;
+	for (int i = 0; i < 3; i++) {
+		T1[i] += other.T1[i];
+		T2[i] += other.T2[i];
+		TP[i] += other.TP[i];
+	}
+	return *this;
+}
 
-	for (i = 0; i < mesh->GetNumFaces(); i++) {
+void InertiaTensor::accumulateVolumeIntegrals(const Face* faces, int begin, int end, VolumeIntegrals& T) {
+	double nx, ny, nz;
+	int A, B, C;
+	FaceIntegrals fi;
 
-		f = &mesh->GetFace(i);
+	for (int i = begin; i < end; i++) {
+		const Face& f = faces[i];
+		glm::dvec3 n = glm::dvec3(f.normal);
 
-		nx = fabs(f->normal[X]);
-		ny = fabs(f->normal[Y]);
-		nz = fabs(f->normal[Z]);
+		nx = fabs(n[X]);
+		ny = fabs(n[Y]);
+		nz = fabs(n[Z]);
 		if (nx > ny && nx > nz) C = X;
 		else C = (ny > nz) ? Y : Z;
 		A = (C + 1) % 3;
 		B = (A + 1) % 3;
 
-		compFaceIntegrals(f);
+		compFaceIntegrals(f, A, B, C, fi);
+
+		T.T0 += n[X] * ((A == X) ? fi.Fa : ((B == X) ? fi.Fb : fi.Fc));
+
+		T.T1[A] += n[A] * fi.Faa;
+		T.T1[B] += n[B] * fi.Fbb;
+		T.T1[C] += n[C] * fi.Fcc;
+		T.T2[A] += n[A] * fi.Faaa;
+		T.T2[B] += n[B] * fi.Fbbb;
+		T.T2[C] += n[C] * fi.Fccc;
+		T.TP[A] += n[A] * fi.Faab;
+		T.TP[B] += n[B] * fi.Fbbc;
+		T.TP[C] += n[C] * fi.Fcca;
+	}
+}
+
+/* Applies the final divisions of the volume integrals */
+static void FinishVolumeIntegrals(InertiaTensor::VolumeIntegrals& T) {
+	T.T1[X] /= 2; T.T1[Y] /= 2; T.T1[Z] /= 2;
+	T.T2[X] /= 3; T.T2[Y] /= 3; T.T2[Z] /= 3;
+	T.TP[X] /= 2; T.TP[Y] /= 2; T.TP[Z] /= 2;
+}
 
-		T0 += f->normal[X] * ((A == X) ? Fa : ((B == X) ? Fb : Fc));
+InertiaTensor::VolumeIntegrals InertiaTensor::compVolumeIntegrals(const std::vector<Face>& faces, ThreadPool* pool) {
+	int numFaces = (int)faces.size();
+	int numBlocks = (numFaces + FACE_BLOCK_SIZE - 1) / FACE_BLOCK_SIZE;
+
+	std::vector<VolumeIntegrals> partials(numBlocks);
+	auto reduceBlock = [&](int block) {
+		int begin = block * FACE_BLOCK_SIZE;
+		accumulateVolumeIntegrals(faces.data(), begin, std::min(begin + FACE_BLOCK_SIZE, numFaces), partials[block]);
+	};
+	ThreadPool::RunTasks(pool, numBlocks, reduceBlock);
+
+	VolumeIntegrals T;
+	for (const VolumeIntegrals& partial : partials) {
+		T += partial;
+	}
+	FinishVolumeIntegrals(T);
+	return T;
+}
 
-		T1[A] += f->normal[A] * Faa;
-		T1[B] += f->normal[B] * Fbb;
-		T1[C] += f->normal[C] * Fcc;
-		T2[A] += f->normal[A] * Faaa;
-		T2[B] += f->normal[B] * Fbbb;
-		T2[C] += f->normal[C] * Fccc;
-		TP[A] += f->normal[A] * Faab;
-		TP[B] += f->normal[B] * Fbbc;
-		TP[C] += f->normal[C] * Fcca;
+void InertiaTensor::ComputeBatch(const std::vector<const Mesh*>& meshes, float density, std::vector<MassProps>& results, ThreadPool* pool) {
+	/* Flatten the face blocks of all meshes into one task list */
+	std::vector<int> firstBlock(meshes.size() + 1, 0);
+	for (size_t m = 0; m < meshes.size(); m++) {
+		int numFaces = (int)meshes[m]->GetFaces().size();
+		firstBlock[m + 1] = firstBlock[m] + (numFaces + FACE_BLOCK_SIZE - 1) / FACE_BLOCK_SIZE;
 	}
 
-	T1[X] /= 2; T1[Y] /= 2; T1[Z] /= 2;
-	T2[X] /= 3; T2[Y] /= 3; T2[Z] /= 3;
-	TP[X] /= 2; TP[Y] /= 2; TP[Z] /= 2;
+	std::vector<VolumeIntegrals> partials(firstBlock.back());
+	auto reduceBlock = [&](int task) {
+		size_t m = std::upper_bound(firstBlock.begin(), firstBlock.end(), task) - firstBlock.begin() - 1;
+		const std::vector<Face>& faces = meshes[m]->GetFaces();
+		int begin = (task - firstBlock[m]) * FACE_BLOCK_SIZE;
+		accumulateVolumeIntegrals(faces.data(), begin, std::min(begin + FACE_BLOCK_SIZE, (int)faces.size()), partials[task]);
+	};
+	ThreadPool::RunTasks(pool, (int)partials.size(), reduceBlock);
+
+	/* Blocks are added in the same order as compVolumeIntegrals, so batched results match the single mesh path exactly */
+	results.resize(meshes.size());
+	for (size_t m = 0; m < meshes.size(); m++) {
+		VolumeIntegrals T;
+		for (int block = firstBlock[m]; block < firstBlock[m + 1]; block++) {
+			T += partials[block];
+		}
+		FinishVolumeIntegrals(T);
+		results[m] = FromVolumeIntegrals(T, density);
+	}
 }
 
 
@@ -237,14 +291,25 @@ void InertiaTensor::compVolumeIntegrals(std::shared_ptr<Mesh> mesh) {
    ============================================================================
 */
 
-InertiaTensor::MassProps InertiaTensor::Compute(std::shared_ptr<Mesh> mesh, float density) {
-	float mass;
-	float r[3];            /* center of mass */
-	float J[3][3];         /* inertia tensor */
-
+InertiaTensor::MassProps InertiaTensor::Compute(const std::vector<Face>& faces, float density, ThreadPool* pool) {
 	//readPolyhedron(argv[1], &p);
 
-	InertiaTensor::compVolumeIntegrals(mesh);
+	return FromVolumeIntegrals(InertiaTensor::compVolumeIntegrals(faces, pool), density);
+}
+
+InertiaTensor::MassProps InertiaTensor::FromVolumeIntegrals(const VolumeIntegrals& T, float density) {
+	double mass;
+	double r[3];            /* center of mass */
+	double J[3][3];         /* inertia tensor */
+	const double T0 = T.T0;
+	const double* T1 = T.T1;
+	const double* T2 = T.T2;
+	const double* TP = T.TP;
+
+	/* The integrals assume closed, outward wound faces; anything else gives a volume that is not positive */
+	if (!(T0 > 0.0)) {
+		printf("Mass properties of a mesh with volume %g: its faces are wound inwards or do not enclose a volume\n", T0);
+	}
 
 	/*
 	printf("\nT1 =   %+20.6f\n\n", T0);
@@ -262,8 +327,6 @@ InertiaTensor::MassProps InertiaTensor::Compute(std::shared_ptr<Mesh> mesh, floa
 	printf("Tzx =  %+20.6f\n\n", TP[Z]);
 	*/
 
-	density = 1.0;  /* assume unit density */
-
 	mass = density * T0;
 
 	/* compute center of mass */
@@ -292,7 +355,7 @@ InertiaTensor::MassProps InertiaTensor::Compute(std::shared_ptr<Mesh> mesh, floa
 		J[X][X], J[X][Y], J[X][Z],
 		J[Y][X], J[Y][Y], J[Y][Z],
 		J[Z][X], J[Z][Y], J[Z][Z]
-	), mass, glm::vec3(r[0], r[1], r[2]) });
+	), (float)mass, glm::vec3(r[0], r[1], r[2]) });
 	/*
 	printf("center of mass:  (%+12.6f,%+12.6f,%+12.6f)\n\n", r[X], r[Y], r[Z]);
 
@@ -63,74 +63,53 @@
 #define SQR(x) ((x)*(x))
 #define CUBE(x) ((x)*(x)*(x))
 
+class ThreadPool;
+
+/*
+	Mirtich's polyhedral mass properties for triangle meshes. The integrals are plain values passed between the
+	stages rather than class state, so any number of meshes can be processed concurrently. Faces are reduced in
+	fixed blocks of FACE_BLOCK_SIZE whose partial sums are added in block order, which makes the result independent
+	of the number of threads. All accumulation is done in double precision.
+*/
 class InertiaTensor {
-
-	/*
-	   ============================================================================
-	   data structures
-	   ============================================================================
-	*/
-
-	typedef struct {
-		int numVerts;
-		double norm[3];
-		double w;
-		int verts[MAX_POLYGON_SZ];
-		struct polyhedron *poly;
-	} FACE;
-
-	typedef struct polyhedron {
-		int numVerts, numFaces;
-		double verts[MAX_VERTS][3];
-		FACE faces[MAX_FACES];
-	} POLYHEDRON;
-
-
-	/*
-	   ============================================================================
-	   globals
-	   ============================================================================
-	*/
-
-	static int A;   /* alpha */
-	static int B;   /* beta */
-	static int C;   /* gamma */
+public:
+	static const int FACE_BLOCK_SIZE = 4096;
 
 	/* projection integrals */
-	static float P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb;
+	struct ProjectionIntegrals {
+		double P1, Pa, Pb, Paa, Pab, Pbb, Paaa, Paab, Pabb, Pbbb;
+	};
 
 	/* face integrals */
-	static float Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca;
+	struct FaceIntegrals {
+		double Fa, Fb, Fc, Faa, Fbb, Fcc, Faaa, Fbbb, Fccc, Faab, Fbbc, Fcca;
+	};
 
 	/* volume integrals */
-	static float T0, T1[3], T2[3], TP[3];
+	struct VolumeIntegrals {
+		double T0 = 0.0, T1[3] = { 0.0, 0.0, 0.0 }, T2[3] = { 0.0, 0.0, 0.0 }, TP[3] = { 0.0, 0.0, 0.0 };
 
+		VolumeIntegrals& operator+=(const VolumeIntegrals& other);
+	};
 
-	/*
-	   ============================================================================
-	   compute mass properties
-	   ============================================================================
-	*/
-public:
-	/* compute various integrations over projection of face */
-	static void compProjectionIntegrals(Face *f);
-	static void compFaceIntegrals(Face *f);
-	static void compVolumeIntegrals(std::shared_ptr<Mesh> mesh);
-
-
-	/*
-	   ============================================================================
-	   main
-	   ============================================================================
-	*/
-
-	InertiaTensor() {};
-	~InertiaTensor() {};
 	struct MassProps {
 		glm::mat3 Ibody; //Inertia tensor in body space
 		float mass;
 		glm::vec3 com; //Center of mass
 	};
 
-	static MassProps Compute(std::shared_ptr<Mesh> mesh, float density);
-};
\ No newline at end of file
+	/* compute various integrations over projection of face (A, B span the projection plane, C is the normal axis) */
+	static void compProjectionIntegrals(const Face& f, int A, int B, ProjectionIntegrals& p);
+	static void compFaceIntegrals(const Face& f, int A, int B, int C, FaceIntegrals& fi);
+	/* Unscaled integrals over faces [begin, end), before the final divisions */
+	static void accumulateVolumeIntegrals(const Face* faces, int begin, int end, VolumeIntegrals& T);
+	static VolumeIntegrals compVolumeIntegrals(const std::vector<Face>& faces, ThreadPool* pool = nullptr);
+
+	static MassProps Compute(const std::vector<Face>& faces, float density, ThreadPool* pool = nullptr);
+	static MassProps Compute(std::shared_ptr<Mesh> mesh, float density) { return Compute(mesh->GetFaces(), density); }
+
+	/* Mass properties of many meshes at once; every face block of every mesh is a separate task */
+	static void ComputeBatch(const std::vector<const Mesh*>& meshes, float density, std::vector<MassProps>& results, ThreadPool* pool = nullptr);
+
+	static MassProps FromVolumeIntegrals(const VolumeIntegrals& T, float density);
+};
@@ -0,0 +1,306 @@
+/* The SIMD paths must round exactly like the scalar one, so GCC may not fuse the multiplies and adds (MSVC never does) */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "KallayKernel.h"
+
+#include <algorithm>
+
+#include "util/CpuFeatures.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	const int NUM_SUMS = 10;
+
+	/* One block of triangles as coordinate streams, padded with degenerate (zero volume) triangles to a multiple of 8 */
+	struct TriangleBlock {
+		double x1[KallayKernel::BLOCK_SIZE], y1[KallayKernel::BLOCK_SIZE], z1[KallayKernel::BLOCK_SIZE];
+		double x2[KallayKernel::BLOCK_SIZE], y2[KallayKernel::BLOCK_SIZE], z2[KallayKernel::BLOCK_SIZE];
+		double x3[KallayKernel::BLOCK_SIZE], y3[KallayKernel::BLOCK_SIZE], z3[KallayKernel::BLOCK_SIZE];
+		int count; //Padded count
+	};
+
+	void Gather(const float* positions, const unsigned int* indices, int first, int numTriangles, TriangleBlock& block) {
+		for (int t = 0; t < numTriangles; t++) {
+			const unsigned int* tri = indices + (size_t)(first + t) * 3;
+			const float* p1 = positions + (size_t)tri[0] * 3;
+			const float* p2 = positions + (size_t)tri[1] * 3;
+			const float* p3 = positions + (size_t)tri[2] * 3;
+			block.x1[t] = p1[0]; block.y1[t] = p1[1]; block.z1[t] = p1[2];
+			block.x2[t] = p2[0]; block.y2[t] = p2[1]; block.z2[t] = p2[2];
+			block.x3[t] = p3[0]; block.y3[t] = p3[1]; block.z3[t] = p3[2];
+		}
+		block.count = (numTriangles + 7) & ~7;
+		for (int t = numTriangles; t < block.count; t++) {
+			block.x1[t] = block.y1[t] = block.z1[t] = 0.0;
+			block.x2[t] = block.y2[t] = block.z2[t] = 0.0;
+			block.x3[t] = block.y3[t] = block.z3[t] = 0.0;
+		}
+	}
+
+	/* Kahan summation: sum += value, carrying the lost low-order bits in compensation */
+	inline void KahanAdd(double& sum, double& compensation, double value) {
+		double y = value - compensation;
+		double t = sum + y;
+		compensation = (t - sum) - y;
+		sum = t;
+	}
+
+	struct ScalarAccumulator {
+		double sum[NUM_SUMS] = {};
+		double compensation[NUM_SUMS] = {};
+
+		void Add(int i, double value) { KahanAdd(sum[i], compensation[i], value); }
+	};
+
+	void AccumulateScalar(const TriangleBlock& b, int begin, ScalarAccumulator& acc) {
+		for (int t = begin; t < b.count; t++) {
+			double x1 = b.x1[t], y1 = b.y1[t], z1 = b.z1[t];
+			double x2 = b.x2[t], y2 = b.y2[t], z2 = b.z2[t];
+			double x3 = b.x3[t], y3 = b.y3[t], z3 = b.z3[t];
+
+			// Signed volume of this tetrahedron (see the orientation note in KallayKernel.h)
+			double v = x1 * y2*z3 + y1 * z2*x3 + x2 * y3*z1 - (x3*y2*z1 + x2 * y1*z3 + y3 * z2*x1);
+			double x4 = x1 + x2 + x3;
+			double y4 = y1 + y2 + y3;
+			double z4 = z1 + z2 + z3;
+
+			acc.Add(0, v);
+			acc.Add(1, v * x4);
+			acc.Add(2, v * y4);
+			acc.Add(3, v * z4);
+			acc.Add(4, v * (x1*x1 + x2 * x2 + x3 * x3 + x4 * x4));
+			acc.Add(5, v * (y1*y1 + y2 * y2 + y3 * y3 + y4 * y4));
+			acc.Add(6, v * (z1*z1 + z2 * z2 + z3 * z3 + z4 * z4));
+			acc.Add(7, v * (y1*x1 + y2 * x2 + y3 * x3 + y4 * x4));
+			acc.Add(8, v * (z1*x1 + z2 * x2 + z3 * x3 + z4 * x4));
+			acc.Add(9, v * (z1*y1 + z2 * y2 + z3 * y3 + z4 * y4));
+		}
+	}
+
+#if SIMD_X86
+	struct SSEAccumulator {
+		__m128d sum[NUM_SUMS];
+		__m128d compensation[NUM_SUMS];
+
+		SSEAccumulator() {
+			for (int i = 0; i < NUM_SUMS; i++) {
+				sum[i] = compensation[i] = _mm_setzero_pd();
+			}
+		}
+
+		inline void Add(int i, __m128d value) {
+			__m128d y = _mm_sub_pd(value, compensation[i]);
+			__m128d t = _mm_add_pd(sum[i], y);
+			compensation[i] = _mm_sub_pd(_mm_sub_pd(t, sum[i]), y);
+			sum[i] = t;
+		}
+	};
+
+	/* x1*x1 + x2*x2 + x3*x3 + x4*x4 style monomial sums for two triangles */
+	inline __m128d Monomial(__m128d a1, __m128d b1, __m128d a2, __m128d b2, __m128d a3, __m128d b3, __m128d a4, __m128d b4) {
+		return _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a1, b1), _mm_mul_pd(a2, b2)), _mm_mul_pd(a3, b3)), _mm_mul_pd(a4, b4));
+	}
+
+	inline void AccumulateSSE2(const TriangleBlock& b, int t, SSEAccumulator& acc) {
+		__m128d x1 = _mm_loadu_pd(b.x1 + t), y1 = _mm_loadu_pd(b.y1 + t), z1 = _mm_loadu_pd(b.z1 + t);
+		__m128d x2 = _mm_loadu_pd(b.x2 + t), y2 = _mm_loadu_pd(b.y2 + t), z2 = _mm_loadu_pd(b.z2 + t);
+		__m128d x3 = _mm_loadu_pd(b.x3 + t), y3 = _mm_loadu_pd(b.y3 + t), z3 = _mm_loadu_pd(b.z3 + t);
+
+		__m128d positive = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(x1, y2), z3), _mm_mul_pd(_mm_mul_pd(y1, z2), x3)), _mm_mul_pd(_mm_mul_pd(x2, y3), z1));
+		__m128d negative = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(x3, y2), z1), _mm_mul_pd(_mm_mul_pd(x2, y1), z3)), _mm_mul_pd(_mm_mul_pd(y3, z2), x1));
+		__m128d v = _mm_sub_pd(positive, negative);
+		__m128d x4 = _mm_add_pd(_mm_add_pd(x1, x2), x3);
+		__m128d y4 = _mm_add_pd(_mm_add_pd(y1, y2), y3);
+		__m128d z4 = _mm_add_pd(_mm_add_pd(z1, z2), z3);
+
+		acc.Add(0, v);
+		acc.Add(1, _mm_mul_pd(v, x4));
+		acc.Add(2, _mm_mul_pd(v, y4));
+		acc.Add(3, _mm_mul_pd(v, z4));
+		acc.Add(4, _mm_mul_pd(v, Monomial(x1, x1, x2, x2, x3, x3, x4, x4)));
+		acc.Add(5, _mm_mul_pd(v, Monomial(y1, y1, y2, y2, y3, y3, y4, y4)));
+		acc.Add(6, _mm_mul_pd(v, Monomial(z1, z1, z2, z2, z3, z3, z4, z4)));
+		acc.Add(7, _mm_mul_pd(v, Monomial(y1, x1, y2, x2, y3, x3, y4, x4)));
+		acc.Add(8, _mm_mul_pd(v, Monomial(z1, x1, z2, x2, z3, x3, z4, x4)));
+		acc.Add(9, _mm_mul_pd(v, Monomial(z1, y1, z2, y2, z3, y3, z4, y4)));
+	}
+
+	/* Four triangles per step, as two independent accumulators to hide the latency of the compensated additions */
+	void AccumulateSSE(const TriangleBlock& b, SSEAccumulator acc[2]) {
+		for (int t = 0; t < b.count; t += 4) {
+			AccumulateSSE2(b, t, acc[0]);
+			AccumulateSSE2(b, t + 2, acc[1]);
+		}
+	}
+
+	struct AVXAccumulator {
+		__m256d sum[NUM_SUMS];
+		__m256d compensation[NUM_SUMS];
+	};
+
+	TARGET_AVX2 inline void ClearAVX(AVXAccumulator& acc) {
+		for (int i = 0; i < NUM_SUMS; i++) {
+			acc.sum[i] = acc.compensation[i] = _mm256_setzero_pd();
+		}
+	}
+
+	TARGET_AVX2 inline void AddAVX(AVXAccumulator& acc, int i, __m256d value) {
+		__m256d y = _mm256_sub_pd(value, acc.compensation[i]);
+		__m256d t = _mm256_add_pd(acc.sum[i], y);
+		acc.compensation[i] = _mm256_sub_pd(_mm256_sub_pd(t, acc.sum[i]), y);
+		acc.sum[i] = t;
+	}
+
+	TARGET_AVX2 inline __m256d MonomialAVX(__m256d a1, __m256d b1, __m256d a2, __m256d b2, __m256d a3, __m256d b3, __m256d a4, __m256d b4) {
+		return _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a1, b1), _mm256_mul_pd(a2, b2)), _mm256_mul_pd(a3, b3)), _mm256_mul_pd(a4, b4));
+	}
+
+	/* Multiplies and adds stay separate (see the top of the file), so every lane rounds exactly like the scalar path */
+	TARGET_AVX2 inline void AccumulateAVX4(const TriangleBlock& b, int t, AVXAccumulator& acc) {
+		__m256d x1 = _mm256_loadu_pd(b.x1 + t), y1 = _mm256_loadu_pd(b.y1 + t), z1 = _mm256_loadu_pd(b.z1 + t);
+		__m256d x2 = _mm256_loadu_pd(b.x2 + t), y2 = _mm256_loadu_pd(b.y2 + t), z2 = _mm256_loadu_pd(b.z2 + t);
+		__m256d x3 = _mm256_loadu_pd(b.x3 + t), y3 = _mm256_loadu_pd(b.y3 + t), z3 = _mm256_loadu_pd(b.z3 + t);
+
+		__m256d positive = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(x1, y2), z3), _mm256_mul_pd(_mm256_mul_pd(y1, z2), x3)), _mm256_mul_pd(_mm256_mul_pd(x2, y3), z1));
+		__m256d negative = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(x3, y2), z1), _mm256_mul_pd(_mm256_mul_pd(x2, y1), z3)), _mm256_mul_pd(_mm256_mul_pd(y3, z2), x1));
+		__m256d v = _mm256_sub_pd(positive, negative);
+		__m256d x4 = _mm256_add_pd(_mm256_add_pd(x1, x2), x3);
+		__m256d y4 = _mm256_add_pd(_mm256_add_pd(y1, y2), y3);
+		__m256d z4 = _mm256_add_pd(_mm256_add_pd(z1, z2), z3);
+
+		AddAVX(acc, 0, v);
+		AddAVX(acc, 1, _mm256_mul_pd(v, x4));
+		AddAVX(acc, 2, _mm256_mul_pd(v, y4));
+		AddAVX(acc, 3, _mm256_mul_pd(v, z4));
+		AddAVX(acc, 4, _mm256_mul_pd(v, MonomialAVX(x1, x1, x2, x2, x3, x3, x4, x4)));
+		AddAVX(acc, 5, _mm256_mul_pd(v, MonomialAVX(y1, y1, y2, y2, y3, y3, y4, y4)));
+		AddAVX(acc, 6, _mm256_mul_pd(v, MonomialAVX(z1, z1, z2, z2, z3, z3, z4, z4)));
+		AddAVX(acc, 7, _mm256_mul_pd(v, MonomialAVX(y1, x1, y2, x2, y3, x3, y4, x4)));
+		AddAVX(acc, 8, _mm256_mul_pd(v, MonomialAVX(z1, x1, z2, x2, z3, x3, z4, x4)));
+		AddAVX(acc, 9, _mm256_mul_pd(v, MonomialAVX(z1, y1, z2, y2, z3, y3, z4, y4)));
+	}
+
+	/* Eight triangles per step, two accumulators of four lanes */
+	TARGET_AVX2 void AccumulateAVX(const TriangleBlock& b, AVXAccumulator acc[2]) {
+		for (int t = 0; t < b.count; t += 8) {
+			AccumulateAVX4(b, t, acc[0]);
+			AccumulateAVX4(b, t + 4, acc[1]);
+		}
+	}
+
+	/* Spills the lanes (sums and compensations) of a vector accumulator into a scalar one */
+	void MergeLanes(const double* sums, const double* compensations, int numLanes, ScalarAccumulator& out) {
+		for (int i = 0; i < NUM_SUMS; i++) {
+			for (int lane = 0; lane < numLanes; lane++) {
+				out.Add(i, sums[i * numLanes + lane]);
+				out.Add(i, -compensations[i * numLanes + lane]);
+			}
+		}
+	}
+
+	TARGET_AVX2 void SpillAVX(const AVXAccumulator& acc, double* sums, double* compensations) {
+		for (int i = 0; i < NUM_SUMS; i++) {
+			_mm256_storeu_pd(sums + i * 4, acc.sum[i]);
+			_mm256_storeu_pd(compensations + i * 4, acc.compensation[i]);
+		}
+	}
+#endif
+
+}
+
+void KallayKernel::Accumulate(const float* positions, const unsigned int* indices, int numTriangles, KallaySums& sums, Path path) {
+	if (!IsSupported(path)) {
+		path = GetBestPath();
+	}
+
+	TriangleBlock block;
+	ScalarAccumulator total;
+	total.sum[0] = sums.m;
+	total.sum[1] = sums.Cx; total.sum[2] = sums.Cy; total.sum[3] = sums.Cz;
+	total.sum[4] = sums.xx; total.sum[5] = sums.yy; total.sum[6] = sums.zz;
+	total.sum[7] = sums.yx; total.sum[8] = sums.zx; total.sum[9] = sums.zy;
+
+#if SIMD_X86
+	SSEAccumulator sse[2];
+	AVXAccumulator avx[2];
+	if (path == Path::AVX2) {
+		ClearAVX(avx[0]);
+		ClearAVX(avx[1]);
+	}
+#endif
+
+	for (int first = 0; first < numTriangles; first += BLOCK_SIZE) {
+		Gather(positions, indices, first, std::min(BLOCK_SIZE, numTriangles - first), block);
+#if SIMD_X86
+		if (path == Path::AVX2) {
+			AccumulateAVX(block, avx);
+			continue;
+		}
+		if (path == Path::SSE) {
+			AccumulateSSE(block, sse);
+			continue;
+		}
+#endif
+		AccumulateScalar(block, 0, total);
+	}
+
+#if SIMD_X86
+	double laneSums[NUM_SUMS * 4], laneCompensations[NUM_SUMS * 4];
+	for (int a = 0; a < 2; a++) {
+		if (path == Path::AVX2) {
+			SpillAVX(avx[a], laneSums, laneCompensations);
+			MergeLanes(laneSums, laneCompensations, 4, total);
+		} else if (path == Path::SSE) {
+			for (int i = 0; i < NUM_SUMS; i++) {
+				_mm_storeu_pd(laneSums + i * 2, sse[a].sum[i]);
+				_mm_storeu_pd(laneCompensations + i * 2, sse[a].compensation[i]);
+			}
+			MergeLanes(laneSums, laneCompensations, 2, total);
+		}
+	}
+#endif
+
+	/* Fold the remaining compensation back into the sums */
+	for (int i = 0; i < NUM_SUMS; i++) {
+		total.sum[i] -= total.compensation[i];
+	}
+	sums.m = total.sum[0];
+	sums.Cx = total.sum[1]; sums.Cy = total.sum[2]; sums.Cz = total.sum[3];
+	sums.xx = total.sum[4]; sums.yy = total.sum[5]; sums.zz = total.sum[6];
+	sums.yx = total.sum[7]; sums.zx = total.sum[8]; sums.zy = total.sum[9];
+}
+
+KallayKernel::Path KallayKernel::GetBestPath() {
+	if (IsSupported(Path::AVX2)) {
+		return Path::AVX2;
+	}
+	if (IsSupported(Path::SSE)) {
+		return Path::SSE;
+	}
+	return Path::Scalar;
+}
+
+bool KallayKernel::IsSupported(Path path) {
+	switch (path) {
+#if SIMD_X86
+	case Path::SSE: return CpuFeatures::Get().sse2;
+	case Path::AVX2: return CpuFeatures::Get().avx2;
+#endif
+	case Path::Scalar: return true;
+	default: return false;
+	}
+}
+
+const char* KallayKernel::GetName(Path path) {
+	switch (path) {
+	case Path::SSE: return "SSE";
+	case Path::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
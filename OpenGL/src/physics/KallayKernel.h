@@ -0,0 +1,36 @@
+#pragma once
+
+/* The ten running sums of Kallay's method: six times the volume, the centroid and the inertia monomials */
+struct KallaySums {
+	double m = 0.0;
+	double Cx = 0.0, Cy = 0.0, Cz = 0.0;
+	double xx = 0.0, yy = 0.0, zz = 0.0, yx = 0.0, zx = 0.0, zy = 0.0;
+};
+
+/*
+	Vectorized accumulation of Kallay's tetrahedron sums over an indexed triangle mesh.
+
+	Triangles are gathered in blocks of BLOCK_SIZE into structure-of-arrays double streams (one stream per vertex
+	coordinate), then the signed volumes and the ten monomial sums are computed 4 (SSE2) or 8 (AVX2) triangles at a
+	time. Every sum keeps a Kahan compensation term per lane and the lanes are combined with compensated additions,
+	so the result is as accurate as the scalar path despite the different summation order.
+
+	Each triangle forms a tetrahedron with the origin whose signed volume is det(v1, v2, v3), so the faces must be
+	wound consistently: the tetrahedra outside the mesh then cancel and the sums hold the solid wherever the origin
+	lies. Outward (counter-clockwise) winding gives positive sums and inward winding negates all of them.
+*/
+class KallayKernel {
+public:
+	enum class Path { Scalar, SSE, AVX2 };
+
+	static const int BLOCK_SIZE = 256;
+
+	static void Accumulate(const float* positions, const unsigned int* indices, int numTriangles, KallaySums& sums, Path path);
+	static void Accumulate(const float* positions, const unsigned int* indices, int numTriangles, KallaySums& sums) {
+		Accumulate(positions, indices, numTriangles, sums, GetBestPath());
+	}
+
+	static Path GetBestPath();
+	static bool IsSupported(Path path);
+	static const char* GetName(Path path);
+};
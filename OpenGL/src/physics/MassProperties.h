@@ -2,6 +2,7 @@
 
 //Kallay, M. (2006). Computing the Moment of Inertia of a Solid Defined by a Triangle Mesh. Journal of Graphics Tools, 11(2), 5157. https://doi.org/10.1080/2151237X.2006.10129220
 #include "Mesh.h"
+#include "physics/KallayKernel.h"
 
 #include <vector>
 
@@ -17,63 +18,41 @@ struct MassProps {
 
 class MassProperties {
 public:
-	MassProperties(Mesh& mesh) : _m(0.0), _Cx(0.0), _Cy(0.0), _Cz(0.0), _xx(0.0), _yy(0.0), _zz(0.0), _yx(0.0), _zx(0.0), _zy(0.0) {
+	MassProperties() : _m(0.0), _Cx(0.0), _Cy(0.0), _Cz(0.0), _xx(0.0), _yy(0.0), _zz(0.0), _yx(0.0), _zx(0.0), _zy(0.0) {}
+	MassProperties(Mesh& mesh, KallayKernel::Path path = KallayKernel::GetBestPath()) : MassProperties() {
 		std::vector<float>& pos = mesh.GetPositions();
 		std::vector<unsigned int>& inds = mesh.GetIndices();
 
-		//For each triangle, form a tetrahedron and compute its inertial properties
-		glm::vec3 avgRecipe = glm::vec3(1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f);
-		int numTriangles = inds.size() / 3;
-		for (int idx = 0; idx < numTriangles; idx++) {
-			int i = inds[idx * 3];
-			int j = inds[idx * 3 + 1];
-			int k = inds[idx * 3 + 2];
-			glm::vec3 v1 = glm::vec3(pos[i * 3], pos[i * 3 + 1], pos[i * 3 + 2]);
-			glm::vec3 v2 = glm::vec3(pos[j * 3], pos[j * 3 + 1], pos[j * 3 + 2]);
-			glm::vec3 v3 = glm::vec3(pos[k * 3], pos[k * 3 + 1], pos[k * 3 + 2]);
-
-			glm::mat3 A = glm::mat3(
-				v1.x, v1.y, v1.z,
-				v2.x, v2.y, v2.z,
-				v3.x, v3.y, v3.z);
-
-			glm::mat3 Aprime = glm::mat3(
-				v1.x, v1.y, v1.z,
-				v3.x, v3.y, v3.z,				
-				v2.x, v2.y, v2.z);
-
-			// Compute the determinant and make sure it is not negative (and if it is, flip the order of the vertices)
-			float detA = glm::determinant(A);
-			float detAprime = glm::determinant(Aprime);
-
-			//Check that the origin is on the inside of the facet
-			glm::vec3 avg = A * avgRecipe;
-			glm::vec3 normal = glm::normalize(glm::cross(v2 - v1, v3 - v1));
-			float dotProd = glm::dot(avg, normal);
-
-			//If the origin is on the inner side of the face, the determinant must be positive
-			if (dotProd < 0) {
-				AddTriangleContribution(
-					v1.x, v1.y, v1.z,
-					v2.x, v2.y, v2.z,
-					v3.x, v3.y, v3.z);
-			} else {
-				AddTriangleContribution(
-					v1.x, v1.y, v1.z,
-					v3.x, v3.y, v3.z,
-					v2.x, v2.y, v2.z);
-			}			
-		}
-
-		double _Ixx, _Iyy, _Izz,
+		//For each triangle, form a tetrahedron with the origin and accumulate its contribution (see KallayKernel.h)
+		KallaySums sums;
+		KallayKernel::Accumulate(pos.data(), inds.data(), (int)(inds.size() / 3), sums, path);
+
+		//Every sum carries the sign of the winding, so a mesh wound inwards comes out negated as a whole
+		double sign = sums.m < 0.0 ? -1.0 : 1.0;
+		_m = sign * sums.m;
+		_Cx = sign * sums.Cx; _Cy = sign * sums.Cy; _Cz = sign * sums.Cz;
+		_xx = sign * sums.xx; _yy = sign * sums.yy; _zz = sign * sums.zz;
+		_yx = sign * sums.yx; _zx = sign * sums.zx; _zy = sign * sums.zy;
+
+		double m, Cx, Cy, Cz, _Ixx, _Iyy, _Izz,
 			_Iyx, _Izx, _Izy;
 		GetResults(
-			_m, _Cx, _Cy, _Cz,
+			m, Cx, Cy, Cz,
 			_Ixx, _Iyy, _Izz,
 			_Iyx, _Izx, _Izy);
+
+		//Unit density; the mixed entries are products of inertia so enter the tensor negated
+		m_Results.mass = (float)m;
+		m_Results.com = glm::vec3(Cx, Cy, Cz);
+		m_Results.I = glm::mat3(
+			_Ixx, -_Iyx, -_Izx,
+			-_Iyx, _Iyy, -_Izy,
+			-_Izx, -_Izy, _Izz);
 	}
 	~MassProperties() {}
 
+	const MassProps& GetMassProps() const { return m_Results; }
+
 /**********************************************************************
 Add the contribution of a triangle to the mass properties.
 Call this method for each one of the mesh's triangles.
@@ -85,24 +64,6 @@ void AddTriangleContribution(
 	double x2, double y2, double z2,    // Triangle's vertex 2
 	double x3, double y3, double z3)    // Triangle's vertex 3
 {
-	
-	glm::mat3 A = glm::mat3(
-		x1, y1, z1,
-		x2, y2, z2,
-		x3, y3, z3);
-
-	glm::mat3 Aprime = glm::mat3(
-		x1, y1, z1,
-		x3, y3, z3,
-		x2, y2, z2);
-
-
-	// Compute the determinant and make sure it is not negative (and if it is, flip the order of the vertices)
-	float detA = glm::determinant(A);
-	float detAprime = glm::determinant(Aprime);
-
-	
-	
 	// Signed volume of this tetrahedron.
 	double v = x1 * y2*z3 + y1 * z2*x3 + x2 * y3*z1 - (x3*y2*z1 + x2 * y1*z3 + y3 * z2*x1);
 
@@ -167,4 +128,5 @@ private:
 	double _m;                              // Mass
 	double _Cx, _Cy, _Cz;                   // Centroid
 	double _xx, _yy, _zz, _yx, _zx, _zy;    // Moment of inertia tensor
+	MassProps m_Results;
 };
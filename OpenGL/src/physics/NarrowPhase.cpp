@@ -0,0 +1,762 @@
+#include "NarrowPhase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "geometry/ConvexHull.h"
+
+/* GJK stops once an iteration brings the closest point no more than this much (relative to its square) closer */
+static const double GJK_RELATIVE_TOLERANCE = 1e-10;
+/* Squared distances this small next to the simplex size count as touching */
+static const double GJK_OVERLAP_TOLERANCE = 1e-14;
+/* EPA stops once the polytope is within this much (relative to the shape size) of the boundary */
+static const double EPA_RELATIVE_TOLERANCE = 1e-6;
+
+ConvexShape ConvexShape::Sphere(float radius, const glm::vec3& position) {
+	ConvexShape shape;
+	shape.type = Type::Sphere;
+	shape.radius = radius;
+	shape.position = position;
+	return shape;
+}
+
+ConvexShape ConvexShape::Box(const glm::vec3& halfExtents, const glm::vec3& position, const glm::quat& rotation) {
+	ConvexShape shape;
+	shape.type = Type::Box;
+	shape.halfExtents = halfExtents;
+	shape.position = position;
+	shape.rotation = rotation;
+	return shape;
+}
+
+ConvexShape ConvexShape::Hull(const ConvexHull& hull, const glm::vec3& position, const glm::quat& rotation) {
+	ConvexShape shape;
+	shape.type = Type::Hull;
+	shape.hull = &hull;
+	shape.position = position;
+	shape.rotation = rotation;
+	return shape;
+}
+
+float ConvexShape::GetBoundingRadius() const {
+	switch (type) {
+	case Type::Box:
+		return glm::length(halfExtents);
+	case Type::Hull: {
+		float radius2 = 0.0f;
+		for (const glm::vec3& vertex : hull->GetVertices()) {
+			radius2 = std::max(radius2, glm::dot(vertex, vertex));
+		}
+		return std::sqrt(radius2);
+	}
+	default:
+		return radius;
+	}
+}
+
+glm::vec3 ConvexShape::SupportCore(const glm::vec3& direction, int& feature) const {
+	switch (type) {
+	case Type::Box: {
+		glm::vec3 local = glm::conjugate(rotation) * direction;
+		glm::vec3 corner;
+		feature = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			bool positive = local[axis] >= 0.0f;
+			corner[axis] = positive ? halfExtents[axis] : -halfExtents[axis];
+			feature |= (positive ? 1 : 0) << axis;
+		}
+		return ToWorld(corner);
+	}
+	case Type::Hull: {
+		feature = hull->Support(glm::conjugate(rotation) * direction, feature);
+		return ToWorld(hull->GetVertices()[feature]);
+	}
+	default:
+		feature = 0;
+		return position;
+	}
+}
+
+namespace {
+
+	/* Vertex of the Minkowski difference A - B, with the points on A and B it came from */
+	struct SupportPoint {
+		glm::dvec3 w, a, b;
+		int featureA, featureB;
+	};
+
+	/* Barycentric weights are kept alongside the points that support the closest point */
+	struct Simplex {
+		SupportPoint points[4];
+		double weights[4];
+		int count = 0;
+
+		void Keep(int i0) {
+			points[0] = points[i0];
+			weights[0] = 1.0;
+			count = 1;
+		}
+		void Keep(int i0, int i1, double w0, double w1) {
+			SupportPoint p0 = points[i0], p1 = points[i1];
+			points[0] = p0; points[1] = p1;
+			weights[0] = w0; weights[1] = w1;
+			count = 2;
+		}
+		void Keep(int i0, int i1, int i2, double w0, double w1, double w2) {
+			SupportPoint p0 = points[i0], p1 = points[i1], p2 = points[i2];
+			points[0] = p0; points[1] = p1; points[2] = p2;
+			weights[0] = w0; weights[1] = w1; weights[2] = w2;
+			count = 3;
+		}
+
+		glm::dvec3 PointA() const {
+			glm::dvec3 p(0.0);
+			for (int i = 0; i < count; i++) {
+				p += points[i].a * weights[i];
+			}
+			return p;
+		}
+		glm::dvec3 PointB() const {
+			glm::dvec3 p(0.0);
+			for (int i = 0; i < count; i++) {
+				p += points[i].b * weights[i];
+			}
+			return p;
+		}
+		/* Vertices of the point with the largest weight */
+		uint32_t Feature() const {
+			int best = 0;
+			for (int i = 1; i < count; i++) {
+				if (weights[i] > weights[best]) {
+					best = i;
+				}
+			}
+			return ((uint32_t)points[best].featureA << 16) | ((uint32_t)points[best].featureB & 0xFFFF);
+		}
+	};
+
+	/* Support of A - B along d: of the cores only, or of the whole shapes. Hull searches start from the vertices of from */
+	SupportPoint Support(const ConvexShape& a, const ConvexShape& b, const glm::dvec3& d, bool withMargins, const SupportPoint* from = nullptr) {
+		SupportPoint p;
+		p.featureA = from ? from->featureA : 0;
+		p.featureB = from ? from->featureB : 0;
+		glm::vec3 direction(d);
+		p.a = glm::dvec3(a.SupportCore(direction, p.featureA));
+		p.b = glm::dvec3(b.SupportCore(-direction, p.featureB));
+		if (withMargins) {
+			glm::dvec3 n = d / glm::length(d);
+			p.a += n * (double)a.GetMargin();
+			p.b -= n * (double)b.GetMargin();
+		}
+		p.w = p.a - p.b;
+		return p;
+	}
+
+	glm::dvec3 ClosestOnSegment(Simplex& s, int i0, int i1) {
+		const glm::dvec3 a = s.points[i0].w, ab = s.points[i1].w - a;
+		double t = -glm::dot(a, ab), denominator = glm::dot(ab, ab);
+		if (t <= 0.0 || denominator <= 0.0) {
+			s.Keep(i0);
+			return a;
+		}
+		if (t >= denominator) {
+			s.Keep(i1);
+			return s.points[0].w;
+		}
+		t /= denominator;
+		s.Keep(i0, i1, 1.0 - t, t);
+		return a + ab * t;
+	}
+
+	/* Closest point of triangle (i0, i1, i2) to the origin, by Voronoi regions (Ericson 5.1.5) */
+	glm::dvec3 ClosestOnTriangle(Simplex& s, int i0, int i1, int i2) {
+		const glm::dvec3 a = s.points[i0].w, b = s.points[i1].w, c = s.points[i2].w;
+		const glm::dvec3 ab = b - a, ac = c - a;
+
+		double d1 = -glm::dot(ab, a), d2 = -glm::dot(ac, a);
+		if (d1 <= 0.0 && d2 <= 0.0) {
+			s.Keep(i0);
+			return a;
+		}
+		double d3 = -glm::dot(ab, b), d4 = -glm::dot(ac, b);
+		if (d3 >= 0.0 && d4 <= d3) {
+			s.Keep(i1);
+			return b;
+		}
+		double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+			double v = d1 / (d1 - d3);
+			s.Keep(i0, i1, 1.0 - v, v);
+			return a + ab * v;
+		}
+		double d5 = -glm::dot(ab, c), d6 = -glm::dot(ac, c);
+		if (d6 >= 0.0 && d5 <= d6) {
+			s.Keep(i2);
+			return c;
+		}
+		double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+			double w = d2 / (d2 - d6);
+			s.Keep(i0, i2, 1.0 - w, w);
+			return a + ac * w;
+		}
+		double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) {
+			double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			s.Keep(i1, i2, 1.0 - w, w);
+			return b + (c - b) * w;
+		}
+		double sum = va + vb + vc;
+		if (sum <= 0.0) {
+			/* Degenerate triangle: the closest point is on its longest edge */
+			double lab = glm::dot(ab, ab), lac = glm::dot(ac, ac), lbc = glm::dot(c - b, c - b);
+			if (lab >= lac && lab >= lbc) {
+				return ClosestOnSegment(s, i0, i1);
+			}
+			return lac >= lbc ? ClosestOnSegment(s, i0, i2) : ClosestOnSegment(s, i1, i2);
+		}
+		double v = vb / sum, w = vc / sum;
+		s.Keep(i0, i1, i2, 1.0 - v - w, v, w);
+		return a + ab * v + ac * w;
+	}
+
+	/* Closest point of the tetrahedron to the origin; leaves the simplex whole if the origin is inside */
+	glm::dvec3 ClosestOnTetrahedron(Simplex& s) {
+		static const int FACES[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } }; //Three vertices, then the opposite one
+		const glm::dvec3 a = s.points[0].w;
+		double volume = glm::dot(s.points[3].w - a, glm::cross(s.points[1].w - a, s.points[2].w - a));
+		double scale = glm::dot(s.points[1].w - a, s.points[1].w - a) + glm::dot(s.points[2].w - a, s.points[2].w - a) +
+			glm::dot(s.points[3].w - a, s.points[3].w - a);
+		bool flat = std::abs(volume) <= 1e-12 * scale * std::sqrt(scale);
+
+		Simplex best = s;
+		glm::dvec3 closest(0.0);
+		double bestDistance = -1.0;
+		for (const int* face : FACES) {
+			const glm::dvec3 p0 = s.points[face[0]].w;
+			glm::dvec3 n = glm::cross(s.points[face[1]].w - p0, s.points[face[2]].w - p0);
+			double originSide = -glm::dot(n, p0), vertexSide = glm::dot(n, s.points[face[3]].w - p0);
+			if (!flat && originSide * vertexSide >= 0.0) {
+				continue; //The origin is on the inner side of this face
+			}
+			Simplex candidate = s;
+			glm::dvec3 p = ClosestOnTriangle(candidate, face[0], face[1], face[2]);
+			double distance = glm::dot(p, p);
+			if (bestDistance < 0.0 || distance < bestDistance) {
+				bestDistance = distance;
+				best = candidate;
+				closest = p;
+			}
+		}
+		if (bestDistance < 0.0) {
+			return glm::dvec3(0.0);
+		}
+		s = best;
+		return closest;
+	}
+
+	glm::dvec3 ClosestPoint(Simplex& s) {
+		switch (s.count) {
+		case 1: s.weights[0] = 1.0; return s.points[0].w;
+		case 2: return ClosestOnSegment(s, 0, 1);
+		case 3: return ClosestOnTriangle(s, 0, 1, 2);
+		default: return ClosestOnTetrahedron(s);
+		}
+	}
+
+	/*
+		GJK between the cores (or the whole shapes). Returns true if they overlap, with the simplex enclosing (or, when
+		touching, reaching) the origin; otherwise v is the closest point of A - B to the origin.
+	*/
+	bool RunGjk(const ConvexShape& a, const ConvexShape& b, bool withMargins, Simplex& s, glm::dvec3& v, int& iterations) {
+		v = glm::dvec3(a.position - b.position);
+		if (glm::dot(v, v) == 0.0) {
+			v = glm::dvec3(1.0, 0.0, 0.0);
+		}
+		s.count = 0;
+		for (iterations = 0; iterations < NarrowPhase::MAX_GJK_ITERATIONS; iterations++) {
+			SupportPoint p = Support(a, b, -v, withMargins, s.count > 0 ? &s.points[s.count - 1] : nullptr);
+			if (s.count > 0) {
+				double vv = glm::dot(v, v);
+				if (vv - glm::dot(v, p.w) <= GJK_RELATIVE_TOLERANCE * vv) {
+					return false; //No support point gets closer to the origin
+				}
+				for (int i = 0; i < s.count; i++) {
+					if (s.points[i].w == p.w) {
+						return false;
+					}
+				}
+			}
+			double previous = s.count > 0 ? glm::dot(v, v) : -1.0;
+			s.points[s.count++] = p;
+			v = ClosestPoint(s);
+
+			double maxSize = 0.0;
+			for (int i = 0; i < s.count; i++) {
+				maxSize = std::max(maxSize, glm::dot(s.points[i].w, s.points[i].w));
+			}
+			if (s.count == 4 || glm::dot(v, v) <= GJK_OVERLAP_TOLERANCE * maxSize) {
+				return true;
+			}
+			if (previous >= 0.0 && glm::dot(v, v) >= previous) {
+				return false; //Rounding stopped the progress
+			}
+		}
+		return false;
+	}
+
+	struct EpaFace {
+		int v[3];
+		glm::dvec3 normal; //Unit, outward
+		double distance; //Of the plane from the origin
+	};
+
+	bool MakeFace(const std::vector<SupportPoint>& vertices, int i0, int i1, int i2, EpaFace& face) {
+		glm::dvec3 n = glm::cross(vertices[i1].w - vertices[i0].w, vertices[i2].w - vertices[i0].w);
+		double length = glm::length(n);
+		if (length <= 0.0) {
+			return false;
+		}
+		face.v[0] = i0; face.v[1] = i1; face.v[2] = i2;
+		face.normal = n / length;
+		face.distance = glm::dot(face.normal, vertices[i0].w);
+		return true;
+	}
+
+	/*
+		Barycentric weights of the origin's projection on a face, from the areas of the sub-triangles it makes with
+		each edge; false if the projection lies outside the face, in which case the weights are still filled in
+	*/
+	bool FaceWeights(const std::vector<SupportPoint>& vertices, const EpaFace& face, double weights[3]) {
+		const glm::dvec3 p = face.normal * face.distance;
+		const glm::dvec3& w0 = vertices[face.v[0]].w;
+		const glm::dvec3& w1 = vertices[face.v[1]].w;
+		const glm::dvec3& w2 = vertices[face.v[2]].w;
+		const double area = glm::dot(glm::cross(w1 - w0, w2 - w0), face.normal);
+		weights[0] = glm::dot(glm::cross(w1 - p, w2 - p), face.normal) / area;
+		weights[1] = glm::dot(glm::cross(w2 - p, w0 - p), face.normal) / area;
+		weights[2] = 1.0 - weights[0] - weights[1];
+		const double slack = -1e-9;
+		return weights[0] >= slack && weights[1] >= slack && weights[2] >= slack;
+	}
+
+	/* Grows the GJK simplex to a tetrahedron around the origin; false if the shapes are flat where they touch */
+	bool CompleteTetrahedron(const ConvexShape& a, const ConvexShape& b, Simplex& s, double tolerance) {
+		if (s.count == 1) {
+			const glm::dvec3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+			for (const glm::dvec3& axis : axes) {
+				SupportPoint p = Support(a, b, axis, true);
+				if (glm::length(p.w - s.points[0].w) > tolerance) {
+					s.points[s.count++] = p;
+					break;
+				}
+			}
+		}
+		if (s.count == 2) {
+			/* Search around the segment for a point off its line */
+			glm::dvec3 d = glm::normalize(s.points[1].w - s.points[0].w);
+			glm::dvec3 axis = std::abs(d.x) < std::abs(d.y) ? (std::abs(d.x) < std::abs(d.z) ? glm::dvec3(1, 0, 0) : glm::dvec3(0, 0, 1))
+				: (std::abs(d.y) < std::abs(d.z) ? glm::dvec3(0, 1, 0) : glm::dvec3(0, 0, 1));
+			glm::dvec3 u = glm::normalize(glm::cross(d, axis));
+			for (int step = 0; step < 6; step++) {
+				SupportPoint p = Support(a, b, u, true);
+				if (glm::length(glm::cross(p.w - s.points[0].w, d)) > tolerance) {
+					s.points[s.count++] = p;
+					break;
+				}
+				u = glm::normalize(u * 0.5 + glm::cross(d, u) * 0.8660254037844386); //60 degrees about d
+			}
+		}
+		if (s.count == 3) {
+			glm::dvec3 n = glm::cross(s.points[1].w - s.points[0].w, s.points[2].w - s.points[0].w);
+			if (glm::dot(n, n) > 0.0) {
+				n = glm::normalize(n);
+				SupportPoint p = Support(a, b, n, true);
+				if (std::abs(glm::dot(p.w - s.points[0].w, n)) <= tolerance) {
+					p = Support(a, b, -n, true);
+				}
+				if (std::abs(glm::dot(p.w - s.points[0].w, n)) > tolerance) {
+					s.points[s.count++] = p;
+				}
+			}
+		}
+		return s.count == 4;
+	}
+
+	/* EPA from a simplex of the whole shapes around the origin */
+	bool RunEpa(const ConvexShape& a, const ConvexShape& b, Simplex& s, ContactPoint& contact) {
+		double size = 0.0;
+		for (int i = 0; i < s.count; i++) {
+			size = std::max(size, glm::length(s.points[i].w));
+		}
+		const double tolerance = EPA_RELATIVE_TOLERANCE * std::max(size, 1e-30);
+		if (!CompleteTetrahedron(a, b, s, tolerance)) {
+			return false;
+		}
+
+		std::vector<SupportPoint> vertices(s.points, s.points + 4);
+		if (glm::dot(glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w), vertices[3].w - vertices[0].w) > 0.0) {
+			std::swap(vertices[1], vertices[2]);
+		}
+		std::vector<EpaFace> faces;
+		const int TETRAHEDRON[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+		for (const int* f : TETRAHEDRON) {
+			EpaFace face;
+			if (!MakeFace(vertices, f[0], f[1], f[2], face)) {
+				return false;
+			}
+			faces.push_back(face);
+		}
+
+		std::vector<std::pair<int, int>> horizon;
+		int closest = 0;
+		for (int iteration = 0; iteration < NarrowPhase::MAX_EPA_ITERATIONS; iteration++) {
+			closest = 0;
+			for (int f = 1; f < (int)faces.size(); f++) {
+				if (faces[f].distance < faces[closest].distance) {
+					closest = f;
+				}
+			}
+			const EpaFace nearest = faces[closest];
+			SupportPoint p = Support(a, b, nearest.normal, true, &vertices[nearest.v[0]]);
+			if (glm::dot(p.w, nearest.normal) - nearest.distance <= tolerance) {
+				break;
+			}
+
+			/* Remove every face the new point sees and close the hole with faces to the point */
+			horizon.clear();
+			int newVertex = (int)vertices.size();
+			vertices.push_back(p);
+			for (int f = 0; f < (int)faces.size(); ) {
+				if (glm::dot(faces[f].normal, p.w - vertices[faces[f].v[0]].w) > 0.0) {
+					for (int e = 0; e < 3; e++) {
+						std::pair<int, int> edge(faces[f].v[e], faces[f].v[(e + 1) % 3]);
+						auto twin = std::find(horizon.begin(), horizon.end(), std::make_pair(edge.second, edge.first));
+						if (twin != horizon.end()) {
+							horizon.erase(twin);
+						} else {
+							horizon.push_back(edge);
+						}
+					}
+					faces[f] = faces.back();
+					faces.pop_back();
+				} else {
+					f++;
+				}
+			}
+			for (const std::pair<int, int>& edge : horizon) {
+				EpaFace face;
+				if (MakeFace(vertices, edge.first, edge.second, newVertex, face)) {
+					faces.push_back(face);
+				}
+			}
+			if (faces.empty()) {
+				faces.push_back(nearest);
+				closest = 0;
+				break;
+			}
+			closest = 0;
+		}
+		for (int f = 1; f < (int)faces.size(); f++) {
+			if (faces[f].distance < faces[closest].distance) {
+				closest = f;
+			}
+		}
+
+		/*
+			Witness points from the barycentric coordinates of the origin's projection on the closest face. A flat
+			side of the Minkowski difference (a box resting on a face) is split into several faces at the same
+			distance, and the projection need not fall inside the one found first, so the face that holds it is
+			preferred. The weights are not clamped: clamping would move the point along the face and pull the
+			witness points out of line with the normal.
+		*/
+		double weights[3];
+		int chosen = -1;
+		for (int f = 0; f < (int)faces.size() && chosen < 0; f++) {
+			if (faces[f].distance - faces[closest].distance <= tolerance && FaceWeights(vertices, faces[f], weights)) {
+				chosen = f;
+			}
+		}
+		if (chosen < 0) {
+			chosen = closest;
+			FaceWeights(vertices, faces[chosen], weights);
+		}
+
+		const EpaFace& face = faces[chosen];
+		Simplex triangle;
+		triangle.count = 3;
+		for (int i = 0; i < 3; i++) {
+			triangle.points[i] = vertices[face.v[i]];
+			triangle.weights[i] = weights[i];
+		}
+
+		contact.pointA = glm::vec3(triangle.PointA());
+		contact.pointB = glm::vec3(triangle.PointB());
+		contact.normal = glm::vec3(face.normal);
+		contact.depth = (float)face.distance;
+		contact.feature = triangle.Feature();
+		return true;
+	}
+
+}
+
+/* Distance result from a GJK run that ended with the cores apart */
+static void SeparatedResult(const ConvexShape& a, const ConvexShape& b, const Simplex& s, const glm::dvec3& v, NarrowPhase::DistanceResult& result) {
+	double length = glm::length(v);
+	glm::dvec3 normal = -v / length;
+	glm::dvec3 pointA = s.PointA() + normal * (double)a.GetMargin();
+	glm::dvec3 pointB = s.PointB() - normal * (double)b.GetMargin();
+	result.distance = (float)(length - (double)a.GetMargin() - (double)b.GetMargin());
+	result.pointA = glm::vec3(pointA);
+	result.pointB = glm::vec3(pointB);
+	result.normal = glm::vec3(normal);
+	result.feature = s.Feature();
+}
+
+bool NarrowPhase::Distance(const ConvexShape& a, const ConvexShape& b, DistanceResult& result) {
+	Simplex s;
+	glm::dvec3 v;
+	if (RunGjk(a, b, false, s, v, result.iterations)) {
+		return false;
+	}
+	SeparatedResult(a, b, s, v, result);
+	return true;
+}
+
+bool NarrowPhase::Overlap(const ConvexShape& a, const ConvexShape& b) {
+	DistanceResult result;
+	return !Distance(a, b, result) || result.distance <= 0.0f;
+}
+
+bool NarrowPhase::Collide(const ConvexShape& a, const ConvexShape& b, ContactPoint& contact, float contactDistance) {
+	Simplex s;
+	glm::dvec3 v;
+	int iterations;
+	if (!RunGjk(a, b, false, s, v, iterations)) {
+		DistanceResult result;
+		SeparatedResult(a, b, s, v, result);
+		if (result.distance > contactDistance) {
+			return false;
+		}
+		contact.pointA = result.pointA;
+		contact.pointB = result.pointB;
+		contact.normal = result.normal;
+		contact.depth = -result.distance;
+		contact.feature = result.feature;
+	} else if (a.type == ConvexShape::Type::Sphere && b.type == ConvexShape::Type::Sphere) {
+		/* Two spheres whose cores overlap share a centre: EPA has no volume to work with, and every direction is as deep */
+		contact.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		contact.pointA = a.position + contact.normal * a.radius;
+		contact.pointB = b.position - contact.normal * b.radius;
+		contact.depth = a.radius + b.radius;
+		contact.feature = 0;
+	} else {
+		/* The cores overlap; with margins, EPA needs a simplex of the whole shapes rather than of the cores */
+		if (a.GetMargin() > 0.0f || b.GetMargin() > 0.0f) {
+			RunGjk(a, b, true, s, v, iterations);
+		}
+		if (!RunEpa(a, b, s, contact)) {
+			/* Touching where both shapes are flat: no depth to resolve and no well defined normal */
+			glm::vec3 centres = b.position - a.position;
+			contact.pointA = contact.pointB = glm::vec3(s.PointA());
+			contact.normal = glm::dot(centres, centres) > 0.0f ? glm::normalize(centres) : glm::vec3(0.0f, 1.0f, 0.0f);
+			contact.depth = 0.0f;
+			contact.feature = s.Feature();
+		}
+	}
+	contact.localA = a.ToLocal(contact.pointA);
+	contact.localB = b.ToLocal(contact.pointB);
+	contact.normalImpulse = 0.0f;
+	contact.tangentImpulse[0] = contact.tangentImpulse[1] = 0.0f;
+	contact.lifetime = 0;
+	return true;
+}
+
+int ContactManifold::Update(const ConvexShape& a, const ConvexShape& b, int perturbations) {
+	ContactPoint contact;
+	const bool touching = NarrowPhase::Collide(a, b, contact, m_BreakingDistance);
+	if (a.type == ConvexShape::Type::Sphere || b.type == ConvexShape::Type::Sphere) {
+		/* A sphere touches at a single point, which moves over its surface as it rolls: the new point takes the old one's impulses */
+		if (touching && m_NumPoints > 0) {
+			contact.normalImpulse = m_Points[0].normalImpulse;
+			contact.tangentImpulse[0] = m_Points[0].tangentImpulse[0];
+			contact.tangentImpulse[1] = m_Points[0].tangentImpulse[1];
+			contact.lifetime = m_Points[0].lifetime + 1;
+		}
+		m_NumPoints = touching ? 1 : 0;
+		m_Points[0] = contact;
+		return m_NumPoints;
+	}
+	Refresh(a, b, touching ? &contact.normal : nullptr);
+	if (!touching) {
+		return m_NumPoints;
+	}
+	Add(contact);
+	if (perturbations <= 0 || m_NumPoints >= MAX_POINTS) {
+		return m_NumPoints;
+	}
+
+	/*
+		Tilt the smaller shape about axes across the normal, by an angle that moves it no more than the breaking
+		distance, and collide again; each tilt finds the corner on that side. The tilted point is carried back with
+		the shape and the depth measured along the original normal, as for a refreshed point.
+	*/
+	const bool tiltA = a.GetBoundingRadius() < b.GetBoundingRadius();
+	const ConvexShape& original = tiltA ? a : b;
+	float angle = m_BreakingDistance / std::max(original.GetBoundingRadius(), 1e-6f);
+	if (angle > MAX_PERTURBATION_ANGLE) {
+		angle = MAX_PERTURBATION_ANGLE;
+	}
+	const glm::vec3 n = contact.normal;
+	glm::vec3 u = glm::normalize(std::abs(n.x) < 0.57735f ? glm::vec3(0.0f, n.z, -n.y) : glm::vec3(n.y, -n.x, 0.0f));
+	glm::vec3 v = glm::cross(n, u);
+	for (int i = 0; i < perturbations; i++) {
+		/* Half a step off the tangents, which for boxes lie along the edges: a tilt about an edge lowers two corners alike */
+		float turn = 6.2831853f * (i + 0.5f) / perturbations;
+		ConvexShape tilted = original;
+		tilted.rotation = glm::normalize(glm::angleAxis(angle, u * std::cos(turn) + v * std::sin(turn)) * original.rotation);
+
+		ContactPoint p;
+		if (!NarrowPhase::Collide(tiltA ? tilted : a, tiltA ? b : tilted, p, m_BreakingDistance)) {
+			continue;
+		}
+		if (tiltA) {
+			p.pointA = a.ToWorld(tilted.ToLocal(p.pointA));
+		} else {
+			p.pointB = b.ToWorld(tilted.ToLocal(p.pointB));
+		}
+		p.normal = n;
+		p.depth = glm::dot(p.pointA - p.pointB, n);
+		if (p.depth < -m_BreakingDistance) {
+			continue;
+		}
+		/*
+			The point found on the other shape belongs to the tilted pose and has moved across the normal with the
+			tilt; put it straight across from the carried point instead, so the pair lines up as a refreshed one does
+		*/
+		if (tiltA) {
+			p.pointB = p.pointA - n * p.depth;
+		} else {
+			p.pointA = p.pointB + n * p.depth;
+		}
+		p.localA = a.ToLocal(p.pointA);
+		p.localB = b.ToLocal(p.pointB);
+		Add(p);
+	}
+	return m_NumPoints;
+}
+
+/* Cosine of the largest turn of the normal that keeps a point (and its cached impulses) in the manifold */
+static const float MIN_NORMAL_COSINE = 0.95f;
+
+void ContactManifold::Refresh(const ConvexShape& a, const ConvexShape& b, const glm::vec3* normal) {
+	const float breaking2 = m_BreakingDistance * m_BreakingDistance;
+	int kept = 0;
+	for (int i = 0; i < m_NumPoints; i++) {
+		ContactPoint p = m_Points[i];
+		if (normal) {
+			if (glm::dot(p.normal, *normal) < MIN_NORMAL_COSINE) {
+				continue;
+			}
+			p.normal = *normal;
+		}
+		p.pointA = a.ToWorld(p.localA);
+		p.pointB = b.ToWorld(p.localB);
+		glm::vec3 offset = p.pointA - p.pointB;
+		p.depth = glm::dot(offset, p.normal);
+
+		/* Drop points that have separated along the normal or slid apart across it */
+		glm::vec3 slide = offset - p.normal * p.depth;
+		if (p.depth < -m_BreakingDistance || glm::dot(slide, slide) > breaking2) {
+			continue;
+		}
+		p.lifetime++;
+		m_Points[kept++] = p;
+	}
+	m_NumPoints = kept;
+}
+
+/* Share of the breaking distance by which a new point has to be deeper than all the others to displace one regardless of area */
+static const float DEPTH_TOLERANCE = 0.1f;
+
+/* Largest area spanned by four points, over the three ways of pairing them into diagonals */
+static float Area4(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) {
+	float a = glm::length(glm::cross(p0 - p1, p2 - p3));
+	float b = glm::length(glm::cross(p0 - p2, p1 - p3));
+	float c = glm::length(glm::cross(p0 - p3, p1 - p2));
+	return std::max(a, std::max(b, c));
+}
+
+void ContactManifold::Add(const ContactPoint& contact) {
+	/*
+		Of the points within the breaking distance on both shapes, the one with the same feature, or otherwise the
+		nearest, is the same contact. A feature alone is not enough: where faces touch, the vertices reported are
+		whichever ones span the closest face of the Minkowski difference, and the same pair can come with a point
+		anywhere on the touching face.
+	*/
+	int match = -1;
+	bool sameFeature = false;
+	float nearest = m_BreakingDistance * m_BreakingDistance;
+	for (int i = 0; i < m_NumPoints; i++) {
+		glm::vec3 dA = m_Points[i].localA - contact.localA;
+		glm::vec3 dB = m_Points[i].localB - contact.localB;
+		float distance2 = std::max(glm::dot(dA, dA), glm::dot(dB, dB));
+		if (distance2 >= m_BreakingDistance * m_BreakingDistance) {
+			continue;
+		}
+		bool feature = m_Points[i].feature == contact.feature;
+		if ((feature && !sameFeature) || (feature == sameFeature && distance2 < nearest)) {
+			match = i;
+			sameFeature = feature;
+			nearest = distance2;
+		}
+	}
+	if (match >= 0) {
+		ContactPoint& point = m_Points[match];
+		ContactPoint updated = contact;
+		updated.normalImpulse = point.normalImpulse;
+		updated.tangentImpulse[0] = point.tangentImpulse[0];
+		updated.tangentImpulse[1] = point.tangentImpulse[1];
+		updated.lifetime = point.lifetime;
+		point = updated;
+		return;
+	}
+	if (m_NumPoints < MAX_POINTS) {
+		m_Points[m_NumPoints++] = contact;
+		return;
+	}
+
+	/*
+		Full: keep the deepest point and replace whichever other point leaves the largest area. Unless the new point
+		is clearly the deepest, that area has to beat the current one: on a resting face the narrow phase returns
+		some point inside the face every frame, which would otherwise keep displacing a corner.
+	*/
+	int deepest = 0;
+	for (int i = 1; i < MAX_POINTS; i++) {
+		if (m_Points[i].depth > m_Points[deepest].depth) {
+			deepest = i;
+		}
+	}
+	const bool newDeepest = contact.depth > m_Points[deepest].depth;
+	const bool clearlyDeepest = contact.depth > m_Points[deepest].depth + DEPTH_TOLERANCE * m_BreakingDistance;
+	int replace = -1;
+	float bestArea = clearlyDeepest ? -1.0f : Area4(m_Points[0].localA, m_Points[1].localA, m_Points[2].localA, m_Points[3].localA);
+	for (int i = 0; i < MAX_POINTS; i++) {
+		if (i == deepest && !newDeepest) {
+			continue;
+		}
+		glm::vec3 p[MAX_POINTS];
+		for (int j = 0; j < MAX_POINTS; j++) {
+			p[j] = j == i ? contact.localA : m_Points[j].localA;
+		}
+		float area = Area4(p[0], p[1], p[2], p[3]);
+		if (area > bestArea) {
+			bestArea = area;
+			replace = i;
+		}
+	}
+	if (replace >= 0) {
+		m_Points[replace] = contact;
+	}
+}
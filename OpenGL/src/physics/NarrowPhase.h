@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+class ConvexHull;
+
+/*
+	Convex shape given by its support mapping, placed in the world by a position and a unit rotation.
+
+	A sphere is handled as a point with a margin of its radius: GJK runs on the cores (the shapes without their
+	margins) and the margins are added afterwards, which makes sphere queries exact instead of iterating towards a
+	curved surface. Two spheres with the same centre are resolved directly, since their cores have no extent for
+	EPA to expand. Boxes and hulls have no margin.
+*/
+struct ConvexShape {
+	enum class Type { Sphere, Box, Hull };
+
+	Type type = Type::Sphere;
+	float radius = 0.0f; //Sphere
+	glm::vec3 halfExtents = glm::vec3(0.0f); //Box
+	const ConvexHull* hull = nullptr; //Hull, in local space; not owned
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+	static ConvexShape Sphere(float radius, const glm::vec3& position);
+	static ConvexShape Box(const glm::vec3& halfExtents, const glm::vec3& position, const glm::quat& rotation);
+	static ConvexShape Hull(const ConvexHull& hull, const glm::vec3& position, const glm::quat& rotation);
+
+	inline float GetMargin() const { return type == Type::Sphere ? radius : 0.0f; }
+	/* Radius of a sphere about the local origin that holds the shape */
+	float GetBoundingRadius() const;
+
+	/*
+		Point of the core farthest along a world direction, and the vertex it is (0 for a sphere). For a hull, feature
+		may hold a vertex to start the search from (as ConvexHull::Support), or -1.
+	*/
+	glm::vec3 SupportCore(const glm::vec3& direction, int& feature) const;
+
+	inline glm::vec3 ToWorld(const glm::vec3& local) const { return position + rotation * local; }
+	inline glm::vec3 ToLocal(const glm::vec3& world) const { return glm::conjugate(rotation) * (world - position); }
+};
+
+/* Closest or deepest points between two shapes; the normal points from A to B */
+struct ContactPoint {
+	glm::vec3 pointA, pointB; //World space, on the surfaces
+	glm::vec3 localA, localB; //The same points in the local space of each shape
+	glm::vec3 normal;
+	float depth = 0.0f; //Penetration depth, negative when the shapes are apart
+	uint32_t feature = 0; //Shape A vertex in the high 16 bits, shape B vertex in the low 16 bits
+
+	/* Solver state carried over from frame to frame by ContactManifold, for warm starting */
+	float normalImpulse = 0.0f;
+	float tangentImpulse[2] = { 0.0f, 0.0f };
+	int lifetime = 0; //Frames the point has been in the manifold
+};
+
+/*
+	Narrow phase queries between convex shapes: GJK (Gilbert, Johnson and Keerthi 1988, with the distance subalgorithm
+	of Ericson, Real-Time Collision Detection 9.5) for the distance between separated shapes, and EPA (van den Bergen
+	2001) for the depth of penetration. Both run in double, since their termination depends on small differences.
+*/
+class NarrowPhase {
+public:
+	static const int MAX_GJK_ITERATIONS = 64;
+	static const int MAX_EPA_ITERATIONS = 64;
+
+	struct DistanceResult {
+		float distance = 0.0f; //Between the shapes including their margins, negative if only the margins overlap
+		glm::vec3 pointA, pointB; //Closest points on the surfaces
+		glm::vec3 normal; //From A to B
+		uint32_t feature = 0;
+		int iterations = 0;
+	};
+
+	/* GJK; returns false if the cores overlap, in which case only iterations is set */
+	static bool Distance(const ConvexShape& a, const ConvexShape& b, DistanceResult& result);
+
+	/* Whether the shapes (including margins) overlap or touch */
+	static bool Overlap(const ConvexShape& a, const ConvexShape& b);
+
+	/*
+		Contact between two shapes closer than contactDistance: from GJK while the cores are apart, from EPA on
+		the whole shapes once they overlap. Returns false if the shapes are farther apart than that.
+	*/
+	static bool Collide(const ConvexShape& a, const ConvexShape& b, ContactPoint& contact, float contactDistance = 0.0f);
+};
+
+/*
+	Contact points between two shapes accumulated over frames, since one narrow phase query gives a single point and
+	a resting box needs up to four (as in Bullet's persistent manifolds).
+
+	Points are stored in the local space of both shapes. Every update moves them with the shapes, drops the ones that
+	have separated or slid apart by more than the breaking distance, and then adds the newest contact: it replaces
+	the point with the same feature, or one close to it, keeping its cached impulses. When the manifold is full, the
+	deepest point stays and the rest are chosen to cover the largest area.
+*/
+class ContactManifold {
+public:
+	static const int MAX_POINTS = 4;
+	/* Largest tilt, in radians, used to look for more points (see Update) */
+	static constexpr float MAX_PERTURBATION_ANGLE = 0.125f;
+
+	explicit ContactManifold(float breakingDistance = 0.02f) : m_BreakingDistance(breakingDistance) {}
+
+	/*
+		Returns the number of points after the update. With perturbations, a manifold that is not yet full also
+		collides the smaller shape tilted slightly in that many directions around the normal (as Bullet does), which
+		finds the corners of a resting face at once instead of waiting for the shapes to rock onto them. A pair with
+		a sphere only ever touches at one point, so its manifold holds just the newest contact.
+	*/
+	int Update(const ConvexShape& a, const ConvexShape& b, int perturbations = 0);
+	void Clear() { m_NumPoints = 0; }
+
+	inline int GetNumPoints() const { return m_NumPoints; }
+	inline const ContactPoint& GetPoint(int i) const { return m_Points[i]; }
+	inline ContactPoint& GetPoint(int i) { return m_Points[i]; }
+	inline float GetBreakingDistance() const { return m_BreakingDistance; }
+
+private:
+	ContactPoint m_Points[MAX_POINTS];
+	int m_NumPoints = 0;
+	float m_BreakingDistance;
+
+	/* Moves the points with the shapes; with a normal, every point takes it on, or is dropped if it turned too far */
+	void Refresh(const ConvexShape& a, const ConvexShape& b, const glm::vec3* normal);
+	void Add(const ContactPoint& contact);
+};
@@ -0,0 +1,562 @@
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "geometry/ConvexHull.h"
+#include "util/ThreadPool.h"
+
+/* Bodies (or manifolds) per parallel task */
+static const int BLOCK_SIZE = 256;
+
+static inline int NumBlocks(int count) {
+	return (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
+
+static inline int BlockEnd(int block, int count) {
+	return std::min((block + 1) * BLOCK_SIZE, count);
+}
+
+static inline std::chrono::high_resolution_clock::time_point Now() {
+	return std::chrono::high_resolution_clock::now();
+}
+
+static float MillisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+	std::chrono::duration<float, std::milli> duration = Now() - start;
+	return duration.count();
+}
+
+/* Symmetric 3x3 matrices stored as xx, yy, zz, xy, xz, yz arrays */
+static inline glm::mat3 LoadSymmetric(const std::vector<float> (&m)[6], int i) {
+	return glm::mat3(
+		m[0][i], m[3][i], m[4][i],
+		m[3][i], m[1][i], m[5][i],
+		m[4][i], m[5][i], m[2][i]);
+}
+
+static inline void StoreSymmetric(std::vector<float> (&m)[6], int i, const glm::mat3& value) {
+	m[0][i] = value[0][0]; m[1][i] = value[1][1]; m[2][i] = value[2][2];
+	m[3][i] = value[0][1]; m[4][i] = value[0][2]; m[5][i] = value[1][2];
+}
+
+/* Two unit vectors completing an orthonormal basis with n; the same n always gives the same pair */
+static inline void TangentBasis(const glm::vec3& n, glm::vec3& t0, glm::vec3& t1) {
+	t0 = glm::normalize(std::abs(n.x) < 0.57735f ? glm::vec3(0.0f, n.z, -n.y) : glm::vec3(n.y, -n.x, 0.0f));
+	t1 = glm::cross(n, t0);
+}
+
+BodyDesc BodyDesc::Box(const glm::vec3& halfExtents, float density, const glm::vec3& position, const glm::quat& rotation) {
+	BodyDesc desc;
+	desc.shape = ConvexShape::Box(halfExtents, position, rotation);
+	desc.mass = density * 8.0f * halfExtents.x * halfExtents.y * halfExtents.z;
+	glm::vec3 h2 = halfExtents * halfExtents;
+	desc.inertia = glm::mat3(desc.mass / 3.0f);
+	desc.inertia[0][0] *= h2.y + h2.z;
+	desc.inertia[1][1] *= h2.x + h2.z;
+	desc.inertia[2][2] *= h2.x + h2.y;
+	desc.scale = 2.0f * halfExtents;
+	return desc;
+}
+
+BodyDesc BodyDesc::Sphere(float radius, float density, const glm::vec3& position) {
+	BodyDesc desc;
+	desc.shape = ConvexShape::Sphere(radius, position);
+	desc.mass = density * 4.18879020f * radius * radius * radius;
+	desc.inertia = glm::mat3(0.4f * desc.mass * radius * radius);
+	desc.scale = glm::vec3(radius);
+	return desc;
+}
+
+PhysicsWorld::PhysicsWorld() : PhysicsWorld(Settings()) {
+}
+
+PhysicsWorld::PhysicsWorld(const Settings& settings) : m_Settings(settings), m_BroadPhase(BroadPhase::Create(settings.broadPhase)) {
+}
+
+int PhysicsWorld::AddBody(const BodyDesc& desc) {
+	const int body = GetNumBodies();
+	const bool isStatic = desc.mass <= 0.0f;
+	const glm::quat rotation = glm::normalize(desc.shape.rotation);
+	const glm::mat3 R = glm::mat3_cast(rotation);
+	const glm::mat3 inertia = isStatic ? glm::mat3(0.0f) : desc.inertia;
+	const glm::mat3 inverseInertia = isStatic ? glm::mat3(0.0f) : glm::inverse(desc.inertia);
+	const glm::vec3 momentum = isStatic ? glm::vec3(0.0f) : desc.mass * desc.linearVelocity;
+	const glm::vec3 angularMomentum = isStatic ? glm::vec3(0.0f) : R * inertia * glm::transpose(R) * desc.angularVelocity;
+
+	for (int axis = 0; axis < 3; axis++) {
+		m_Position[axis].push_back(desc.shape.position[axis]);
+		m_Momentum[axis].push_back(momentum[axis]);
+		m_AngularMomentum[axis].push_back(angularMomentum[axis]);
+		m_Scale[axis].push_back(desc.scale[axis]);
+	}
+	m_Rotation[0].push_back(rotation.x); m_Rotation[1].push_back(rotation.y);
+	m_Rotation[2].push_back(rotation.z); m_Rotation[3].push_back(rotation.w);
+	m_InverseMass.push_back(isStatic ? 0.0f : 1.0f / desc.mass);
+	for (int c = 0; c < 6; c++) {
+		m_Inertia[c].push_back(0.0f);
+		m_InverseInertia[c].push_back(0.0f);
+		m_InverseInertiaWorld[c].push_back(0.0f);
+	}
+	StoreSymmetric(m_Inertia, body, inertia);
+	StoreSymmetric(m_InverseInertia, body, inverseInertia);
+	UpdateWorldInertia(body, body + 1);
+	m_Friction.push_back(desc.friction);
+
+	ConvexShape shape = desc.shape;
+	shape.position = glm::vec3(0.0f);
+	shape.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	m_Shapes.push_back(shape);
+
+	glm::vec3 min, max;
+	switch (shape.type) {
+	case ConvexShape::Type::Box:
+		min = -shape.halfExtents;
+		max = shape.halfExtents;
+		break;
+	case ConvexShape::Type::Hull:
+		min = glm::vec3(FLT_MAX);
+		max = glm::vec3(-FLT_MAX);
+		for (const glm::vec3& vertex : shape.hull->GetVertices()) {
+			min = glm::min(min, vertex);
+			max = glm::max(max, vertex);
+		}
+		break;
+	default:
+		min = glm::vec3(-shape.radius);
+		max = glm::vec3(shape.radius);
+		break;
+	}
+	m_BoundsCentre.push_back(0.5f * (min + max));
+	m_BoundsHalfExtents.push_back(0.5f * (max - min));
+	return body;
+}
+
+void PhysicsWorld::Clear() {
+	for (int axis = 0; axis < 3; axis++) {
+		m_Position[axis].clear();
+		m_Momentum[axis].clear();
+		m_AngularMomentum[axis].clear();
+		m_Scale[axis].clear();
+	}
+	for (int c = 0; c < 4; c++) {
+		m_Rotation[c].clear();
+	}
+	for (int c = 0; c < 6; c++) {
+		m_Inertia[c].clear();
+		m_InverseInertia[c].clear();
+		m_InverseInertiaWorld[c].clear();
+	}
+	m_InverseMass.clear();
+	m_Friction.clear();
+	m_Shapes.clear();
+	m_BoundsCentre.clear();
+	m_BoundsHalfExtents.clear();
+	m_Manifolds.clear();
+	m_PreviousManifolds.clear();
+	m_BroadPhase->Clear();
+	m_Accumulator = 0.0f;
+	m_Stats = StepStats();
+}
+
+void PhysicsWorld::SetBroadPhase(BroadPhase::Type type) {
+	m_Settings.broadPhase = type;
+	m_BroadPhase = BroadPhase::Create(type);
+}
+
+glm::vec3 PhysicsWorld::GetLinearVelocity(int body) const {
+	return m_InverseMass[body] * glm::vec3(m_Momentum[0][body], m_Momentum[1][body], m_Momentum[2][body]);
+}
+
+glm::vec3 PhysicsWorld::GetAngularVelocity(int body) const {
+	return LoadSymmetric(m_InverseInertiaWorld, body) * glm::vec3(m_AngularMomentum[0][body], m_AngularMomentum[1][body], m_AngularMomentum[2][body]);
+}
+
+ConvexShape PhysicsWorld::GetShape(int body) const {
+	ConvexShape shape = m_Shapes[body];
+	shape.position = GetPosition(body);
+	shape.rotation = GetRotation(body);
+	return shape;
+}
+
+TransformBatch PhysicsWorld::GetTransforms(int first, int count) const {
+	TransformBatch batch;
+	batch.px = m_Position[0].data() + first; batch.py = m_Position[1].data() + first; batch.pz = m_Position[2].data() + first;
+	batch.qx = m_Rotation[0].data() + first; batch.qy = m_Rotation[1].data() + first;
+	batch.qz = m_Rotation[2].data() + first; batch.qw = m_Rotation[3].data() + first;
+	batch.sx = m_Scale[0].data() + first; batch.sy = m_Scale[1].data() + first; batch.sz = m_Scale[2].data() + first;
+	batch.count = count;
+	return batch;
+}
+
+int PhysicsWorld::Update(float deltaTime, ThreadPool* pool) {
+	m_Accumulator += deltaTime;
+	int steps = 0;
+	while (m_Accumulator >= m_Settings.timeStep && steps < m_Settings.maxSteps) {
+		Step(pool);
+		m_Accumulator -= m_Settings.timeStep;
+		steps++;
+	}
+	/* Too far behind to catch up: keep only the fraction of a step */
+	if (m_Accumulator >= m_Settings.timeStep) {
+		m_Accumulator = std::fmod(m_Accumulator, m_Settings.timeStep);
+	}
+	return steps;
+}
+
+void PhysicsWorld::Step(ThreadPool* pool) {
+	/* Every phase takes its own start time, so each stat holds that phase alone */
+	auto start = Now();
+	FindContacts(pool);
+	m_Stats.broadPhaseMs = MillisecondsSince(start) - m_Stats.narrowPhaseMs; //FindContacts times the narrow phase itself
+
+	start = Now();
+	BuildIslands();
+	m_Stats.solveMs = MillisecondsSince(start);
+
+	/* The contacts found at the start of the step serve every substep, with their depths following the bodies */
+	const int substeps = std::max(m_Settings.substeps, 1);
+	const float dt = m_Settings.timeStep / substeps;
+	m_Stats.integrateMs = 0.0f;
+	for (int substep = 0; substep < substeps; substep++) {
+		start = Now();
+		ApplyGravity(dt, pool);
+		m_Stats.integrateMs += MillisecondsSince(start);
+
+		/* One task per island: even a single contact pair is iterated enough to outweigh the scheduling */
+		start = Now();
+		ThreadPool::RunTasks(pool, (int)m_Islands.size(), [&](int i) {
+			if (substep == 0) {
+				SetUpIsland(m_Islands[i]);
+			}
+			SolveIsland(m_Islands[i], dt);
+		});
+		m_Stats.solveMs += MillisecondsSince(start);
+
+		start = Now();
+		Integrate(dt, pool);
+		m_Stats.integrateMs += MillisecondsSince(start);
+	}
+}
+
+void PhysicsWorld::ApplyGravity(float dt, ThreadPool* pool) {
+	const int count = GetNumBodies();
+	const glm::vec3 impulse = m_Settings.gravity * dt;
+	m_LinearVelocity.resize(count);
+	m_AngularVelocity.resize(count);
+	m_PseudoLinearVelocity.assign(count, glm::vec3(0.0f));
+	m_PseudoAngularVelocity.assign(count, glm::vec3(0.0f));
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		const int begin = block * BLOCK_SIZE, end = BlockEnd(block, count);
+		for (int i = begin; i < end; i++) {
+			float inverseMass = m_InverseMass[i];
+			if (inverseMass == 0.0f) {
+				m_LinearVelocity[i] = glm::vec3(0.0f);
+				m_AngularVelocity[i] = glm::vec3(0.0f);
+				continue;
+			}
+			for (int axis = 0; axis < 3; axis++) {
+				m_Momentum[axis][i] += impulse[axis] / inverseMass;
+			}
+			m_LinearVelocity[i] = GetLinearVelocity(i);
+			m_AngularVelocity[i] = GetAngularVelocity(i);
+		}
+	});
+}
+
+void PhysicsWorld::FindContacts(ThreadPool* pool) {
+	const int count = GetNumBodies();
+	const float margin = m_Settings.contactDistance;
+
+	/* World bounds of the body space bounds, grown by the contact distance */
+	m_Bounds.Resize(count);
+	ThreadPool::RunTasks(pool, NumBlocks(count), [&](int block) {
+		const int begin = block * BLOCK_SIZE, end = BlockEnd(block, count);
+		for (int i = begin; i < end; i++) {
+			glm::mat3 R = glm::mat3_cast(GetRotation(i));
+			glm::vec3 centre = GetPosition(i) + R * m_BoundsCentre[i];
+			glm::vec3 h = m_BoundsHalfExtents[i];
+			glm::vec3 half = glm::abs(R[0]) * h.x + glm::abs(R[1]) * h.y + glm::abs(R[2]) * h.z + glm::vec3(margin);
+			m_Bounds.Set(i, centre - half, centre + half);
+		}
+	});
+	m_BroadPhase->FindPairs(m_Bounds, m_Pairs, pool);
+
+	/* Carry the manifolds of pairs that still overlap over; both lists are sorted by pair */
+	auto start = Now();
+	std::swap(m_Manifolds, m_PreviousManifolds);
+	m_Manifolds.clear();
+	size_t previous = 0;
+	for (const BodyPair& pair : m_Pairs) {
+		if (m_InverseMass[pair.a] == 0.0f && m_InverseMass[pair.b] == 0.0f) {
+			continue;
+		}
+		while (previous < m_PreviousManifolds.size() && m_PreviousManifolds[previous].pair < pair) {
+			previous++;
+		}
+		if (previous < m_PreviousManifolds.size() && m_PreviousManifolds[previous].pair == pair) {
+			m_Manifolds.push_back(m_PreviousManifolds[previous++]);
+		} else {
+			PairManifold manifold = { pair, ContactManifold(m_Settings.contactDistance) };
+			m_Manifolds.push_back(manifold);
+		}
+	}
+
+	ThreadPool::RunTasks(pool, NumBlocks((int)m_Manifolds.size()), [&](int block) {
+		const int begin = block * BLOCK_SIZE, end = BlockEnd(block, (int)m_Manifolds.size());
+		for (int i = begin; i < end; i++) {
+			PairManifold& m = m_Manifolds[i];
+			m.manifold.Update(GetShape(m.pair.a), GetShape(m.pair.b), m_Settings.perturbations);
+		}
+	});
+	m_Stats.numPairs = (int)m_Manifolds.size();
+	m_Stats.narrowPhaseMs = MillisecondsSince(start);
+}
+
+int PhysicsWorld::FindRoot(int body) {
+	while (m_Parents[body] != body) {
+		m_Parents[body] = m_Parents[m_Parents[body]]; //Path halving
+		body = m_Parents[body];
+	}
+	return body;
+}
+
+void PhysicsWorld::BuildIslands() {
+	const int count = GetNumBodies();
+
+	/* Join dynamic bodies that touch; the lower index becomes the root, so the forest doesn't depend on timing */
+	m_Parents.resize(count);
+	for (int i = 0; i < count; i++) {
+		m_Parents[i] = i;
+	}
+	for (const PairManifold& m : m_Manifolds) {
+		if (m.manifold.GetNumPoints() > 0 && !IsStatic(m.pair.a) && !IsStatic(m.pair.b)) {
+			int a = FindRoot(m.pair.a), b = FindRoot(m.pair.b);
+			if (a != b) {
+				m_Parents[std::max(a, b)] = std::min(a, b);
+			}
+		}
+	}
+
+	/* Number the islands with contacts in order of their first manifold, and count what goes into each */
+	std::vector<int> islandOfRoot(count, -1);
+	m_Islands.clear();
+	int numContacts = 0;
+	for (const PairManifold& m : m_Manifolds) {
+		int points = m.manifold.GetNumPoints();
+		if (points == 0) {
+			continue;
+		}
+		int root = FindRoot(IsStatic(m.pair.a) ? m.pair.b : m.pair.a);
+		if (islandOfRoot[root] < 0) {
+			islandOfRoot[root] = (int)m_Islands.size();
+			m_Islands.push_back(Island{ 0, 0, 0, 0, 0, 0 });
+		}
+		Island& island = m_Islands[islandOfRoot[root]];
+		island.numManifolds++;
+		island.numConstraints += points;
+		numContacts += points;
+	}
+	for (int i = 0; i < count; i++) {
+		if (!IsStatic(i) && islandOfRoot[FindRoot(i)] >= 0) {
+			m_Islands[islandOfRoot[FindRoot(i)]].numBodies++;
+		}
+	}
+
+	/* Lay the islands out one after another and fill them in */
+	int bodies = 0, manifolds = 0, constraints = 0;
+	for (Island& island : m_Islands) {
+		island.firstBody = bodies;
+		island.firstManifold = manifolds;
+		island.firstConstraint = constraints;
+		bodies += island.numBodies;
+		manifolds += island.numManifolds;
+		constraints += island.numConstraints;
+		island.numBodies = island.numManifolds = 0;
+	}
+	m_IslandBodies.resize(bodies);
+	m_IslandManifolds.resize(manifolds);
+	m_Constraints.resize(constraints);
+	for (int i = 0; i < (int)m_Manifolds.size(); i++) {
+		const PairManifold& m = m_Manifolds[i];
+		if (m.manifold.GetNumPoints() > 0) {
+			Island& island = m_Islands[islandOfRoot[FindRoot(IsStatic(m.pair.a) ? m.pair.b : m.pair.a)]];
+			m_IslandManifolds[island.firstManifold + island.numManifolds++] = i;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		if (!IsStatic(i) && islandOfRoot[FindRoot(i)] >= 0) {
+			Island& island = m_Islands[islandOfRoot[FindRoot(i)]];
+			m_IslandBodies[island.firstBody + island.numBodies++] = i;
+		}
+	}
+
+	/* Largest first, so a big pile starts solving while the small islands fill in around it */
+	std::stable_sort(m_Islands.begin(), m_Islands.end(), [](const Island& a, const Island& b) { return a.numConstraints > b.numConstraints; });
+
+	m_Stats.numContacts = numContacts;
+	m_Stats.numIslands = (int)m_Islands.size();
+	m_Stats.largestIsland = 0;
+	for (const Island& island : m_Islands) {
+		m_Stats.largestIsland = std::max(m_Stats.largestIsland, island.numBodies);
+	}
+}
+
+void PhysicsWorld::SetUpIsland(const Island& island) {
+	ContactConstraint* constraints = m_Constraints.data() + island.firstConstraint;
+	int n = 0;
+	for (int m = 0; m < island.numManifolds; m++) {
+		PairManifold& pm = m_Manifolds[m_IslandManifolds[island.firstManifold + m]];
+		const int a = pm.pair.a, b = pm.pair.b;
+		const glm::mat3 inverseInertiaA = LoadSymmetric(m_InverseInertiaWorld, a);
+		const glm::mat3 inverseInertiaB = LoadSymmetric(m_InverseInertiaWorld, b);
+		const float inverseMass = m_InverseMass[a] + m_InverseMass[b];
+		for (int p = 0; p < pm.manifold.GetNumPoints(); p++) {
+			ContactPoint& point = pm.manifold.GetPoint(p);
+			ContactConstraint& c = constraints[n++];
+			c.a = a;
+			c.b = b;
+			c.point = &point;
+			glm::vec3 contact = 0.5f * (point.pointA + point.pointB);
+			c.rA = contact - GetPosition(a);
+			c.rB = contact - GetPosition(b);
+			c.normal = point.normal;
+			TangentBasis(c.normal, c.tangent[0], c.tangent[1]);
+			const glm::vec3 directions[3] = { c.normal, c.tangent[0], c.tangent[1] };
+			float masses[3];
+			for (int d = 0; d < 3; d++) {
+				c.angularA[d] = inverseInertiaA * glm::cross(c.rA, directions[d]);
+				c.angularB[d] = inverseInertiaB * glm::cross(c.rB, directions[d]);
+				float k = inverseMass + glm::dot(glm::cross(c.angularA[d], c.rA) + glm::cross(c.angularB[d], c.rB), directions[d]);
+				masses[d] = k > 0.0f ? 1.0f / k : 0.0f;
+			}
+			c.normalMass = masses[0];
+			c.tangentMass[0] = masses[1];
+			c.tangentMass[1] = masses[2];
+			c.friction = std::sqrt(m_Friction[a] * m_Friction[b]);
+		}
+	}
+}
+
+void PhysicsWorld::SolveIsland(const Island& island, float dt) {
+	ContactConstraint* constraints = m_Constraints.data() + island.firstConstraint;
+	glm::vec3* v = m_LinearVelocity.data();
+	glm::vec3* w = m_AngularVelocity.data();
+
+	/* Static bodies are shared between islands, so only dynamic bodies are ever written */
+	auto applyTo = [&](glm::vec3* v, glm::vec3* w, const ContactConstraint& c, int direction, const glm::vec3& impulse, float amount) {
+		if (m_InverseMass[c.a] != 0.0f) {
+			v[c.a] -= m_InverseMass[c.a] * impulse;
+			w[c.a] -= c.angularA[direction] * amount;
+		}
+		if (m_InverseMass[c.b] != 0.0f) {
+			v[c.b] += m_InverseMass[c.b] * impulse;
+			w[c.b] += c.angularB[direction] * amount;
+		}
+	};
+	auto apply = [&](const ContactConstraint& c, int direction, const glm::vec3& impulse, float amount) {
+		applyTo(v, w, c, direction, impulse, amount);
+	};
+
+	/* Measure every point at the current poses and apply the last substep's impulses */
+	for (int k = 0; k < island.numConstraints; k++) {
+		ContactConstraint& c = constraints[k];
+		const ContactPoint& point = *c.point;
+		glm::vec3 pointA = GetPosition(c.a) + GetRotation(c.a) * point.localA;
+		glm::vec3 pointB = GetPosition(c.b) + GetRotation(c.b) * point.localB;
+		float depth = glm::dot(pointA - pointB, c.normal);
+
+		/*
+			Apart: allow closing the gap this substep (speculative contact). Overlapping: push out a share of the depth,
+			but with pseudo velocities that are dropped after the substep (split impulse); pushing with the real velocity
+			turns the penetration into a spring with no damping, and a tall stack sways on it until it falls over
+		*/
+		c.bias = std::min(depth, 0.0f) / dt;
+		c.positionBias = m_Settings.baumgarte / dt * (depth - m_Settings.allowedPenetration);
+		c.positionImpulse = 0.0f;
+
+		apply(c, 0, c.normal * point.normalImpulse, point.normalImpulse);
+		for (int t = 0; t < 2; t++) {
+			apply(c, 1 + t, c.tangent[t] * point.tangentImpulse[t], point.tangentImpulse[t]);
+		}
+	}
+
+	/*
+		Each iteration separates the points with the pseudo velocities, then solves every normal and after them all
+		the friction, so the friction limits come from settled normal impulses. The sweeps alternate direction, so
+		neither end of a stack always goes first.
+	*/
+	glm::vec3* pv = m_PseudoLinearVelocity.data();
+	glm::vec3* pw = m_PseudoAngularVelocity.data();
+	for (int iteration = 0; iteration < m_Settings.velocityIterations; iteration++) {
+		const bool backwards = iteration % 2 != 0;
+		for (int k = 0; k < island.numConstraints; k++) {
+			ContactConstraint& c = constraints[backwards ? island.numConstraints - 1 - k : k];
+			glm::vec3 dv = pv[c.b] + glm::cross(pw[c.b], c.rB) - pv[c.a] - glm::cross(pw[c.a], c.rA);
+			float lambda = (c.positionBias - glm::dot(dv, c.normal)) * c.normalMass;
+			float accumulated = std::max(c.positionImpulse + lambda, 0.0f);
+			lambda = accumulated - c.positionImpulse;
+			c.positionImpulse = accumulated;
+			applyTo(pv, pw, c, 0, c.normal * lambda, lambda);
+		}
+		for (int k = 0; k < island.numConstraints; k++) {
+			ContactConstraint& c = constraints[backwards ? island.numConstraints - 1 - k : k];
+			ContactPoint& point = *c.point;
+			glm::vec3 dv = v[c.b] + glm::cross(w[c.b], c.rB) - v[c.a] - glm::cross(w[c.a], c.rA);
+			float lambda = (c.bias - glm::dot(dv, c.normal)) * c.normalMass;
+			float accumulated = std::max(point.normalImpulse + lambda, 0.0f);
+			lambda = accumulated - point.normalImpulse;
+			point.normalImpulse = accumulated;
+			apply(c, 0, c.normal * lambda, lambda);
+		}
+		for (int k = 0; k < island.numConstraints; k++) {
+			ContactConstraint& c = constraints[backwards ? island.numConstraints - 1 - k : k];
+			ContactPoint& point = *c.point;
+			const float limit = c.friction * point.normalImpulse;
+			for (int t = 0; t < 2; t++) {
+				glm::vec3 dv = v[c.b] + glm::cross(w[c.b], c.rB) - v[c.a] - glm::cross(w[c.a], c.rA);
+				float lambda = -glm::dot(dv, c.tangent[t]) * c.tangentMass[t];
+				float accumulated = glm::clamp(point.tangentImpulse[t] + lambda, -limit, limit);
+				lambda = accumulated - point.tangentImpulse[t];
+				point.tangentImpulse[t] = accumulated;
+				apply(c, 1 + t, c.tangent[t] * lambda, lambda);
+			}
+		}
+	}
+}
+
+void PhysicsWorld::Integrate(float dt, ThreadPool* pool) {
+	ThreadPool::RunTasks(pool, NumBlocks(GetNumBodies()), [&](int block) {
+		const int begin = block * BLOCK_SIZE, end = BlockEnd(block, GetNumBodies());
+		for (int i = begin; i < end; i++) {
+			float inverseMass = m_InverseMass[i];
+			if (inverseMass == 0.0f) {
+				continue;
+			}
+			const glm::vec3 v = m_LinearVelocity[i], w = m_AngularVelocity[i];
+			const glm::vec3 moveV = v + m_PseudoLinearVelocity[i], moveW = w + m_PseudoAngularVelocity[i];
+			glm::quat q = GetRotation(i);
+
+			/* Momentum from the solved velocities, with the inertia at the rotation they were solved for */
+			glm::mat3 R = glm::mat3_cast(q);
+			glm::vec3 L = R * (LoadSymmetric(m_Inertia, i) * (glm::transpose(R) * w));
+			for (int axis = 0; axis < 3; axis++) {
+				m_Momentum[axis][i] = v[axis] / inverseMass;
+				m_AngularMomentum[axis][i] = L[axis];
+				m_Position[axis][i] += moveV[axis] * dt;
+			}
+
+			q = glm::normalize(q + glm::quat(0.0f, moveW.x, moveW.y, moveW.z) * q * (0.5f * dt));
+			m_Rotation[0][i] = q.x; m_Rotation[1][i] = q.y; m_Rotation[2][i] = q.z; m_Rotation[3][i] = q.w;
+		}
+		UpdateWorldInertia(begin, end);
+	});
+}
+
+void PhysicsWorld::UpdateWorldInertia(int begin, int end) {
+	for (int i = begin; i < end; i++) {
+		glm::mat3 R = glm::mat3_cast(GetRotation(i));
+		StoreSymmetric(m_InverseInertiaWorld, i, R * LoadSymmetric(m_InverseInertia, i) * glm::transpose(R));
+	}
+}
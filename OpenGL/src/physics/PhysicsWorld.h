@@ -0,0 +1,169 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include "geometry/TransformBatch.h"
+#include "physics/BroadPhase.h"
+#include "physics/NarrowPhase.h"
+
+class ThreadPool;
+
+/* Shape, mass and initial state of a body added to a PhysicsWorld */
+struct BodyDesc {
+	ConvexShape shape; //Centred on the centre of mass; its position and rotation are the initial pose
+	float mass = 0.0f; //0 for a static body
+	glm::mat3 inertia = glm::mat3(0.0f); //Body space, about the centre of mass
+	glm::vec3 linearVelocity = glm::vec3(0.0f), angularVelocity = glm::vec3(0.0f);
+	float friction = 0.5f;
+	glm::vec3 scale = glm::vec3(1.0f); //Instance scale for rendering
+
+	/* Solid bodies of uniform density; a density of 0 makes them static. Box scales suit the unit cube mesh */
+	static BodyDesc Box(const glm::vec3& halfExtents, float density, const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	static BodyDesc Sphere(float radius, float density, const glm::vec3& position);
+};
+
+/*
+	Rigid body simulation at a fixed time step. Body state lives in one array per component (positions, rotation
+	quaternions, linear and angular momentum, inverse inertia in world space), so the per-body stages stream through
+	memory and the positions and rotations can be handed to Mesh::UpdateInstances as a TransformBatch with no copy.
+
+	Each step finds contacts (broad phase, then a persistent ContactManifold per overlapping pair), splits the bodies
+	into islands of bodies joined by contacts, and then runs a few substeps, each applying gravity, solving every
+	island with sequential impulses (Catto 2005) and integrating. The contacts are found once per step and their
+	depths follow the bodies through the substeps; short substeps hold a tall stack far better than the same number
+	of iterations in one long step. The impulses are warm started from those cached in the manifolds, and
+	penetration is pushed out with pseudo velocities that move the bodies but are never kept (split impulse), so
+	resolving it adds no energy. Islands share no bodies, so they are solved in parallel, largest first; static
+	bodies touch many islands but are never written. Each island is solved serially and everything else is per body
+	or per pair, so the results do not depend on the number of threads.
+
+	Momentum rather than velocity is integrated, so the angular velocity follows the rotation of the inertia tensor.
+*/
+class PhysicsWorld {
+public:
+	struct Settings {
+		float timeStep = 1.0f / 60.0f;
+		int maxSteps = 4; //Per Update; time beyond that is dropped rather than caught up on
+		glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+		int substeps = 4; //Solver passes per step, all with the contacts found at the start of the step
+		int velocityIterations = 4; //Per substep
+		float baumgarte = 0.2f; //Share of the penetration removed per substep
+		float allowedPenetration = 0.005f;
+		float contactDistance = 0.02f; //Bounds margin and manifold breaking distance; closer pairs get speculative contacts
+		int perturbations = 4; //See ContactManifold::Update
+		BroadPhase::Type broadPhase = BroadPhase::Type::SweepAndPrune;
+	};
+
+	/* Counters and stage times of the last step */
+	struct StepStats {
+		int numPairs = 0; //Broad phase pairs with at least one dynamic body
+		int numContacts = 0; //Contact points
+		int numIslands = 0; //Islands with contacts
+		int largestIsland = 0; //Bodies
+		float broadPhaseMs = 0.0f, narrowPhaseMs = 0.0f;
+		float solveMs = 0.0f; //Building the islands and solving them in every substep
+		float integrateMs = 0.0f; //Gravity and integration in every substep
+	};
+
+	PhysicsWorld();
+	explicit PhysicsWorld(const Settings& settings);
+
+	/* Returns the index of the body, which stays the same until Clear */
+	int AddBody(const BodyDesc& desc);
+	void Clear();
+
+	/* Runs as many fixed steps as fit in the time passed, carrying the remainder over; returns the steps taken */
+	int Update(float deltaTime, ThreadPool* pool = nullptr);
+	void Step(ThreadPool* pool = nullptr);
+
+	void SetBroadPhase(BroadPhase::Type type);
+	inline const Settings& GetSettings() const { return m_Settings; }
+	inline const StepStats& GetStepStats() const { return m_Stats; }
+
+	inline int GetNumBodies() const { return (int)m_Shapes.size(); }
+	inline bool IsStatic(int body) const { return m_InverseMass[body] == 0.0f; }
+	inline glm::vec3 GetPosition(int body) const { return glm::vec3(m_Position[0][body], m_Position[1][body], m_Position[2][body]); }
+	inline glm::quat GetRotation(int body) const {
+		return glm::quat(m_Rotation[3][body], m_Rotation[0][body], m_Rotation[1][body], m_Rotation[2][body]);
+	}
+	glm::vec3 GetLinearVelocity(int body) const;
+	glm::vec3 GetAngularVelocity(int body) const;
+	/* Shape placed at the body's current pose */
+	ConvexShape GetShape(int body) const;
+
+	/* Positions, rotations and render scales of count bodies from first, pointing straight into the state arrays */
+	TransformBatch GetTransforms(int first, int count) const;
+	TransformBatch GetTransforms() const { return GetTransforms(0, GetNumBodies()); }
+
+private:
+	/* Contact manifold of one broad phase pair, kept while the pair's bounds overlap */
+	struct PairManifold {
+		BodyPair pair;
+		ContactManifold manifold;
+	};
+
+	/* Solver data of one contact point, built each step */
+	struct ContactConstraint {
+		int a, b; //Bodies
+		ContactPoint* point; //In the manifold, for the cached impulses
+		glm::vec3 rA, rB; //From the centres of mass to the contact
+		glm::vec3 normal, tangent[2];
+		glm::vec3 angularA[3], angularB[3]; //Inverse world inertia times r x direction, for the normal and both tangents
+		float normalMass, tangentMass[2];
+		float bias; //Normal velocity to reach
+		float positionBias; //Separating pseudo velocity that removes a share of the penetration
+		float positionImpulse; //Accumulated over one substep only
+		float friction;
+	};
+
+	/* Bodies and manifolds of one island, as ranges of m_IslandBodies and m_IslandManifolds */
+	struct Island {
+		int firstBody, numBodies;
+		int firstManifold, numManifolds;
+		int firstConstraint, numConstraints;
+	};
+
+	Settings m_Settings;
+	float m_Accumulator = 0.0f;
+
+	/* Per body state, one array per component */
+	std::vector<float> m_Position[3];
+	std::vector<float> m_Rotation[4]; //x, y, z, w as in TransformBatch
+	std::vector<float> m_Momentum[3];
+	std::vector<float> m_AngularMomentum[3];
+	std::vector<float> m_InverseMass;
+	std::vector<float> m_Inertia[6]; //Body space, symmetric: xx, yy, zz, xy, xz, yz
+	std::vector<float> m_InverseInertia[6]; //Body space, the same layout
+	std::vector<float> m_InverseInertiaWorld[6]; //Rotated into world space every step
+	std::vector<float> m_Friction;
+	std::vector<float> m_Scale[3];
+	std::vector<ConvexShape> m_Shapes; //In body space
+	std::vector<glm::vec3> m_BoundsCentre, m_BoundsHalfExtents; //Body space bounds of each shape
+
+	/* Per step scratch */
+	std::vector<glm::vec3> m_LinearVelocity, m_AngularVelocity;
+	std::vector<glm::vec3> m_PseudoLinearVelocity, m_PseudoAngularVelocity; //Move the bodies for one substep, never kept as momentum
+	BoundsArrays m_Bounds;
+	std::unique_ptr<BroadPhase> m_BroadPhase;
+	std::vector<BodyPair> m_Pairs;
+	std::vector<PairManifold> m_Manifolds, m_PreviousManifolds; //Sorted by pair
+	std::vector<int> m_Parents; //Union-find forest over the bodies
+	std::vector<int> m_IslandBodies, m_IslandManifolds;
+	std::vector<Island> m_Islands; //Largest first
+	std::vector<ContactConstraint> m_Constraints;
+
+	StepStats m_Stats;
+
+	void ApplyGravity(float dt, ThreadPool* pool);
+	void FindContacts(ThreadPool* pool);
+	void BuildIslands();
+	void SetUpIsland(const Island& island);
+	void SolveIsland(const Island& island, float dt);
+	void Integrate(float dt, ThreadPool* pool);
+	void UpdateWorldInertia(int begin, int end);
+	int FindRoot(int body);
+};
@@ -18,10 +18,12 @@ namespace Test {
 		virtual void OnImGuiRender() {}
 		void SetCamera(Camera* camera) { m_Camera = camera; }
 		void SetScreenSize(int width, int height) { m_Width = width; m_Height = height; }
+		void SetCursorPosition(float x, float y) { m_CursorX = x; m_CursorY = y; } //Window pixels, origin at the top left
 		
 	protected:
 		Camera* m_Camera;
 		int m_Width, m_Height;
+		float m_CursorX = 0.0f, m_CursorY = 0.0f;
 	};
 
 
@@ -0,0 +1,70 @@
+#include "TestBenchmark.h"
+
+#include "Renderer.h"
+#include "benchmarks/Benchmark.h"
+#include "checks/Check.h"
+
+#include "imgui/imgui.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace Test {
+
+	TestBenchmark::TestBenchmark() {
+		RegisterBenchmark("Self checks", [](std::ostream& out) { Check::RunAll(out); });
+		RegisterBenchmark("Mesh adjacency", Benchmark::RunAdjacency);
+		RegisterBenchmark("OBJ parsing", Benchmark::RunObjParsing);
+		RegisterBenchmark("OBJ parsing thread scaling", Benchmark::RunObjScaling);
+		RegisterBenchmark("Cooked mesh cache", Benchmark::RunMeshCache);
+		RegisterBenchmark("Vertex formats", Benchmark::RunVertexFormats);
+		RegisterBenchmark("Instance transform batch", Benchmark::RunTransformBatch);
+		RegisterBenchmark("Mass properties", Benchmark::RunMassProperties);
+		RegisterBenchmark("Kallay accumulation", Benchmark::RunKallay);
+		RegisterBenchmark("Broad phase scaling", Benchmark::RunBroadPhase);
+		RegisterBenchmark("GJK/EPA narrow phase", Benchmark::RunNarrowPhase);
+		RegisterBenchmark("Rigid body world", Benchmark::RunRigidBodies);
+		RegisterBenchmark("Particle pool", Benchmark::RunParticlePool);
+		RegisterBenchmark("Particle kernels and thread scaling", Benchmark::RunParticleKernels);
+		RegisterBenchmark("Particle depth sort", Benchmark::RunParticleSort);
+		RegisterBenchmark("Particle spatial hash grid", Benchmark::RunParticleGrid);
+		RegisterBenchmark("Particle CPU and GPU backends", Benchmark::RunParticleBackends);
+		RegisterBenchmark("Winding number BVH build", Benchmark::RunWindingNumberBuild);
+		RegisterBenchmark("Winding number queries", Benchmark::RunWindingNumberQueries);
+		RegisterBenchmark("Mesh ray casting", Benchmark::RunRayCasting);
+		RegisterBenchmark("Packet ray-triangle kernels", Benchmark::RunIntersectKernels);
+		RegisterBenchmark("Mouse picking", Benchmark::RunPicking);
+		RegisterBenchmark("PCA and oriented bounds", Benchmark::RunSpatialProperties);
+		RegisterBenchmark("Signed distance field baking", Benchmark::RunSignedDistanceField);
+		RegisterBenchmark("Quickhull convex hulls", Benchmark::RunConvexHull);
+	}
+
+	TestBenchmark::~TestBenchmark() {
+	}
+
+	void TestBenchmark::OnRender() {
+		GLCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
+		GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+	}
+
+	void TestBenchmark::OnImGuiRender() {
+		for (auto& benchmark : m_Benchmarks) {
+			if (ImGui::Button(benchmark.first.c_str())) {
+				std::ostringstream report;
+				report << "== " << benchmark.first << " ==" << std::endl;
+				benchmark.second(report);
+				std::cout << report.str();
+				m_Output += report.str();
+			}
+		}
+
+		if (ImGui::Button("Clear")) {
+			m_Output.clear();
+		}
+
+		ImGui::BeginChild("benchmark output", ImVec2(0, 0), true);
+		ImGui::TextUnformatted(m_Output.c_str());
+		ImGui::EndChild();
+	}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Test.h"
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Test {
+
+	/* Lists the self checks (checks/Check.h) and the benchmarks from benchmarks/Benchmark.h; each button runs one and appends its report to the panel (and stdout) */
+	class TestBenchmark : public Test {
+	public:
+		TestBenchmark();
+		~TestBenchmark();
+
+		void OnRender() override;
+		void OnImGuiRender() override;
+
+	private:
+		std::vector<std::pair<std::string, std::function<void(std::ostream&)>>> m_Benchmarks;
+		std::string m_Output;
+
+		void RegisterBenchmark(const std::string& name, std::function<void(std::ostream&)> benchmark) {
+			m_Benchmarks.push_back(std::make_pair(name, benchmark));
+		}
+	};
+
+}
@@ -12,57 +12,16 @@
 
 #include <algorithm>
 
+#include "StreamingBuffer.h"
+#include "util/ThreadPool.h"
+
 
 namespace Test {
 	double lastTime = glfwGetTime();
 
-	// CPU representation of a particle
-	struct Particle {
-		glm::vec3 pos, speed;
-		unsigned char r, g, b, a; // Color
-		float size, angle, weight;
-		float life; // Remaining life of the particle. if < 0 : dead and unused.
-		float cameradistance; // *Squared* distance to the camera. if dead : -1.0f
-
-		bool operator<(const Particle& that) const {
-			// Sort in reverse order : far particles drawn first.
-			return this->cameradistance > that.cameradistance;
-		}
-	};
-
-	const int MaxParticles = 100;
-	Particle ParticlesContainer[MaxParticles];
-
-	int LastUsedParticle = 0;
-
-	int ParticlesCount = 0;
-
-	static GLfloat* g_particule_position_size_data = new GLfloat[MaxParticles * 4];
-	static GLubyte* g_particule_color_data = new GLubyte[MaxParticles * 4];
-
-
-	// Finds a Particle in ParticlesContainer which isn't used yet.
-	// (i.e. life < 0);
-	int FindUnusedParticle() {
-
-		for (int i = LastUsedParticle; i < MaxParticles; i++) {
-			if (ParticlesContainer[i].life < 0) {
-				LastUsedParticle = i;
-				return i;
-			}
-		}
-
-		for (int i = 0; i < LastUsedParticle; i++) {
-			if (ParticlesContainer[i].life < 0) {
-				LastUsedParticle = i;
-				return i;
-			}
-		}
-
-		return 0; // All particles are taken, override the first one
-	}
-
-
+	/* Particles live for the emitter's lifetime (5 seconds) and are emitted at EMISSION_RATE per second, so about 50000 are alive */
+	const int MaxParticles = 100000;
+	const float EMISSION_RATE = 10000.0f;
 
 
 	TestParticle::TestParticle() : 
@@ -87,9 +46,8 @@ namespace Test {
 		m_MeshPlane->SetColor(0.2f, 0.2f, 0.6f, 1.0f);
 		m_PlaneTexture = std::make_unique<Texture>("res/textures/marble.jpg");
 
-		// VAO for the particles
-		m_VAO = std::make_unique<VertexArray>();
-		m_VAO->Bind();
+		// Simulation, buffers and VAO for the particles
+		m_Particles = ParticleBackend::Create((ParticleBackend::Type)m_BackendType, MaxParticles, &ThreadPool::Global());
 
 		// Load shaders for the scene
 		m_BasicShader = std::make_unique<Shader>("res/shaders/Basic.shader");
@@ -106,10 +64,7 @@ namespace Test {
 	void TestParticle::OnUpdate(float deltaTime) {
 		m_MeshPlane->Update(deltaTime, 100.0f, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
 
-		//Initialize particles
-		InitParticles();
-
-		//Simulate particles and draw them
+		//Simulate particles and stream them to the GPU
 		UpdateParticles(*m_Camera);
 
 	}
@@ -161,14 +116,38 @@ namespace Test {
 			//FS uniforms
 			m_ParticleShader->SetUniform1i("myTextureSampler", 0);
 
-			
-
-			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, ParticlesCount);
+			m_Particles->Draw(*m_ParticleShader);
 
 		}
 	}
 
 	void TestParticle::OnImGuiRender() {
+		const StreamingBuffer::Stats& stats = StreamingBuffer::GetFrameStats();
+		const char* names[ParticleBackend::NUM_TYPES];
+		for (int t = 0; t < ParticleBackend::NUM_TYPES; t++) {
+			names[t] = ParticleBackend::GetName((ParticleBackend::Type)t);
+		}
+		if (ImGui::Combo("Simulation", &m_BackendType, names, ParticleBackend::NUM_TYPES)) {
+			m_Particles = ParticleBackend::Create((ParticleBackend::Type)m_BackendType, MaxParticles, &ThreadPool::Global());
+		}
+		ImGui::Text("%d particles (%.1f MB)", m_Particles->GetCount(), m_Particles->GetMemoryUsage() / (1024.0 * 1024.0));
+
+		if (m_Particles->GetType() == ParticleBackend::Type::CPU) {
+			CpuParticleBackend& cpu = static_cast<CpuParticleBackend&>(*m_Particles);
+			ImGui::Text("Streamed %.1f KB last frame (%s), %u fence waits (%.2f ms)", stats.bytesUploaded / 1024.0,
+				cpu.GetStream().IsPersistent() ? "persistent mapping" : "orphaning", stats.fenceWaits, stats.fenceWaitMs);
+			ImGui::Checkbox("Collisions", &cpu.GetSettings().collisions);
+			if (cpu.GetSettings().collisions) {
+				ImGui::Checkbox("Particle collisions", &cpu.GetCollider().GetSettings().particleCollisions);
+				ImGui::SliderFloat("Restitution", &cpu.GetCollider().GetSettings().restitution, 0.0f, 1.0f);
+				ImGui::Text("%d contacts", cpu.GetCollider().GetNumContacts());
+			}
+			ImGui::Checkbox("Coherent depth sort", &cpu.GetSettings().coherentSort);
+			if (cpu.GetSettings().coherentSort) {
+				const ParticleSorter& sorter = cpu.GetSorter();
+				ImGui::Text(sorter.WasCoherent() ? "Previous order reused, %d particles set aside" : "Sorted all %d particles", sorter.GetNumDisplaced());
+			}
+		}
 	}
 
 	void TestParticle::RenderScene() {
@@ -177,177 +156,16 @@ namespace Test {
 
 	void TestParticle::UpdateParticles(Camera& camera) {
 		double currentTime = glfwGetTime();
-		double delta = currentTime - lastTime;
+		float delta = (float)(currentTime - lastTime);
 		lastTime = currentTime;
 
-		// Generate 10 new particule each millisecond,
-		// but limit this to 16 ms (60 fps), or if you have 1 long frame (1sec),
+		// Emit at a fixed rate, but limit this to 16 ms (60 fps), or if you have 1 long frame (1sec),
 		// newparticles will be huge and the next frame even longer.
-		int newparticles = (int)(delta*10000.0);
-		if (newparticles > (int)(0.016f*10000.0))
-			newparticles = (int)(0.016f*10000.0);
-
-		for (int i = 0; i < newparticles; i++) {
-			int particleIndex = FindUnusedParticle();
-			ParticlesContainer[particleIndex].life = 500.0f; // This particle will live 5 seconds.
-			ParticlesContainer[particleIndex].pos = glm::vec3(0, 0, -20.0f);
-
-			float spread = 1.5f;
-			glm::vec3 maindir = glm::vec3(0.0f, 10.0f, 0.0f);
-			// Very bad way to generate a random direction; 
-			// See for instance http://stackoverflow.com/questions/5408276/python-uniform-spherical-distribution instead,
-			// combined with some user-controlled parameters (main direction, spread, etc)
-			glm::vec3 randomdir = glm::vec3(
-				(rand() % 2000 - 1000.0f) / 1000.0f,
-				(rand() % 2000 - 1000.0f) / 1000.0f,
-				(rand() % 2000 - 1000.0f) / 1000.0f
-			);
-
-			ParticlesContainer[particleIndex].speed = maindir + randomdir * spread;
-
-
-			// Very bad way to generate a random color
-			ParticlesContainer[particleIndex].r = rand() % 256;
-			ParticlesContainer[particleIndex].g = rand() % 256;
-			ParticlesContainer[particleIndex].b = rand() % 256;
-			ParticlesContainer[particleIndex].a = (rand() % 256) / 3;
-
-			ParticlesContainer[particleIndex].size = (rand() % 1000) / 2000.0f + 0.1f;
-
-		}
-
-
-
-		// Simulate all particles
-		for (int i = 0; i < MaxParticles; i++) {
-
-			Particle& p = ParticlesContainer[i]; // shortcut
-
-			if (p.life > 0.0f) {
-
-				// Decrease life
-				p.life -= delta;
-				if (p.life > 0.0f) {
-
-					// Simulate simple physics : gravity only, no collisions
-					p.speed += glm::vec3(0.0f, -9.81f, 0.0f) * (float)delta * 0.5f;
-					p.pos += p.speed * (float)delta;
-					p.cameradistance = glm::length(p.pos - camera.Position);
-					//ParticlesContainer[i].pos += glm::vec3(0.0f,10.0f, 0.0f) * (float)delta;
-
-					// Fill the GPU buffer
-					g_particule_position_size_data[4 * ParticlesCount + 0] = p.pos.x;
-					g_particule_position_size_data[4 * ParticlesCount + 1] = p.pos.y;
-					g_particule_position_size_data[4 * ParticlesCount + 2] = p.pos.z;
-
-					g_particule_position_size_data[4 * ParticlesCount + 3] = p.size;
-
-					g_particule_color_data[4 * ParticlesCount + 0] = p.r;
-					g_particule_color_data[4 * ParticlesCount + 1] = p.g;
-					g_particule_color_data[4 * ParticlesCount + 2] = p.b;
-					g_particule_color_data[4 * ParticlesCount + 3] = p.a;
-
-				} else {
-					// Particles that just died will be put at the end of the buffer in SortParticles();
-					p.cameradistance = -1.0f;
-				}
-
-				ParticlesCount++;
-
-			}
-		}
-
-		std::sort(&ParticlesContainer[0], &ParticlesContainer[MaxParticles]);
-	}
+		int newparticles = (int)(delta * EMISSION_RATE);
+		if (newparticles > (int)(0.016f * EMISSION_RATE))
+			newparticles = (int)(0.016f * EMISSION_RATE);
 
-	void TestParticle::InitParticles() {
-		m_VAO->Bind();
-		
-
-
-		// The VBO containing the 4 vertices of the particles.
-		// Thanks to instancing, they will be shared by all particles.
-		static const GLfloat g_vertex_buffer_data[] = {
-		 -0.5f, -0.5f, 0.0f,
-		 0.5f, -0.5f, 0.0f,
-		 -0.5f, 0.5f, 0.0f,
-		 0.5f, 0.5f, 0.0f,
-		};
-		GLuint billboard_vertex_buffer;
-		glGenBuffers(1, &billboard_vertex_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, billboard_vertex_buffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(g_vertex_buffer_data), g_vertex_buffer_data, GL_STATIC_DRAW);
-
-		// The VBO containing the positions and sizes of the particles
-		GLuint particles_position_buffer;
-		glGenBuffers(1, &particles_position_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, particles_position_buffer);
-		// Initialize with empty (NULL) buffer : it will be updated later, each frame.
-		glBufferData(GL_ARRAY_BUFFER, MaxParticles * 4 * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
-
-		// The VBO containing the colors of the particles
-		GLuint particles_color_buffer;
-		glGenBuffers(1, &particles_color_buffer);
-		glBindBuffer(GL_ARRAY_BUFFER, particles_color_buffer);
-		// Initialize with empty (NULL) buffer : it will be updated later, each frame.
-		glBufferData(GL_ARRAY_BUFFER, MaxParticles * 4 * sizeof(GLubyte), NULL, GL_STREAM_DRAW);
-
-		// Update the buffers that OpenGL uses for rendering.
-		// There are much more sophisticated means to stream data from the CPU to the GPU,
-		// but this is outside the scope of this tutorial.
-		// http://www.opengl.org/wiki/Buffer_Object_Streaming
-
-		glBindBuffer(GL_ARRAY_BUFFER, particles_position_buffer);
-		glBufferData(GL_ARRAY_BUFFER, MaxParticles * 4 * sizeof(GLfloat), NULL, GL_STREAM_DRAW); // Buffer orphaning, a common way to improve streaming perf. See above link for details.
-		glBufferSubData(GL_ARRAY_BUFFER, 0, ParticlesCount * sizeof(GLfloat) * 4, g_particule_position_size_data);
-
-		glBindBuffer(GL_ARRAY_BUFFER, particles_color_buffer);
-		glBufferData(GL_ARRAY_BUFFER, MaxParticles * 4 * sizeof(GLubyte), NULL, GL_STREAM_DRAW); // Buffer orphaning, a common way to improve streaming perf. See above link for details.
-		glBufferSubData(GL_ARRAY_BUFFER, 0, ParticlesCount * sizeof(GLubyte) * 4, g_particule_color_data);
-
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, billboard_vertex_buffer);
-		glVertexAttribPointer(
-			0, // attribute. No particular reason for 0, but must match the layout in the shader.
-			3, // size
-			GL_FLOAT, // type
-			GL_FALSE, // normalized?
-			0, // stride
-			(void*)0 // array buffer offset
-		);
-
-		// 2nd attribute buffer : positions of particles' centers
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, particles_position_buffer);
-		glVertexAttribPointer(
-			1, // attribute. No particular reason for 1, but must match the layout in the shader.
-			4, // size : x + y + z + size => 4
-			GL_FLOAT, // type
-			GL_FALSE, // normalized?
-			0, // stride
-			(void*)0 // array buffer offset
-		);
-
-		// 3rd attribute buffer : particles' colors
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, particles_color_buffer);
-		glVertexAttribPointer(
-			2, // attribute. No particular reason for 1, but must match the layout in the shader.
-			4, // size : r + g + b + a => 4
-			GL_UNSIGNED_BYTE, // type
-			GL_TRUE, // normalized? *** YES, this means that the unsigned char[4] will be accessible with a vec4 (floats) in the shader ***
-			0, // stride
-			(void*)0 // array buffer offset
-		);
-
-		// These functions are specific to glDrawArrays*Instanced*.
-		// The first parameter is the attribute buffer we're talking about.
-		// The second parameter is the "rate at which generic vertex attributes advance when rendering multiple instances"
-		// http://www.opengl.org/sdk/docs/man/xhtml/glVertexAttribDivisor.xml
-		glVertexAttribDivisor(0, 0); // particles vertices : always reuse the same 4 vertices -> 0
-		glVertexAttribDivisor(1, 1); // positions : one per quad (its center) -> 1
-		glVertexAttribDivisor(2, 1); // color : one per quad -> 1
+		// Spawn and simulate the particles; the CPU backend also collides and depth sorts them and streams them to the GPU
+		m_Particles->Update(delta, m_Emitter, newparticles, camera.Position);
 	}
-}
\ No newline at end of file
+}
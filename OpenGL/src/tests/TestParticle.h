@@ -7,6 +7,7 @@
 #include "Texture.h"
 
 #include "Camera.h"
+#include "particles/ParticleBackend.h"
 
 namespace Test {
 
@@ -21,7 +22,6 @@ namespace Test {
 		void RenderScene();
 
 		void UpdateParticles(Camera & camera);
-		void InitParticles();
 
 	private:
 		int m_ShadowResolution = 1;
@@ -29,8 +29,6 @@ namespace Test {
 		float m_Rotation;
 		
 		std::unique_ptr<Mesh> m_Mesh, m_MeshPlane, m_MeshLight, m_MeshBox;
-		std::unique_ptr<VertexArray> m_VAO;
-		std::unique_ptr<VertexBuffer> m_VertexBuffer;
 		std::unique_ptr<IndexBuffer> m_IndexBuffer;
 		std::unique_ptr<Shader> m_BasicShader, m_Shader, m_DepthShader, m_NormalVisualizingShader, m_DebugDepthQuadShader, m_SimpleShader, m_NormalMappingShader, m_ParticleShader;
 		std::unique_ptr<Texture> m_Texture, m_PlaneTexture, m_LightTexture, m_TextureBrickDiffuse, m_TextureBrickNormal, m_TextureBrickDepth;
@@ -38,6 +36,10 @@ namespace Test {
 		float m_ViewPortWidth, m_ViewPortHeight, m_AspectRatio;
 
 		bool m_NormalVisualizationFlag = false;
+
+		ParticleEmitter m_Emitter;
+		std::unique_ptr<ParticleBackend> m_Particles;
+		int m_BackendType = (int)ParticleBackend::Type::CPU;
 	};
 
 }
\ No newline at end of file
@@ -11,10 +11,12 @@
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <random>
 
 //#include "physics/Inertia.h"
 #include "physics/InertiaTensor.h"
 #include "geometry/Geometry.h"
+#include "util/ThreadPool.h"
 
 namespace Test {
 
@@ -32,6 +34,15 @@ namespace Test {
 
 	};
 
+	/* Time allowed for picking each frame */
+	const float PICK_BUDGET_MS = 1.0f;
+
+	/* Boxes dropped from above the sphere, over a square of this half size, onto a ground slab a little larger */
+	const int NUM_BOXES = 1000;
+	const float BOX_FIELD_HALF_SIZE = 12.0f;
+	const float GROUND_LEVEL = -1.0f; //The sphere rests on it
+	const int FIRST_BOX = 2;
+
 	std::unique_ptr<Mesh> m_Sphere;
 	std::unique_ptr<Mesh> m_Tet;
 	bool m_NormalVisualizationFlag = false;
@@ -39,7 +50,8 @@ namespace Test {
 	TestPhysics::TestPhysics() : 
 		m_Proj(glm::perspective(glm::radians(45.0f), 3.0f / 4.0f, -10.0f, 100.0f)),
 		m_View(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 0.0f))),
-		m_Translation(0.0f, 0.0f, 0.0f), m_LightPosition(0.0f, 2.0f, 0.0f) {
+		m_Translation(0.0f, 0.0f, 0.0f), m_LightPosition(0.0f, 2.0f, 0.0f),
+		m_BroadPhaseType((int)m_World.GetSettings().broadPhase), m_LastTime(glfwGetTime()) {
 
 		GLint m_viewport[4];
 		GLCall(glGetIntegerv(GL_VIEWPORT, m_viewport));
@@ -81,44 +93,41 @@ namespace Test {
 		*/
 
 		m_Mesh = (std::unique_ptr<Mesh>)Mesh::Sphere(Mesh::SphereDivisions::res32, 1);
-		ComputeSpatialProperties(&m_Mesh->GetPositions());
 		//m_Mesh = (std::shared_ptr<Mesh>)Mesh::Tetrahedron(1, A1, A2, A3, A4);
 		RigidBody rb(m_Mesh, 1.0);
 
 
-		{
-			int numFaces = m_Mesh->GetNumFaces();
-			std::vector<unsigned int> inds = m_Mesh->GetIndices();
-			std::vector<float> pos = m_Mesh->GetPositions();
-			int numPoints = m_Mesh->GetNumVertices();
-			
-			//Heap allocate arrays for indices and positions
-			int* ar = NULL;
-			ar = new int[inds.size()];
-			std::copy(inds.begin(), inds.end(), ar);
-
-			HDK_Sample::UT_Vector3T<float>* fv = NULL;
-			fv = new UT_Vector3T<float>[numPoints];
-
-			for (int nIdx = 0; nIdx < numPoints; nIdx++) {
-				float vec[] = { pos[nIdx * 3], pos[nIdx * 3 + 1], pos[nIdx * 3 + 2] };
-				
-				HDK_Sample::UT_Vector3T<float> t(vec);
-				fv[nIdx] = t;
-			}
-
-			mySolidAngleTree.init(m_Mesh->GetNumFaces(), ar, m_Mesh->GetNumVertices(), fv);
-
-			float qpVals[] = { 100.0f, 100.0f, 100.0f };
-			HDK_Sample::UT_Vector3T<float> qp(qpVals);
-			float solidAngle = mySolidAngleTree.computeSolidAngle(qp, 2.0f);
-
-			//Release heap allocated memory in array
-			delete[] ar;
-			ar = NULL; //Clear to prevent use of invalid memory reference
-
-			int iti = 1;
-
+		m_WindingNumbers.Build(m_Mesh->GetPositions(), m_Mesh->GetIndices());
+		m_Picker.AddInstance(m_Mesh->GetBVH(), glm::mat4(1.0f));
+
+		/* The cube mesh spans [-0.5, 0.5], so the render scale of each body is its size */
+		const float groundHalfSize = BOX_FIELD_HALF_SIZE + 4.0f;
+		m_World.AddBody(BodyDesc::Box(glm::vec3(groundHalfSize, 0.5f, groundHalfSize), 0.0f, glm::vec3(0.0f, GROUND_LEVEL - 0.5f, 0.0f)));
+		m_World.AddBody(BodyDesc::Sphere(1.0f, 0.0f, glm::vec3(0.0f)));
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> size(0.1f, 0.4f);
+		std::normal_distribution<float> normal;
+		for (int i = 0; i < NUM_BOXES; i++) {
+			glm::vec3 position(uniform(rng) * BOX_FIELD_HALF_SIZE, 6.0f + 4.0f * uniform(rng), uniform(rng) * BOX_FIELD_HALF_SIZE);
+			glm::quat rotation = glm::normalize(glm::quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+			BodyDesc box = BodyDesc::Box(glm::vec3(size(rng), size(rng), size(rng)), 1.0f, position, rotation);
+			box.angularVelocity = glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+			m_World.AddBody(box);
+		}
+		m_Ground = (std::unique_ptr<Mesh>)Mesh::Cube(1);
+		m_Ground->SetColor(0.4f, 0.4f, 0.4f, 1.0f);
+		m_Ground->UpdateInstances(m_World.GetTransforms(0, 1));
+		m_Boxes = (std::unique_ptr<Mesh>)Mesh::Cube(NUM_BOXES);
+		m_Boxes->SetColor(0.8f, 0.6f, 0.2f, 1.0f);
+		m_Boxes->UpdateInstances(m_World.GetTransforms(FIRST_BOX, NUM_BOXES));
+
+		/* Every box is a pickable instance of the cube's BVH, moved with its body in OnUpdate */
+		m_BoxModels.resize(NUM_BOXES);
+		TransformKernels::BuildMatrices(m_World.GetTransforms(FIRST_BOX, NUM_BOXES), m_BoxModels.data());
+		m_FirstBoxInstance = m_Picker.GetNumInstances();
+		for (const glm::mat4& model : m_BoxModels) {
+			m_Picker.AddInstance(m_Boxes->GetBVH(), model);
 		}
 
 		// Load shaders for the scene
@@ -137,6 +146,18 @@ namespace Test {
 
 	void TestPhysics::OnUpdate(float deltaTime) {
 		m_Mesh->Update(deltaTime, 1.0f, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+		double currentTime = glfwGetTime();
+		m_World.Update((float)(currentTime - m_LastTime), &ThreadPool::Global());
+		m_LastTime = currentTime;
+		m_Boxes->UpdateInstances(m_World.GetTransforms(FIRST_BOX, NUM_BOXES));
+		TransformKernels::BuildMatrices(m_World.GetTransforms(FIRST_BOX, NUM_BOXES), m_BoxModels.data());
+		for (int i = 0; i < NUM_BOXES; i++) {
+			m_Picker.SetTransform(m_FirstBoxInstance + i, m_BoxModels[i]);
+		}
+
+		/* Pick whatever is under the cursor, within a fixed share of the frame */
+		Ray ray = Picker::CursorRay(m_CursorX, m_CursorY, (float)m_Width, (float)m_Height, *m_Camera);
+		m_Picker.Pick(ray, m_PickHit, PICK_BUDGET_MS);
 	}
 
 	enum ProjectionType { ORTHO, PERSPECTIVE };
@@ -176,6 +197,8 @@ namespace Test {
 			m_BasicShader->SetUniform3f("u_LightColor", 0.6f, 0.6f, 0.6f);
 			m_Texture->Bind(0);
 			m_Mesh->Draw(*m_BasicShader);
+			m_Ground->Draw(*m_BasicShader);
+			m_Boxes->Draw(*m_BasicShader);
 			
 			if (m_NormalVisualizationFlag) {
 				/* Set uniforms for the normal visualizing shader */
@@ -193,6 +216,32 @@ namespace Test {
 	void TestPhysics::OnImGuiRender() {
 		ImGui::Checkbox("normal visualization", &m_NormalVisualizationFlag);
 		ImGui::SliderFloat3("light_position", &m_LightPosition.x, -30.0f, 30.0f);
+		const OrientedBox& obb = m_Mesh->GetSpatialProperties().obb;
+		ImGui::Text("oriented bounds: centre (%.3f, %.3f, %.3f), half extents (%.3f, %.3f, %.3f)",
+			obb.center.x, obb.center.y, obb.center.z, obb.halfExtents.x, obb.halfExtents.y, obb.halfExtents.z);
+		const ConvexHull& hull = m_Mesh->GetConvexHull();
+		ImGui::Text("convex hull: %d vertices, %d faces", (int)hull.GetVertices().size(), (int)hull.GetFaces().size());
+
+		/* Switching starts the new broad phase from scratch on the next step */
+		const char* broadPhaseNames[BroadPhase::NUM_TYPES];
+		for (int type = 0; type < BroadPhase::NUM_TYPES; type++) {
+			broadPhaseNames[type] = BroadPhase::GetName((BroadPhase::Type)type);
+		}
+		if (ImGui::Combo("broad phase", &m_BroadPhaseType, broadPhaseNames, BroadPhase::NUM_TYPES)) {
+			m_World.SetBroadPhase((BroadPhase::Type)m_BroadPhaseType);
+		}
+		const PhysicsWorld::StepStats& stats = m_World.GetStepStats();
+		ImGui::Text("%d bodies, %d pairs, %d contacts, %d islands (largest %d)", m_World.GetNumBodies(), stats.numPairs, stats.numContacts,
+			stats.numIslands, stats.largestIsland);
+		ImGui::Text("last step: broad phase %.3f ms, narrow phase %.3f ms, solver %.3f ms, integration %.3f ms",
+			stats.broadPhaseMs, stats.narrowPhaseMs, stats.solveMs, stats.integrateMs);
+
+		if (m_PickHit.instance != Picker::NO_HIT) {
+			ImGui::Text("picked instance %d, face %d at (%.3f, %.3f, %.3f)", m_PickHit.instance, m_PickHit.face,
+				m_PickHit.point.x, m_PickHit.point.y, m_PickHit.point.z);
+		} else {
+			ImGui::Text("picked nothing");
+		}
 	}
 
 	void TestPhysics::RenderScene() {
@@ -7,9 +7,12 @@
 #include "Texture.h"
 
 #include "Camera.h"
-#include "WindingNumber/UT_SolidAngle.h"
+#include "geometry/Picker.h"
+#include "geometry/TransformBatch.h"
+#include "geometry/WindingNumberQuery.h"
+#include "physics/PhysicsWorld.h"
 
-using namespace HDK_Sample;
+#include "glm/gtc/quaternion.hpp"
 
 namespace Test {
 
@@ -26,7 +29,11 @@ namespace Test {
 	private:
 		glm::vec3 m_Translation, m_LightPosition;
 		float m_Rotation;
-		UT_SolidAngle<float, float> mySolidAngleTree;
+		WindingNumberQuery m_WindingNumbers;
+		Picker m_Picker;
+		Picker::Hit m_PickHit;
+		std::vector<glm::mat4> m_BoxModels; //Picker transforms of the boxes, instances m_FirstBoxInstance onwards
+		int m_FirstBoxInstance;
 		std::shared_ptr<Mesh> m_Mesh, m_Arrow;
 		std::unique_ptr<VertexArray> m_VAO;
 		std::unique_ptr<VertexBuffer> m_VertexBuffer;
@@ -36,6 +43,12 @@ namespace Test {
 		glm::mat4 m_Proj, m_View;
 		float m_ViewPortWidth, m_ViewPortHeight, m_AspectRatio;
 
+		/* Boxes dropped onto the sphere and a ground slab; body 0 is the ground, body 1 the sphere, the rest the boxes */
+		PhysicsWorld m_World;
+		std::unique_ptr<Mesh> m_Ground, m_Boxes;
+		int m_BroadPhaseType;
+		double m_LastTime; //OnUpdate is handed the time since start, the world steps by the time since the last frame
+
 	};
 
 }
\ No newline at end of file
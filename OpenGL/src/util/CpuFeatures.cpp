@@ -0,0 +1,62 @@
+#include "CpuFeatures.h"
+
+#if SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if SIMD_X86
+static void CpuId(int leaf, int subleaf, unsigned int registers[4]) {
+#ifdef _MSC_VER
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i < 4; i++) {
+		registers[i] = (unsigned int)values[i];
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+/* XCR0, the register state enabled by the operating system */
+static unsigned long long ReadXcr0() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures::CpuFeatures() {
+#if SIMD_X86
+	unsigned int registers[4];
+	CpuId(0, 0, registers);
+	unsigned int maxLeaf = registers[0];
+
+	CpuId(1, 0, registers);
+	sse2 = (registers[3] & (1u << 26)) != 0;
+	sse41 = (registers[2] & (1u << 19)) != 0;
+	fma = (registers[2] & (1u << 12)) != 0;
+	bool osxsave = (registers[2] & (1u << 27)) != 0;
+	bool avx = (registers[2] & (1u << 28)) != 0;
+
+	/* AVX registers are only usable when the OS saves the XMM and YMM state (XCR0 bits 1 and 2) */
+	bool ymmEnabled = osxsave && avx && (ReadXcr0() & 0x6) == 0x6;
+	if (maxLeaf >= 7 && ymmEnabled) {
+		CpuId(7, 0, registers);
+		avx2 = fma && (registers[1] & (1u << 5)) != 0;
+	}
+	fma = fma && ymmEnabled;
+#endif
+}
+
+const CpuFeatures& CpuFeatures::Get() {
+	static const CpuFeatures features;
+	return features;
+}
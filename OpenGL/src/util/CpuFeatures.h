@@ -0,0 +1,34 @@
+#pragma once
+
+/*
+	Runtime CPU feature detection for the SIMD kernels. Functions using instructions beyond the build's baseline are
+	marked with the TARGET_* macros so that only they are compiled for the wider instruction set; callers check the
+	matching CpuFeatures flag before calling them. MSVC accepts the intrinsics without any per-function attribute.
+*/
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+class CpuFeatures {
+public:
+	bool sse2 = false;
+	bool sse41 = false;
+	bool avx2 = false; //Also requires FMA and OS support for the YMM state
+	bool fma = false;
+
+	/* Detected once on first use */
+	static const CpuFeatures& Get();
+
+private:
+	CpuFeatures();
+};
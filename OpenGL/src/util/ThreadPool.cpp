@@ -0,0 +1,167 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+/* The pool the current thread is working for (if any) and its deque slot in that pool */
+static thread_local ThreadPool* t_Pool = nullptr;
+static thread_local int t_Slot = 0;
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+	if (numThreads == 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 0; i < numThreads; i++) {
+		m_Queues.emplace_back(new Queue());
+	}
+	for (unsigned int i = 1; i < numThreads; i++) {
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, (int)i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_SleepMutex);
+		m_Stop = true;
+	}
+	m_WakeCondition.notify_all();
+	for (std::thread& worker : m_Workers) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Global() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Push(int slot, const Range& range) {
+	{
+		std::lock_guard<std::mutex> lock(m_Queues[slot]->mutex);
+		m_Queues[slot]->ranges.push_back(range);
+	}
+	m_QueuedRanges.fetch_add(1);
+
+	if (m_SleepingWorkers.load() > 0) {
+		/* Taking the lock orders this with a worker that is between checking for work and going to sleep */
+		{ std::lock_guard<std::mutex> lock(m_SleepMutex); }
+		m_WakeCondition.notify_one();
+	}
+}
+
+bool ThreadPool::PopOrSteal(int slot, Range& range) {
+	if (m_QueuedRanges.load() == 0) {
+		return false;
+	}
+
+	int numQueues = (int)m_Queues.size();
+	for (int i = 0; i < numQueues; i++) {
+		int victim = (slot + i) % numQueues;
+		Queue& queue = *m_Queues[victim];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.ranges.empty()) {
+			continue;
+		}
+		if (victim == slot) {
+			range = queue.ranges.back();
+			queue.ranges.pop_back();
+		} else {
+			range = queue.ranges.front();
+			queue.ranges.pop_front();
+		}
+		m_QueuedRanges.fetch_sub(1);
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::Execute(Range range, int slot) {
+	Job* job = range.job;
+	while (range.end - range.begin > job->grainSize) {
+		int middle = range.begin + (range.end - range.begin) / 2;
+		Push(slot, { job, middle, range.end });
+		range.end = middle;
+	}
+
+	(*job->body)(range.begin, range.end);
+
+	/* The job may go out of scope as soon as this brings remaining to zero */
+	job->remaining.fetch_sub(range.end - range.begin);
+}
+
+void ThreadPool::RunJob(Job& job, int begin, int end, int slot) {
+	Execute({ &job, begin, end }, slot);
+
+	/* Help with any queued work until every piece of this job has been processed */
+	Range range;
+	while (job.remaining.load() > 0) {
+		if (PopOrSteal(slot, range)) {
+			Execute(range, slot);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop(int slot) {
+	t_Pool = this;
+	t_Slot = slot;
+
+	Range range;
+	while (true) {
+		if (PopOrSteal(slot, range)) {
+			Execute(range, slot);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_SleepMutex);
+		m_SleepingWorkers.fetch_add(1);
+		m_WakeCondition.wait(lock, [&]() { return m_Stop || m_QueuedRanges.load() > 0; });
+		m_SleepingWorkers.fetch_sub(1);
+		if (m_Stop) {
+			return;
+		}
+	}
+}
+
+void ThreadPool::Run(int numTasks, const std::function<void(int)>& task) {
+	ParallelFor(0, numTasks, 1, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			task(i);
+		}
+	});
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body) {
+	if (end <= begin) {
+		return;
+	}
+	grainSize = std::max(1, grainSize);
+
+	if (m_Workers.empty() || end - begin <= grainSize) {
+		for (int rangeBegin = begin; rangeBegin < end; rangeBegin += grainSize) {
+			body(rangeBegin, std::min(end, rangeBegin + grainSize));
+		}
+		return;
+	}
+
+	Job job;
+	job.body = &body;
+	job.grainSize = grainSize;
+	job.remaining = end - begin;
+
+	if (t_Pool == this) {
+		RunJob(job, begin, end, t_Slot);
+		return;
+	}
+
+	/* Entering from outside the pool: use the shared slot 0 */
+	std::lock_guard<std::mutex> runLock(m_RunMutex);
+	ThreadPool* previousPool = t_Pool;
+	int previousSlot = t_Slot;
+	t_Pool = this;
+	t_Slot = 0;
+	RunJob(job, begin, end, 0);
+	t_Pool = previousPool;
+	t_Slot = previousSlot;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Work-stealing thread pool for data-parallel loops. Every thread owns a deque of index ranges: a thread splits
+	the range it is about to run in halves, pushes the upper halves onto its own deque and keeps the lowest piece,
+	and idle threads steal the oldest (largest) pieces from the other deques. The calling thread works alongside
+	the pool, so a pool of N threads uses N - 1 workers.
+
+	Calls made from inside a task are parallel as well: the nested ranges go onto the calling thread's deque and
+	the thread keeps executing (or stealing) work until its own loop has finished, which makes recursive
+	fork-join algorithms such as BVH construction scale without deadlocking.
+*/
+class ThreadPool {
+public:
+	/* numThreads includes the calling thread; 0 uses every hardware thread */
+	explicit ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline unsigned int GetNumThreads() const { return (unsigned int)m_Workers.size() + 1; }
+
+	/* Calls task(taskIndex) for every taskIndex in [0, numTasks) and blocks until all of them are done */
+	void Run(int numTasks, const std::function<void(int)>& task);
+
+	/* Splits [begin, end) into ranges of at most grainSize elements and calls body(rangeBegin, rangeEnd) for each */
+	void ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body);
+
+	/* Calls task(t) for every t in [0, numTasks), on pool if there is one and more than one task, else serially on this thread */
+	template<typename F>
+	static void RunTasks(ThreadPool* pool, int numTasks, F&& task) {
+		if (pool != nullptr && numTasks > 1) {
+			pool->Run(numTasks, task);
+		} else {
+			for (int t = 0; t < numTasks; t++) {
+				task(t);
+			}
+		}
+	}
+
+	/* Shared pool sized to the machine, created on first use */
+	static ThreadPool& Global();
+
+private:
+	struct Job {
+		const std::function<void(int, int)>* body;
+		int grainSize;
+		std::atomic<int> remaining; //Elements not yet processed
+	};
+
+	struct Range {
+		Job* job;
+		int begin, end;
+	};
+
+	/* Owner pushes and pops at the back, thieves take from the front */
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Range> ranges;
+	};
+
+	std::vector<std::thread> m_Workers;
+	std::vector<std::unique_ptr<Queue>> m_Queues; //Slot 0 belongs to threads calling in from outside the pool
+	std::mutex m_RunMutex; //Serializes calls from different threads outside the pool
+
+	std::mutex m_SleepMutex;
+	std::condition_variable m_WakeCondition;
+	std::atomic<int> m_QueuedRanges{ 0 };
+	std::atomic<int> m_SleepingWorkers{ 0 };
+	bool m_Stop = false;
+
+	void WorkerLoop(int slot);
+	void Execute(Range range, int slot);
+	void Push(int slot, const Range& range);
+	bool PopOrSteal(int slot, Range& range);
+	void RunJob(Job& job, int begin, int end, int slot);
+};